@@ -38,16 +38,23 @@ benchmarks = [
     "test_polygon_clipping.cpp",
     #"test_polygon_clipping_rendering.cpp",
     "test_proj_transform1.cpp",
+    "test_proj_transform2.cpp",
     "test_expression_parse.cpp",
+    "test_expression_eval.cpp",
     "test_face_ptr_creation.cpp",
     "test_font_registration.cpp",
     "test_rendering.cpp",
     "test_rendering_shared_map.cpp",
     "test_offset_converter.cpp",
     "test_marker_cache.cpp",
+    "test_marker_bitmap_cache.cpp",
     "test_quad_tree.cpp",
+    "test_label_collision.cpp",
     "test_noop_rendering.cpp",
     "test_getline.cpp",
+    "test_compositing.cpp",
+    "test_image_filters.cpp",
+    "test_arena.cpp",
 #    "test_numeric_cast_vs_static_cast.cpp",
 ]
 for cpp_test in benchmarks:
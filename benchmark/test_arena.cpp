@@ -0,0 +1,174 @@
+#include "bench_framework.hpp"
+#include <mapnik/util/arena.hpp>
+
+#include <memory>
+#include <vector>
+
+// streamed query: objects of a few sizes are created in batches and
+// released before the next batch, as features are while rendering
+static std::size_t const sizes[] = { 24, 48, 64, 160, 40, 96 };
+
+class test_new : public benchmark::test_case
+{
+public:
+    std::size_t batch_;
+    test_new(mapnik::parameters const& params)
+     : test_case(params),
+       batch_(*params.get<mapnik::value_integer>("batch", 256)) {}
+
+    bool validate() const
+    {
+        return true;
+    }
+
+    bool operator()() const
+    {
+        std::vector<char*> objects(batch_);
+        for (std::size_t i = 0; i < iterations_; ++i)
+        {
+            for (std::size_t j = 0; j < batch_; ++j)
+            {
+                objects[j] = new char[sizes[j % 6]];
+                objects[j][0] = 1;
+            }
+            for (std::size_t j = 0; j < batch_; ++j)
+            {
+                delete [] objects[j];
+            }
+        }
+        return true;
+    }
+};
+
+class test_arena : public benchmark::test_case
+{
+public:
+    std::size_t batch_;
+    test_arena(mapnik::parameters const& params)
+     : test_case(params),
+       batch_(*params.get<mapnik::value_integer>("batch", 256)) {}
+
+    bool validate() const
+    {
+        mapnik::util::arena arena;
+        void * ptr = arena.allocate(48);
+        arena.deallocate(ptr, 48);
+        return arena.allocate(40) == ptr && arena.num_blocks() == 1;
+    }
+
+    bool operator()() const
+    {
+        mapnik::util::arena arena;
+        std::vector<char*> objects(batch_);
+        for (std::size_t i = 0; i < iterations_; ++i)
+        {
+            for (std::size_t j = 0; j < batch_; ++j)
+            {
+                objects[j] = static_cast<char*>(arena.allocate(sizes[j % 6]));
+                objects[j][0] = 1;
+            }
+            for (std::size_t j = 0; j < batch_; ++j)
+            {
+                arena.deallocate(objects[j], sizes[j % 6]);
+            }
+        }
+        return true;
+    }
+};
+
+struct object
+{
+    double x;
+    double y;
+    std::size_t id;
+};
+
+class test_make_shared : public benchmark::test_case
+{
+public:
+    std::size_t batch_;
+    test_make_shared(mapnik::parameters const& params)
+     : test_case(params),
+       batch_(*params.get<mapnik::value_integer>("batch", 256)) {}
+
+    bool validate() const
+    {
+        return true;
+    }
+
+    bool operator()() const
+    {
+        std::vector<std::shared_ptr<object>> objects(batch_);
+        for (std::size_t i = 0; i < iterations_; ++i)
+        {
+            for (std::size_t j = 0; j < batch_; ++j)
+            {
+                objects[j] = std::make_shared<object>();
+            }
+            for (auto & obj : objects) obj.reset();
+        }
+        return true;
+    }
+};
+
+class test_allocate_shared : public benchmark::test_case
+{
+public:
+    std::size_t batch_;
+    test_allocate_shared(mapnik::parameters const& params)
+     : test_case(params),
+       batch_(*params.get<mapnik::value_integer>("batch", 256)) {}
+
+    bool validate() const
+    {
+        return true;
+    }
+
+    bool operator()() const
+    {
+        auto arena = std::make_shared<mapnik::util::arena>();
+        mapnik::util::arena_allocator<object> alloc(arena);
+        std::vector<std::shared_ptr<object>> objects(batch_);
+        for (std::size_t i = 0; i < iterations_; ++i)
+        {
+            for (std::size_t j = 0; j < batch_; ++j)
+            {
+                objects[j] = std::allocate_shared<object>(alloc);
+            }
+            for (auto & obj : objects) obj.reset();
+        }
+        return true;
+    }
+};
+
+int main(int argc, char** argv)
+{
+    int return_value = 0;
+    try
+    {
+        mapnik::parameters params;
+        benchmark::handle_args(argc,argv,params);
+        {
+            test_new test_runner(params);
+            return_value = return_value | run(test_runner,"new/delete");
+        }
+        {
+            test_arena test_runner(params);
+            return_value = return_value | run(test_runner,"arena");
+        }
+        {
+            test_make_shared test_runner(params);
+            return_value = return_value | run(test_runner,"make_shared");
+        }
+        {
+            test_allocate_shared test_runner(params);
+            return_value = return_value | run(test_runner,"allocate_shared with arena");
+        }
+    }
+    catch (std::exception const& ex)
+    {
+        std::clog << ex.what() << "\n";
+        return -1;
+    }
+    return return_value;
+}
@@ -0,0 +1,89 @@
+#include "bench_framework.hpp"
+#include <mapnik/image.hpp>
+#include <mapnik/image_compositing.hpp>
+#include <mapnik/util/cpu_features.hpp>
+#include <cstring>
+#include <random>
+
+namespace {
+
+mapnik::image_rgba8 make_layer(std::size_t size, unsigned seed)
+{
+    // premultiplied canvas where about half the pixels are transparent
+    mapnik::image_rgba8 im(size, size, true, true);
+    std::mt19937 engine(seed);
+    std::uniform_int_distribution<int> dist(0, 255);
+    std::uint8_t * bytes = im.bytes();
+    for (std::size_t i = 0; i < im.size(); i += 4)
+    {
+        int a = dist(engine) < 128 ? 0 : dist(engine);
+        for (std::size_t c = 0; c < 3; ++c)
+        {
+            bytes[i + c] = static_cast<std::uint8_t>((dist(engine) * a) / 255);
+        }
+        bytes[i + 3] = static_cast<std::uint8_t>(a);
+    }
+    return im;
+}
+
+}
+
+class test : public benchmark::test_case
+{
+    mapnik::composite_mode_e mode_;
+    mapnik::util::simd_level level_;
+    mapnik::image_rgba8 src_;
+    mapnik::image_rgba8 dst_;
+public:
+    test(mapnik::parameters const& params,
+         mapnik::composite_mode_e mode,
+         mapnik::util::simd_level level)
+     : test_case(params),
+       mode_(mode),
+       level_(level),
+       src_(make_layer(512, 1)),
+       dst_(make_layer(512, 2)) {}
+
+    bool validate() const
+    {
+        // vectorized kernels must reproduce the agg blenders exactly
+        mapnik::image_rgba8 expected(dst_);
+        mapnik::util::set_simd_level(mapnik::util::simd_level::none);
+        mapnik::composite(expected, src_, mode_, 0.75f);
+        mapnik::image_rgba8 result(dst_);
+        mapnik::util::set_simd_level(level_);
+        mapnik::composite(result, src_, mode_, 0.75f);
+        mapnik::util::set_simd_level(mapnik::util::detected_simd_level());
+        return std::memcmp(expected.bytes(), result.bytes(), result.size()) == 0;
+    }
+
+    bool operator()() const
+    {
+        mapnik::util::set_simd_level(level_);
+        mapnik::image_rgba8 canvas(dst_);
+        for (std::size_t i = 0; i < iterations_; ++i)
+        {
+            mapnik::composite(canvas, src_, mode_, 1.0f);
+        }
+        mapnik::util::set_simd_level(mapnik::util::detected_simd_level());
+        return true;
+    }
+};
+
+int main(int argc, char** argv)
+{
+    using mapnik::util::simd_level;
+    simd_level best = mapnik::util::detected_simd_level();
+    return benchmark::sequencer(argc, argv)
+        .run<test>("src-over scalar", mapnik::src_over, simd_level::none)
+        .run<test>("src-over vectorized", mapnik::src_over, best)
+        .run<test>("multiply scalar", mapnik::multiply, simd_level::none)
+        .run<test>("multiply vectorized", mapnik::multiply, best)
+        .run<test>("screen scalar", mapnik::screen, simd_level::none)
+        .run<test>("screen vectorized", mapnik::screen, best)
+        .run<test>("dst-out scalar", mapnik::dst_out, simd_level::none)
+        .run<test>("dst-out vectorized", mapnik::dst_out, best)
+        .run<test>("dst-in scalar", mapnik::dst_in, simd_level::none)
+        .run<test>("dst-in vectorized", mapnik::dst_in, best)
+        .done();
+}
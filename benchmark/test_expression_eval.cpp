@@ -0,0 +1,160 @@
+#include "bench_framework.hpp"
+#include <mapnik/unicode.hpp>
+#include <mapnik/attribute.hpp>
+#include <mapnik/expression.hpp>
+#include <mapnik/expression_evaluator.hpp>
+#include <mapnik/expression_program.hpp>
+#include <mapnik/feature.hpp>
+#include <mapnik/feature_factory.hpp>
+
+namespace {
+
+std::vector<std::string> const highways = {
+    "motorway", "motorway_link", "trunk", "trunk_link", "primary", "primary_link",
+    "secondary", "secondary_link", "tertiary", "tertiary_link", "residential",
+    "unclassified", "living_street", "service", "pedestrian", "track", "footway",
+    "cycleway", "path", "steps" };
+
+std::vector<mapnik::expression_ptr> make_filters()
+{
+    std::vector<mapnik::expression_ptr> filters;
+    for (std::string const& highway : highways)
+    {
+        filters.push_back(mapnik::parse_expression(
+            "[highway]='" + highway + "' and ([tunnel]!='yes' or [layer] < 0) and [mapnik::geometry_type]=2"));
+    }
+    return filters;
+}
+
+std::vector<mapnik::feature_ptr> make_features()
+{
+    mapnik::transcoder tr("utf-8");
+    mapnik::context_ptr ctx = std::make_shared<mapnik::context_type>();
+    ctx->push("highway");
+    ctx->push("tunnel");
+    ctx->push("layer");
+    std::vector<mapnik::feature_ptr> features;
+    for (std::size_t i = 0; i < highways.size(); ++i)
+    {
+        mapnik::feature_ptr feature(mapnik::feature_factory::create(ctx, i));
+        feature->put("highway", tr.transcode(highways[i].c_str()));
+        feature->put("tunnel", tr.transcode(i % 3 == 0 ? "yes" : "no"));
+        feature->put("layer", static_cast<mapnik::value_integer>(i % 2));
+        mapnik::geometry::line_string<double> line;
+        line.emplace_back(0, 0);
+        line.emplace_back(1, 1);
+        feature->set_geometry(std::move(line));
+        features.push_back(feature);
+    }
+    return features;
+}
+
+}
+
+class test_tree : public benchmark::test_case
+{
+protected:
+    std::vector<mapnik::expression_ptr> filters_;
+    std::vector<mapnik::feature_ptr> features_;
+    mapnik::attributes vars_;
+public:
+    test_tree(mapnik::parameters const& params)
+     : test_case(params),
+       filters_(make_filters()),
+       features_(make_features()),
+       vars_() {}
+
+    std::size_t count_tree() const
+    {
+        std::size_t count = 0;
+        for (auto const& feature : features_)
+        {
+            for (auto const& filter : filters_)
+            {
+                mapnik::value_type result = mapnik::util::apply_visitor(
+                    mapnik::evaluate<mapnik::feature_impl, mapnik::value_type, mapnik::attributes>(*feature, vars_), *filter);
+                if (result.to_bool()) ++count;
+            }
+        }
+        return count;
+    }
+
+    bool validate() const
+    {
+        return count_tree() > 0;
+    }
+
+    bool operator()() const
+    {
+        for (std::size_t i = 0; i < iterations_; ++i)
+        {
+            count_tree();
+        }
+        return true;
+    }
+};
+
+class test_program : public test_tree
+{
+    std::vector<mapnik::expression_program> programs_;
+public:
+    test_program(mapnik::parameters const& params)
+     : test_tree(params),
+       programs_()
+    {
+        for (auto const& filter : filters_)
+        {
+            programs_.emplace_back(*filter);
+        }
+    }
+
+    std::size_t count_program() const
+    {
+        std::vector<mapnik::value_type> registers;
+        std::size_t count = 0;
+        for (auto const& feature : features_)
+        {
+            for (auto const& program : programs_)
+            {
+                if (program.evaluate(*feature, vars_, registers).to_bool()) ++count;
+            }
+        }
+        return count;
+    }
+
+    bool validate() const
+    {
+        std::size_t expected = count_tree();
+        std::size_t result = count_program();
+        if (expected != result)
+        {
+            std::clog << "compiled filters matched " << result << " != " << expected << "\n";
+        }
+        return expected == result;
+    }
+
+    bool operator()() const
+    {
+        for (std::size_t i = 0; i < iterations_; ++i)
+        {
+            count_program();
+        }
+        return true;
+    }
+};
+
+int main(int argc, char** argv)
+{
+    mapnik::parameters params;
+    benchmark::handle_args(argc,argv,params);
+    int return_value = 0;
+    {
+        test_tree test_runner(params);
+        return_value = return_value | run(test_runner,"expr eval tree");
+    }
+    {
+        test_program test_runner(params);
+        return_value = return_value | run(test_runner,"expr eval compiled");
+    }
+    return return_value;
+}
@@ -0,0 +1,99 @@
+#include "bench_framework.hpp"
+#include <mapnik/image.hpp>
+#include <mapnik/image_filter.hpp>
+#include <mapnik/image_filter_types.hpp>
+#include <mapnik/util/cpu_features.hpp>
+#include <mapnik/util/thread_pool.hpp>
+#include <cstring>
+#include <random>
+
+namespace {
+
+mapnik::image_rgba8 make_layer(std::size_t size, unsigned seed)
+{
+    mapnik::image_rgba8 im(size, size, true, true);
+    std::mt19937 engine(seed);
+    std::uniform_int_distribution<int> dist(0, 255);
+    std::uint8_t * bytes = im.bytes();
+    for (std::size_t i = 0; i < im.size(); i += 4)
+    {
+        int a = dist(engine) < 128 ? 0 : dist(engine);
+        for (std::size_t c = 0; c < 3; ++c)
+        {
+            bytes[i + c] = static_cast<std::uint8_t>((dist(engine) * a) / 255);
+        }
+        bytes[i + 3] = static_cast<std::uint8_t>(a);
+    }
+    return im;
+}
+
+}
+
+class test : public benchmark::test_case
+{
+    mapnik::filter::filter_type filter_;
+    mapnik::util::simd_level level_;
+    mapnik::util::thread_pool * pool_;
+    mapnik::image_rgba8 src_;
+
+    mapnik::image_rgba8 apply(mapnik::util::simd_level level, mapnik::util::thread_pool * pool) const
+    {
+        mapnik::util::set_simd_level(level);
+        mapnik::image_rgba8 im(src_);
+        mapnik::filter::filter_visitor<mapnik::image_rgba8> visitor(im, 1.0, pool);
+        mapnik::util::apply_visitor(visitor, filter_);
+        mapnik::util::set_simd_level(mapnik::util::detected_simd_level());
+        return im;
+    }
+
+public:
+    test(mapnik::parameters const& params,
+         mapnik::filter::filter_type const& filter,
+         mapnik::util::simd_level level,
+         mapnik::util::thread_pool * pool)
+     : test_case(params),
+       filter_(filter),
+       level_(level),
+       pool_(pool),
+       src_(make_layer(1024, 1)) {}
+
+    bool validate() const
+    {
+        // bands and vector kernels must reproduce the scalar filters exactly
+        mapnik::image_rgba8 expected = apply(mapnik::util::simd_level::none, nullptr);
+        mapnik::image_rgba8 result = apply(level_, pool_);
+        return std::memcmp(expected.bytes(), result.bytes(), result.size()) == 0;
+    }
+
+    bool operator()() const
+    {
+        mapnik::util::set_simd_level(level_);
+        mapnik::image_rgba8 im(src_);
+        mapnik::filter::filter_visitor<mapnik::image_rgba8> visitor(im, 1.0, pool_);
+        for (std::size_t i = 0; i < iterations_; ++i)
+        {
+            mapnik::util::apply_visitor(visitor, filter_);
+        }
+        mapnik::util::set_simd_level(mapnik::util::detected_simd_level());
+        return true;
+    }
+};
+
+int main(int argc, char** argv)
+{
+    using mapnik::util::simd_level;
+    namespace filter = mapnik::filter;
+    simd_level best = mapnik::util::detected_simd_level();
+    mapnik::util::thread_pool pool(3);
+    return benchmark::sequencer(argc, argv)
+        .run<test>("agg-stack-blur scalar", filter::agg_stack_blur(8, 8), simd_level::none, nullptr)
+        .run<test>("agg-stack-blur vectorized", filter::agg_stack_blur(8, 8), best, nullptr)
+        .run<test>("agg-stack-blur vectorized, 4 bands", filter::agg_stack_blur(8, 8), best, &pool)
+        .run<test>("blur scalar", filter::blur(), simd_level::none, nullptr)
+        .run<test>("blur vectorized", filter::blur(), best, nullptr)
+        .run<test>("blur vectorized, 4 bands", filter::blur(), best, &pool)
+        .run<test>("sharpen scalar", filter::sharpen(), simd_level::none, nullptr)
+        .run<test>("sharpen vectorized", filter::sharpen(), best, nullptr)
+        .run<test>("sharpen vectorized, 4 bands", filter::sharpen(), best, &pool)
+        .done();
+}
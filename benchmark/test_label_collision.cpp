@@ -0,0 +1,150 @@
+#include "bench_framework.hpp"
+#include <mapnik/label_collision_detector.hpp>
+#include <mapnik/quad_tree.hpp>
+#include <mapnik/unicode.hpp>
+#include <cmath>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace {
+
+// label_collision_detector4 as it was before moving to box_grid
+class quad_tree_detector
+{
+    using label = mapnik::label_collision_detector4::label;
+    using tree_t = mapnik::quad_tree<label>;
+    tree_t tree_;
+public:
+    explicit quad_tree_detector(mapnik::box2d<double> const& extent)
+        : tree_(extent) {}
+
+    bool has_placement(mapnik::box2d<double> const& box, double margin,
+                       mapnik::value_unicode_string const& text, double repeat_distance)
+    {
+        mapnik::box2d<double> repeat_box(box.minx() - repeat_distance, box.miny() - repeat_distance,
+                                         box.maxx() + repeat_distance, box.maxy() + repeat_distance);
+        mapnik::box2d<double> margin_box(box.minx() - margin, box.miny() - margin,
+                                         box.maxx() + margin, box.maxy() + margin);
+        tree_t::query_iterator tree_itr = tree_.query_in_box(repeat_box);
+        tree_t::query_iterator tree_end = tree_.query_end();
+        for ( ;tree_itr != tree_end; ++tree_itr)
+        {
+            if (tree_itr->get().box.intersects(margin_box) ||
+                (text == tree_itr->get().text && tree_itr->get().box.intersects(repeat_box)))
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    void insert(mapnik::box2d<double> const& box, mapnik::value_unicode_string const& text)
+    {
+        if (tree_.extent().intersects(box)) tree_.insert(label(box, text), box);
+    }
+};
+
+// Glyph boxes of candidate line label positions on a dense tile: each
+// candidate is a run of glyph boxes tried as a whole, placed if none of
+// them collides.
+struct candidate
+{
+    std::vector<mapnik::box2d<double>> glyphs;
+    std::size_t name;
+};
+
+std::vector<candidate> make_candidates(std::size_t count)
+{
+    std::mt19937 engine(7);
+    std::uniform_real_distribution<double> position(-64.0, 576.0);
+    std::uniform_real_distribution<double> angle(0.0, 6.283);
+    std::uniform_int_distribution<std::size_t> length(6, 20);
+    std::vector<candidate> result(count);
+    for (std::size_t i = 0; i < count; ++i)
+    {
+        double x = position(engine);
+        double y = position(engine);
+        double a = angle(engine);
+        std::size_t n = length(engine);
+        for (std::size_t j = 0; j < n; ++j)
+        {
+            double cx = x + j * 7.0 * std::cos(a);
+            double cy = y + j * 7.0 * std::sin(a);
+            result[i].glyphs.emplace_back(cx - 5, cy - 6, cx + 5, cy + 6);
+        }
+        result[i].name = i % 50;
+    }
+    return result;
+}
+
+}
+
+template <typename Detector>
+class test : public benchmark::test_case
+{
+    std::vector<candidate> candidates_;
+    std::vector<mapnik::value_unicode_string> names_;
+
+public:
+    std::size_t place() const
+    {
+        Detector detector(mapnik::box2d<double>(-64, -64, 576, 576));
+        std::size_t placed = 0;
+        for (auto const& c : candidates_)
+        {
+            auto const& name = names_[c.name];
+            bool fits = true;
+            for (auto const& box : c.glyphs)
+            {
+                if (!detector.has_placement(box, 2.0, name, 100.0))
+                {
+                    fits = false;
+                    break;
+                }
+            }
+            if (!fits) continue;
+            for (auto const& box : c.glyphs)
+            {
+                detector.insert(box, name);
+            }
+            ++placed;
+        }
+        return placed;
+    }
+
+    test(mapnik::parameters const& params)
+     : test_case(params),
+       candidates_(make_candidates(20000)),
+       names_()
+    {
+        mapnik::transcoder tr("utf-8");
+        for (int i = 0; i < 50; ++i)
+        {
+            names_.push_back(tr.transcode(("Street " + std::to_string(i)).c_str()));
+        }
+    }
+
+    bool validate() const
+    {
+        test<quad_tree_detector> reference(params_);
+        return place() == reference.place();
+    }
+
+    bool operator()() const
+    {
+        for (std::size_t i = 0; i < iterations_; ++i)
+        {
+            place();
+        }
+        return true;
+    }
+};
+
+int main(int argc, char** argv)
+{
+    return benchmark::sequencer(argc, argv)
+        .run<test<quad_tree_detector>>("label collision quad_tree")
+        .run<test<mapnik::label_collision_detector4>>("label collision grid")
+        .done();
+}
@@ -0,0 +1,113 @@
+#include "bench_framework.hpp"
+#include <mapnik/map.hpp>
+#include <mapnik/layer.hpp>
+#include <mapnik/rule.hpp>
+#include <mapnik/feature_type_style.hpp>
+#include <mapnik/feature_factory.hpp>
+#include <mapnik/memory_datasource.hpp>
+#include <mapnik/symbolizer.hpp>
+#include <mapnik/agg_renderer.hpp>
+#include <mapnik/marker_bitmap_cache.hpp>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+
+namespace {
+
+// a tile full of identical point of interest icons
+mapnik::Map poi_map(std::string const& file, std::size_t count)
+{
+    mapnik::parameters params;
+    params["type"] = "memory";
+    auto ds = std::make_shared<mapnik::memory_datasource>(params);
+    mapnik::context_ptr ctx = std::make_shared<mapnik::context_type>();
+    std::mt19937 engine(1);
+    std::uniform_real_distribution<double> dist(0.0, 256.0);
+    for (std::size_t i = 0; i < count; ++i)
+    {
+        mapnik::feature_ptr feature(mapnik::feature_factory::create(ctx, static_cast<mapnik::value_integer>(i + 1)));
+        feature->set_geometry(mapnik::geometry::point<double>(dist(engine), dist(engine)));
+        ds->push(feature);
+    }
+    mapnik::Map map(256, 256);
+    mapnik::feature_type_style style;
+    mapnik::rule r;
+    mapnik::markers_symbolizer sym;
+    mapnik::put(sym, mapnik::keys::file, file);
+    mapnik::put(sym, mapnik::keys::allow_overlap, true);
+    r.append(std::move(sym));
+    style.add_rule(std::move(r));
+    map.insert_style("poi", std::move(style));
+    mapnik::layer lyr("poi");
+    lyr.set_datasource(ds);
+    lyr.add_style("poi");
+    map.add_layer(lyr);
+    map.zoom_to_box(mapnik::box2d<double>(0, 0, 256, 256));
+    return map;
+}
+
+}
+
+class test : public benchmark::test_case
+{
+    mapnik::Map map_;
+    bool cached_;
+    std::shared_ptr<mapnik::marker_bitmap_cache> cache_;
+
+    mapnik::image_rgba8 render() const
+    {
+        mapnik::image_rgba8 im(map_.width(), map_.height());
+        mapnik::agg_renderer<mapnik::image_rgba8> ren(map_, im);
+        if (cached_) ren.set_marker_bitmap_cache(cache_);
+        ren.apply();
+        return im;
+    }
+
+public:
+    test(mapnik::parameters const& params, std::string const& file, bool cached)
+     : test_case(params),
+       map_(poi_map(file, 2000)),
+       cached_(cached),
+       // shared by the renderers of all iterations, like a tile server would
+       cache_(std::make_shared<mapnik::marker_bitmap_cache>()) {}
+
+    bool validate() const
+    {
+        mapnik::image_rgba8 result = render();
+        if (!cached_) return true;
+        // bitmaps differ from direct rendering by rounding only
+        mapnik::image_rgba8 expected(map_.width(), map_.height());
+        mapnik::agg_renderer<mapnik::image_rgba8> ren(map_, expected);
+        ren.apply();
+        for (std::size_t i = 0; i < result.size(); ++i)
+        {
+            if (std::abs(int(result.bytes()[i]) - int(expected.bytes()[i])) > 2) return false;
+        }
+        return true;
+    }
+
+    bool operator()() const
+    {
+        for (std::size_t i = 0; i < iterations_; ++i)
+        {
+            render();
+        }
+        if (cached_)
+        {
+            auto stats = cache_->stats();
+            std::clog << "marker bitmaps: " << stats.hits << " hits, " << stats.misses << " misses, "
+                      << stats.entries << " entries, " << stats.bytes << " bytes\n";
+        }
+        return true;
+    }
+};
+
+int main(int argc, char** argv)
+{
+    return benchmark::sequencer(argc, argv)
+        .run<test>("svg markers direct", "./test/data/svg/place-of-worship-24.svg", false)
+        .run<test>("svg markers cached", "./test/data/svg/place-of-worship-24.svg", true)
+        .run<test>("ellipse markers direct", "shape://ellipse", false)
+        .run<test>("ellipse markers cached", "shape://ellipse", true)
+        .done();
+}
@@ -16,10 +16,13 @@
 #include <mapnik/geometry/is_empty.hpp>
 #include <mapnik/image_util.hpp>
 #include <mapnik/color.hpp>
+#include <mapnik/clip_converter.hpp>
+#include <mapnik/util/cpu_features.hpp>
 // boost geometry
 #include <boost/geometry.hpp>
 // agg
 #include "agg_conv_clip_polygon.h"
+#include "agg_conv_clip_polyline.h"
 // clipper
 #include "agg_path_storage.h"
 // rendering
@@ -31,6 +34,7 @@
 #include "agg_renderer_scanline.h"
 
 // stl
+#include <cmath>
 #include <fstream>
 #include <iostream>
 #include <cstdlib>
@@ -65,20 +69,29 @@ void render(mapnik::geometry::multi_polygon<double> const& geom,
     mapnik::save_to_file(im,name);
 }
 
+using agg_clip = agg::conv_clip_polygon<mapnik::geometry::polygon_vertex_adapter<double>>;
+using converter_clip = mapnik::polygon_clip_converter<mapnik::geometry::polygon_vertex_adapter<double>>;
+using agg_line_clip = agg::conv_clip_polyline<mapnik::geometry::line_string_vertex_adapter<double>>;
+using converter_line_clip = mapnik::line_clip_converter<mapnik::geometry::line_string_vertex_adapter<double>>;
+
+template <typename Clipper>
 class test1 : public benchmark::test_case
 {
     std::string wkt_in_;
     mapnik::box2d<double> extent_;
     std::string expected_;
+    unsigned expected_count_;
 public:
-    using conv_clip = agg::conv_clip_polygon<mapnik::geometry::polygon_vertex_adapter<double>>;
+    using conv_clip = Clipper;
     test1(mapnik::parameters const& params,
           std::string const& wkt_in,
-          mapnik::box2d<double> const& extent)
+          mapnik::box2d<double> const& extent,
+          unsigned expected_count)
      : test_case(params),
        wkt_in_(wkt_in),
        extent_(extent),
-       expected_("./benchmark/data/polygon_clipping_agg") {}
+       expected_("./benchmark/data/polygon_clipping_agg"),
+       expected_count_(expected_count) {}
     bool validate() const
     {
         mapnik::geometry::geometry<double> geom;
@@ -198,9 +211,8 @@ public:
             while ((cmd = clipped.vertex(&x, &y)) != mapnik::SEG_END) {
                 count++;
             }
-            unsigned expected_count = 30;
-            if (count != expected_count) {
-                std::clog << "test1: clipping failed: processed " << count << " verticies but expected " << expected_count << "\n";
+            if (count != expected_count_) {
+                std::clog << "test1: clipping failed: processed " << count << " verticies but expected " << expected_count_ << "\n";
                 valid = false;
             }
         }
@@ -510,17 +522,147 @@ public:
 };
 */
 
-int main(int argc, char** argv)
+// A polygon of `points` vertices on a circle around the lower left corner of
+// the clipping box, so that most of it lies outside.
+template <typename Clipper>
+class test5 : public benchmark::test_case
+{
+    mapnik::geometry::polygon<double> poly_;
+    mapnik::box2d<double> extent_;
+    mapnik::util::simd_level level_;
+public:
+    test5(mapnik::parameters const& params,
+          mapnik::box2d<double> const& extent,
+          std::size_t points,
+          mapnik::util::simd_level level)
+     : test_case(params),
+       extent_(extent),
+       level_(level)
+    {
+        double radius = extent_.width() / 2;
+        mapnik::geometry::linear_ring<double> ring;
+        for (std::size_t i = 0; i < points; ++i)
+        {
+            double angle = 2 * M_PI * i / points;
+            ring.emplace_back(extent_.minx() + radius * std::cos(angle),
+                              extent_.miny() + radius * std::sin(angle));
+        }
+        ring.push_back(ring.front());
+        poly_.push_back(std::move(ring));
+    }
+
+    unsigned clip(bool & inside) const
+    {
+        mapnik::geometry::polygon_vertex_adapter<double> va(poly_);
+        Clipper clipped(va);
+        clipped.clip_box(extent_.minx(), extent_.miny(), extent_.maxx(), extent_.maxy());
+        clipped.rewind(0);
+        unsigned count = 0;
+        unsigned cmd;
+        double x, y;
+        while ((cmd = clipped.vertex(&x, &y)) != mapnik::SEG_END)
+        {
+            if (cmd != mapnik::SEG_CLOSE && !extent_.contains(x, y)) inside = false;
+            ++count;
+        }
+        return count;
+    }
+
+    bool validate() const
+    {
+        bool inside = true;
+        unsigned count = clip(inside);
+        return inside && count > poly_.front().size() / 8;
+    }
+
+    bool operator()() const
+    {
+        mapnik::util::set_simd_level(level_);
+        bool inside = true;
+        unsigned count = 0;
+        for (std::size_t i = 0; i < iterations_; ++i)
+        {
+            count += clip(inside);
+        }
+        mapnik::util::set_simd_level(mapnik::util::detected_simd_level());
+        return count > 0;
+    }
+};
+
+// A line of `points` vertices waving across the clipping box and twice as
+// wide as it, so that it leaves and enters the box many times.
+template <typename Clipper>
+class test6 : public benchmark::test_case
 {
-    mapnik::parameters params;
-    benchmark::handle_args(argc,argv,params);
+    mapnik::geometry::line_string<double> line_;
+    mapnik::box2d<double> extent_;
+    mapnik::util::simd_level level_;
+public:
+    test6(mapnik::parameters const& params,
+          mapnik::box2d<double> const& extent,
+          std::size_t points,
+          mapnik::util::simd_level level)
+     : test_case(params),
+       extent_(extent),
+       level_(level)
+    {
+        mapnik::coord2d center = extent_.center();
+        for (std::size_t i = 0; i < points; ++i)
+        {
+            double t = static_cast<double>(i) / points;
+            line_.emplace_back(center.x + extent_.width() * (2 * t - 1),
+                               center.y + extent_.height() * 0.75 * std::sin(t * 40 * M_PI));
+        }
+    }
+
+    unsigned clip(bool & inside) const
+    {
+        mapnik::geometry::line_string_vertex_adapter<double> va(line_);
+        Clipper clipped(va);
+        clipped.clip_box(extent_.minx(), extent_.miny(), extent_.maxx(), extent_.maxy());
+        clipped.rewind(0);
+        // agg's clipper can be off by rounding at the border
+        mapnik::box2d<double> padded(extent_);
+        padded.pad(1e-9);
+        unsigned count = 0;
+        unsigned cmd;
+        double x, y;
+        while ((cmd = clipped.vertex(&x, &y)) != mapnik::SEG_END)
+        {
+            if (!padded.contains(x, y)) inside = false;
+            ++count;
+        }
+        return count;
+    }
+
+    bool validate() const
+    {
+        bool inside = true;
+        unsigned count = clip(inside);
+        return inside && count > line_.size() / 8;
+    }
+
+    bool operator()() const
+    {
+        mapnik::util::set_simd_level(level_);
+        bool inside = true;
+        unsigned count = 0;
+        for (std::size_t i = 0; i < iterations_; ++i)
+        {
+            count += clip(inside);
+        }
+        mapnik::util::set_simd_level(mapnik::util::detected_simd_level());
+        return count > 0;
+    }
+};
 
+int main(int argc, char** argv)
+{
     // polygon/rect clipping
     // IN : POLYGON ((155 203, 233 454, 315 340, 421 446, 463 324, 559 466, 665 253, 528 178, 394 229, 329 138, 212 134, 183 228, 200 264, 155 203),(313 190, 440 256, 470 248, 510 305, 533 237, 613 263, 553 397, 455 262, 405 378, 343 287, 249 334, 229 191, 313 190))
     // RECT : POLYGON ((181 106, 181 470, 631 470, 631 106, 181 106))
     // OUT (expected)
     // POLYGON ((181 286.6666666666667, 233 454, 315 340, 421 446, 463 324, 559 466, 631 321.3207547169811, 631 234.38686131386862, 528 178, 394 229, 329 138, 212 134, 183 228, 200 264, 181 238.24444444444444, 181 286.6666666666667),(313 190, 440 256, 470 248, 510 305, 533 237, 613 263, 553 397, 455 262, 405 378, 343 287, 249 334, 229 191, 313 190))
-#if 0
     mapnik::box2d<double> clipping_box(181,106,631,470);
     std::string filename_("./benchmark/data/polygon.wkt");
     std::ifstream in(filename_.c_str(),std::ios_base::in | std::ios_base::binary);
@@ -528,21 +670,19 @@ int main(int argc, char** argv)
         throw std::runtime_error("could not open: '" + filename_ + "'");
     std::string wkt_in( (std::istreambuf_iterator<char>(in) ),
                (std::istreambuf_iterator<char>()) );
-    int return_value = 0;
-    {
-        test1 test_runner(params,wkt_in,clipping_box);
-        return_value = return_value | run(test_runner,"clipping polygon with agg");
-    }
-    {
-        test3 test_runner(params,wkt_in,clipping_box);
-        return_value = return_value | run(test_runner,"clipping polygon with boost");
-    }
-    /*
-    {
-        test4 test_runner(params,wkt_in,clipping_box);
-        return_value = return_value | run(test_runner,"clipping polygon with clipper_tree");
-    }
-    */
-#endif
-    return 0;// return_value;
+    using mapnik::util::simd_level;
+    simd_level best = mapnik::util::detected_simd_level();
+    // polygon_clip_converter renders the same pixels as agg with one
+    // vertex less
+    return benchmark::sequencer(argc, argv)
+        .run<test1<agg_clip>>("clipping polygon with agg", wkt_in, clipping_box, 30)
+        .run<test1<converter_clip>>("clipping polygon with polygon_clip_converter", wkt_in, clipping_box, 29)
+        .run<test3>("clipping polygon with boost", wkt_in, clipping_box)
+        .run<test5<agg_clip>>("clipping large polygon with agg", clipping_box, 10000, best)
+        .run<test5<converter_clip>>("clipping large polygon with polygon_clip_converter scalar", clipping_box, 10000, simd_level::none)
+        .run<test5<converter_clip>>("clipping large polygon with polygon_clip_converter vectorized", clipping_box, 10000, best)
+        .run<test6<agg_line_clip>>("clipping large line with agg", clipping_box, 10000, best)
+        .run<test6<converter_line_clip>>("clipping large line with line_clip_converter scalar", clipping_box, 10000, simd_level::none)
+        .run<test6<converter_line_clip>>("clipping large line with line_clip_converter vectorized", clipping_box, 10000, best)
+        .done();
 }
@@ -0,0 +1,98 @@
+#include "bench_framework.hpp"
+#include <mapnik/geometry/box2d.hpp>
+#include <mapnik/projection.hpp>
+#include <mapnik/proj_transform.hpp>
+#include <mapnik/util/cpu_features.hpp>
+#include <vector>
+
+// Transforms of whole coordinate arrays between epsg:4326 and epsg:3857,
+// where test_proj_transform1 transforms one box at a time
+class test : public benchmark::test_case
+{
+    std::string src_;
+    std::string dest_;
+    mapnik::box2d<double> from_;
+    mapnik::util::simd_level level_;
+    std::vector<double> xs_;
+    std::vector<double> ys_;
+public:
+    test(mapnik::parameters const& params,
+         std::string const& src,
+         std::string const& dest,
+         mapnik::box2d<double> const& from,
+         mapnik::util::simd_level level)
+     : test_case(params),
+       src_(src),
+       dest_(dest),
+       from_(from),
+       level_(level)
+    {
+        // a 256x256 grid over the source extent
+        for (int j = 0; j < 256; ++j)
+        {
+            for (int i = 0; i < 256; ++i)
+            {
+                xs_.push_back(from_.minx() + from_.width() * i / 255.0);
+                ys_.push_back(from_.miny() + from_.height() * j / 255.0);
+            }
+        }
+    }
+
+    bool validate() const
+    {
+        mapnik::projection src(src_);
+        mapnik::projection dest(dest_);
+        mapnik::proj_transform tr(src, dest);
+        std::vector<double> x(xs_), y(ys_);
+        mapnik::util::set_simd_level(level_);
+        bool ok = tr.forward(x.data(), y.data(), nullptr, static_cast<int>(x.size()));
+        ok = ok && tr.backward(x.data(), y.data(), nullptr, static_cast<int>(x.size()));
+        mapnik::util::set_simd_level(mapnik::util::detected_simd_level());
+        if (!ok) return false;
+        for (std::size_t i = 0; i < x.size(); ++i)
+        {
+            if (std::fabs(x[i] - xs_[i]) > 1e-6 * from_.width() ||
+                std::fabs(y[i] - ys_[i]) > 1e-6 * from_.height())
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    bool operator()() const
+    {
+        mapnik::projection src(src_);
+        mapnik::projection dest(dest_);
+        mapnik::proj_transform tr(src, dest);
+        mapnik::util::set_simd_level(level_);
+        std::vector<double> x, y;
+        for (std::size_t i = 0; i < iterations_; ++i)
+        {
+            x = xs_;
+            y = ys_;
+            if (!tr.forward(x.data(), y.data(), nullptr, static_cast<int>(x.size())))
+            {
+                throw std::runtime_error("could not transform coords");
+            }
+        }
+        mapnik::util::set_simd_level(mapnik::util::detected_simd_level());
+        return true;
+    }
+};
+
+int main(int argc, char** argv)
+{
+    using mapnik::util::simd_level;
+    simd_level best = mapnik::util::detected_simd_level();
+    mapnik::box2d<double> lonlat(-180, -85, 180, 85);
+    mapnik::box2d<double> merc(-20037508.3427892476, -19971868.8804085888, 20037508.3427892476, 19971868.8804085888);
+    std::string lonlat_str("+init=epsg:4326");
+    std::string merc_str("+init=epsg:3857");
+    return benchmark::sequencer(argc, argv)
+        .run<test>("lonlat->merc scalar", lonlat_str, merc_str, lonlat, simd_level::none)
+        .run<test>("lonlat->merc vectorized", lonlat_str, merc_str, lonlat, best)
+        .run<test>("merc->lonlat scalar", merc_str, lonlat_str, merc, simd_level::none)
+        .run<test>("merc->lonlat vectorized", merc_str, lonlat_str, merc, best)
+        .done();
+}
@@ -1,54 +1,146 @@
 #include "bench_framework.hpp"
 #include <mapnik/quad_tree.hpp>
+#include <mapnik/flat_quad_tree.hpp>
 #include <random>
+#include <utility>
+#include <vector>
 
-using quad_tree_type = mapnik::quad_tree<std::size_t>;
+namespace {
 
-class test : public benchmark::test_case
+using box_type = mapnik::box2d<double>;
+using boxes_type = std::vector<std::pair<std::size_t, box_type>>;
+
+boxes_type random_boxes(std::size_t count, double scale, unsigned seed)
 {
-public:
-    test(mapnik::parameters const& params)
-     : test_case(params) {}
+    std::default_random_engine engine(seed);
+    std::uniform_int_distribution<int> uniform_dist(0, 2048);
+    boxes_type result;
+    result.reserve(count);
+    for (std::size_t i = 0; i < count; ++i)
+    {
+        int cx = uniform_dist(engine);
+        int cy = uniform_dist(engine);
+        int sx = scale * uniform_dist(engine);
+        int sy = scale * uniform_dist(engine);
+        result.emplace_back(i, box_type(cx - sx, cy - sy, cx + sx, cy + sy));
+    }
+    return result;
+}
 
-    bool validate() const
+// quad_tree queries return everything in the nodes overlapping the query
+// box, so values are checked against their boxes to match flat_quad_tree
+struct quad_tree_index
+{
+    mapnik::quad_tree<std::size_t> tree;
+    boxes_type const& boxes;
+
+    quad_tree_index(boxes_type const& items, bool)
+        : tree(box_type(0, 0, 2048, 2048)),
+          boxes(items)
     {
-        return true;
+        for (auto const& b : boxes)
+        {
+            tree.insert(b.first, b.second);
+        }
     }
 
-    bool operator()() const
+    std::size_t query(box_type const& box)
     {
-        std::random_device rd;
-        std::default_random_engine engine(rd());
-        std::uniform_int_distribution<int> uniform_dist(0, 2048);
-        quad_tree_type tree(mapnik::box2d<double>(0,0,2048,2048));
-        //populate
-        for (size_t i = 0; i < iterations_; ++i)
+        std::size_t count = 0;
+        auto itr = tree.query_in_box(box);
+        auto end = tree.query_end();
+        for ( ;itr != end; ++itr)
         {
-            int cx = uniform_dist(engine);
-            int cy = uniform_dist(engine);
-            int sx = 0.2 * uniform_dist(engine);
-            int sy = 0.2 * uniform_dist(engine);
-            mapnik::box2d<double> box(cx - sx,cy - sy, cx + sx, cy + sy);
-            tree.insert(i, box);
+            if (boxes[itr->get()].second.intersects(box)) ++count;
+        }
+        return count;
+    }
+};
+
+struct flat_quad_tree_index
+{
+    mapnik::flat_quad_tree<std::size_t> tree;
+
+    flat_quad_tree_index(boxes_type const& boxes, bool bulk)
+        : tree(box_type(0, 0, 2048, 2048))
+    {
+        if (bulk)
+        {
+            tree.insert(boxes.begin(), boxes.end());
+        }
+        else
+        {
+            for (auto const& b : boxes)
+            {
+                tree.insert(b.first, b.second);
+            }
         }
-        // bounding box query
-        std::size_t count=0;
-        for (size_t i = 0; i < iterations_; ++i)
+    }
+
+    std::size_t query(box_type const& box) const
+    {
+        std::size_t count = 0;
+        tree.query(box, [&](mapnik::flat_quad_tree<std::size_t>::item const&) { ++count; return false; });
+        return count;
+    }
+};
+
+template <typename Index>
+class test : public benchmark::test_case
+{
+    boxes_type boxes_;
+    boxes_type queries_;
+    bool bulk_;
+    std::size_t queries_per_item_;
+
+public:
+    // each run builds an index of iterations boxes, then makes
+    // queries_per_item * iterations box queries
+    test(mapnik::parameters const& params, bool bulk, std::size_t queries_per_item)
+     : test_case(params),
+       boxes_(random_boxes(iterations_, 0.2, 1)),
+       queries_(random_boxes(iterations_, 0.1, 2)),
+       bulk_(bulk),
+       queries_per_item_(queries_per_item) {}
+
+    std::size_t run() const
+    {
+        Index index(boxes_, bulk_);
+        std::size_t count = 0;
+        for (std::size_t i = 0; i < queries_per_item_; ++i)
         {
-            int cx = uniform_dist(engine);
-            int cy = uniform_dist(engine);
-            int sx = 0.4 * uniform_dist(engine);
-            int sy = 0.4 * uniform_dist(engine);
-            mapnik::box2d<double> box(cx - sx,cy - sy, cx + sx, cy + sy);
-            auto itr = tree.query_in_box(box);
-            auto end = tree.query_end();
-            for ( ;itr != end; ++itr)
+            for (auto const& q : queries_)
             {
-                ++count;
+                count += index.query(q.second);
             }
         }
+        return count;
+    }
+
+    bool validate() const
+    {
+        test<quad_tree_index> reference(params_, false, 1);
+        test<Index> self(params_, bulk_, 1);
+        return self.run() == reference.run();
+    }
+
+    bool operator()() const
+    {
+        run();
         return true;
     }
 };
 
-BENCHMARK(test,"quad_tree creation")
+}
+
+int main(int argc, char** argv)
+{
+    return benchmark::sequencer(argc, argv)
+        .run<test<quad_tree_index>>("quad_tree insert", false, 0)
+        .run<test<flat_quad_tree_index>>("flat_quad_tree insert", false, 0)
+        .run<test<flat_quad_tree_index>>("flat_quad_tree bulk insert", true, 0)
+        .run<test<quad_tree_index>>("quad_tree insert + query", false, 1)
+        .run<test<flat_quad_tree_index>>("flat_quad_tree insert + query", false, 1)
+        .run<test<flat_quad_tree_index>>("flat_quad_tree bulk insert + query", true, 1)
+        .done();
+}
@@ -25,6 +25,8 @@
 
 // mapnik
 #include <mapnik/util/noncopyable.hpp>
+#include <mapnik/geometry/box2d.hpp>
+#include <mapnik/render_report.hpp>
 
 
 #pragma GCC diagnostic push
@@ -34,7 +36,78 @@
 
 namespace mapnik {
 
-struct rasterizer :  agg::rasterizer_scanline_aa<agg::rasterizer_sl_clip_int_sat>, util::noncopyable {};
+struct rasterizer :  agg::rasterizer_scanline_aa<agg::rasterizer_sl_clip_int_sat>, util::noncopyable
+{
+    using base_type = agg::rasterizer_scanline_aa<agg::rasterizer_sl_clip_int_sat>;
+
+    rasterizer()
+        : geometry_stats_(nullptr),
+          rasterize_stats_(nullptr),
+          sweep_timer_(false) {}
+
+    // Accumulates the time spent pulling paths through their converters
+    // into cells, and sweeping the cells into the canvas, into the given
+    // stats. Passing null pointers turns timing off.
+    void set_stats(render_stats * geometry, render_stats * rasterize)
+    {
+        geometry_stats_ = geometry;
+        rasterize_stats_ = rasterize;
+    }
+
+    template <typename VertexSource>
+    void add_path(VertexSource & vs, unsigned path_id = 0)
+    {
+        render_timer timer(geometry_stats_ != nullptr);
+        base_type::add_path(vs, path_id);
+        if (geometry_stats_) timer.stop(*geometry_stats_);
+    }
+
+    // Hides the base version, which agg::render_scanlines calls before
+    // sweeping, to record the cell bounds of every rendered path.
+    bool rewind_scanlines()
+    {
+        sweep_timer_ = render_timer(rasterize_stats_ != nullptr);
+        if (!base_type::rewind_scanlines())
+        {
+            if (rasterize_stats_) sweep_timer_.stop(*rasterize_stats_);
+            return false;
+        }
+        add_drawn(box2d<int>(min_x(), min_y(), max_x() + 1, max_y() + 1));
+        return true;
+    }
+
+    // the last call of a sweep returns false, which ends its timing
+    template <typename Scanline>
+    bool sweep_scanline(Scanline & sl)
+    {
+        if (base_type::sweep_scanline(sl)) return true;
+        if (rasterize_stats_) sweep_timer_.stop(*rasterize_stats_);
+        return false;
+    }
+
+    // records pixels written without the rasterizer, like blitted bitmaps
+    void add_drawn(box2d<int> const& box)
+    {
+        if (!box.valid()) return;
+        if (drawn_.valid()) drawn_.expand_to_include(box);
+        else drawn_ = box;
+    }
+
+    // pixels rendered since the last call, maxx and maxy being exclusive,
+    // or an invalid box if nothing was rendered
+    box2d<int> take_drawn()
+    {
+        box2d<int> drawn = drawn_;
+        drawn_ = box2d<int>();
+        return drawn;
+    }
+
+private:
+    box2d<int> drawn_;
+    render_stats * geometry_stats_;
+    render_stats * rasterize_stats_;
+    render_timer sweep_timer_;
+};
 
 }
 
@@ -91,22 +91,11 @@ void render_raster_marker(RendererType renb, RasterizerType & ras, image_rgba8 c
     {
         const_rendering_buffer src_buffer(src);
         pixfmt_pre pixf_mask(src_buffer);
-        if (snap_to_pixels)
-        {
-            renb.blend_from(pixf_mask,
-                            0,
-                            static_cast<int>(std::floor(tr.tx + .5)),
-                            static_cast<int>(std::floor(tr.ty + .5)),
-                            unsigned(255*opacity));
-        }
-        else
-        {
-            renb.blend_from(pixf_mask,
-                            0,
-                            static_cast<int>(tr.tx),
-                            static_cast<int>(tr.ty),
-                            unsigned(255*opacity));
-        }
+        int x = snap_to_pixels ? static_cast<int>(std::floor(tr.tx + .5)) : static_cast<int>(tr.tx);
+        int y = snap_to_pixels ? static_cast<int>(std::floor(tr.ty + .5)) : static_cast<int>(tr.ty);
+        renb.blend_from(pixf_mask, 0, x, y, unsigned(255*opacity));
+        // the rasterizer reports what was blitted along with what it renders
+        ras.add_drawn(box2d<int>(x, y, x + static_cast<int>(src.width()), y + static_cast<int>(src.height())));
     }
     else
     {
@@ -36,9 +36,13 @@
 #include <mapnik/symbolizer_enumerations.hpp>
 #include <mapnik/renderer_common.hpp>
 #include <mapnik/image_util.hpp>
+#include <mapnik/image_pool.hpp>
 // stl
+#include <algorithm>
+#include <deque>
 #include <memory>
 #include <stack>
+#include <vector>
 
 // fwd declaration to avoid dependence on agg headers
 namespace agg { struct trans_affine; }
@@ -55,36 +59,83 @@ namespace mapnik {
   class proj_transform;
   struct rasterizer;
   struct rgba8_t;
+  class marker_bitmap_cache;
+  class glyph_bitmap_cache;
+  class shaping_cache;
+  namespace util { class thread_pool; }
   template<typename T> class image;
 }
 
 namespace mapnik {
 
+// Stack of transparent buffers for compositing. Each buffer remembers the
+// region that may hold non-transparent pixels after it was popped, so
+// only that region is cleared when it is pushed again.
 template <typename T>
-class buffer_stack
+class buffer_stack : private util::noncopyable
 {
+    struct entry
+    {
+        std::unique_ptr<T> buffer;
+        box2d<int> dirty;
+    };
 public:
     buffer_stack(std::size_t width, std::size_t height)
         : width_(width),
           height_(height),
           buffers_(),
-          position_(buffers_.begin())
+          position_(buffers_.begin()),
+          pool_()
+    {
+    }
+
+    ~buffer_stack()
+    {
+        if (pool_)
+        {
+            for (entry & e : buffers_)
+            {
+                pool_->release(std::move(e.buffer));
+            }
+        }
+    }
+
+    // borrow new buffers from the pool and return them on destruction
+    void set_pool(std::shared_ptr<image_pool<T>> const& pool)
     {
+        pool_ = pool;
     }
 
     T & push()
     {
+        box2d<int> full(0, 0, width_, height_);
         if (position_ == buffers_.begin())
         {
-            buffers_.emplace_front(width_, height_);
+            buffers_.push_front(entry{pool_ ? pool_->acquire(width_, height_)
+                                            : std::make_unique<T>(width_, height_, false),
+                                      full});
             position_ = buffers_.begin();
         }
         else
         {
             --position_;
-            mapnik::fill(*position_, 0); // fill with transparent colour
         }
-        return *position_;
+        T & buffer = *position_->buffer;
+        box2d<int> & dirty = position_->dirty;
+        if (dirty == full)
+        {
+            mapnik::fill(buffer, 0); // fill with transparent colour
+        }
+        else if (dirty.valid())
+        {
+            for (int y = dirty.miny(); y < dirty.maxy(); ++y)
+            {
+                std::fill(buffer.get_row(y) + dirty.minx(), buffer.get_row(y) + dirty.maxx(), 0);
+            }
+        }
+        // anything may be drawn until the buffer is popped
+        dirty = full;
+        return buffer;
     }
     bool in_range() const
     {
@@ -98,16 +149,25 @@ public:
         ++position_;
     }
 
+    // pop a buffer whose non-transparent pixels all lie within dirty,
+    // maxx and maxy being exclusive, or an invalid box if there are none
+    void pop(box2d<int> const& dirty)
+    {
+        position_->dirty = dirty;
+        ++position_;
+    }
+
     T & top() const
     {
-        return *position_;
+        return *position_->buffer;
     }
 
 private:
     const std::size_t width_;
     const std::size_t height_;
-    std::deque<T> buffers_;
-    typename std::deque<T>::iterator position_;
+    std::deque<entry> buffers_;
+    typename std::deque<entry>::iterator position_;
+    std::shared_ptr<image_pool<T>> pool_;
 };
 
 template <typename T0, typename T1=label_collision_detector4>
@@ -127,6 +187,22 @@ public:
     // pass in mapnik::request object to provide the mutable things per render
     agg_renderer(Map const& m, request const& req, attributes const& vars, buffer_type & pixmap, double scale_factor=1.0, unsigned offset_x=0, unsigned offset_y=0);
     ~agg_renderer();
+    // borrow compositing and image filter scratch buffers from a pool
+    // shared by several renderers, call before rendering
+    void set_buffer_pool(std::shared_ptr<image_pool<buffer_type>> const& pool);
+    // split image filters into row bands run on the pool's workers, call
+    // before rendering; the pool must not be the one running this renderer
+    void set_filter_pool(std::shared_ptr<util::thread_pool> const& pool);
+    // draw svg markers composited with src-over from bitmaps rasterized
+    // once per marker, style, transform and quarter pixel position; the
+    // cache can be shared by several renderers
+    void set_marker_bitmap_cache(std::shared_ptr<marker_bitmap_cache> const& cache);
+    // draw text and halos from glyph bitmaps rendered once per face, size,
+    // transform, halo radius and subpixel position, skipping FreeType for
+    // repeated glyphs; the cache can be shared by several renderers
+    void set_glyph_bitmap_cache(std::shared_ptr<glyph_bitmap_cache> const& cache);
+    // reuse harfbuzz shaping of label text, see face_manager::set_shaping_cache
+    void set_shaping_cache(std::shared_ptr<shaping_cache> const& cache);
     void start_map_processing(Map const& map);
     void end_map_processing(Map const& map);
     void start_layer_processing(layer const& lay, box2d<double> const& query_extent);
@@ -212,9 +288,29 @@ protected:
     void draw_geo_extent(box2d<double> const& extent,mapnik::color const& color);
 
 private:
+    // Bounds of what was drawn into a buffer with its own dirty region,
+    // collected from the rasterizer's cell bounds and the blits reporting
+    // to it. scan is set after drawing which reports nothing, the buffer
+    // is then searched for non-transparent pixels instead.
+    struct drawn_region
+    {
+        box2d<int> box;
+        bool scan;
+    };
+
+    void push_drawn_region();
+    box2d<int> pop_drawn_region(buffer_type const& buffer);
+    void mark_drawn_untracked();
+
     std::stack<std::reference_wrapper<buffer_type>> buffers_;
+    std::vector<drawn_region> drawn_;
     buffer_stack<buffer_type> internal_buffers_;
     std::unique_ptr<buffer_type> inflated_buffer_;
+    box2d<int> inflated_dirty_;
+    std::shared_ptr<image_pool<buffer_type>> buffer_pool_;
+    std::shared_ptr<util::thread_pool> filter_pool_;
+    std::shared_ptr<marker_bitmap_cache> marker_bitmaps_;
+    std::shared_ptr<glyph_bitmap_cache> glyph_bitmaps_;
     const std::unique_ptr<rasterizer> ras_ptr;
     gamma_method_enum gamma_method_;
     double gamma_;
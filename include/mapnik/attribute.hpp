@@ -26,6 +26,7 @@
 // mapnik
 #include <mapnik/value/types.hpp>
 #include <mapnik/value.hpp>
+#include <mapnik/attribute_registry.hpp>
 #include <mapnik/util/geometry_to_ds_type.hpp>
 // stl
 #include <string>
@@ -36,16 +37,19 @@ namespace mapnik {
 struct attribute
 {
     std::string name_;
+    std::size_t id_;
     explicit attribute(std::string const& _name)
-        : name_(_name) {}
+        : name_(_name),
+          id_(attribute_registry::instance().insert(_name)) {}
 
     template <typename V ,typename F>
     V const& value(F const& f) const
     {
-        return f.get(name_);
+        return f.get(id_, name_);
     }
 
     std::string const& name() const { return name_;}
+    std::size_t id() const { return id_;}
 };
 
 struct geometry_type_attribute
@@ -0,0 +1,71 @@
+/*****************************************************************************
+ *
+ * This file is part of Mapnik (c++ mapping toolkit)
+ *
+ * Copyright (C) 2017 Artem Pavlenko
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ *****************************************************************************/
+
+#ifndef MAPNIK_ATTRIBUTE_REGISTRY_HPP
+#define MAPNIK_ATTRIBUTE_REGISTRY_HPP
+
+// mapnik
+#include <mapnik/config.hpp>
+#include <mapnik/util/singleton.hpp>
+#include <mapnik/util/noncopyable.hpp>
+
+// stl
+#include <atomic>
+#include <string>
+#include <unordered_map>
+
+namespace mapnik
+{
+
+// Process wide numbering of attribute names referenced by expressions.
+// Frozen feature contexts resolve every registered id to their column index
+// once, so evaluating an `attribute` node is a direct index into the
+// feature data instead of a lookup by name.
+// The registry holds at most `max_size` names so that servers loading
+// arbitrary styles don't grow it forever. Attributes named once it is full
+// get `npos` and are looked up by name.
+class MAPNIK_DECL attribute_registry :
+        public singleton<attribute_registry, CreateStatic>,
+        private util::noncopyable
+{
+    friend class CreateStatic<attribute_registry>;
+public:
+    static constexpr std::size_t npos = static_cast<std::size_t>(-1);
+    static constexpr std::size_t max_size = 4096;
+    // returns the id of `name`, registering it if needed, or npos if
+    // the registry is full
+    std::size_t insert(std::string const& name);
+    // returns the id of `name` or npos if it isn't registered
+    std::size_t find(std::string const& name) const;
+    std::size_t size() const
+    {
+        return size_.load(std::memory_order_acquire);
+    }
+private:
+    attribute_registry();
+    std::unordered_map<std::string, std::size_t> ids_;
+    std::atomic<std::size_t> size_;
+};
+
+}
+
+#endif // MAPNIK_ATTRIBUTE_REGISTRY_HPP
@@ -0,0 +1,181 @@
+/*****************************************************************************
+ *
+ * This file is part of Mapnik (c++ mapping toolkit)
+ *
+ * Copyright (C) 2017 Artem Pavlenko
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ *****************************************************************************/
+
+#ifndef MAPNIK_BOX_GRID_HPP
+#define MAPNIK_BOX_GRID_HPP
+
+// mapnik
+#include <mapnik/geometry/box2d.hpp>
+#include <mapnik/util/noncopyable.hpp>
+
+// stl
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+namespace mapnik
+{
+
+// Uniform grid of square cells over an extent, indexing values by their
+// bounding boxes. Each value is linked into every cell its box overlaps;
+// boxes sticking out of the extent are clamped to the border cells. Cells
+// are singly linked lists in one flat vector, so inserting never allocates
+// per cell and queries allocate nothing at all. Suited to many small boxes
+// spread over a bounded area, such as label placements.
+template <typename T>
+class box_grid : util::noncopyable
+{
+public:
+    using value_type = T;
+    struct item
+    {
+        box2d<double> box;
+        value_type value;
+    };
+    using items_type = std::vector<item>;
+    using const_iterator = typename items_type::const_iterator;
+    using iterator = typename items_type::iterator;
+
+    // cell_size <= 0 picks about 64 units, with at most 256 x 256 cells
+    explicit box_grid(box2d<double> const& extent, double cell_size = 0.0)
+        : extent_(extent),
+          items_(),
+          links_(),
+          heads_()
+    {
+        double size = std::max(extent_.width(), extent_.height());
+        if (!(cell_size > 0.0)) cell_size = std::max(64.0, size / 256.0);
+        cols_ = dimension(extent_.width(), cell_size);
+        rows_ = dimension(extent_.height(), cell_size);
+        scale_x_ = extent_.width() > 0 ? cols_ / extent_.width() : 0.0;
+        scale_y_ = extent_.height() > 0 ? rows_ / extent_.height() : 0.0;
+        heads_.assign(static_cast<std::size_t>(cols_) * rows_, npos);
+    }
+
+    void insert(value_type const& value, box2d<double> const& box)
+    {
+        std::uint32_t index = static_cast<std::uint32_t>(items_.size());
+        items_.push_back(item{box, value});
+        unsigned x0, y0, x1, y1;
+        cell_range(box, x0, y0, x1, y1);
+        for (unsigned y = y0; y <= y1; ++y)
+        {
+            for (unsigned x = x0; x <= x1; ++x)
+            {
+                std::uint32_t & head = heads_[y * cols_ + x];
+                links_.push_back(link{index, head});
+                head = static_cast<std::uint32_t>(links_.size() - 1);
+            }
+        }
+    }
+
+    // Calls f(item const&) for the values in the cells box overlaps, until
+    // it returns true. Values spanning several cells may be seen more than
+    // once. Returns true if f stopped the query.
+    template <typename F>
+    bool query(box2d<double> const& box, F && f) const
+    {
+        unsigned x0, y0, x1, y1;
+        cell_range(box, x0, y0, x1, y1);
+        for (unsigned y = y0; y <= y1; ++y)
+        {
+            for (unsigned x = x0; x <= x1; ++x)
+            {
+                for (std::uint32_t l = heads_[y * cols_ + x]; l != npos; l = links_[l].next)
+                {
+                    if (f(items_[links_[l].item])) return true;
+                }
+            }
+        }
+        return false;
+    }
+
+    void clear()
+    {
+        items_.clear();
+        links_.clear();
+        std::fill(heads_.begin(), heads_.end(), npos);
+    }
+
+    box2d<double> const& extent() const { return extent_; }
+    std::size_t size() const { return items_.size(); }
+    bool empty() const { return items_.empty(); }
+    unsigned cols() const { return cols_; }
+    unsigned rows() const { return rows_; }
+
+    // all values in insertion order
+    iterator begin() { return items_.begin(); }
+    iterator end() { return items_.end(); }
+    const_iterator begin() const { return items_.begin(); }
+    const_iterator end() const { return items_.end(); }
+
+private:
+    static constexpr std::uint32_t npos = std::numeric_limits<std::uint32_t>::max();
+
+    struct link
+    {
+        std::uint32_t item;
+        std::uint32_t next;
+    };
+
+    static unsigned dimension(double length, double cell_size)
+    {
+        double cells = std::ceil(length / cell_size);
+        return static_cast<unsigned>(std::min(std::max(cells, 1.0), 1024.0));
+    }
+
+    static unsigned clamp_cell(double value, unsigned count)
+    {
+        // also maps NaN to the first cell
+        if (!(value > 0.0)) return 0;
+        if (value >= count) return count - 1;
+        return static_cast<unsigned>(value);
+    }
+
+    void cell_range(box2d<double> const& box,
+                    unsigned & x0, unsigned & y0,
+                    unsigned & x1, unsigned & y1) const
+    {
+        x0 = clamp_cell((box.minx() - extent_.minx()) * scale_x_, cols_);
+        x1 = clamp_cell((box.maxx() - extent_.minx()) * scale_x_, cols_);
+        y0 = clamp_cell((box.miny() - extent_.miny()) * scale_y_, rows_);
+        y1 = clamp_cell((box.maxy() - extent_.miny()) * scale_y_, rows_);
+    }
+
+    box2d<double> extent_;
+    unsigned cols_;
+    unsigned rows_;
+    double scale_x_;
+    double scale_y_;
+    items_type items_;
+    std::vector<link> links_;
+    std::vector<std::uint32_t> heads_;
+};
+
+template <typename T>
+constexpr std::uint32_t box_grid<T>::npos;
+
+}
+
+#endif // MAPNIK_BOX_GRID_HPP
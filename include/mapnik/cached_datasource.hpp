@@ -0,0 +1,59 @@
+/*****************************************************************************
+ *
+ * This file is part of Mapnik (c++ mapping toolkit)
+ *
+ * Copyright (C) 2017 Artem Pavlenko
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ *****************************************************************************/
+
+#ifndef MAPNIK_CACHED_DATASOURCE_HPP
+#define MAPNIK_CACHED_DATASOURCE_HPP
+
+// mapnik
+#include <mapnik/config.hpp>
+#include <mapnik/datasource.hpp>
+
+namespace mapnik {
+
+// Datasource decorator serving features(query) from the process wide
+// feature_cache, so queries within the same super tiles at the same
+// resolution, adjacent tiles included, do not hit the wrapped datasource
+// again. Features it returns may be shared with other queries and must
+// not be modified. All other calls are forwarded unchanged.
+class MAPNIK_DECL cached_datasource : public datasource
+{
+public:
+    explicit cached_datasource(datasource_ptr const& ds);
+    virtual ~cached_datasource();
+    virtual datasource::datasource_t type() const;
+    virtual featureset_ptr features(query const& q) const;
+    virtual processor_context_ptr get_context(feature_style_context_map & ctx) const;
+    virtual featureset_ptr features_with_context(query const& q, processor_context_ptr ctx) const;
+    virtual featureset_ptr features_at_point(coord2d const& pt, double tol = 0) const;
+    virtual box2d<double> envelope() const;
+    virtual boost::optional<datasource_geometry_t> get_geometry_type() const;
+    virtual layer_descriptor get_descriptor() const;
+    virtual std::size_t max_concurrent_queries() const;
+    virtual query_slot_queue & query_slots() const;
+    datasource_ptr const& wrapped() const;
+private:
+    datasource_ptr ds_;
+};
+
+}
+
+#endif // MAPNIK_CACHED_DATASOURCE_HPP
@@ -0,0 +1,576 @@
+/*****************************************************************************
+ *
+ * This file is part of Mapnik (c++ mapping toolkit)
+ *
+ * Copyright (C) 2017 Artem Pavlenko
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ *****************************************************************************/
+
+#ifndef MAPNIK_CLIP_CONVERTER_HPP
+#define MAPNIK_CLIP_CONVERTER_HPP
+
+// mapnik
+#include <mapnik/config.hpp>
+#include <mapnik/vertex.hpp>
+#include <mapnik/geometry/point.hpp>
+#include <mapnik/util/noncopyable.hpp>
+
+// stl
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace mapnik {
+
+namespace kernels {
+
+// Cohen-Sutherland outcodes of the `count` points (x[i], y[i]) against the
+// box [x1, x2] x [y1, y2]: bit 0 is set left of the box, bit 1 right of it,
+// bit 2 below and bit 3 above, points on the border are inside. Dispatches
+// to sse4.1 or avx2 code when available. Returns the bitwise or of all the
+// codes, which is 0 when every point is inside.
+MAPNIK_DECL unsigned outcodes(double const* x, double const* y, std::size_t count,
+                              double x1, double y1, double x2, double y2,
+                              std::uint8_t * codes);
+
+}
+
+namespace detail {
+
+// Commands and coordinates in separate arrays. The arrays only grow while
+// the buffer is in use, so they are written without bounds checks once they
+// fit the largest path seen. release_clip_buffers drops buffers grown large.
+struct clip_path_buffer
+{
+    clip_path_buffer()
+        : size_(0) {}
+
+    // makes room for `count` more vertices and returns the index of the first
+    std::size_t extend(std::size_t count)
+    {
+        std::size_t first = size_;
+        size_ += count;
+        if (size_ > commands.size())
+        {
+            std::size_t capacity = std::max<std::size_t>(2 * size_, 64);
+            commands.resize(capacity);
+            xs.resize(capacity);
+            ys.resize(capacity);
+        }
+        return first;
+    }
+
+    void push(unsigned command, double x, double y)
+    {
+        std::size_t i = extend(1);
+        commands[i] = command;
+        xs[i] = x;
+        ys[i] = y;
+    }
+
+    void truncate(std::size_t size)
+    {
+        size_ = size;
+    }
+
+    void clear()
+    {
+        size_ = 0;
+    }
+
+    std::size_t size() const
+    {
+        return size_;
+    }
+
+    // heap memory held by the arrays
+    std::size_t capacity_bytes() const
+    {
+        return commands.capacity() * sizeof(unsigned) + (xs.capacity() + ys.capacity()) * sizeof(double);
+    }
+
+    std::vector<unsigned> commands;
+    std::vector<double> xs;
+    std::vector<double> ys;
+private:
+    std::size_t size_;
+};
+
+// a ring of a polygon path and the bitwise or of its vertices' outcodes
+struct clip_ring_info
+{
+    std::size_t last; // index of the ring's SEG_CLOSE
+    unsigned beyond;
+};
+
+struct clip_buffers
+{
+    clip_path_buffer in;
+    clip_path_buffer out;
+    std::vector<std::uint8_t> codes;
+    std::vector<clip_ring_info> rings;
+    std::vector<geometry::point<double>> points;
+    std::vector<geometry::point<double>> temp;
+
+    // heap memory held by the buffers
+    std::size_t capacity_bytes() const
+    {
+        return in.capacity_bytes() + out.capacity_bytes() + codes.capacity() +
+            rings.capacity() * sizeof(clip_ring_info) +
+            (points.capacity() + temp.capacity()) * sizeof(geometry::point<double>);
+    }
+};
+
+// Converters are made for each geometry, they take their buffers from a small
+// per thread pool and hand them back when done so that the buffers don't
+// grow from nothing every time. Buffers holding more than
+// max_pooled_clip_buffer_bytes are freed instead of pooled, so that one huge
+// geometry does not pin its memory in every rendering thread.
+constexpr std::size_t max_pooled_clip_buffer_bytes = 4 << 20;
+MAPNIK_DECL clip_buffers * acquire_clip_buffers();
+MAPNIK_DECL void release_clip_buffers(clip_buffers * buffers);
+
+template <typename Geometry>
+class clip_converter_base : private util::noncopyable
+{
+public:
+    explicit clip_converter_base(Geometry & geom)
+        : geom_(geom),
+          buffers_(*acquire_clip_buffers()),
+          x1_(0),
+          y1_(0),
+          x2_(1),
+          y2_(1),
+          index_(0),
+          filled_(false) {}
+
+    ~clip_converter_base()
+    {
+        release_clip_buffers(&buffers_);
+    }
+
+    void clip_box(double x1, double y1, double x2, double y2)
+    {
+        x1_ = std::min(x1, x2);
+        y1_ = std::min(y1, y2);
+        x2_ = std::max(x1, x2);
+        y2_ = std::max(y1, y2);
+        filled_ = false;
+    }
+
+    double x1() const { return x1_; }
+    double y1() const { return y1_; }
+    double x2() const { return x2_; }
+    double y2() const { return y2_; }
+
+    unsigned type() const { return static_cast<unsigned>(geom_.type()); }
+
+protected:
+    unsigned next(double * x, double * y)
+    {
+        clip_path_buffer const& out = buffers_.out;
+        if (index_ == out.size()) return SEG_END;
+        *x = out.xs[index_];
+        *y = out.ys[index_];
+        return out.commands[index_++];
+    }
+
+    // outcodes of `count` input vertices from `first` on
+    unsigned classify(std::size_t first, std::size_t count)
+    {
+        std::vector<std::uint8_t> & codes = buffers_.codes;
+        if (codes.size() < first + count) codes.resize(std::max(2 * (first + count), codes.size()));
+        return kernels::outcodes(buffers_.in.xs.data() + first, buffers_.in.ys.data() + first, count,
+                                 x1_, y1_, x2_, y2_, codes.data() + first);
+    }
+
+    Geometry & geom_;
+    clip_buffers & buffers_;
+    double x1_;
+    double y1_;
+    double x2_;
+    double y2_;
+    std::size_t index_;
+    bool filled_;
+};
+
+}
+
+// Drop in replacement for agg::conv_clip_polygon. rewind() reads the whole
+// path into contiguous buffers and classifies the vertices of each ring
+// against the clip box in one vectorized pass. Rings inside the box pass
+// through untouched, the others are clipped with Sutherland-Hodgman after
+// runs of vertices beyond the same edge have been shortened to their first
+// and last vertex. Every output ring ends with SEG_CLOSE, rings without area
+// are dropped.
+template <typename Geometry>
+class polygon_clip_converter : public detail::clip_converter_base<Geometry>
+{
+    using base_type = detail::clip_converter_base<Geometry>;
+    using point_type = geometry::point<double>;
+public:
+    using source_type = Geometry;
+
+    explicit polygon_clip_converter(Geometry & geom)
+        : base_type(geom) {}
+
+    void rewind(unsigned path_id)
+    {
+        this->geom_.rewind(path_id);
+        fill();
+    }
+
+    unsigned vertex(double * x, double * y)
+    {
+        if (!this->filled_) fill();
+        return this->next(x, y);
+    }
+
+private:
+    void fill()
+    {
+        this->filled_ = true;
+        this->index_ = 0;
+        detail::clip_path_buffer & in = this->buffers_.in;
+        detail::clip_path_buffer & out = this->buffers_.out;
+        in.clear();
+        out.clear();
+        this->buffers_.rings.clear();
+        std::size_t first = 0;
+        unsigned beyond = 0;
+        double x, y;
+        unsigned command;
+        while ((command = this->geom_.vertex(&x, &y)) != SEG_END)
+        {
+            if (command == SEG_MOVETO || command == SEG_CLOSE)
+            {
+                beyond |= close_ring(first);
+                first = in.size();
+                if (command == SEG_CLOSE) continue;
+            }
+            in.push(in.size() == first ? SEG_MOVETO : SEG_LINETO, x, y);
+        }
+        beyond |= close_ring(first);
+        if (beyond == 0)
+        {
+            std::swap(in, out);
+            return;
+        }
+        first = 0;
+        for (detail::clip_ring_info const& ring : this->buffers_.rings)
+        {
+            clip_ring(first, ring);
+            first = ring.last + 1;
+        }
+    }
+
+    // Rings without area are dropped, the others are classified and get a
+    // SEG_CLOSE at their first vertex. Returns the ring's bitwise or of
+    // outcodes.
+    unsigned close_ring(std::size_t first)
+    {
+        detail::clip_path_buffer & in = this->buffers_.in;
+        std::size_t last = in.size();
+        if (last - first < 3)
+        {
+            in.truncate(first);
+            return 0;
+        }
+        unsigned beyond = this->classify(first, last - first);
+        in.push(SEG_CLOSE, in.xs[first], in.ys[first]);
+        this->buffers_.rings.push_back(detail::clip_ring_info{last, beyond});
+        return beyond;
+    }
+
+    void clip_ring(std::size_t first, detail::clip_ring_info const& info)
+    {
+        detail::clip_path_buffer const& in = this->buffers_.in;
+        detail::clip_path_buffer & out = this->buffers_.out;
+        if (info.beyond == 0)
+        {
+            std::size_t size = info.last + 1 - first;
+            std::size_t i = out.extend(size);
+            std::copy_n(in.commands.begin() + first, size, out.commands.begin() + i);
+            std::copy_n(in.xs.begin() + first, size, out.xs.begin() + i);
+            std::copy_n(in.ys.begin() + first, size, out.ys.begin() + i);
+            return;
+        }
+        // The part of the ring between the ends of a run beyond one edge and
+        // the straight line replacing it both lie beyond that edge, so the
+        // winding numbers inside the box are the same with either. A ring
+        // entirely beyond one edge ends up with two vertices.
+        double const* xs = in.xs.data() + first;
+        double const* ys = in.ys.data() + first;
+        std::uint8_t const* codes = this->buffers_.codes.data() + first;
+        std::size_t size = info.last - first;
+        std::vector<point_type> & points = this->buffers_.points;
+        std::vector<point_type> & temp = this->buffers_.temp;
+        if (points.size() < size) points.resize(2 * size);
+        std::size_t count = 0;
+        for (std::size_t i = 0; i < size;)
+        {
+            unsigned code = codes[i];
+            std::size_t j = i;
+            while (code != 0 && j + 1 < size && (code & codes[j + 1]) != 0)
+            {
+                code &= codes[++j];
+            }
+            points[count++] = point_type(xs[i], ys[i]);
+            if (j > i) points[count++] = point_type(xs[j], ys[j]);
+            i = j + 1;
+        }
+        if (count < 3) return;
+
+        // only edges that some vertex is beyond cut the ring
+        double x1 = this->x1_, y1 = this->y1_, x2 = this->x2_, y2 = this->y2_;
+        if (info.beyond & 1)
+        {
+            count = clip_edge(points, count, temp, [x1](point_type const& p) { return p.x >= x1; },
+                              [x1](point_type const& a, point_type const& b) { return at_x(a, b, x1); });
+            points.swap(temp);
+        }
+        if (info.beyond & 2)
+        {
+            count = clip_edge(points, count, temp, [x2](point_type const& p) { return p.x <= x2; },
+                              [x2](point_type const& a, point_type const& b) { return at_x(a, b, x2); });
+            points.swap(temp);
+        }
+        if (info.beyond & 4)
+        {
+            count = clip_edge(points, count, temp, [y1](point_type const& p) { return p.y >= y1; },
+                              [y1](point_type const& a, point_type const& b) { return at_y(a, b, y1); });
+            points.swap(temp);
+        }
+        if (info.beyond & 8)
+        {
+            count = clip_edge(points, count, temp, [y2](point_type const& p) { return p.y <= y2; },
+                              [y2](point_type const& a, point_type const& b) { return at_y(a, b, y2); });
+            points.swap(temp);
+        }
+        if (count < 3) return;
+        std::size_t i = out.extend(count + 1);
+        for (std::size_t k = 0; k < count; ++k, ++i)
+        {
+            out.commands[i] = k == 0 ? SEG_MOVETO : SEG_LINETO;
+            out.xs[i] = points[k].x;
+            out.ys[i] = points[k].y;
+        }
+        out.commands[i] = SEG_CLOSE;
+        out.xs[i] = points[0].x;
+        out.ys[i] = points[0].y;
+    }
+
+    // One Sutherland-Hodgman pass, from the first `size` points of `in` to
+    // `out`. Returns the number of points written.
+    template <typename Inside, typename Intersect>
+    static std::size_t clip_edge(std::vector<point_type> const& in, std::size_t size,
+                                 std::vector<point_type> & out, Inside inside, Intersect intersect)
+    {
+        if (size == 0) return 0;
+        if (out.size() < 2 * size) out.resize(4 * size);
+        point_type * dest = out.data();
+        std::size_t count = 0;
+        point_type prev = in[size - 1];
+        bool prev_inside = inside(prev);
+        for (std::size_t i = 0; i < size; ++i)
+        {
+            point_type const& p = in[i];
+            bool p_inside = inside(p);
+            if (p_inside != prev_inside) dest[count++] = intersect(prev, p);
+            if (p_inside) dest[count++] = p;
+            prev = p;
+            prev_inside = p_inside;
+        }
+        return count;
+    }
+
+    // The end points are ordered so that an edge shared by two rings, which
+    // they walk in opposite directions, is cut at the same point.
+    static point_type at_x(point_type a, point_type b, double x)
+    {
+        if (b.x < a.x) std::swap(a, b);
+        return point_type(x, a.y + (b.y - a.y) * (x - a.x) / (b.x - a.x));
+    }
+
+    static point_type at_y(point_type a, point_type b, double y)
+    {
+        if (b.y < a.y) std::swap(a, b);
+        return point_type(a.x + (b.x - a.x) * (y - a.y) / (b.y - a.y), y);
+    }
+};
+
+// Drop in replacement for agg::conv_clip_polyline. rewind() reads the whole
+// path into contiguous buffers and classifies all vertices against the clip
+// box in one vectorized pass. Segments inside the box or entirely beyond one
+// of its edges are decided by their outcodes, the rest are clipped with
+// Liang-Barsky. As with agg, a closed path gets its closing segment back to
+// the start (if it has more than two vertices) and no SEG_CLOSE, and
+// vertices that start no visible segment are dropped.
+template <typename Geometry>
+class line_clip_converter : public detail::clip_converter_base<Geometry>
+{
+    using base_type = detail::clip_converter_base<Geometry>;
+public:
+    using source_type = Geometry;
+
+    explicit line_clip_converter(Geometry & geom)
+        : base_type(geom) {}
+
+    void rewind(unsigned path_id)
+    {
+        this->geom_.rewind(path_id);
+        fill();
+    }
+
+    unsigned vertex(double * x, double * y)
+    {
+        if (!this->filled_) fill();
+        return this->next(x, y);
+    }
+
+private:
+    void fill()
+    {
+        this->filled_ = true;
+        this->index_ = 0;
+        detail::clip_path_buffer & in = this->buffers_.in;
+        detail::clip_path_buffer & out = this->buffers_.out;
+        out.clear();
+        in.clear();
+        double x, y;
+        double start_x = 0, start_y = 0;
+        std::size_t vertices = 0;
+        unsigned command;
+        while ((command = this->geom_.vertex(&x, &y)) != SEG_END)
+        {
+            if (command == SEG_MOVETO)
+            {
+                drop_point();
+                start_x = x;
+                start_y = y;
+                vertices = 1;
+                in.push(SEG_MOVETO, x, y);
+            }
+            else if (command == SEG_CLOSE)
+            {
+                if (vertices > 2) in.push(SEG_LINETO, start_x, start_y);
+                vertices = 0;
+            }
+            else
+            {
+                in.push(in.size() == 0 ? SEG_MOVETO : SEG_LINETO, x, y);
+                ++vertices;
+            }
+        }
+        drop_point();
+        std::size_t size = in.size();
+        if (size == 0) return;
+        double const* xs = in.xs.data();
+        double const* ys = in.ys.data();
+        if (this->classify(0, size) == 0)
+        {
+            std::swap(in, out);
+            return;
+        }
+        std::uint8_t const* codes = this->buffers_.codes.data();
+        // whether the output ends at vertex i - 1
+        bool connected = false;
+        for (std::size_t i = 1; i < size; ++i)
+        {
+            if (in.commands[i] == SEG_MOVETO)
+            {
+                connected = false;
+                continue;
+            }
+            unsigned code0 = codes[i - 1];
+            unsigned code1 = codes[i];
+            if ((code0 | code1) == 0)
+            {
+                if (!connected) out.push(SEG_MOVETO, xs[i - 1], ys[i - 1]);
+                out.push(SEG_LINETO, xs[i], ys[i]);
+                connected = true;
+            }
+            else if ((code0 & code1) != 0)
+            {
+                connected = false;
+            }
+            else
+            {
+                double dx = xs[i] - xs[i - 1];
+                double dy = ys[i] - ys[i - 1];
+                double t0 = 0, t1 = 1;
+                if (clip_segment(xs[i - 1], ys[i - 1], dx, dy, t0, t1))
+                {
+                    if (code0 != 0) out.push(SEG_MOVETO, clamp_x(xs[i - 1] + t0 * dx), clamp_y(ys[i - 1] + t0 * dy));
+                    else if (!connected) out.push(SEG_MOVETO, xs[i - 1], ys[i - 1]);
+                    if (code1 == 0) out.push(SEG_LINETO, xs[i], ys[i]);
+                    else out.push(SEG_LINETO, clamp_x(xs[i - 1] + t1 * dx), clamp_y(ys[i - 1] + t1 * dy));
+                }
+                connected = code1 == 0;
+            }
+        }
+    }
+
+    // a move to that no line to follows
+    void drop_point()
+    {
+        detail::clip_path_buffer & in = this->buffers_.in;
+        if (in.size() > 0 && in.commands[in.size() - 1] == SEG_MOVETO) in.truncate(in.size() - 1);
+    }
+
+    // Liang-Barsky: narrows [t0, t1] to the part of x + t * dx, y + t * dy
+    // inside the box, false if there is none
+    bool clip_segment(double x, double y, double dx, double dy, double & t0, double & t1) const
+    {
+        return clip_t(-dx, x - this->x1_, t0, t1) &&
+               clip_t(dx, this->x2_ - x, t0, t1) &&
+               clip_t(-dy, y - this->y1_, t0, t1) &&
+               clip_t(dy, this->y2_ - y, t0, t1);
+    }
+
+    static bool clip_t(double p, double q, double & t0, double & t1)
+    {
+        if (p == 0) return q >= 0;
+        double r = q / p;
+        if (p < 0)
+        {
+            if (r > t1) return false;
+            if (r > t0) t0 = r;
+        }
+        else
+        {
+            if (r < t0) return false;
+            if (r < t1) t1 = r;
+        }
+        return true;
+    }
+
+    double clamp_x(double x) const
+    {
+        return std::min(std::max(x, this->x1_), this->x2_);
+    }
+
+    double clamp_y(double y) const
+    {
+        return std::min(std::max(y, this->y1_), this->y2_);
+    }
+};
+
+}
+
+#endif // MAPNIK_CLIP_CONVERTER_HPP
@@ -33,6 +33,7 @@
 #include <mapnik/util/noncopyable.hpp>
 #include <mapnik/feature_style_processor_context.hpp>
 #include <mapnik/datasource_geometry_type.hpp>
+#include <mapnik/query_slots.hpp>
 
 // stl
 #include <map>
@@ -112,9 +113,25 @@ public:
     virtual featureset_ptr features_at_point(coord2d const& pt, double tol = 0) const = 0;
     virtual box2d<double> envelope() const = 0;
     virtual layer_descriptor get_descriptor() const = 0;
+
+    /*!
+     * @brief How many queries may be in flight at once, counting the
+     * featuresets they return until these are exhausted or destroyed.
+     *
+     * Datasources are not required to be thread-safe. Concurrent querying
+     * (see feature_style_processor::set_query_pool) runs the queries of
+     * datasources returning 1 one at a time. Return
+     * query_slot_queue::unlimited when there is no limit.
+     */
+    virtual std::size_t max_concurrent_queries() const { return 1; }
+    // datasources sharing a resource (connection pool, file handle) share
+    // one queue, wrapping datasources forward to the wrapped datasource's
+    virtual query_slot_queue & query_slots() const { return query_slots_; }
     virtual ~datasource() {}
 protected:
     parameters params_;
+private:
+    mutable query_slot_queue query_slots_;
 };
 
 using datasource_name = const char* (*)();
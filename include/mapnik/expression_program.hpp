@@ -0,0 +1,271 @@
+/*****************************************************************************
+ *
+ * This file is part of Mapnik (c++ mapping toolkit)
+ *
+ * Copyright (C) 2017 Artem Pavlenko
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ *****************************************************************************/
+
+#ifndef MAPNIK_EXPRESSION_PROGRAM_HPP
+#define MAPNIK_EXPRESSION_PROGRAM_HPP
+
+// mapnik
+#include <mapnik/config.hpp>
+#include <mapnik/value.hpp>
+#include <mapnik/expression_node.hpp>
+#include <mapnik/function_call.hpp>
+#include <mapnik/util/geometry_to_ds_type.hpp>
+
+// stl
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace mapnik
+{
+
+// Flat, register based representation of an expression tree.
+//
+// Expressions are lowered once into a linear list of instructions.
+// Operands refer either to a register, a constant, a feature attribute
+// or a global variable, so leaf nodes never need to be copied into
+// registers and comparisons such as [highway]='primary' compile into a
+// single instruction. Logical and/or are short-circuited with jumps.
+// Evaluation gives the same result as the `evaluate` tree visitor.
+class MAPNIK_DECL expression_program
+{
+public:
+    enum opcode : std::uint8_t
+    {
+        op_move = 0,
+        op_negate,
+        op_plus,
+        op_minus,
+        op_mult,
+        op_div,
+        op_mod,
+        op_less,
+        op_less_equal,
+        op_greater,
+        op_greater_equal,
+        op_equal_to,
+        op_not_equal_to,
+        op_logical_not,
+        op_to_bool,
+        op_jump_if_false,
+        op_jump_if_true,
+        op_regex_match,
+        op_regex_replace,
+        op_unary_call,
+        op_binary_call,
+        op_geometry_type
+    };
+
+    enum operand_kind : std::uint8_t
+    {
+        operand_register = 0,
+        operand_constant,
+        operand_attribute,
+        operand_global
+    };
+
+    struct operand
+    {
+        operand_kind kind;
+        std::uint32_t index;
+    };
+
+    struct instruction
+    {
+        opcode op;
+        std::uint32_t dst;   // destination (or tested) register
+        operand a;
+        operand b;
+        std::uint32_t extra; // jump target or index into regex/function tables
+    };
+
+    explicit expression_program(expr_node const& expr);
+
+    std::vector<instruction> const& instructions() const
+    {
+        return code_;
+    }
+
+    std::size_t num_registers() const
+    {
+        return num_registers_;
+    }
+
+    // `registers` is scratch space which can be reused between calls
+    // to avoid allocating on every evaluation.
+    template <typename Feature, typename Variables>
+    value_type evaluate(Feature const& feature,
+                        Variables const& vars,
+                        std::vector<value_type> & registers) const;
+
+    template <typename Feature, typename Variables>
+    value_type evaluate(Feature const& feature, Variables const& vars) const
+    {
+        std::vector<value_type> registers;
+        return evaluate(feature, vars, registers);
+    }
+
+private:
+    struct compiler;
+
+    template <typename Feature, typename Variables>
+    value_type const& fetch(operand const& o,
+                            Feature const& feature,
+                            Variables const& vars,
+                            std::vector<value_type> const& registers) const
+    {
+        switch (o.kind)
+        {
+        case operand_register:
+            return registers[o.index];
+        case operand_constant:
+            return constants_[o.index];
+        case operand_attribute:
+            return attributes_[o.index].value<value_type>(feature);
+        case operand_global:
+        {
+            auto itr = vars.find(names_[o.index]);
+            if (itr != vars.end())
+            {
+                return itr->second;
+            }
+            break;
+        }
+        }
+        return null_;
+    }
+
+    std::vector<instruction> code_;
+    std::vector<value_type> constants_;
+    std::vector<std::string> names_;
+    std::vector<attribute> attributes_;
+    std::vector<regex_match_node> regex_match_nodes_;
+    std::vector<regex_replace_node> regex_replace_nodes_;
+    std::vector<unary_function_impl> unary_functions_;
+    std::vector<binary_function_impl> binary_functions_;
+    std::size_t num_registers_;
+    value_type null_;
+};
+
+template <typename Feature, typename Variables>
+value_type expression_program::evaluate(Feature const& feature,
+                                        Variables const& vars,
+                                        std::vector<value_type> & registers) const
+{
+    if (registers.size() < num_registers_)
+    {
+        registers.resize(num_registers_);
+    }
+    std::size_t pc = 0;
+    std::size_t const size = code_.size();
+    while (pc < size)
+    {
+        instruction const& ins = code_[pc++];
+        value_type & dst = registers[ins.dst];
+        switch (ins.op)
+        {
+        case op_move:
+            dst = fetch(ins.a, feature, vars, registers);
+            break;
+        case op_negate:
+            dst = make_op<tags::negate>::type()(fetch(ins.a, feature, vars, registers));
+            break;
+        case op_plus:
+            dst = make_op<tags::plus>::type()(fetch(ins.a, feature, vars, registers),
+                                              fetch(ins.b, feature, vars, registers));
+            break;
+        case op_minus:
+            dst = make_op<tags::minus>::type()(fetch(ins.a, feature, vars, registers),
+                                               fetch(ins.b, feature, vars, registers));
+            break;
+        case op_mult:
+            dst = make_op<tags::mult>::type()(fetch(ins.a, feature, vars, registers),
+                                              fetch(ins.b, feature, vars, registers));
+            break;
+        case op_div:
+            dst = make_op<tags::div>::type()(fetch(ins.a, feature, vars, registers),
+                                             fetch(ins.b, feature, vars, registers));
+            break;
+        case op_mod:
+            dst = make_op<tags::mod>::type()(fetch(ins.a, feature, vars, registers),
+                                             fetch(ins.b, feature, vars, registers));
+            break;
+        case op_less:
+            dst = make_op<tags::less>::type()(fetch(ins.a, feature, vars, registers),
+                                              fetch(ins.b, feature, vars, registers));
+            break;
+        case op_less_equal:
+            dst = make_op<tags::less_equal>::type()(fetch(ins.a, feature, vars, registers),
+                                                    fetch(ins.b, feature, vars, registers));
+            break;
+        case op_greater:
+            dst = make_op<tags::greater>::type()(fetch(ins.a, feature, vars, registers),
+                                                 fetch(ins.b, feature, vars, registers));
+            break;
+        case op_greater_equal:
+            dst = make_op<tags::greater_equal>::type()(fetch(ins.a, feature, vars, registers),
+                                                       fetch(ins.b, feature, vars, registers));
+            break;
+        case op_equal_to:
+            dst = make_op<tags::equal_to>::type()(fetch(ins.a, feature, vars, registers),
+                                                  fetch(ins.b, feature, vars, registers));
+            break;
+        case op_not_equal_to:
+            dst = make_op<tags::not_equal_to>::type()(fetch(ins.a, feature, vars, registers),
+                                                      fetch(ins.b, feature, vars, registers));
+            break;
+        case op_logical_not:
+            dst = !fetch(ins.a, feature, vars, registers).to_bool();
+            break;
+        case op_to_bool:
+            dst = fetch(ins.a, feature, vars, registers).to_bool();
+            break;
+        case op_jump_if_false:
+            if (!dst.to_bool()) pc = ins.extra;
+            break;
+        case op_jump_if_true:
+            if (dst.to_bool()) pc = ins.extra;
+            break;
+        case op_regex_match:
+            dst = regex_match_nodes_[ins.extra].apply(fetch(ins.a, feature, vars, registers));
+            break;
+        case op_regex_replace:
+            dst = regex_replace_nodes_[ins.extra].apply(fetch(ins.a, feature, vars, registers));
+            break;
+        case op_unary_call:
+            dst = unary_functions_[ins.extra](fetch(ins.a, feature, vars, registers));
+            break;
+        case op_binary_call:
+            dst = binary_functions_[ins.extra](fetch(ins.a, feature, vars, registers),
+                                               fetch(ins.b, feature, vars, registers));
+            break;
+        case op_geometry_type:
+            dst = static_cast<value_integer>(util::to_ds_type(feature.get_geometry()));
+            break;
+        }
+    }
+    return registers[0];
+}
+
+}
+
+#endif // MAPNIK_EXPRESSION_PROGRAM_HPP
@@ -32,7 +32,10 @@
 #include <mapnik/geometry/envelope.hpp>
 //
 #include <mapnik/feature_kv_iterator.hpp>
+#include <mapnik/feature_schema.hpp>
+#include <mapnik/attribute_registry.hpp>
 #include <mapnik/util/noncopyable.hpp>
+#include <mapnik/util/arena.hpp>
 
 // stl
 #include <memory>
@@ -65,29 +68,89 @@ public:
     using const_iterator = typename map_type::const_iterator;
 
     context()
-        : mapping_() {}
+        : mapping_(),
+          slots_(),
+          frozen_(false) {}
 
     inline size_type push(key_type const& name)
     {
         size_type index = mapping_.size();
+        if (frozen_) check_frozen(name);
         mapping_.emplace(name, index);
         return index;
     }
 
     inline void add(key_type const& name, size_type index)
     {
+        if (frozen_) check_frozen(name);
         mapping_.emplace(name, index);
     }
 
+    // no columns can be added once a context is frozen, datasources
+    // which know their schema up front freeze it before creating features.
+    // Freezing builds the sorted column index and binds the registered
+    // attribute ids to column indices.
+    inline void freeze()
+    {
+        if (frozen_) return;
+        mapping_.freeze();
+        bind();
+        frozen_ = true;
+    }
+    inline bool frozen() const { return frozen_; }
+
     inline size_type size() const { return mapping_.size(); }
     inline const_iterator begin() const { return mapping_.begin();}
     inline const_iterator end() const { return mapping_.end();}
 
+    // column index of a registered attribute (see attribute_registry),
+    // the binding table is only written by freeze()
+    inline bool index_of(std::size_t attribute_id, key_type const& name, size_type & index) const
+    {
+        if (attribute_id < slots_.size())
+        {
+            index = slots_[attribute_id];
+            return index != attribute_registry::npos;
+        }
+        // context not frozen or attribute registered after it was
+        const_iterator itr = mapping_.find(name);
+        if (itr != mapping_.end())
+        {
+            index = itr->second;
+            return true;
+        }
+        return false;
+    }
+
 private:
+    void check_frozen(key_type const& name) const
+    {
+        if (mapping_.find(name) == mapping_.end())
+        {
+            throw std::runtime_error("Cannot add key to frozen feature context: '" + name + "'");
+        }
+    }
+
+    // resolve the ids registered so far to column indices,
+    // all ids below slots_.size() are known to be present or absent
+    void bind()
+    {
+        attribute_registry const& registry = attribute_registry::instance();
+        std::vector<std::size_t> slots(registry.size(), attribute_registry::npos);
+        for (auto const& kv : mapping_)
+        {
+            std::size_t id = registry.find(kv.first);
+            if (id < slots.size()) slots[id] = kv.second;
+        }
+        slots_ = std::move(slots);
+    }
+
     map_type mapping_;
+    std::vector<std::size_t> slots_;
+    bool frozen_;
 };
 
-using context_type = context<std::map<std::string,std::size_t> >;
+using context_type = context<feature_schema>;
 using context_ptr = std::shared_ptr<context_type>;
 
 static const value default_feature_value{};
@@ -98,7 +161,8 @@ class MAPNIK_DECL feature_impl : private util::noncopyable
 public:
 
     using value_type = mapnik::value;
-    using cont_type = std::vector<value_type>;
+    // values are kept on the heap unless the feature was given an arena
+    using cont_type = std::vector<value_type, util::arena_allocator<value_type>>;
     using iterator = feature_kv_iterator;
 
     feature_impl(context_ptr const& ctx, mapnik::value_integer _id)
@@ -108,6 +172,14 @@ public:
         geom_(geometry::geometry_empty()),
         raster_() {}
 
+    feature_impl(context_ptr const& ctx, mapnik::value_integer _id,
+                 std::shared_ptr<util::arena> const& arena)
+        : id_(_id),
+        ctx_(ctx),
+        data_(ctx_->mapping_.size(), value_type(), cont_type::allocator_type(arena)),
+        geom_(geometry::geometry_empty()),
+        raster_() {}
+
     inline mapnik::value_integer id() const { return id_;}
     inline void set_id(mapnik::value_integer _id) { id_ = _id;}
     template <typename T>
@@ -144,6 +216,10 @@ public:
         {
             data_[itr->second] = std::move(val);
         }
+        else if (ctx_->frozen())
+        {
+            throw std::out_of_range(std::string("Key does not exist: '") + key + "'");
+        }
         else
         {
             cont_type::size_type index = ctx_->push(key);
@@ -166,6 +242,17 @@ public:
             return default_feature_value;
     }
 
+    // lookup of an attribute referenced by an expression, `id` is
+    // the attribute_registry id of `key`
+    inline value_type const& get(std::size_t id, context_type::key_type const& key) const
+    {
+        std::size_t index;
+        if (ctx_->index_of(id, key, index))
+            return get(index);
+        else
+            return default_feature_value;
+    }
+
     inline value_type const& get(std::size_t index) const
     {
         if (index < data_.size())
@@ -0,0 +1,107 @@
+/*****************************************************************************
+ *
+ * This file is part of Mapnik (c++ mapping toolkit)
+ *
+ * Copyright (C) 2017 Artem Pavlenko
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ *****************************************************************************/
+
+#ifndef MAPNIK_FEATURE_CACHE_HPP
+#define MAPNIK_FEATURE_CACHE_HPP
+
+// mapnik
+#include <mapnik/config.hpp>
+#include <mapnik/datasource.hpp>
+#include <mapnik/featureset.hpp>
+#include <mapnik/geometry/box2d.hpp>
+#include <mapnik/query.hpp>
+#include <mapnik/util/lru_cache.hpp>
+#include <mapnik/util/singleton.hpp>
+#include <mapnik/util/noncopyable.hpp>
+
+// stl
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace mapnik
+{
+
+namespace detail { class recording_featureset; }
+
+using feature_cache_stats = util::lru_cache_stats;
+
+// Process wide cache of query results, shared by every map and thread.
+// Queries are widened to a grid of super tiles of super_tile_pixels at
+// their resolution, and entries are keyed by datasource identity, the
+// covered super tiles, the resolution, scale denominator, filter factor,
+// property names and variables. Adjacent tiles rendered at the same
+// resolution thus share entries, each query only gets the features whose
+// envelope intersects its own bbox. The cache is bounded by an estimate
+// of the memory held by the cached features and evicts the least
+// recently used entries first. Results larger than the whole cache are
+// streamed through without being kept. Cached features are handed out
+// as is and shared between queries and threads, they must be treated as
+// immutable. It is disabled (max_bytes == 0) by default, see
+// cached_datasource for a datasource using it.
+class MAPNIK_DECL feature_cache :
+        public singleton<feature_cache, CreateStatic>,
+        private util::noncopyable
+{
+    friend class CreateStatic<feature_cache>;
+    friend class detail::recording_featureset;
+public:
+    // width and height of the super tiles in pixels
+    static constexpr double super_tile_pixels = 1024.0;
+
+    struct cached_feature
+    {
+        box2d<double> envelope;
+        feature_ptr feature;
+    };
+    using feature_list = std::vector<cached_feature>;
+    using feature_list_ptr = std::shared_ptr<feature_list const>;
+
+    void set_max_bytes(std::size_t max_bytes);
+    std::size_t max_bytes() const;
+    // returns the cached result of ds->features_with_context(q, ctx),
+    // querying the datasource on a miss
+    featureset_ptr features(datasource_ptr const& ds, query const& q,
+                            processor_context_ptr const& ctx = processor_context_ptr());
+    void clear();
+    feature_cache_stats stats() const;
+
+private:
+    struct entry
+    {
+        // the datasource this entry was created for, its address is part
+        // of the key and may be reused once it is gone
+        std::weak_ptr<datasource> ds;
+        feature_list_ptr features;
+    };
+
+    feature_cache();
+
+    util::lru_cache<std::string, entry> cache_;
+};
+
+extern template class MAPNIK_DECL singleton<feature_cache, CreateStatic>;
+
+}
+
+#endif // MAPNIK_FEATURE_CACHE_HPP
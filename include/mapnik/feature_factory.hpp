@@ -26,6 +26,7 @@
 // mapnik
 #include <mapnik/feature.hpp>
 #include <mapnik/value/types.hpp>
+#include <mapnik/util/arena.hpp>
 
 // boost
 //#include <boost/pool/pool_alloc.hpp>
@@ -40,6 +41,19 @@ struct feature_factory
         //return boost::allocate_shared<feature_impl>(boost::fast_pool_allocator<feature_impl>(),fid);
         return std::make_shared<feature_impl>(ctx,fid);
     }
+
+    // allocates the feature, its reference count and its attribute value
+    // storage from `arena` when given; geometries are still allocated on
+    // the heap, the geometry types take no allocator
+    static std::shared_ptr<feature_impl> create (context_ptr const& ctx, mapnik::value_integer fid,
+                                                 std::shared_ptr<util::arena> const& arena)
+    {
+        if (arena)
+        {
+            return std::allocate_shared<feature_impl>(util::arena_allocator<feature_impl>(arena), ctx, fid, arena);
+        }
+        return std::make_shared<feature_impl>(ctx,fid);
+    }
 };
 }
 
@@ -26,6 +26,7 @@
 // mapnik
 #include <mapnik/config.hpp>
 #include <mapnik/value.hpp>
+#include <mapnik/feature_schema.hpp>
 #include <mapnik/util/variant.hpp>
 
 #pragma GCC diagnostic push
@@ -37,7 +38,6 @@
 #pragma GCC diagnostic pop
 
 // stl
-#include <map>
 #include <tuple>
 
 namespace mapnik {
@@ -62,7 +62,7 @@ private:
     value_type const& dereference() const;
 
     feature_impl const& f_;
-    std::map<std::string,std::size_t>::const_iterator itr_;
+    feature_schema::const_iterator itr_;
     mutable value_type kv_;
 
 };
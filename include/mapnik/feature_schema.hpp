@@ -0,0 +1,234 @@
+/*****************************************************************************
+ *
+ * This file is part of Mapnik (c++ mapping toolkit)
+ *
+ * Copyright (C) 2017 Artem Pavlenko
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ *****************************************************************************/
+
+#ifndef MAPNIK_FEATURE_SCHEMA_HPP
+#define MAPNIK_FEATURE_SCHEMA_HPP
+
+// stl
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <iterator>
+#include <mutex>
+#include <numeric>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace mapnik {
+
+// Flat replacement for std::map<std::string, std::size_t> used by feature
+// contexts. Columns are kept in a vector and indexed by an open addressing
+// hash table storing the precomputed hash of every name. Lookups hash the
+// key once and only compare strings on a hash match. Columns are appended
+// and inserted into the table in amortized constant time, the table doubles
+// once it is half full. Iteration is ordered by name, as std::map iterated,
+// through a sorted index rebuilt by begin() after columns were added.
+class feature_schema
+{
+public:
+    using key_type = std::string;
+    using mapped_type = std::size_t;
+    using value_type = std::pair<key_type, mapped_type>;
+    using container_type = std::vector<value_type>;
+    using size_type = container_type::size_type;
+    using difference_type = container_type::difference_type;
+    using hasher = std::hash<key_type>;
+
+    // forward iterator following the sorted index, iterators returned by
+    // find() are only meant to be dereferenced and compared to end()
+    class const_iterator
+    {
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = feature_schema::value_type;
+        using difference_type = feature_schema::difference_type;
+        using pointer = value_type const*;
+        using reference = value_type const&;
+
+        const_iterator()
+            : schema_(nullptr),
+              pos_(end_pos) {}
+
+        reference operator*() const { return schema_->entries_[pos_]; }
+        pointer operator->() const { return &schema_->entries_[pos_]; }
+
+        const_iterator & operator++()
+        {
+            pos_ = schema_->next_[pos_];
+            return *this;
+        }
+
+        const_iterator operator++(int)
+        {
+            const_iterator itr(*this);
+            ++(*this);
+            return itr;
+        }
+
+        bool operator==(const_iterator const& rhs) const { return pos_ == rhs.pos_; }
+        bool operator!=(const_iterator const& rhs) const { return pos_ != rhs.pos_; }
+
+    private:
+        friend class feature_schema;
+        const_iterator(feature_schema const* schema, std::uint32_t pos)
+            : schema_(schema),
+              pos_(pos) {}
+
+        feature_schema const* schema_;
+        std::uint32_t pos_;
+    };
+    using iterator = const_iterator;
+
+    feature_schema()
+        : entries_(),
+          slots_(),
+          mask_(0),
+          next_(),
+          head_(end_pos),
+          sorted_(true),
+          sort_mutex_() {}
+
+    std::pair<const_iterator, bool> emplace(key_type const& key, mapped_type index)
+    {
+        std::size_t hash = hasher()(key);
+        const_iterator itr = find(key, hash);
+        if (itr != end()) return std::make_pair(itr, false);
+        if ((entries_.size() + 1) * 2 > slots_.size())
+        {
+            grow();
+        }
+        entries_.emplace_back(key, index);
+        insert_slot(hash, entries_.size() - 1);
+        sorted_.store(false, std::memory_order_relaxed);
+        return std::make_pair(const_iterator(this, static_cast<std::uint32_t>(entries_.size() - 1)), true);
+    }
+
+    // builds the sorted index up front, no columns are added afterwards
+    void freeze()
+    {
+        sort_index();
+    }
+
+    const_iterator find(key_type const& key) const
+    {
+        return find(key, hasher()(key));
+    }
+
+    // lookup with a hash computed by the caller using feature_schema::hasher
+    const_iterator find(key_type const& key, std::size_t hash) const
+    {
+        if (slots_.empty()) return end();
+        for (std::size_t i = hash & mask_;; i = (i + 1) & mask_)
+        {
+            slot const& s = slots_[i];
+            if (s.pos == empty_slot) return end();
+            if (s.hash == hash && entries_[s.pos].first == key)
+            {
+                return const_iterator(this, s.pos);
+            }
+        }
+    }
+
+    size_type count(key_type const& key) const
+    {
+        return find(key) != end() ? 1 : 0;
+    }
+
+    size_type size() const { return entries_.size(); }
+    bool empty() const { return entries_.empty(); }
+
+    const_iterator begin() const
+    {
+        if (!sorted_.load(std::memory_order_acquire)) sort_index();
+        return const_iterator(this, head_);
+    }
+
+    const_iterator end() const { return const_iterator(this, end_pos); }
+
+private:
+    static constexpr std::uint32_t empty_slot = 0xffffffff;
+    static constexpr std::uint32_t end_pos = 0xffffffff;
+    struct slot
+    {
+        std::size_t hash;
+        std::uint32_t pos;
+    };
+
+    void insert_slot(std::size_t hash, std::size_t pos)
+    {
+        std::size_t i = hash & mask_;
+        while (slots_[i].pos != empty_slot) i = (i + 1) & mask_;
+        slots_[i] = slot{hash, static_cast<std::uint32_t>(pos)};
+    }
+
+    // doubles the table, keeping the load factor at or below 0.5,
+    // from the stored hashes
+    void grow()
+    {
+        std::size_t capacity = slots_.empty() ? 8 : slots_.size() * 2;
+        std::vector<slot> old(capacity, slot{0, empty_slot});
+        old.swap(slots_);
+        mask_ = capacity - 1;
+        for (slot const& s : old)
+        {
+            if (s.pos != empty_slot) insert_slot(s.hash, s.pos);
+        }
+        entries_.reserve(capacity / 2);
+    }
+
+    // links the columns in name order, features sharing a context may
+    // iterate it from several threads
+    void sort_index() const
+    {
+        std::lock_guard<std::mutex> lock(sort_mutex_);
+        if (sorted_.load(std::memory_order_relaxed)) return;
+        std::vector<std::uint32_t> order(entries_.size());
+        std::iota(order.begin(), order.end(), 0);
+        std::sort(order.begin(), order.end(), [this](std::uint32_t lhs, std::uint32_t rhs)
+                  { return entries_[lhs].first < entries_[rhs].first; });
+        next_.resize(entries_.size());
+        std::uint32_t next = end_pos;
+        for (auto itr = order.rbegin(); itr != order.rend(); ++itr)
+        {
+            next_[*itr] = next;
+            next = *itr;
+        }
+        head_ = next;
+        sorted_.store(true, std::memory_order_release);
+    }
+
+    container_type entries_;
+    std::vector<slot> slots_;
+    std::size_t mask_;
+    // sorted index: first column by name and the column following each
+    mutable std::vector<std::uint32_t> next_;
+    mutable std::uint32_t head_;
+    mutable std::atomic<bool> sorted_;
+    mutable std::mutex sort_mutex_;
+};
+
+}
+
+#endif // MAPNIK_FEATURE_SCHEMA_HPP
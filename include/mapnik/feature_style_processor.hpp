@@ -33,17 +33,27 @@
 #include <vector>
 #include <set>
 #include <string>
+#include <memory>
+#include <unordered_map>
 
 namespace mapnik
 {
 
 class Map;
+class request;
 class layer;
 class projection;
 class proj_transform;
 class feature_type_style;
+class feature_impl;
+class rule;
 class rule_cache;
+class render_report;
+class render_plan_cache;
+struct rule_report;
+struct style_report;
 struct layer_rendering_material;
+namespace util { class thread_pool; }
 
 enum eAttributeCollectionPolicy
 {
@@ -63,6 +73,12 @@ public:
      */
     void apply(double scale_denom_override=0.0);
 
+    /*!
+     * \brief apply renderer to all map layers, taking size, extent and
+     * buffer size from the request instead of the map.
+     */
+    void apply(request const& req, double scale_denom_override=0.0);
+
     /*!
      * \brief apply renderer to a single layer, providing pre-populated set of query attribute names.
      */
@@ -84,7 +100,70 @@ public:
                         int buffer_size,
                         std::set<std::string>& names);
 
+    /*!
+     * \brief issue datasource queries of all layers concurrently on the given pool.
+     *
+     * Featuresets are read on the worker threads during the prepare phase
+     * and consumed in layer order while rendering, so output is unchanged.
+     * Up to the query buffer limit features per query are buffered in memory
+     * until the layer has been rendered, the rest is read while rendering.
+     * No more than max_concurrent_queries() queries run against a datasource
+     * at once: one for most datasources, max_size for synchronous postgis
+     * and no limit for memory and geojson. Layers whose datasource provides a
+     * processor context (e.g. asynchronous postgis) are queried on the
+     * rendering thread. Passing an empty pointer restores serial querying.
+     */
+    void set_query_pool(std::shared_ptr<util::thread_pool> const& pool);
+
+    /*!
+     * \brief read at most max_features features of a query on the query pool.
+     *
+     * Past the limit the rendering thread reads the remaining features from
+     * the live featureset, which keeps its datasource query slot (see
+     * datasource::max_concurrent_queries) until it is exhausted.
+     */
+    void set_query_buffer_limit(std::size_t max_features);
+
+    /*!
+     * \brief evaluate rule filters with their compiled expression_program
+     * instead of walking the expression tree.
+     */
+    void set_compiled_filters(bool compiled);
+
+    /*!
+     * \brief give every datasource query its own util::arena.
+     *
+     * Datasources supporting it allocate features, their reference counts
+     * and attribute values from the arena. Memory of released features is
+     * reused by the next ones, so streamed queries stay small. Geometries
+     * are still allocated on the heap.
+     */
+    void set_feature_arenas(bool enabled);
+
+    /*!
+     * \brief record wall time, feature and vertex counts per layer, style,
+     * rule and symbolizer into the given report while rendering.
+     *
+     * Passing an empty pointer disables the instrumentation.
+     */
+    void set_render_report(std::shared_ptr<render_report> const& report);
+    std::shared_ptr<render_report> const& get_render_report() const;
+
+    /*!
+     * \brief take active styles, rule caches and attribute names of layers
+     * from the given cache instead of computing them for every render.
+     *
+     * The cache must have been created for the Map this processor renders.
+     * Passing an empty pointer restores the uncached setup.
+     */
+    void set_render_plans(std::shared_ptr<render_plan_cache> const& plans);
+
 private:
+    // number of features fetched with Featureset::next_batch and
+    // filtered together in render_style
+    static constexpr std::size_t feature_batch_size = 256;
+    static constexpr std::size_t default_query_buffer_limit = 65536;
+
     /*!
      * \brief renders a featureset with the given styles.
      */
@@ -92,13 +171,42 @@ private:
                       feature_type_style const* style,
                       rule_cache const& rules,
                       featureset_ptr features,
-                      proj_transform const& prj_trans);
+                      proj_transform const& prj_trans,
+                      style_report * report);
+
+    /*!
+     * \brief renders a feature with the symbolizers of a rule.
+     */
+    void render_symbolizers(Processor & p,
+                            rule const& r,
+                            feature_impl & feature,
+                            proj_transform const& prj_trans,
+                            rule_report * report);
+
+    /*!
+     * \brief maps the map's styles to their names for get_style_report.
+     */
+    void index_styles();
+
+    style_report * get_style_report(layer const& lay, feature_type_style const* style);
+
+    void apply_view(double scale,
+                    unsigned width,
+                    unsigned height,
+                    box2d<double> const& extent,
+                    int buffer_size,
+                    double scale_denom);
 
     void prepare_layers(layer_rendering_material & parent_mat,
                         std::vector<layer> const & layers,
                         feature_style_context_map & ctx_map,
                         Processor & p,
-                        double scale_denom);
+                        double scale,
+                        double scale_denom,
+                        unsigned width,
+                        unsigned height,
+                        box2d<double> const& extent,
+                        int buffer_size);
 
     /*!
      * \brief prepare features for rendering asynchronously.
@@ -121,6 +229,13 @@ private:
     void render_submaterials(layer_rendering_material const & mat, Processor & p);
 
     Map const& m_;
+    std::shared_ptr<util::thread_pool> query_pool_;
+    std::size_t query_buffer_limit_;
+    bool compiled_filters_;
+    bool feature_arenas_;
+    std::shared_ptr<render_report> report_;
+    std::shared_ptr<render_plan_cache> plans_;
+    std::unordered_map<feature_type_style const*, std::string const*> style_names_;
 };
 }
 
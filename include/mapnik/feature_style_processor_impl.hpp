@@ -39,15 +39,28 @@
 #include <mapnik/rule_cache.hpp>
 #include <mapnik/attribute_collector.hpp>
 #include <mapnik/expression_evaluator.hpp>
+#include <mapnik/expression_program.hpp>
 #include <mapnik/scale_denominator.hpp>
 #include <mapnik/projection.hpp>
 #include <mapnik/proj_transform.hpp>
+#include <mapnik/proj_transform_cache.hpp>
+#include <mapnik/query_slots.hpp>
+#include <mapnik/render_report.hpp>
+#include <mapnik/render_plan.hpp>
+#include <mapnik/request.hpp>
+#include <mapnik/symbolizer_utils.hpp>
+#include <mapnik/util/arena.hpp>
 #include <mapnik/util/featureset_buffer.hpp>
+#include <mapnik/util/deferred_featureset.hpp>
+#include <mapnik/util/prefetched_featureset.hpp>
+#include <mapnik/util/thread_pool.hpp>
 #include <mapnik/util/variant.hpp>
 #include <mapnik/symbolizer_dispatch.hpp>
 
 // stl
+#include <array>
 #include <vector>
+#include <future>
 #include <stdexcept>
 
 namespace mapnik
@@ -58,25 +71,48 @@ struct layer_rendering_material
 {
     layer const& lay_;
     projection const& proj0_;
-    projection proj1_;
+    // map to layer srs, from the calling thread's proj_transform_cache
+    // entries and set by prepare_layer
+    proj_transform_cache::transform_ptr prj_trans_;
     box2d<double> layer_ext2_;
     std::vector<feature_type_style const*> active_styles_;
     std::vector<featureset_ptr> featureset_ptr_list_;
-    std::vector<rule_cache> rule_caches_;
+    // worker side timings of the queries issued on the query pool
+    std::vector<std::pair<std::shared_future<featureset_ptr>,
+                          std::shared_ptr<render_stats>>> pooled_queries_;
+    layer_plan_ptr plan_;
     std::vector<layer_rendering_material> materials_;
 
     layer_rendering_material(layer const& lay, projection const& dest)
         :
         lay_(lay),
         proj0_(dest),
-        proj1_(lay.srs(),true) {}
+        prj_trans_() {}
 
     layer_rendering_material(layer_rendering_material && rhs) = default;
 };
 
+// Adds the time spent reading pooled queries on the worker threads to the
+// layer report, once their results are ready.
+inline void report_pooled_queries(layer_rendering_material const& mat, layer_report & report)
+{
+    for (auto const& pooled : mat.pooled_queries_)
+    {
+        pooled.first.wait();
+        report.query.add(*pooled.second);
+    }
+}
+
 template <typename Processor>
 feature_style_processor<Processor>::feature_style_processor(Map const& m, double scale_factor)
-    : m_(m)
+    : m_(m),
+      query_pool_(),
+      query_buffer_limit_(default_query_buffer_limit),
+      compiled_filters_(false),
+      feature_arenas_(false),
+      report_(),
+      plans_(),
+      style_names_()
 {
     // https://github.com/mapnik/mapnik/issues/1100
     if (scale_factor <= 0)
@@ -85,12 +121,90 @@ feature_style_processor<Processor>::feature_style_processor(Map const& m, double
     }
 }
 
+template <typename Processor>
+void feature_style_processor<Processor>::set_query_pool(std::shared_ptr<util::thread_pool> const& pool)
+{
+    query_pool_ = pool;
+}
+
+template <typename Processor>
+void feature_style_processor<Processor>::set_query_buffer_limit(std::size_t max_features)
+{
+    query_buffer_limit_ = max_features;
+}
+
+template <typename Processor>
+void feature_style_processor<Processor>::set_compiled_filters(bool compiled)
+{
+    compiled_filters_ = compiled;
+}
+
+template <typename Processor>
+void feature_style_processor<Processor>::set_feature_arenas(bool enabled)
+{
+    feature_arenas_ = enabled;
+}
+
+template <typename Processor>
+void feature_style_processor<Processor>::set_render_report(std::shared_ptr<render_report> const& report)
+{
+    report_ = report;
+}
+
+template <typename Processor>
+std::shared_ptr<render_report> const& feature_style_processor<Processor>::get_render_report() const
+{
+    return report_;
+}
+
+template <typename Processor>
+void feature_style_processor<Processor>::set_render_plans(std::shared_ptr<render_plan_cache> const& plans)
+{
+    if (plans && &plans->map() != &m_)
+    {
+        throw std::runtime_error("render_plan_cache was created for a different map");
+    }
+    plans_ = plans;
+}
+
+template <typename Processor>
+void feature_style_processor<Processor>::index_styles()
+{
+    style_names_.clear();
+    if (!report_) return;
+    for (auto const& kv : m_.styles())
+    {
+        style_names_.emplace(&kv.second, &kv.first);
+    }
+}
+
+template <typename Processor>
+style_report * feature_style_processor<Processor>::get_style_report(layer const& lay,
+                                                                    feature_type_style const* style)
+{
+    if (!report_) return nullptr;
+    auto itr = style_names_.find(style);
+    if (itr == style_names_.end())
+    {
+        // rendering started with apply_to_layer
+        index_styles();
+        itr = style_names_.find(style);
+        if (itr == style_names_.end()) return nullptr;
+    }
+    return &report_->layer(lay.name()).style(*itr->second);
+}
+
 template <typename Processor>
 void feature_style_processor<Processor>::prepare_layers(layer_rendering_material & parent_mat,
                                                         std::vector<layer> const & layers,
                                                         feature_style_context_map & ctx_map,
                                                         Processor & p,
-                                                        double scale_denom)
+                                                        double scale,
+                                                        double scale_denom,
+                                                        unsigned width,
+                                                        unsigned height,
+                                                        box2d<double> const& extent,
+                                                        int buffer_size)
 {
     for (layer const& lyr : layers)
     {
@@ -102,18 +216,19 @@ void feature_style_processor<Processor>::prepare_layers(layer_rendering_material
             prepare_layer(mat,
                           ctx_map,
                           p,
-                          m_.scale(),
+                          scale,
                           scale_denom,
-                          m_.width(),
-                          m_.height(),
-                          m_.get_current_extent(),
-                          m_.buffer_size(),
+                          width,
+                          height,
+                          extent,
+                          buffer_size,
                           names);
 
             // Store active material
             if (!mat.active_styles_.empty())
             {
-                prepare_layers(mat, lyr.layers(), ctx_map, p, scale_denom);
+                prepare_layers(mat, lyr.layers(), ctx_map, p, scale, scale_denom,
+                               width, height, extent, buffer_size);
                 parent_mat.materials_.emplace_back(std::move(mat));
             }
         }
@@ -122,13 +237,42 @@ void feature_style_processor<Processor>::prepare_layers(layer_rendering_material
 
 template <typename Processor>
 void feature_style_processor<Processor>::apply(double scale_denom)
+{
+    apply_view(m_.scale(),
+               m_.width(),
+               m_.height(),
+               m_.get_current_extent(),
+               m_.buffer_size(),
+               scale_denom);
+}
+
+template <typename Processor>
+void feature_style_processor<Processor>::apply(request const& req, double scale_denom)
+{
+    apply_view(req.scale(),
+               req.width(),
+               req.height(),
+               req.extent(),
+               req.buffer_size(),
+               scale_denom);
+}
+
+template <typename Processor>
+void feature_style_processor<Processor>::apply_view(double scale,
+                                                    unsigned width,
+                                                    unsigned height,
+                                                    box2d<double> const& extent,
+                                                    int buffer_size,
+                                                    double scale_denom)
 {
     Processor & p = static_cast<Processor&>(*this);
+    render_timer timer(report_ != nullptr);
+    index_styles();
     p.start_map_processing(m_);
 
     projection proj(m_.srs(),true);
     if (scale_denom <= 0.0)
-        scale_denom = mapnik::scale_denominator(m_.scale(),proj.is_geographic());
+        scale_denom = mapnik::scale_denominator(scale,proj.is_geographic());
     scale_denom *= p.scale_factor(); // FIXME - we might want to comment this out
 
     // Asynchronous query supports:
@@ -144,12 +288,14 @@ void feature_style_processor<Processor>::apply(double scale_denom)
     if (!m_.layers().empty())
     {
         layer_rendering_material root_mat(m_.layers().front(), proj);
-        prepare_layers(root_mat, m_.layers(), ctx_map, p, scale_denom);
+        prepare_layers(root_mat, m_.layers(), ctx_map, p, scale, scale_denom,
+                       width, height, extent, buffer_size);
 
         render_submaterials(root_mat, p);
     }
 
     p.end_map_processing(m_);
+    if (report_) timer.stop(report_->total);
 }
 
 template <typename Processor>
@@ -158,6 +304,8 @@ void feature_style_processor<Processor>::apply(mapnik::layer const& lyr,
                                                double scale_denom)
 {
     Processor & p = static_cast<Processor&>(*this);
+    render_timer timer(report_ != nullptr);
+    index_styles();
     p.start_map_processing(m_);
     projection proj(m_.srs(),true);
     if (scale_denom <= 0.0)
@@ -178,6 +326,7 @@ void feature_style_processor<Processor>::apply(mapnik::layer const& lyr,
                        names);
     }
     p.end_map_processing(m_);
+    if (report_) timer.stop(report_->total);
 }
 
 /*!
@@ -209,13 +358,20 @@ void feature_style_processor<Processor>::apply_to_layer(layer const& lay,
                   buffer_size,
                   names);
 
-    prepare_layers(mat, lay.layers(), ctx_map, p, scale_denom);
+    prepare_layers(mat, lay.layers(), ctx_map, p, scale, scale_denom,
+                   width, height, extent, buffer_size);
 
     if (!mat.active_styles_.empty())
     {
         p.start_layer_processing(mat.lay_, mat.layer_ext2_);
 
+        render_timer timer(report_ != nullptr);
         render_material(mat,p);
+        if (report_)
+        {
+            timer.stop(report_->layer(mat.lay_.name()).total);
+            report_pooled_queries(mat, report_->layer(mat.lay_.name()));
+        }
         render_submaterials(mat, p);
 
         p.end_layer_processing(mat.lay_);
@@ -255,7 +411,8 @@ void feature_style_processor<Processor>::prepare_layer(layer_rendering_material
     }
 
     processor_context_ptr current_ctx = ds->get_context(ctx_map);
-    proj_transform prj_trans(mat.proj0_,mat.proj1_);
+    mat.prj_trans_ = proj_transform_cache::instance().get(mat.proj0_.params(), lay.srs());
+    proj_transform const& prj_trans = *mat.prj_trans_;
 
     box2d<double> query_ext = extent; // unbuffered
     box2d<double> buffered_query_ext(query_ext);  // buffered
@@ -316,28 +473,13 @@ void feature_style_processor<Processor>::prepare_layer(layer_rendering_material
     }
 
     std::vector<feature_type_style const*> & active_styles = mat.active_styles_;
+    mat.plan_ = plans_ ? plans_->get(lay, scale_denom) : render_plan_cache::make_plan(m_, lay, scale_denom);
+    layer_plan const& plan = *mat.plan_;
 
     if (early_return)
     {
-        // check for styles needing compositing operations applied
-        // https://github.com/mapnik/mapnik/issues/1477
-        for (std::string const& style_name : style_names)
-        {
-            boost::optional<feature_type_style const&> style=m_.find_style(style_name);
-            if (!style)
-            {
-                continue;
-            }
-
-            if (style->comp_op() || style->image_filters().size() > 0)
-            {
-                if (style->active(scale_denom))
-                {
-                    // we'll have to handle compositing ops
-                    active_styles.push_back(&(*style));
-                }
-            }
-        }
+        // we'll have to handle compositing ops
+        active_styles = plan.composite_styles;
         return;
     }
 
@@ -367,40 +509,8 @@ void feature_style_processor<Processor>::prepare_layer(layer_rendering_material
         }
     }
 
-    std::vector<rule_cache> & rule_caches = mat.rule_caches_;
-    attribute_collector collector(names);
-
-    // iterate through all named styles collecting active styles and attribute names
-    for (std::string const& style_name : style_names)
-    {
-        boost::optional<feature_type_style const&> style=m_.find_style(style_name);
-        if (!style)
-        {
-            MAPNIK_LOG_ERROR(feature_style_processor)
-                << "feature_style_processor: Style=" << style_name
-                << " required for layer=" << lay.name() << " does not exist.";
-
-            continue;
-        }
-
-        std::vector<rule> const& style_rules = style->get_rules();
-        bool active_rules = false;
-        rule_cache rc;
-        for(rule const& r : style_rules)
-        {
-            if (r.active(scale_denom))
-            {
-                rc.add_rule(r);
-                active_rules = true;
-                collector(r);
-            }
-        }
-        if (active_rules)
-        {
-            rule_caches.push_back(std::move(rc));
-            active_styles.push_back(&(*style));
-        }
-    }
+    active_styles = plan.active_styles;
+    names.insert(plan.names.begin(), plan.names.end());
 
     // Don't even try to do more work if there are no active styles.
     if (active_styles.empty())
@@ -431,7 +541,7 @@ void feature_style_processor<Processor>::prepare_layer(layer_rendering_material
             q.add_property_name(name);
         }
     }
-    q.set_filter_factor(collector.get_filter_factor());
+    q.set_filter_factor(plan.filter_factor);
 
     // Also query the group by attribute
     std::string const& group_by = lay.group_by();
@@ -441,18 +551,65 @@ void feature_style_processor<Processor>::prepare_layer(layer_rendering_material
     }
 
     bool cache_features = lay.cache_features() && active_styles.size() > 1;
+    std::size_t num_queries = (!group_by.empty() || cache_features) ? 1 : active_styles.size();
 
     std::vector<featureset_ptr> & featureset_ptr_list = mat.featureset_ptr_list_;
-    if (!group_by.empty() || cache_features)
+    // Datasources providing a processor context already query asynchronously
+    // and their context is not meant to be shared between threads.
+    if (query_pool_ && !current_ctx)
     {
-        featureset_ptr_list.push_back(ds->features_with_context(q,current_ctx));
+        for (std::size_t i = 0; i < num_queries; ++i)
+        {
+            if (feature_arenas_) q.set_arena(std::make_shared<util::arena>());
+            // submitting is cheap, the query is timed where it runs
+            std::shared_ptr<render_stats> stats = report_ ? std::make_shared<render_stats>() : nullptr;
+            std::size_t buffer_limit = query_buffer_limit_;
+            std::shared_future<featureset_ptr> result = query_pool_->submit([ds, q, current_ctx, stats, buffer_limit]() -> featureset_ptr
+            {
+                render_timer timer(stats != nullptr);
+                // Most datasources share a single handle (file, dataset, layer)
+                // between queries and PostGIS hands out max_size connections;
+                // keep the slot until the featureset is exhausted.
+                query_slot slot;
+                std::size_t limit = ds->max_concurrent_queries();
+                if (limit != query_slot_queue::unlimited)
+                {
+                    slot = query_slot(ds->query_slots(), limit);
+                }
+                featureset_ptr features = ds->features_with_context(q, current_ctx);
+                if (!features)
+                {
+                    return features;
+                }
+                // Read ahead on the worker thread so I/O bound datasources do
+                // not block the rendering thread later on. Past the buffer
+                // limit the live featureset is handed back to bound memory.
+                std::vector<feature_ptr> buffer;
+                feature_ptr feature;
+                while (buffer.size() < buffer_limit && (feature = features->next()))
+                {
+                    buffer.push_back(std::move(feature));
+                }
+                if (buffer.size() < buffer_limit)
+                {
+                    features.reset();
+                }
+                if (stats) timer.stop(*stats, buffer.size());
+                return std::make_shared<prefetched_featureset>(std::move(buffer), features, std::move(slot));
+            }).share();
+            featureset_ptr_list.push_back(std::make_shared<deferred_featureset>(result));
+            if (stats) mat.pooled_queries_.emplace_back(result, stats);
+        }
     }
     else
     {
-        for(std::size_t i = 0; i < active_styles.size(); ++i)
+        render_timer query_timer(report_ != nullptr);
+        for (std::size_t i = 0; i < num_queries; ++i)
         {
+            if (feature_arenas_) q.set_arena(std::make_shared<util::arena>());
             featureset_ptr_list.push_back(ds->features_with_context(q,current_ctx));
         }
+        if (report_) query_timer.stop(report_->layer(lay.name()).query);
     }
 }
 
@@ -466,7 +623,13 @@ void feature_style_processor<Processor>::render_submaterials(layer_rendering_mat
         {
             p.start_layer_processing(mat.lay_, mat.layer_ext2_);
 
+            render_timer timer(report_ != nullptr);
             render_material(mat, p);
+            if (report_)
+            {
+                timer.stop(report_->layer(mat.lay_.name()).total);
+                report_pooled_queries(mat, report_->layer(mat.lay_.name()));
+            }
             render_submaterials(mat, p);
 
             p.end_layer_processing(mat.lay_);
@@ -486,17 +649,24 @@ void feature_style_processor<Processor>::render_material(layer_rendering_materia
         // but we have to apply compositing operations on styles
         for (feature_type_style const* style : active_styles)
         {
+            style_report * report = get_style_report(mat.lay_, style);
+            render_timer timer(report != nullptr);
             p.start_style_processing(*style);
             p.end_style_processing(*style);
+            if (report)
+            {
+                timer.stop(report->composite);
+                timer.stop(report->total);
+            }
         }
         return;
     }
 
     layer const& lay = mat.lay_;
 
-    std::vector<rule_cache> const & rule_caches = mat.rule_caches_;
+    std::vector<rule_cache> const & rule_caches = mat.plan_->rule_caches;
 
-    proj_transform prj_trans(mat.proj0_,mat.proj1_);
+    proj_transform const& prj_trans = *mat.prj_trans_;
 
     bool cache_features = lay.cache_features() && active_styles.size() > 1;
 
@@ -527,7 +697,8 @@ void feature_style_processor<Processor>::render_material(layer_rendering_materia
                         render_style(p, style,
                                      rule_caches[i],
                                      cache,
-                                     prj_trans);
+                                     prj_trans,
+                                     get_style_report(lay, style));
                         ++i;
                     }
                     cache->clear();
@@ -540,7 +711,8 @@ void feature_style_processor<Processor>::render_material(layer_rendering_materia
             for (feature_type_style const* style : active_styles)
             {
                 cache->prepare();
-                render_style(p, style, rule_caches[i], cache, prj_trans);
+                render_style(p, style, rule_caches[i], cache, prj_trans,
+                             get_style_report(lay, style));
                 ++i;
             }
             cache->clear();
@@ -552,6 +724,7 @@ void feature_style_processor<Processor>::render_material(layer_rendering_materia
         featureset_ptr features = *featureset_ptr_list.begin();
         if (features)
         {
+            render_timer timer(report_ != nullptr);
             // Cache all features into the memory_datasource before rendering.
             feature_ptr feature;
             while ((feature = features->next()))
@@ -559,6 +732,7 @@ void feature_style_processor<Processor>::render_material(layer_rendering_materia
 
                 cache->push(feature);
             }
+            if (report_) timer.stop(report_->layer(lay.name()).query);
         }
         std::size_t i = 0;
         for (feature_type_style const* style : active_styles)
@@ -566,7 +740,8 @@ void feature_style_processor<Processor>::render_material(layer_rendering_materia
             cache->prepare();
             render_style(p, style,
                          rule_caches[i],
-                         cache, prj_trans);
+                         cache, prj_trans,
+                         get_style_report(lay, style));
             ++i;
         }
     }
@@ -581,7 +756,8 @@ void feature_style_processor<Processor>::render_material(layer_rendering_materia
             render_style(p, style,
                          rule_caches[i],
                          features,
-                         prj_trans);
+                         prj_trans,
+                         get_style_report(lay, style));
             ++i;
         }
     }
@@ -593,79 +769,173 @@ void feature_style_processor<Processor>::render_style(
     feature_type_style const* style,
     rule_cache const& rc,
     featureset_ptr features,
-    proj_transform const& prj_trans)
+    proj_transform const& prj_trans,
+    style_report * report)
 {
+    render_timer style_timer(report != nullptr);
     p.start_style_processing(*style);
-    if (!features)
-    {
-        p.end_style_processing(*style);
-        return;
-    }
-    mapnik::attributes vars = p.variables();
-    feature_ptr feature;
-    bool was_painted = false;
-    while ((feature = features->next()))
+    if (features)
     {
-        bool do_else = true;
-        bool do_also = false;
-        for (rule const* r : rc.get_if_rules() )
+        std::vector<rule> const& style_rules = style->get_rules();
+        if (report && report->rules.size() != style_rules.size())
         {
-            expression_ptr const& expr = r->get_filter();
-            value_type result = util::apply_visitor(evaluate<feature_impl,value_type,attributes>(*feature,vars),*expr);
-            if (result.to_bool())
+            report->rules.resize(style_rules.size());
+            for (std::size_t r = 0; r < style_rules.size(); ++r)
             {
-                was_painted = true;
-                do_else=false;
-                do_also=true;
-                rule::symbolizers const& symbols = r->get_symbolizers();
-                if(!p.process(symbols,*feature,prj_trans))
-                {
-                    for (symbolizer const& sym : symbols)
-                    {
-                        util::apply_visitor(symbolizer_dispatch<Processor>(p,*feature,prj_trans),sym);
-                    }
-                }
-                if (style->get_filter_mode() == FILTER_FIRST)
+                report->rules[r].name = style_rules[r].get_name();
+                rule::symbolizers const& symbols = style_rules[r].get_symbolizers();
+                report->rules[r].symbolizers.resize(symbols.size());
+                for (std::size_t s = 0; s < symbols.size(); ++s)
                 {
-                    // Stop iterating over rules and proceed with next feature.
-                    do_also=false;
-                    break;
+                    report->rules[r].symbolizers[s].type = symbolizer_name(symbols[s]);
                 }
             }
         }
-        if (do_else)
+        // rules of the rule cache point into the style's rules
+        auto rule_report_of = [&](rule const* r) -> rule_report *
+        {
+            return report ? &report->rules[r - style_rules.data()] : nullptr;
+        };
+        mapnik::attributes vars = p.variables();
+        std::vector<value_type> registers;
+        std::vector<rule const*> const& if_rules = rc.get_if_rules();
+        std::size_t const num_if_rules = if_rules.size();
+        bool const filter_first = style->get_filter_mode() == FILTER_FIRST;
+        std::array<feature_ptr, feature_batch_size> batch;
+        // matches[r * feature_batch_size + i] is set when if-rule r passes feature i
+        std::vector<char> matches(num_if_rules * feature_batch_size);
+        std::array<char, feature_batch_size> matched;
+        bool was_painted = false;
+        std::size_t size;
+        render_timer query_timer(report != nullptr);
+        while ((size = features->next_batch(batch.data(), batch.size())) > 0)
         {
-            for( rule const* r : rc.get_else_rules() )
+            if (report) query_timer.stop(report->query, size);
+            // Evaluate filters rule by rule over the whole batch, with
+            // FILTER_FIRST a feature is skipped once a rule matched it.
+            matched.fill(0);
+            for (std::size_t r = 0; r < num_if_rules; ++r)
             {
-                was_painted = true;
-                rule::symbolizers const& symbols = r->get_symbolizers();
-                if(!p.process(symbols,*feature,prj_trans))
+                render_timer filter_timer(report != nullptr);
+                std::size_t tested = 0;
+                std::size_t passed = 0;
+                rule const* rl = if_rules[r];
+                std::shared_ptr<expression_program const> const& program = rl->get_filter_program();
+                expression_ptr const& expr = rl->get_filter();
+                char * rule_matches = &matches[r * feature_batch_size];
+                for (std::size_t i = 0; i < size; ++i)
                 {
-                    for (symbolizer const& sym : symbols)
+                    rule_matches[i] = 0;
+                    if (filter_first && matched[i]) continue;
+                    ++tested;
+                    feature_impl const& feature = *batch[i];
+                    value_type result;
+                    if (compiled_filters_ && program)
                     {
-                        util::apply_visitor(symbolizer_dispatch<Processor>(p,*feature,prj_trans),sym);
+                        result = program->evaluate(feature, vars, registers);
                     }
+                    else
+                    {
+                        result = util::apply_visitor(evaluate<feature_impl,value_type,attributes>(feature,vars),*expr);
+                    }
+                    if (result.to_bool())
+                    {
+                        rule_matches[i] = 1;
+                        matched[i] = 1;
+                        ++passed;
+                    }
+                }
+                if (rule_report * rr = rule_report_of(rl))
+                {
+                    filter_timer.stop(rr->filter, tested);
+                    rr->matches += passed;
                 }
             }
-        }
-        if (do_also)
-        {
-            for( rule const* r : rc.get_also_rules() )
+            for (std::size_t i = 0; i < size; ++i)
             {
-                was_painted = true;
-                rule::symbolizers const& symbols = r->get_symbolizers();
-                if(!p.process(symbols,*feature,prj_trans))
+                feature_impl & feature = *batch[i];
+                bool do_else = true;
+                bool do_also = false;
+                for (std::size_t r = 0; r < num_if_rules; ++r)
+                {
+                    if (matches[r * feature_batch_size + i])
+                    {
+                        was_painted = true;
+                        do_else=false;
+                        do_also=true;
+                        render_symbolizers(p, *if_rules[r], feature, prj_trans, rule_report_of(if_rules[r]));
+                        if (filter_first)
+                        {
+                            // Stop iterating over rules and proceed with next feature.
+                            do_also=false;
+                            break;
+                        }
+                    }
+                }
+                if (do_else)
+                {
+                    for( rule const* r : rc.get_else_rules() )
+                    {
+                        was_painted = true;
+                        render_symbolizers(p, *r, feature, prj_trans, rule_report_of(r));
+                    }
+                }
+                if (do_also)
                 {
-                    for (symbolizer const& sym : symbols)
+                    for( rule const* r : rc.get_also_rules() )
                     {
-                        util::apply_visitor(symbolizer_dispatch<Processor>(p,*feature,prj_trans),sym);
+                        was_painted = true;
+                        render_symbolizers(p, *r, feature, prj_trans, rule_report_of(r));
                     }
                 }
+                batch[i].reset();
             }
+            query_timer = render_timer(report != nullptr);
         }
+        if (report) query_timer.stop(report->query);
+        p.painted(p.painted() | was_painted);
     }
-    p.painted(p.painted() | was_painted);
+    render_timer composite_timer(report != nullptr);
     p.end_style_processing(*style);
+    if (report)
+    {
+        composite_timer.stop(report->composite);
+        style_timer.stop(report->total);
+    }
+}
+
+template <typename Processor>
+void feature_style_processor<Processor>::render_symbolizers(
+    Processor & p,
+    rule const& r,
+    feature_impl & feature,
+    proj_transform const& prj_trans,
+    rule_report * report)
+{
+    rule::symbolizers const& symbols = r.get_symbolizers();
+    if (!report)
+    {
+        if(!p.process(symbols,feature,prj_trans))
+        {
+            for (symbolizer const& sym : symbols)
+            {
+                util::apply_visitor(symbolizer_dispatch<Processor>(p,feature,prj_trans),sym);
+            }
+        }
+        return;
+    }
+    std::size_t vertices = vertex_count(feature.get_geometry());
+    render_timer timer;
+    if(!p.process(symbols,feature,prj_trans))
+    {
+        for (std::size_t s = 0; s < symbols.size(); ++s)
+        {
+            render_timer symbolizer_timer;
+            util::apply_visitor(symbolizer_dispatch<Processor>(p,feature,prj_trans),symbols[s]);
+            symbolizer_timer.stop(report->symbolizers[s].stats, 1, vertices);
+        }
+    }
+    timer.stop(report->render, 1, vertices);
 }
 
 }
@@ -28,7 +28,9 @@
 #include <mapnik/util/noncopyable.hpp>
 
 // boost
+#include <cstddef>
 #include <memory>
+#include <utility>
 
 namespace mapnik {
 
@@ -38,15 +40,49 @@ using feature_ptr = std::shared_ptr<feature_impl>;
 struct MAPNIK_DECL Featureset : private util::noncopyable
 {
     virtual feature_ptr next() = 0;
+    // Writes up to `size` features to `features` and returns how many were
+    // written, 0 once the featureset is exhausted. The default calls next().
+    virtual std::size_t next_batch(feature_ptr * features, std::size_t size);
     virtual ~Featureset() {}
 };
 
+// next_batch for featuresets whose next() is cheap: calls T::next()
+// directly so features are not fetched through one virtual call each.
+template <typename T>
+inline std::size_t fill_batch(T & fs, feature_ptr * features, std::size_t size)
+{
+    std::size_t count = 0;
+    while (count < size)
+    {
+        feature_ptr feature = fs.T::next();
+        if (!feature) break;
+        features[count++] = std::move(feature);
+    }
+    return count;
+}
+
+inline std::size_t Featureset::next_batch(feature_ptr * features, std::size_t size)
+{
+    std::size_t count = 0;
+    while (count < size)
+    {
+        feature_ptr feature = next();
+        if (!feature) break;
+        features[count++] = std::move(feature);
+    }
+    return count;
+}
+
 struct MAPNIK_DECL invalid_featureset final : Featureset
 {
     feature_ptr next()
     {
         return feature_ptr();
     }
+    std::size_t next_batch(feature_ptr *, std::size_t)
+    {
+        return 0;
+    }
     ~invalid_featureset() {}
 };
 
@@ -48,6 +48,29 @@ public:
         return feature;
     }
 
+    std::size_t next_batch(feature_ptr * features, std::size_t size)
+    {
+        std::size_t count = 0;
+        while (count == 0)
+        {
+            std::size_t num = fs_->next_batch(features, size);
+            if (num == 0) break;
+            for (std::size_t i = 0; i < num; ++i)
+            {
+                if (filter_.pass(*features[i]))
+                {
+                    if (count != i) features[count] = std::move(features[i]);
+                    ++count;
+                }
+            }
+            for (std::size_t i = count; i < num; ++i)
+            {
+                features[i].reset();
+            }
+        }
+        return count;
+    }
+
 private:
     featureset_ptr fs_;
     filter_type filter_;
@@ -0,0 +1,276 @@
+/*****************************************************************************
+ *
+ * This file is part of Mapnik (c++ mapping toolkit)
+ *
+ * Copyright (C) 2017 Artem Pavlenko
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ *****************************************************************************/
+
+#ifndef MAPNIK_FLAT_QUAD_TREE_HPP
+#define MAPNIK_FLAT_QUAD_TREE_HPP
+
+// mapnik
+#include <mapnik/geometry/box2d.hpp>
+#include <mapnik/util/noncopyable.hpp>
+
+// stl
+#include <algorithm>
+#include <cstdint>
+#include <iterator>
+#include <limits>
+#include <utility>
+#include <vector>
+
+namespace mapnik
+{
+
+// Quad tree with the same node layout as quad_tree (max_depth, overlapping
+// children of ratio * parent size), but with all nodes and items pooled in
+// flat vectors addressed by index. Each node links its items in insertion
+// order. Items keep their boxes so queries report only values whose box
+// intersects the query box. Queries are const, allocate nothing and may run
+// concurrently. pack() (done by the bulk insert) renumbers nodes in depth
+// first order and stores each node's items contiguously, so queries walk
+// memory mostly forwards.
+template <typename T0, typename T1 = box2d<double>>
+class flat_quad_tree : util::noncopyable
+{
+public:
+    using value_type = T0;
+    using bbox_type = T1;
+    struct item
+    {
+        bbox_type box;
+        value_type value;
+    };
+    using items_type = std::vector<item>;
+    using const_iterator = typename items_type::const_iterator;
+    using iterator = typename items_type::iterator;
+
+    explicit flat_quad_tree(bbox_type const& ext,
+                            unsigned int max_depth = 8,
+                            double ratio = 0.55)
+        : max_depth_(max_depth),
+          ratio_(ratio),
+          nodes_(),
+          items_(),
+          next_()
+    {
+        nodes_.emplace_back(ext);
+    }
+
+    void insert(value_type const& data, bbox_type const& box)
+    {
+        append(find_node(box), data, box);
+    }
+
+    // Inserts a range of std::pair<value_type, bbox_type> and packs the tree.
+    template <typename Iterator>
+    void insert(Iterator first, Iterator last)
+    {
+        items_.reserve(items_.size() + std::distance(first, last));
+        next_.reserve(items_.capacity());
+        for (; first != last; ++first)
+        {
+            append(find_node(first->second), first->first, first->second);
+        }
+        pack();
+    }
+
+    // Calls f(item const&) for each item whose box intersects box, in depth
+    // first order, until it returns true. Returns true if f stopped the query.
+    template <typename F>
+    bool query(bbox_type const& box, F && f) const
+    {
+        return query_node(box, f, 0);
+    }
+
+    // Renumbers nodes in depth first order and moves the items of each node
+    // next to each other, keeping their order within the node.
+    void pack()
+    {
+        std::vector<node> nodes;
+        nodes.reserve(nodes_.size());
+        items_type items;
+        items.reserve(items_.size());
+        std::vector<std::uint32_t> next;
+        next.reserve(items_.size());
+        std::vector<std::uint32_t> stack(1, 0);
+        std::vector<std::uint32_t> index(nodes_.size(), npos);
+        while (!stack.empty())
+        {
+            std::uint32_t n = stack.back();
+            stack.pop_back();
+            index[n] = static_cast<std::uint32_t>(nodes.size());
+            nodes.push_back(nodes_[n]);
+            node & copy = nodes.back();
+            copy.first = copy.last = npos;
+            for (std::uint32_t i = nodes_[n].first; i != npos; i = next_[i])
+            {
+                std::uint32_t pos = static_cast<std::uint32_t>(items.size());
+                items.push_back(std::move(items_[i]));
+                next.push_back(npos);
+                if (copy.last != npos) next[copy.last] = pos;
+                else copy.first = pos;
+                copy.last = pos;
+            }
+            for (int k = 4; k-- > 0; )
+            {
+                if (nodes_[n].children[k] != npos) stack.push_back(nodes_[n].children[k]);
+            }
+        }
+        for (auto & n : nodes)
+        {
+            for (auto & child : n.children)
+            {
+                if (child != npos) child = index[child];
+            }
+        }
+        nodes_.swap(nodes);
+        items_.swap(items);
+        next_.swap(next);
+    }
+
+    void clear()
+    {
+        bbox_type ext = extent();
+        nodes_.clear();
+        nodes_.emplace_back(ext);
+        items_.clear();
+        next_.clear();
+    }
+
+    void reserve(std::size_t count)
+    {
+        items_.reserve(count);
+        next_.reserve(count);
+    }
+
+    bbox_type const& extent() const
+    {
+        return nodes_.front().extent;
+    }
+
+    std::size_t count() const
+    {
+        return nodes_.size();
+    }
+
+    std::size_t count_items() const
+    {
+        return items_.size();
+    }
+
+    // all items, in insertion order until the tree is packed
+    iterator begin() { return items_.begin(); }
+    iterator end() { return items_.end(); }
+    const_iterator begin() const { return items_.begin(); }
+    const_iterator end() const { return items_.end(); }
+
+private:
+    static constexpr std::uint32_t npos = std::numeric_limits<std::uint32_t>::max();
+
+    struct node
+    {
+        explicit node(bbox_type const& ext)
+            : extent(ext),
+              children{npos, npos, npos, npos},
+              first(npos),
+              last(npos) {}
+
+        bbox_type extent;
+        std::uint32_t children[4];
+        std::uint32_t first;
+        std::uint32_t last;
+    };
+
+    template <typename F>
+    bool query_node(bbox_type const& box, F & f, std::uint32_t n) const
+    {
+        node const& current = nodes_[n];
+        if (!box.intersects(current.extent)) return false;
+        for (std::uint32_t i = current.first; i != npos; i = next_[i])
+        {
+            if (box.intersects(items_[i].box) && f(items_[i])) return true;
+        }
+        for (std::uint32_t child : current.children)
+        {
+            if (child != npos && query_node(box, f, child)) return true;
+        }
+        return false;
+    }
+
+    // the deepest node whose extent contains box, created as needed
+    std::uint32_t find_node(bbox_type const& box)
+    {
+        std::uint32_t n = 0;
+        for (unsigned int depth = 1; depth < max_depth_; ++depth)
+        {
+            bbox_type ext[4];
+            split_box(nodes_[n].extent, ext);
+            int k = 0;
+            while (k < 4 && !ext[k].contains(box)) ++k;
+            if (k == 4) break;
+            if (nodes_[n].children[k] == npos)
+            {
+                nodes_[n].children[k] = static_cast<std::uint32_t>(nodes_.size());
+                nodes_.emplace_back(ext[k]);
+            }
+            n = nodes_[n].children[k];
+        }
+        return n;
+    }
+
+    void append(std::uint32_t n, value_type const& data, bbox_type const& box)
+    {
+        std::uint32_t pos = static_cast<std::uint32_t>(items_.size());
+        items_.push_back(item{box, data});
+        next_.push_back(npos);
+        node & target = nodes_[n];
+        if (target.last != npos) next_[target.last] = pos;
+        else target.first = pos;
+        target.last = pos;
+    }
+
+    void split_box(bbox_type const& node_extent, bbox_type * ext) const
+    {
+        typename bbox_type::value_type width = node_extent.width();
+        typename bbox_type::value_type height = node_extent.height();
+        typename bbox_type::value_type lox = node_extent.minx();
+        typename bbox_type::value_type loy = node_extent.miny();
+        typename bbox_type::value_type hix = node_extent.maxx();
+        typename bbox_type::value_type hiy = node_extent.maxy();
+
+        ext[0] = bbox_type(lox, loy, lox + width * ratio_, loy + height * ratio_);
+        ext[1] = bbox_type(hix - width * ratio_, loy, hix, loy + height * ratio_);
+        ext[2] = bbox_type(lox, hiy - height * ratio_, lox + width * ratio_, hiy);
+        ext[3] = bbox_type(hix - width * ratio_, hiy - height * ratio_, hix, hiy);
+    }
+
+    const unsigned int max_depth_;
+    const double ratio_;
+    std::vector<node> nodes_;
+    items_type items_;
+    std::vector<std::uint32_t> next_;
+};
+
+template <typename T0, typename T1>
+constexpr std::uint32_t flat_quad_tree<T0, T1>::npos;
+
+}
+
+#endif // MAPNIK_FLAT_QUAD_TREE_HPP
@@ -47,6 +47,7 @@ class font_face_set;
 using face_set_ptr = std::unique_ptr<font_face_set>;
 class font_face;
 using face_ptr = std::shared_ptr<font_face>;
+class shaping_cache;
 
 class MAPNIK_DECL freetype_engine : public singleton<freetype_engine, CreateUsingNew>,
                                     private util::noncopyable
@@ -116,6 +117,10 @@ public:
     face_set_ptr get_face_set(font_set const& fset);
     face_set_ptr get_face_set(std::string const& name, boost::optional<font_set> fset);
     stroker_ptr get_stroker() const { return stroker_; }
+    // reuse harfbuzz output for text shaped before, possibly by other
+    // face managers sharing the cache
+    void set_shaping_cache(std::shared_ptr<shaping_cache> const& cache) { shaping_cache_ = cache; }
+    shaping_cache * get_shaping_cache() const { return shaping_cache_.get(); }
 
 private:
     using face_cache = std::map<std::string, face_ptr>;
@@ -126,6 +131,7 @@ private:
     freetype_engine::font_file_mapping_type const& font_file_mapping_;
     freetype_engine::font_memory_cache_type const& font_memory_cache_;
     stroker_ptr stroker_;
+    std::shared_ptr<shaping_cache> shaping_cache_;
 };
 
 using face_manager_freetype = face_manager;
@@ -0,0 +1,95 @@
+/*****************************************************************************
+ *
+ * This file is part of Mapnik (c++ mapping toolkit)
+ *
+ * Copyright (C) 2017 Artem Pavlenko
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ *****************************************************************************/
+
+#ifndef MAPNIK_GEOMETRY_LOD_CACHE_HPP
+#define MAPNIK_GEOMETRY_LOD_CACHE_HPP
+
+// mapnik
+#include <mapnik/config.hpp>
+#include <mapnik/geometry.hpp>
+#include <mapnik/value/types.hpp>
+#include <mapnik/util/lru_cache.hpp>
+#include <mapnik/util/noncopyable.hpp>
+
+// stl
+#include <cstddef>
+#include <functional>
+#include <memory>
+
+namespace mapnik
+{
+
+using geometry_lod_cache_stats = util::lru_cache_stats;
+
+// Thread-safe cache of simplified feature geometries keyed by feature id
+// and zoom band, bounded by the memory held by the geometries and evicting
+// the least recently used ones first. Entries remember a hash of the
+// geometry they were made from, so that a feature id reused for another
+// geometry misses. See lod_datasource.
+class MAPNIK_DECL geometry_lod_cache : private util::noncopyable
+{
+public:
+    using geometry_ptr = std::shared_ptr<geometry::geometry<double> const>;
+
+    explicit geometry_lod_cache(std::size_t max_bytes = 64 << 20);
+
+    void set_max_bytes(std::size_t max_bytes);
+    std::size_t max_bytes() const;
+    // returns nullptr on a miss
+    geometry_ptr find(value_integer id, int band, std::size_t source_hash);
+    void insert(value_integer id, int band, std::size_t source_hash,
+                geometry_ptr const& geom, std::size_t bytes);
+    void clear();
+    geometry_lod_cache_stats stats() const;
+
+private:
+    struct key_type
+    {
+        value_integer id;
+        int band;
+
+        bool operator==(key_type const& rhs) const
+        {
+            return id == rhs.id && band == rhs.band;
+        }
+    };
+
+    struct key_hash
+    {
+        std::size_t operator()(key_type const& key) const
+        {
+            return std::hash<value_integer>()(key.id) * 31 + static_cast<std::size_t>(key.band);
+        }
+    };
+
+    struct entry
+    {
+        std::size_t source_hash;
+        geometry_ptr geom;
+    };
+
+    util::lru_cache<key_type, entry, key_hash> cache_;
+};
+
+}
+
+#endif // MAPNIK_GEOMETRY_LOD_CACHE_HPP
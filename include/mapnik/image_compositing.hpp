@@ -37,6 +37,8 @@
 namespace mapnik
 {
 
+template <typename T> class box2d;
+
 // Compositing modes
 // http://www.w3.org/TR/2009/WD-SVGCompositing-20090430/
 
@@ -83,6 +85,9 @@ enum composite_mode_e
 
 MAPNIK_DECL boost::optional<composite_mode_e> comp_op_from_string(std::string const& name);
 MAPNIK_DECL boost::optional<std::string> comp_op_to_string(composite_mode_e comp_op);
+// true when compositing a fully transparent source pixel leaves the
+// destination pixel unchanged
+MAPNIK_DECL bool transparent_source_is_noop(composite_mode_e comp_op);
 
 template <typename T>
 MAPNIK_DECL void composite(T & dst, T const& src,
@@ -91,5 +96,14 @@ MAPNIK_DECL void composite(T & dst, T const& src,
                            int dx=0,
                            int dy=0);
 
+// composite the pixels of src within src_region only, maxx and maxy
+// of the region being one past its last column and row
+MAPNIK_DECL void composite(image<rgba8_t> & dst, image<rgba8_t> const& src,
+                           box2d<int> const& src_region,
+                           composite_mode_e mode,
+                           float opacity=1,
+                           int dx=0,
+                           int dy=0);
+
 }
 #endif // MAPNIK_IMAGE_COMPOSITING_HPP
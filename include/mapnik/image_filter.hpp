@@ -28,6 +28,8 @@
 #include <mapnik/image_filter_types.hpp>
 #include <mapnik/image_util.hpp>
 #include <mapnik/util/hsl.hpp>
+#include <mapnik/util/thread_pool.hpp>
+#include <mapnik/pixel_kernels.hpp>
 #pragma GCC diagnostic push
 #include <mapnik/warning_ignore.hpp>
 #include <boost/gil/gil_all.hpp>
@@ -45,7 +47,11 @@
 #pragma GCC diagnostic pop
 
 // stl
+#include <algorithm>
 #include <cmath>
+#include <exception>
+#include <future>
+#include <vector>
 
 // 8-bit YUV
 //Y = ( (  66 * R + 129 * G +  25 * B + 128) >> 8) +  16
@@ -129,6 +135,46 @@ static const float emboss_matrix[] = {-2,-1,0,-1,1,1,0,1,2};
 static const float sharpen_matrix[] = {0,-1,0,-1,5,-1,0,-1,0 };
 static const float edge_detect_matrix[] = {0,1,0,1,-4,1,0,1,0 };
 
+// Splits [0, count) into bands of at least min_band lines and calls f(begin, end)
+// for each of them. The calling thread takes the first band, the pool's workers
+// the others; without a pool everything runs inline. Filters must not be run
+// from inside the pool's own workers, they would end up waiting on themselves.
+template <typename F>
+void for_each_band(util::thread_pool * pool, std::size_t count, F const& f, std::size_t min_band = 16)
+{
+    std::size_t bands = 1;
+    if (pool && count >= 2 * min_band)
+    {
+        bands = std::min(pool->size() + 1, count / min_band);
+    }
+    if (bands <= 1)
+    {
+        if (count > 0) f(0, count);
+        return;
+    }
+    std::size_t const band = (count + bands - 1) / bands;
+    std::vector<std::future<void>> results;
+    results.reserve(bands - 1);
+    std::exception_ptr error;
+    try
+    {
+        for (std::size_t begin = band; begin < count; begin += band)
+        {
+            std::size_t end = std::min(begin + band, count);
+            results.push_back(pool->submit([&f, begin, end] { f(begin, end); }));
+        }
+        f(0, band);
+    }
+    catch (...)
+    {
+        error = std::current_exception();
+    }
+    // bands reference the caller's data, let all of them finish before leaving
+    for (auto & result : results) result.wait();
+    if (error) std::rethrow_exception(error);
+    for (auto & result : results) result.get();
+}
+
 }
 
 using boost::gil::rgba8_image_t;
@@ -388,21 +434,133 @@ void apply_convolution_3x3(Src const& src_view, Dst & dst_view, Filter const& fi
     }
 }
 
+// 3x3 kernels that can be handed to kernels::convolve_3x3, nullptr otherwise
+template <typename Filter>
+float const* convolution_matrix(Filter const&) { return nullptr; }
+inline float const* convolution_matrix(blur) { return detail::blur_matrix; }
+inline float const* convolution_matrix(emboss) { return detail::emboss_matrix; }
+inline float const* convolution_matrix(sharpen) { return detail::sharpen_matrix; }
+inline float const* convolution_matrix(edge_detect) { return detail::edge_detect_matrix; }
+
+// rows [y0, y1) of apply_convolution_3x3 on packed rgba8 buffers
+template <typename Filter>
+void convolve_3x3_rows(std::uint8_t const* src, std::uint8_t * dst,
+                       std::size_t width, std::size_t height,
+                       std::size_t y0, std::size_t y1, Filter const& filter)
+{
+    std::size_t const row_size = width * 4;
+    for (std::size_t y = y0; y < y1; ++y)
+    {
+        std::uint8_t const* mid = src + y * row_size;
+        std::uint8_t const* prev = y > 0 ? mid - row_size : nullptr;
+        std::uint8_t const* next = y + 1 < height ? mid + row_size : nullptr;
+        std::uint8_t const* up = prev ? prev : (next ? next : mid);
+        std::uint8_t const* down = next ? next : (prev ? prev : mid);
+        std::uint8_t * out = dst + y * row_size;
+        for (std::size_t x = 0; x < width; ++x)
+        {
+            std::size_t const l = (x == 0 ? x : x - 1) * 4;
+            std::size_t const r = (x + 1 == width ? x : x + 1) * 4;
+            std::size_t const o = x * 4;
+            for (std::size_t i = 0; i < 3; ++i)
+            {
+                float p[9] = { float(up[l + i]), float(up[o + i]), float(up[r + i]),
+                               float(mid[l + i]), float(mid[o + i]), float(mid[r + i]),
+                               float(down[l + i]), float(down[o + i]), float(down[r + i]) };
+                process_channel(p, out[o + i], filter);
+            }
+            out[o + 3] = mid[o + 3]; // Dst.a = Src.a
+        }
+    }
+}
+
 template <typename Src, typename Filter>
-void apply_filter(Src & src, Filter const& filter, double /*scale_factor*/)
+void apply_convolution_filter(Src & src, Filter const& filter, util::thread_pool * pool)
 {
     demultiply_alpha(src);
-    double_buffer<Src> tb(src);
-    apply_convolution_3x3(tb.src_view, tb.dst_view, filter);
+    std::size_t const width = src.width();
+    std::size_t const height = src.height();
+    if (width == 0 || height == 0) return;
+    std::uint8_t const* bytes = src.bytes();
+    std::vector<std::uint8_t> buffer(width * height * 4);
+    float const* matrix = convolution_matrix(filter);
+    detail::for_each_band(pool, height, [&](std::size_t y0, std::size_t y1)
+    {
+        if (matrix)
+        {
+            kernels::convolve_3x3(bytes, buffer.data(), width, height, y0, y1, matrix);
+        }
+        else
+        {
+            convolve_3x3_rows(bytes, buffer.data(), width, height, y0, y1, filter);
+        }
+    });
+    std::copy(buffer.begin(), buffer.end(), src.bytes());
+}
+
+template <typename Src, typename Filter>
+void apply_filter(Src & src, Filter const& filter, double /*scale_factor*/)
+{
+    apply_convolution_filter(src, filter, nullptr);
 }
 
 template <typename Src>
-void apply_filter(Src & src, agg_stack_blur const& op, double scale_factor)
+void apply_filter(Src & src, blur const& op, double /*scale_factor*/, util::thread_pool * pool)
+{
+    apply_convolution_filter(src, op, pool);
+}
+
+template <typename Src>
+void apply_filter(Src & src, emboss const& op, double /*scale_factor*/, util::thread_pool * pool)
+{
+    apply_convolution_filter(src, op, pool);
+}
+
+template <typename Src>
+void apply_filter(Src & src, sharpen const& op, double /*scale_factor*/, util::thread_pool * pool)
+{
+    apply_convolution_filter(src, op, pool);
+}
+
+template <typename Src>
+void apply_filter(Src & src, edge_detect const& op, double /*scale_factor*/, util::thread_pool * pool)
+{
+    apply_convolution_filter(src, op, pool);
+}
+
+template <typename Src>
+void apply_filter(Src & src, sobel const& op, double /*scale_factor*/, util::thread_pool * pool)
+{
+    apply_convolution_filter(src, op, pool);
+}
+
+template <typename Src>
+void apply_filter(Src & src, agg_stack_blur const& op, double scale_factor, util::thread_pool * pool)
 {
     premultiply_alpha(src);
-    agg::rendering_buffer buf(src.bytes(),src.width(),src.height(), src.row_size());
-    agg::pixfmt_rgba32_pre pixf(buf);
-    agg::stack_blur_rgba32(pixf, op.rx * scale_factor, op.ry * scale_factor);
+    std::size_t const width = src.width();
+    std::size_t const height = src.height();
+    std::ptrdiff_t const row_size = static_cast<std::ptrdiff_t>(src.row_size());
+    std::uint8_t * bytes = src.bytes();
+    unsigned rx = static_cast<unsigned>(op.rx * scale_factor);
+    unsigned ry = static_cast<unsigned>(op.ry * scale_factor);
+    // same passes as agg::stack_blur_rgba32: rows first, then columns
+    detail::for_each_band(pool, height, [&](std::size_t y0, std::size_t y1)
+    {
+        kernels::stack_blur(bytes + static_cast<std::ptrdiff_t>(y0) * row_size, row_size, 4,
+                            y1 - y0, width, rx);
+    });
+    detail::for_each_band(pool, width, [&](std::size_t x0, std::size_t x1)
+    {
+        kernels::stack_blur(bytes + static_cast<std::ptrdiff_t>(x0) * 4, 4, row_size,
+                            x1 - x0, height, ry);
+    });
+}
+
+template <typename Src>
+void apply_filter(Src & src, agg_stack_blur const& op, double scale_factor)
+{
+    apply_filter(src, op, scale_factor, nullptr);
 }
 
 inline double channel_delta(double source, double match)
@@ -480,7 +638,7 @@ void apply_filter(Src & src, color_to_alpha const& op, double /*scale_factor*/)
 }
 
 template <typename Src>
-void apply_filter(Src & src, colorize_alpha const& op, double /*scale_factor*/)
+void apply_filter(Src & src, colorize_alpha const& op, double /*scale_factor*/, util::thread_pool * pool)
 {
     using namespace boost::gil;
     std::ptrdiff_t size = op.size();
@@ -490,24 +648,27 @@ void apply_filter(Src & src, colorize_alpha const& op, double /*scale_factor*/)
         mapnik::filter::color_stop const& stop = op[0];
         mapnik::color const& c = stop.color;
         rgba8_view_t src_view = rgba8_view(src);
-        for (std::ptrdiff_t y = 0; y < src_view.height(); ++y)
+        detail::for_each_band(pool, static_cast<std::size_t>(src_view.height()), [&](std::size_t y0, std::size_t y1)
         {
-            rgba8_view_t::x_iterator src_it = src_view.row_begin(static_cast<long>(y));
-            for (std::ptrdiff_t x = 0; x < src_view.width(); ++x)
+            for (std::size_t y = y0; y < y1; ++y)
             {
-                uint8_t & r = get_color(src_it[x], red_t());
-                uint8_t & g = get_color(src_it[x], green_t());
-                uint8_t & b = get_color(src_it[x], blue_t());
-                uint8_t & a = get_color(src_it[x], alpha_t());
-                if ( a > 0)
+                rgba8_view_t::x_iterator src_it = src_view.row_begin(static_cast<long>(y));
+                for (std::ptrdiff_t x = 0; x < src_view.width(); ++x)
                 {
-                    a = (c.alpha() * a + 255) >> 8;
-                    r = (c.red() * a + 255) >> 8;
-                    g = (c.green() * a + 255) >> 8;
-                    b = (c.blue() * a + 255) >> 8;
+                    uint8_t & r = get_color(src_it[x], red_t());
+                    uint8_t & g = get_color(src_it[x], green_t());
+                    uint8_t & b = get_color(src_it[x], blue_t());
+                    uint8_t & a = get_color(src_it[x], alpha_t());
+                    if ( a > 0)
+                    {
+                        a = (c.alpha() * a + 255) >> 8;
+                        r = (c.red() * a + 255) >> 8;
+                        g = (c.green() * a + 255) >> 8;
+                        b = (c.blue() * a + 255) >> 8;
+                    }
                 }
             }
-        }
+        });
         // set as premultiplied
         set_premultiplied_alpha(src, true);
     }
@@ -534,54 +695,57 @@ void apply_filter(Src & src, colorize_alpha const& op, double /*scale_factor*/)
         if (grad_lut.build_lut())
         {
             rgba8_view_t src_view = rgba8_view(src);
-            for (std::ptrdiff_t y = 0; y < src_view.height(); ++y)
+            detail::for_each_band(pool, static_cast<std::size_t>(src_view.height()), [&](std::size_t y0, std::size_t y1)
             {
-                rgba8_view_t::x_iterator src_it = src_view.row_begin(static_cast<long>(y));
-                for (std::ptrdiff_t x = 0; x < src_view.width(); ++x)
+                for (std::size_t y = y0; y < y1; ++y)
                 {
-                    uint8_t & r = get_color(src_it[x], red_t());
-                    uint8_t & g = get_color(src_it[x], green_t());
-                    uint8_t & b = get_color(src_it[x], blue_t());
-                    uint8_t & a = get_color(src_it[x], alpha_t());
-                    if ( a > 0)
+                    rgba8_view_t::x_iterator src_it = src_view.row_begin(static_cast<long>(y));
+                    for (std::ptrdiff_t x = 0; x < src_view.width(); ++x)
                     {
-                        agg::rgba8 c = grad_lut[a];
-                        a = (c.a * a + 255) >> 8;
-                        r = (c.r * a + 255) >> 8;
-                        g = (c.g * a + 255) >> 8;
-                        b = (c.b * a + 255) >> 8;
-        #if 0
-                        // rainbow
-                        r = 0;
-                        g = 0;
-                        b = 0;
-                        if (a < 64)
+                        uint8_t & r = get_color(src_it[x], red_t());
+                        uint8_t & g = get_color(src_it[x], green_t());
+                        uint8_t & b = get_color(src_it[x], blue_t());
+                        uint8_t & a = get_color(src_it[x], alpha_t());
+                        if ( a > 0)
                         {
-                            g = a * 4;
-                            b = 255;
+                            agg::rgba8 c = grad_lut[a];
+                            a = (c.a * a + 255) >> 8;
+                            r = (c.r * a + 255) >> 8;
+                            g = (c.g * a + 255) >> 8;
+                            b = (c.b * a + 255) >> 8;
+            #if 0
+                            // rainbow
+                            r = 0;
+                            g = 0;
+                            b = 0;
+                            if (a < 64)
+                            {
+                                g = a * 4;
+                                b = 255;
+                            }
+                            else if (a >= 64 && a < 128)
+                            {
+                                g = 255;
+                                b = 255 - ((a - 64) * 4);
+                            }
+                            else if (a >= 128 && a < 192)
+                            {
+                                r = (a - 128) * 4;
+                                g = 255;
+                            }
+                            else // >= 192
+                            {
+                                r = 255;
+                                g = 255 - ((a - 192) * 4);
+                            }
+                            r = (r * a + 255) >> 8;
+                            g = (g * a + 255) >> 8;
+                            b = (b * a + 255) >> 8;
+            #endif
                         }
-                        else if (a >= 64 && a < 128)
-                        {
-                            g = 255;
-                            b = 255 - ((a - 64) * 4);
-                        }
-                        else if (a >= 128 && a < 192)
-                        {
-                            r = (a - 128) * 4;
-                            g = 255;
-                        }
-                        else // >= 192
-                        {
-                            r = 255;
-                            g = 255 - ((a - 192) * 4);
-                        }
-                        r = (r * a + 255) >> 8;
-                        g = (g * a + 255) >> 8;
-                        b = (b * a + 255) >> 8;
-        #endif
                     }
                 }
-            }
+            });
         }
         // set as premultiplied
         set_premultiplied_alpha(src, true);
@@ -589,7 +753,13 @@ void apply_filter(Src & src, colorize_alpha const& op, double /*scale_factor*/)
 }
 
 template <typename Src>
-void apply_filter(Src & src, scale_hsla const& transform, double /*scale_factor*/)
+void apply_filter(Src & src, colorize_alpha const& op, double scale_factor)
+{
+    apply_filter(src, op, scale_factor, nullptr);
+}
+
+template <typename Src>
+void apply_filter(Src & src, scale_hsla const& transform, double /*scale_factor*/, util::thread_pool * pool)
 {
     using namespace boost::gil;
     bool tinting = !transform.is_identity();
@@ -600,85 +770,94 @@ void apply_filter(Src & src, scale_hsla const& transform, double /*scale_factor*
     {
         bool premultiplied = src.get_premultiplied();
         rgba8_view_t src_view = rgba8_view(src);
-        for (std::ptrdiff_t y = 0; y < src_view.height(); ++y)
+        detail::for_each_band(pool, static_cast<std::size_t>(src_view.height()), [&](std::size_t y0, std::size_t y1)
         {
-            rgba8_view_t::x_iterator src_it = src_view.row_begin(static_cast<long>(y));
-            for (std::ptrdiff_t x = 0; x < src_view.width(); ++x)
+            for (std::size_t y = y0; y < y1; ++y)
             {
-                uint8_t & r = get_color(src_it[x], red_t());
-                uint8_t & g = get_color(src_it[x], green_t());
-                uint8_t & b = get_color(src_it[x], blue_t());
-                uint8_t & a = get_color(src_it[x], alpha_t());
-                double r2 = static_cast<double>(r)/255.0;
-                double g2 = static_cast<double>(g)/255.0;
-                double b2 = static_cast<double>(b)/255.0;
-                double a2 = static_cast<double>(a)/255.0;
-                // demultiply
-                if (a2 <= 0.0)
-                {
-                    r = g = b = 0;
-                    continue;
-                }
-                else if (premultiplied)
-                {
-                    r2 /= a2;
-                    g2 /= a2;
-                    b2 /= a2;
-                }
-
-                if (set_alpha)
+                rgba8_view_t::x_iterator src_it = src_view.row_begin(static_cast<long>(y));
+                for (std::ptrdiff_t x = 0; x < src_view.width(); ++x)
                 {
-                    a2 = transform.a0 + (a2 * (transform.a1 - transform.a0));
-                    if (a2 <= 0)
+                    uint8_t & r = get_color(src_it[x], red_t());
+                    uint8_t & g = get_color(src_it[x], green_t());
+                    uint8_t & b = get_color(src_it[x], blue_t());
+                    uint8_t & a = get_color(src_it[x], alpha_t());
+                    double r2 = static_cast<double>(r)/255.0;
+                    double g2 = static_cast<double>(g)/255.0;
+                    double b2 = static_cast<double>(b)/255.0;
+                    double a2 = static_cast<double>(a)/255.0;
+                    // demultiply
+                    if (a2 <= 0.0)
                     {
-                        r = g = b = a = 0;
+                        r = g = b = 0;
                         continue;
                     }
-                    else if (a2 > 1)
+                    else if (premultiplied)
                     {
-                        a2 = 1;
-                        a = 255;
+                        r2 /= a2;
+                        g2 /= a2;
+                        b2 /= a2;
                     }
-                    else
+
+                    if (set_alpha)
                     {
-                        a = static_cast<uint8_t>(std::floor((a2 * 255.0) +.5));
+                        a2 = transform.a0 + (a2 * (transform.a1 - transform.a0));
+                        if (a2 <= 0)
+                        {
+                            r = g = b = a = 0;
+                            continue;
+                        }
+                        else if (a2 > 1)
+                        {
+                            a2 = 1;
+                            a = 255;
+                        }
+                        else
+                        {
+                            a = static_cast<uint8_t>(std::floor((a2 * 255.0) +.5));
+                        }
                     }
+                    if (tinting)
+                    {
+                        double h;
+                        double s;
+                        double l;
+                        rgb2hsl(r2,g2,b2,h,s,l);
+                        double h2 = transform.h0 + (h * (transform.h1 - transform.h0));
+                        double s2 = transform.s0 + (s * (transform.s1 - transform.s0));
+                        double l2 = transform.l0 + (l * (transform.l1 - transform.l0));
+                        if (h2 > 1) { h2 = 1; }
+                        else if (h2 < 0) { h2 = 0; }
+                        if (s2 > 1) { s2 = 1; }
+                        else if (s2 < 0) { s2 = 0; }
+                        if (l2 > 1) { l2 = 1; }
+                        else if (l2 < 0) { l2 = 0; }
+                        hsl2rgb(h2,s2,l2,r2,g2,b2);
+                    }
+                    // premultiply
+                    r2 *= a2;
+                    g2 *= a2;
+                    b2 *= a2;
+                    r = static_cast<uint8_t>(std::floor((r2*255.0)+.5));
+                    g = static_cast<uint8_t>(std::floor((g2*255.0)+.5));
+                    b = static_cast<uint8_t>(std::floor((b2*255.0)+.5));
+                    // all color values must be <= alpha
+                    if (r>a) r=a;
+                    if (g>a) g=a;
+                    if (b>a) b=a;
                 }
-                if (tinting)
-                {
-                    double h;
-                    double s;
-                    double l;
-                    rgb2hsl(r2,g2,b2,h,s,l);
-                    double h2 = transform.h0 + (h * (transform.h1 - transform.h0));
-                    double s2 = transform.s0 + (s * (transform.s1 - transform.s0));
-                    double l2 = transform.l0 + (l * (transform.l1 - transform.l0));
-                    if (h2 > 1) { h2 = 1; }
-                    else if (h2 < 0) { h2 = 0; }
-                    if (s2 > 1) { s2 = 1; }
-                    else if (s2 < 0) { s2 = 0; }
-                    if (l2 > 1) { l2 = 1; }
-                    else if (l2 < 0) { l2 = 0; }
-                    hsl2rgb(h2,s2,l2,r2,g2,b2);
-                }
-                // premultiply
-                r2 *= a2;
-                g2 *= a2;
-                b2 *= a2;
-                r = static_cast<uint8_t>(std::floor((r2*255.0)+.5));
-                g = static_cast<uint8_t>(std::floor((g2*255.0)+.5));
-                b = static_cast<uint8_t>(std::floor((b2*255.0)+.5));
-                // all color values must be <= alpha
-                if (r>a) r=a;
-                if (g>a) g=a;
-                if (b>a) b=a;
             }
-        }
+        });
         // set as premultiplied
         set_premultiplied_alpha(src, true);
     }
 }
 
+template <typename Src>
+void apply_filter(Src & src, scale_hsla const& transform, double scale_factor)
+{
+    apply_filter(src, transform, scale_factor, nullptr);
+}
+
 template <typename Src, typename ColorBlindFilter>
 void apply_color_blind_filter(Src & src, ColorBlindFilter const& op)
 {
@@ -895,21 +1074,30 @@ void apply_filter(Src & src, invert const& /*op*/, double /*scale_factor*/)
     }
 }
 
+// filters without a banded implementation ignore the pool
+template <typename Src, typename Filter>
+void apply_filter(Src & src, Filter const& filter, double scale_factor, util::thread_pool * /*pool*/)
+{
+    apply_filter(src, filter, scale_factor);
+}
+
 template <typename Src>
 struct filter_visitor
 {
-    filter_visitor(Src & src, double scale_factor=1.0)
+    filter_visitor(Src & src, double scale_factor=1.0, util::thread_pool * pool = nullptr)
     : src_(src),
-      scale_factor_(scale_factor) {}
+      scale_factor_(scale_factor),
+      pool_(pool) {}
 
     template <typename T>
     void operator () (T const& filter) const
     {
-        apply_filter(src_, filter, scale_factor_);
+        apply_filter(src_, filter, scale_factor_, pool_);
     }
 
     Src & src_;
     double scale_factor_;
+    util::thread_pool * pool_;
 };
 
 struct filter_radius_visitor
@@ -0,0 +1,122 @@
+/*****************************************************************************
+ *
+ * This file is part of Mapnik (c++ mapping toolkit)
+ *
+ * Copyright (C) 2017 Artem Pavlenko
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ *****************************************************************************/
+
+#ifndef MAPNIK_IMAGE_POOL_HPP
+#define MAPNIK_IMAGE_POOL_HPP
+
+// mapnik
+#include <mapnik/util/noncopyable.hpp>
+
+// stl
+#include <cstddef>
+#include <deque>
+#include <memory>
+#ifdef MAPNIK_THREADSAFE
+#include <mutex>
+#endif
+
+namespace mapnik
+{
+
+// Thread-safe pool of images of any size, used to reuse the large
+// intermediate buffers of renderers across renders. Images are handed
+// out with undefined pixels and the flags of a new image, borrowers
+// clear them if they need to.
+template <typename T>
+class image_pool : private util::noncopyable
+{
+    using holder_type = std::unique_ptr<T>;
+    using cont_type = std::deque<holder_type>;
+
+    std::size_t max_size_;
+    cont_type pool_;
+#ifdef MAPNIK_THREADSAFE
+    mutable std::mutex mutex_;
+#endif
+public:
+    explicit image_pool(std::size_t max_size = 8)
+        : max_size_(max_size),
+          pool_() {}
+
+    holder_type acquire(std::size_t width, std::size_t height)
+    {
+        {
+#ifdef MAPNIK_THREADSAFE
+            std::lock_guard<std::mutex> lock(mutex_);
+#endif
+            for (auto itr = pool_.begin(); itr != pool_.end(); ++itr)
+            {
+                if ((*itr)->width() == width && (*itr)->height() == height)
+                {
+                    holder_type img = std::move(*itr);
+                    pool_.erase(itr);
+                    img->set_premultiplied(false);
+                    img->painted(false);
+                    return img;
+                }
+            }
+        }
+        return std::make_unique<T>(width, height, false);
+    }
+
+    void release(holder_type && img)
+    {
+        if (!img) return;
+#ifdef MAPNIK_THREADSAFE
+        std::lock_guard<std::mutex> lock(mutex_);
+#endif
+        // most recently released images first, drop the oldest ones
+        pool_.push_front(std::move(img));
+        if (pool_.size() > max_size_)
+        {
+            pool_.pop_back();
+        }
+    }
+
+    std::size_t size() const
+    {
+#ifdef MAPNIK_THREADSAFE
+        std::lock_guard<std::mutex> lock(mutex_);
+#endif
+        return pool_.size();
+    }
+
+    std::size_t max_size() const
+    {
+#ifdef MAPNIK_THREADSAFE
+        std::lock_guard<std::mutex> lock(mutex_);
+#endif
+        return max_size_;
+    }
+
+    void clear()
+    {
+#ifdef MAPNIK_THREADSAFE
+        std::lock_guard<std::mutex> lock(mutex_);
+#endif
+        pool_.clear();
+    }
+};
+
+}
+
+#endif // MAPNIK_IMAGE_POOL_HPP
@@ -46,6 +46,7 @@ struct image_any;
 template <typename T> class image;
 struct image_view_any;
 template <typename T> class image_view;
+template <typename T> class box2d;
 class color;
 
 class image_writer_exception : public std::exception
@@ -136,6 +137,11 @@ MAPNIK_DECL bool is_solid (image_view_any const& image);
 template <typename T>
 MAPNIK_DECL bool is_solid (T const& image);
 
+// NONZERO EXTENT
+// bounding box of the pixels that are not zero, maxx and maxy are one past
+// the last of them, an invalid box if all pixels are zero
+MAPNIK_DECL box2d<int> nonzero_extent (image<rgba8_t> const& image);
+
 // APPLY OPACITY
 MAPNIK_DECL void apply_opacity (image_any & image, float opacity);
 
@@ -25,6 +25,7 @@
 
 // mapnik
 #include <mapnik/quad_tree.hpp>
+#include <mapnik/box_grid.hpp>
 #include <mapnik/util/noncopyable.hpp>
 #include <mapnik/value/types.hpp>
 
@@ -34,6 +35,7 @@
 #pragma GCC diagnostic pop
 
 // stl
+#include <functional>
 #include <vector>
 
 namespace mapnik
@@ -127,7 +129,7 @@ public:
 };
 
 
-//quad tree based label collision detector so labels dont appear within a given distance
+// grid based label collision detector so labels dont appear within a given distance
 class label_collision_detector4 : util::noncopyable
 {
 public:
@@ -141,26 +143,21 @@ public:
     };
 
 private:
-    using tree_t = quad_tree< label >;
-    tree_t tree_;
+    using grid_t = box_grid< label >;
+    using label_refs = std::vector<std::reference_wrapper<label> >;
+    grid_t grid_;
+    label_refs labels_;
 
 public:
-    using query_iterator = tree_t::query_iterator;
+    using query_iterator = label_refs::iterator;
 
     explicit label_collision_detector4(box2d<double> const& _extent)
-        : tree_(_extent) {}
+        : grid_(_extent),
+          labels_() {}
 
     bool has_placement(box2d<double> const& box)
     {
-        tree_t::query_iterator tree_itr = tree_.query_in_box(box);
-        tree_t::query_iterator tree_end = tree_.query_end();
-
-        for ( ;tree_itr != tree_end; ++tree_itr)
-        {
-            if (tree_itr->get().box.intersects(box)) return false;
-        }
-
-        return true;
+        return !collides(box);
     }
 
     bool has_placement(box2d<double> const& box, double margin)
@@ -169,18 +166,7 @@ public:
                                                ? box2d<double>(box.minx() - margin, box.miny() - margin,
                                                                box.maxx() + margin, box.maxy() + margin)
                                                : box);
-
-        tree_t::query_iterator tree_itr = tree_.query_in_box(margin_box);
-        tree_t::query_iterator tree_end = tree_.query_end();
-
-        for (;tree_itr != tree_end; ++tree_itr)
-        {
-            if (tree_itr->get().box.intersects(margin_box))
-            {
-                return false;
-            }
-        }
-        return true;
+        return !collides(margin_box);
     }
 
     bool has_placement(box2d<double> const& box, double margin, mapnik::value_unicode_string const& text, double repeat_distance)
@@ -198,48 +184,62 @@ public:
                                                                box.maxx() + margin, box.maxy() + margin)
                                                : box);
 
-        tree_t::query_iterator tree_itr = tree_.query_in_box(repeat_box);
-        tree_t::query_iterator tree_end = tree_.query_end();
-
-        for ( ;tree_itr != tree_end; ++tree_itr)
+        if (!grid_.extent().intersects(repeat_box)) return true;
+        return !grid_.query(repeat_box, [&](grid_t::item const& item)
         {
-            if (tree_itr->get().box.intersects(margin_box) || (text == tree_itr->get().text && tree_itr->get().box.intersects(repeat_box)))
-            {
-                return false;
-            }
-        }
-
-        return true;
+            return item.box.intersects(margin_box) || (text == item.value.text && item.box.intersects(repeat_box));
+        });
     }
 
     void insert(box2d<double> const& box)
     {
-        if (tree_.extent().intersects(box))
+        if (grid_.extent().intersects(box))
         {
-            tree_.insert(label(box), box);
+            grid_.insert(label(box), box);
         }
     }
 
     void insert(box2d<double> const& box, mapnik::value_unicode_string const& text)
     {
-        if (tree_.extent().intersects(box))
+        if (grid_.extent().intersects(box))
         {
-            tree_.insert(label(box, text), box);
+            grid_.insert(label(box, text), box);
         }
     }
 
     void clear()
     {
-        tree_.clear();
+        grid_.clear();
+        labels_.clear();
     }
 
     box2d<double> const& extent() const
     {
-        return tree_.extent();
+        return grid_.extent();
     }
 
-    query_iterator begin() { return tree_.query_in_box(extent()); }
-    query_iterator end() { return tree_.query_end(); }
+    query_iterator begin()
+    {
+        labels_.clear();
+        for (auto & item : grid_)
+        {
+            labels_.push_back(std::ref(item.value));
+        }
+        return labels_.begin();
+    }
+    query_iterator end() { return labels_.end(); }
+
+private:
+    // like the quad_tree this detector used before, nothing is found
+    // outside of the extent
+    bool collides(box2d<double> const& box) const
+    {
+        if (!grid_.extent().intersects(box)) return false;
+        return grid_.query(box, [&box](grid_t::item const& item)
+        {
+            return item.box.intersects(box);
+        });
+    }
 };
 }
 
@@ -0,0 +1,80 @@
+/*****************************************************************************
+ *
+ * This file is part of Mapnik (c++ mapping toolkit)
+ *
+ * Copyright (C) 2017 Artem Pavlenko
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ *****************************************************************************/
+
+#ifndef MAPNIK_LOD_DATASOURCE_HPP
+#define MAPNIK_LOD_DATASOURCE_HPP
+
+// mapnik
+#include <mapnik/config.hpp>
+#include <mapnik/datasource.hpp>
+#include <mapnik/geometry_lod_cache.hpp>
+#include <mapnik/simplify.hpp>
+
+// stl
+#include <cstddef>
+#include <memory>
+
+namespace mapnik {
+
+// Datasource decorator returning line and polygon geometries simplified
+// for the zoom band of the query, so static layers like coastlines are
+// not simplified again for every tile. The first query at a band
+// simplifies each feature with the given algorithm and a tolerance of
+// `tolerance` pixels at the finest resolution of the band, and stores the
+// result in a geometry_lod_cache keyed by feature id. Later queries at
+// the same band reuse it. Bands are powers of two of the query
+// resolution. Whole features are simplified before any clipping, so
+// shared edges of adjacent tiles stay identical. Feature ids should be
+// stable across queries, like the row numbers of a shapefile; cache
+// entries also keep a hash of the source geometry, so an id reused for
+// another geometry is simplified again. Simplified
+// features are new features holding a copy of the cached geometry, the
+// wrapped datasource's features are never modified. Other geometry
+// types, raster data and features_at_point are passed through.
+class MAPNIK_DECL lod_datasource : public datasource
+{
+public:
+    lod_datasource(datasource_ptr const& ds,
+                   simplify_algorithm_e algorithm = douglas_peucker,
+                   double tolerance = 0.5,
+                   std::size_t max_bytes = 64 << 20);
+    virtual ~lod_datasource();
+    virtual datasource::datasource_t type() const;
+    virtual featureset_ptr features(query const& q) const;
+    virtual featureset_ptr features_at_point(coord2d const& pt, double tol = 0) const;
+    virtual box2d<double> envelope() const;
+    virtual boost::optional<datasource_geometry_t> get_geometry_type() const;
+    virtual layer_descriptor get_descriptor() const;
+    virtual std::size_t max_concurrent_queries() const;
+    virtual query_slot_queue & query_slots() const;
+    datasource_ptr const& wrapped() const;
+    geometry_lod_cache & cache() const;
+private:
+    datasource_ptr ds_;
+    simplify_algorithm_e algorithm_;
+    double tolerance_;
+    std::shared_ptr<geometry_lod_cache> cache_;
+};
+
+}
+
+#endif // MAPNIK_LOD_DATASOURCE_HPP
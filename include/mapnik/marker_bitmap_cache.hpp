@@ -0,0 +1,87 @@
+/*****************************************************************************
+ *
+ * This file is part of Mapnik (c++ mapping toolkit)
+ *
+ * Copyright (C) 2017 Artem Pavlenko
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ *****************************************************************************/
+
+#ifndef MAPNIK_MARKER_BITMAP_CACHE_HPP
+#define MAPNIK_MARKER_BITMAP_CACHE_HPP
+
+// mapnik
+#include <mapnik/config.hpp>
+#include <mapnik/image.hpp>
+#include <mapnik/util/lru_cache.hpp>
+#include <mapnik/util/noncopyable.hpp>
+
+// stl
+#include <cstddef>
+#include <memory>
+#include <string>
+
+namespace mapnik
+{
+
+// A marker rasterized once, premultiplied. x and y place the top left
+// corner of the image relative to the integer pixel the marker is drawn at.
+struct marker_bitmap
+{
+    image_rgba8 image;
+    int x;
+    int y;
+};
+
+using marker_bitmap_ptr = std::shared_ptr<marker_bitmap const>;
+
+using marker_bitmap_cache_stats = util::lru_cache_stats;
+
+// Thread-safe cache of rasterized markers, bounded by the memory held by
+// the bitmaps and evicting the least recently used ones first. Renderers
+// build the keys, see agg_renderer::set_marker_bitmap_cache. Entries can
+// be tied to the lifetime of an owner (the marker they were rasterized
+// from), so that they do not match a marker reloaded under the same name
+// or another object created at the owner's address later.
+class MAPNIK_DECL marker_bitmap_cache : private util::noncopyable
+{
+public:
+    explicit marker_bitmap_cache(std::size_t max_bytes = 16 << 20);
+
+    void set_max_bytes(std::size_t max_bytes);
+    std::size_t max_bytes() const;
+    // returns nullptr on a miss, entries tied to an owner only match
+    // lookups for that owner while it is alive
+    marker_bitmap_ptr find(std::string const& key, void const* owner = nullptr);
+    void insert(std::string const& key, marker_bitmap_ptr const& bitmap,
+                std::shared_ptr<void const> const& owner = nullptr);
+    void clear();
+    marker_bitmap_cache_stats stats() const;
+
+private:
+    struct entry
+    {
+        marker_bitmap_ptr bitmap;
+        std::weak_ptr<void const> owner;
+        bool has_owner;
+    };
+
+    util::lru_cache<std::string, entry> cache_;
+};
+
+}
+
+#endif // MAPNIK_MARKER_BITMAP_CACHE_HPP
@@ -63,7 +63,8 @@ struct vector_markers_dispatch : util::noncopyable
                             feature_impl const& feature,
                             attributes const& vars,
                             bool snap_to_pixels,
-                            markers_renderer_context & renderer_context)
+                            markers_renderer_context & renderer_context,
+                            std::string const& marker_key = std::string())
         : params_(src->bounding_box(), recenter(src) * marker_trans,
                   sym, feature, vars, scale_factor, snap_to_pixels)
         , renderer_context_(renderer_context)
@@ -71,7 +72,9 @@ struct vector_markers_dispatch : util::noncopyable
         , path_(path)
         , attrs_(attrs)
         , detector_(detector)
-    {}
+    {
+        params_.marker_key = marker_key;
+    }
 
     template <typename T>
     void add_path(T & path)
@@ -45,6 +45,7 @@ public:
     virtual box2d<double> envelope() const;
     virtual boost::optional<datasource_geometry_t> get_geometry_type() const;
     virtual layer_descriptor get_descriptor() const;
+    virtual std::size_t max_concurrent_queries() const;
     //
     void push(feature_ptr feature);
     void set_envelope(box2d<double> const& box);
@@ -90,6 +90,20 @@ public:
         return feature_ptr();
     }
 
+    std::size_t next_batch(feature_ptr * features, std::size_t size)
+    {
+        if (!bbox_check_)
+        {
+            std::size_t count = 0;
+            while (count < size && pos_ != end_)
+            {
+                features[count++] = *pos_++;
+            }
+            return count;
+        }
+        return fill_batch(*this, features, size);
+    }
+
 private:
     box2d<double> bbox_;
     std::deque<feature_ptr>::const_iterator pos_;
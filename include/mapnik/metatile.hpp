@@ -0,0 +1,86 @@
+/*****************************************************************************
+ *
+ * This file is part of Mapnik (c++ mapping toolkit)
+ *
+ * Copyright (C) 2017 Artem Pavlenko
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ *****************************************************************************/
+
+#ifndef MAPNIK_METATILE_HPP
+#define MAPNIK_METATILE_HPP
+
+// mapnik
+#include <mapnik/config.hpp>
+#include <mapnik/geometry/box2d.hpp>
+#include <mapnik/image.hpp>
+
+// boost
+#include <boost/optional.hpp>
+
+// stl
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace mapnik
+{
+
+class Map;
+class render_report;
+class render_plan_cache;
+class shaping_cache;
+namespace util { class thread_pool; }
+
+struct metatile_options
+{
+    unsigned tiles = 8;         // number of tiles along each side of the metatile
+    unsigned tile_size = 256;   // tile width and height in pixels
+    // buffer around the metatile in pixels, the map's buffer size if unset
+    boost::optional<int> buffer_size;
+    double scale_factor = 1.0;
+    std::string format = "png8";
+    // optional pool used to encode tiles concurrently
+    std::shared_ptr<util::thread_pool> pool;
+    // optional pool used to query the layers' datasources concurrently
+    std::shared_ptr<util::thread_pool> query_pool;
+    // optional report filled while rendering
+    std::shared_ptr<render_report> report;
+    // optional render plans, created for the map passed to render_metatile
+    std::shared_ptr<render_plan_cache> plans;
+    // optional harfbuzz shaping cache shared between metatiles
+    std::shared_ptr<shaping_cache> shaping;
+};
+
+// Slices a rendered metatile into tile_size x tile_size tiles and encodes
+// each of them with `format`. Tiles are returned in row-major order, i.e. the
+// tile at column x and row y is at index y * (image.width() / tile_size) + x.
+MAPNIK_DECL std::vector<std::string> encode_metatile(image_rgba8 const& image,
+                                                     unsigned tile_size,
+                                                     std::string const& format,
+                                                     util::thread_pool * pool = nullptr);
+
+// Renders `extent` of the map once into a metatile image and returns
+// the encoded tiles as described for encode_metatile. Size, extent and
+// buffer size come from a request, so the shared Map is neither copied nor
+// mutated.
+MAPNIK_DECL std::vector<std::string> render_metatile(Map const& map,
+                                                     box2d<double> const& extent,
+                                                     metatile_options const& options);
+
+}
+
+#endif // MAPNIK_METATILE_HPP
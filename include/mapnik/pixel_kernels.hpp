@@ -0,0 +1,74 @@
+/*****************************************************************************
+ *
+ * This file is part of Mapnik (c++ mapping toolkit)
+ *
+ * Copyright (C) 2017 Artem Pavlenko
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ *****************************************************************************/
+
+#ifndef MAPNIK_PIXEL_KERNELS_HPP
+#define MAPNIK_PIXEL_KERNELS_HPP
+
+// mapnik
+#include <mapnik/config.hpp>
+
+// stl
+#include <cstddef>
+#include <cstdint>
+
+namespace mapnik { namespace kernels {
+
+// Whole span operations on `count` consecutive rgba8 pixels (r in the low
+// byte). Each dispatches at runtime to sse4.1 or avx2 code when available
+// (see util::active_simd_level()) and produces exactly the same bytes as
+// the scalar implementation it falls back to.
+
+// agg::multiplier_rgba::premultiply / demultiply
+MAPNIK_DECL void premultiply(std::uint32_t * pixels, std::size_t count);
+MAPNIK_DECL void demultiply(std::uint32_t * pixels, std::size_t count);
+
+// scale straight alpha by `opacity` in [0, 1]
+MAPNIK_DECL void apply_opacity(std::uint32_t * pixels, std::size_t count, float opacity);
+
+// alpha becomes the luminance of the straight colour, the colour becomes `rgb`
+MAPNIK_DECL void grayscale_to_alpha(std::uint32_t * pixels, std::size_t count, std::uint32_t rgb);
+
+// pixels whose colour matches `rgb` become fully transparent
+MAPNIK_DECL void color_to_alpha(std::uint32_t * pixels, std::size_t count, std::uint32_t rgb);
+
+MAPNIK_DECL void fill(std::uint32_t * pixels, std::size_t count, std::uint32_t value);
+
+// One direction of agg::stack_blur_rgba32 (radius clamped to 254) over
+// `lines` lines of `len` pixels, pixel i of line j being at
+// first + j * line_step + i * pixel_step. A horizontal pass over whole rows
+// uses (row_size, 4), a vertical pass over columns (4, row_size).
+MAPNIK_DECL void stack_blur(std::uint8_t * first, std::ptrdiff_t line_step, std::ptrdiff_t pixel_step,
+                            std::size_t lines, std::size_t len, unsigned radius);
+
+// Rows [y0, y1) of a 3x3 convolution of the colour channels of `src` into
+// `dst` (both width * height rgba8 pixels), as done by the blur, emboss,
+// sharpen and edge-detect image filters: each channel is the single
+// precision sum of matrix[k] * neighbour[k] clamped to [0, 255] and
+// truncated, alpha is copied. Edge columns repeat themselves, the first and
+// last row use the row below and above for the missing one.
+MAPNIK_DECL void convolve_3x3(std::uint8_t const* src, std::uint8_t * dst,
+                              std::size_t width, std::size_t height,
+                              std::size_t y0, std::size_t y1, float const* matrix);
+
+}}
+
+#endif // MAPNIK_PIXEL_KERNELS_HPP
@@ -0,0 +1,87 @@
+/*****************************************************************************
+ *
+ * This file is part of Mapnik (c++ mapping toolkit)
+ *
+ * Copyright (C) 2017 Artem Pavlenko
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ *****************************************************************************/
+
+#ifndef MAPNIK_PROJ_TRANSFORM_CACHE_HPP
+#define MAPNIK_PROJ_TRANSFORM_CACHE_HPP
+
+// mapnik
+#include <mapnik/config.hpp>
+#include <mapnik/proj_transform.hpp>
+#include <mapnik/util/singleton.hpp>
+#include <mapnik/util/noncopyable.hpp>
+
+// stl
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+namespace mapnik
+{
+
+struct proj_transform_cache_stats
+{
+    std::size_t lookups = 0;
+    std::size_t inits = 0;    // transforms initialized, once per srs pair and thread
+    double lookup_time = 0.0; // milliseconds spent in get(), inits included
+    double init_time = 0.0;   // milliseconds spent initializing transforms
+};
+
+// Process wide cache of proj_transform objects keyed by their source and
+// destination srs strings, so that renders don't reparse projections for
+// every layer. proj4 projections can't be used concurrently, so entries
+// are kept per thread: each thread initializes the transforms it uses
+// once and their proj contexts are never touched by another thread.
+class MAPNIK_DECL proj_transform_cache :
+        public singleton<proj_transform_cache, CreateStatic>,
+        private util::noncopyable
+{
+    friend class CreateStatic<proj_transform_cache>;
+public:
+    using transform_ptr = std::shared_ptr<proj_transform const>;
+
+    // Returns the transform from source to dest for the calling thread,
+    // initializing it on first use. Throws like constructing the
+    // projections and transform directly. The transform must only be used
+    // by the calling thread, it stays valid while the pointer is held.
+    transform_ptr get(std::string const& source, std::string const& dest);
+    // drops the entries of every thread, they are released on the next
+    // get() of each thread
+    void clear();
+    proj_transform_cache_stats stats() const;
+
+private:
+    proj_transform_cache();
+
+    std::atomic<std::size_t> generation_;
+    std::atomic<std::size_t> lookups_;
+    std::atomic<std::size_t> inits_;
+    std::atomic<std::uint64_t> lookup_ns_;
+    std::atomic<std::uint64_t> init_ns_;
+};
+
+extern template class MAPNIK_DECL singleton<proj_transform_cache, CreateStatic>;
+
+}
+
+#endif // MAPNIK_PROJ_TRANSFORM_CACHE_HPP
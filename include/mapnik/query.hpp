@@ -26,8 +26,10 @@
 //mapnik
 #include <mapnik/geometry/box2d.hpp>
 #include <mapnik/attribute.hpp>
+#include <mapnik/util/arena.hpp>
 
 // stl
+#include <memory>
 #include <set>
 #include <string>
 #include <tuple>
@@ -49,7 +51,8 @@ public:
           filter_factor_(1.0),
           unbuffered_bbox_(unbuffered_bbox),
           names_(),
-          vars_()
+          vars_(),
+          arena_()
     {}
 
     query(box2d<double> const& bbox,
@@ -61,7 +64,8 @@ public:
           filter_factor_(1.0),
           unbuffered_bbox_(bbox),
           names_(),
-          vars_()
+          vars_(),
+          arena_()
     {}
 
     query(box2d<double> const& bbox)
@@ -71,7 +75,8 @@ public:
           filter_factor_(1.0),
           unbuffered_bbox_(bbox),
           names_(),
-          vars_()
+          vars_(),
+          arena_()
     {}
 
     query(query const& other)
@@ -81,7 +86,8 @@ public:
           filter_factor_(other.filter_factor_),
           unbuffered_bbox_(other.unbuffered_bbox_),
           names_(other.names_),
-          vars_(other.vars_)
+          vars_(other.vars_),
+          arena_(other.arena_)
     {}
 
     query& operator=(query const& other)
@@ -94,6 +100,7 @@ public:
         unbuffered_bbox_=other.unbuffered_bbox_;
         names_=other.names_;
         vars_=other.vars_;
+        arena_=other.arena_;
         return *this;
     }
 
@@ -157,6 +164,20 @@ public:
         return vars_;
     }
 
+    // optional arena datasources allocate features and their attribute
+    // values from. Released features return their memory to the arena,
+    // which is freed once the last feature of the query is gone.
+    // Geometries still live on the heap.
+    void set_arena(std::shared_ptr<util::arena> const& arena)
+    {
+        arena_ = arena;
+    }
+
+    std::shared_ptr<util::arena> const& get_arena() const
+    {
+        return arena_;
+    }
+
 private:
     box2d<double> bbox_;
     resolution_type resolution_;
@@ -165,6 +186,7 @@ private:
     box2d<double> unbuffered_bbox_;
     std::set<std::string> names_;
     attributes vars_;
+    std::shared_ptr<util::arena> arena_;
 };
 
 }
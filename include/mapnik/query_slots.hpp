@@ -0,0 +1,134 @@
+/*****************************************************************************
+ *
+ * This file is part of Mapnik (c++ mapping toolkit)
+ *
+ * Copyright (C) 2017 Artem Pavlenko
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ *****************************************************************************/
+
+#ifndef MAPNIK_QUERY_SLOTS_HPP
+#define MAPNIK_QUERY_SLOTS_HPP
+
+// mapnik
+#include <mapnik/util/noncopyable.hpp>
+
+// stl
+#include <condition_variable>
+#include <cstddef>
+#include <limits>
+#include <mutex>
+
+namespace mapnik {
+
+// Bounds the number of queries in flight against a datasource (or a
+// resource shared by several datasources, like a connection pool).
+// Slots are granted in the order they were asked for so a query waiting
+// for a slot is never overtaken by a later one.
+class query_slot_queue : private util::noncopyable
+{
+public:
+    static constexpr std::size_t unlimited = std::numeric_limits<std::size_t>::max();
+
+    query_slot_queue()
+        : next_ticket_(0),
+          next_grant_(0),
+          in_flight_(0) {}
+
+    void acquire(std::size_t limit)
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        std::size_t ticket = next_ticket_++;
+        cond_.wait(lock, [&] { return ticket == next_grant_ && in_flight_ < limit; });
+        ++next_grant_;
+        ++in_flight_;
+        cond_.notify_all();
+    }
+
+    void release()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            --in_flight_;
+        }
+        cond_.notify_all();
+    }
+
+    std::size_t in_flight() const
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return in_flight_;
+    }
+
+private:
+    mutable std::mutex mutex_;
+    std::condition_variable cond_;
+    std::size_t next_ticket_;
+    std::size_t next_grant_;
+    std::size_t in_flight_;
+};
+
+// Holds a slot for as long as it lives
+class query_slot
+{
+public:
+    query_slot()
+        : slots_(nullptr) {}
+
+    query_slot(query_slot_queue & slots, std::size_t limit)
+        : slots_(&slots)
+    {
+        slots_->acquire(limit);
+    }
+
+    query_slot(query_slot && rhs) noexcept
+        : slots_(rhs.slots_)
+    {
+        rhs.slots_ = nullptr;
+    }
+
+    query_slot & operator=(query_slot && rhs) noexcept
+    {
+        if (this != &rhs)
+        {
+            release();
+            slots_ = rhs.slots_;
+            rhs.slots_ = nullptr;
+        }
+        return *this;
+    }
+
+    ~query_slot()
+    {
+        release();
+    }
+
+    void release()
+    {
+        if (slots_)
+        {
+            slots_->release();
+            slots_ = nullptr;
+        }
+    }
+
+private:
+    query_slot_queue * slots_;
+};
+
+}
+
+#endif // MAPNIK_QUERY_SLOTS_HPP
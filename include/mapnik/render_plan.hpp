@@ -0,0 +1,103 @@
+/*****************************************************************************
+ *
+ * This file is part of Mapnik (c++ mapping toolkit)
+ *
+ * Copyright (C) 2017 Artem Pavlenko
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ *****************************************************************************/
+
+#ifndef MAPNIK_RENDER_PLAN_HPP
+#define MAPNIK_RENDER_PLAN_HPP
+
+// mapnik
+#include <mapnik/config.hpp>
+#include <mapnik/rule_cache.hpp>
+#include <mapnik/util/noncopyable.hpp>
+
+// stl
+#include <cstddef>
+#include <map>
+#include <memory>
+#include <set>
+#include <string>
+#include <vector>
+#ifdef MAPNIK_THREADSAFE
+#include <mutex>
+#endif
+
+namespace mapnik
+{
+
+class Map;
+class layer;
+class feature_type_style;
+
+// Scale dependent setup of a layer: its active styles with their rule
+// caches and the attribute names and filter factor to query with.
+struct layer_plan : private util::noncopyable
+{
+    std::vector<feature_type_style const*> active_styles;
+    std::vector<rule_cache> rule_caches;
+    // active styles needing compositing even when the layer is not queried
+    std::vector<feature_type_style const*> composite_styles;
+    std::set<std::string> names;
+    double filter_factor = 1.0;
+};
+
+using layer_plan_ptr = std::shared_ptr<layer_plan const>;
+
+// Memoizes layer plans of one Map, so rendering many tiles does not redo
+// the style setup for each of them. A plan only depends on the styles of
+// the layer and on which of their rules are active, so plans are keyed by
+// the layer's style names and by the interval between the rules' scale
+// thresholds the scale denominator falls in. The Map's styles must not be
+// modified while a cache refers to it, call clear() after doing so.
+// A cache can be shared by renderers on different threads.
+class MAPNIK_DECL render_plan_cache : private util::noncopyable
+{
+public:
+    explicit render_plan_cache(Map const& m, std::size_t max_plans = 1024);
+
+    Map const& map() const { return map_; }
+    layer_plan_ptr get(layer const& lay, double scale_denom);
+    // number of plans held
+    std::size_t size() const;
+    void clear();
+
+    static layer_plan_ptr make_plan(Map const& m, layer const& lay, double scale_denom);
+
+private:
+    struct styles_entry
+    {
+        // sorted scale denominators at which rules of the styles turn on or off
+        std::vector<double> thresholds;
+        // plans by interval between thresholds
+        std::map<std::size_t, layer_plan_ptr> plans;
+    };
+
+    Map const& map_;
+    std::size_t max_plans_;
+    std::size_t size_;
+    std::map<std::vector<std::string>, styles_entry> entries_;
+#ifdef MAPNIK_THREADSAFE
+    mutable std::mutex mutex_;
+#endif
+};
+
+}
+
+#endif // MAPNIK_RENDER_PLAN_HPP
@@ -0,0 +1,141 @@
+/*****************************************************************************
+ *
+ * This file is part of Mapnik (c++ mapping toolkit)
+ *
+ * Copyright (C) 2017 Artem Pavlenko
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ *****************************************************************************/
+
+#ifndef MAPNIK_RENDER_REPORT_HPP
+#define MAPNIK_RENDER_REPORT_HPP
+
+// mapnik
+#include <mapnik/config.hpp>
+#include <mapnik/geometry.hpp>
+
+// stl
+#include <chrono>
+#include <cstddef>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace mapnik
+{
+
+// Wall clock time in milliseconds and work counters of one instrumented
+// step, accumulated over all its calls.
+struct render_stats
+{
+    double time = 0.0;
+    std::size_t calls = 0;
+    std::size_t features = 0;
+    std::size_t vertices = 0;
+
+    MAPNIK_DECL void add(render_stats const& rhs);
+};
+
+// Rules are reported by position in their style and symbolizers by position
+// in their rule, render_report::symbolizer_totals() sums them up by type.
+struct symbolizer_report
+{
+    std::string type;
+    render_stats stats;
+};
+
+struct rule_report
+{
+    std::string name;
+    render_stats filter;  // filter evaluation, features = features tested
+    std::size_t matches = 0;
+    render_stats render;  // symbolizers of the rule, features = features rendered
+    std::vector<symbolizer_report> symbolizers;
+};
+
+struct style_report
+{
+    std::string name;
+    render_stats query;     // fetching features from the layer featuresets
+    render_stats total;     // whole style, compositing included
+    render_stats composite; // end_style_processing: image filters and compositing
+    std::vector<rule_report> rules; // by position in the style
+};
+
+struct layer_report
+{
+    std::string name;
+    render_stats query;  // datasource queries, worker side when on a query pool
+    render_stats total;  // rendering the layer, sub layers excluded
+    std::vector<style_report> styles;
+
+    MAPNIK_DECL style_report & style(std::string const& name);
+};
+
+// Structured timing report of feature_style_processor::apply(), filled
+// when one is set with feature_style_processor::set_render_report().
+// Layers, styles and rules are looked up by name, so repeated renders
+// with the same report accumulate.
+class MAPNIK_DECL render_report
+{
+public:
+    std::vector<layer_report> layers;
+    render_stats total;
+    // agg_renderer steps over all layers, part of the symbolizer times
+    render_stats geometry;   // converting paths into rasterizer cells
+    render_stats rasterize;  // sweeping rasterizer cells into the canvas
+    render_stats labeling;   // text and shield placement, collisions included
+
+    layer_report & layer(std::string const& name);
+    std::map<std::string, render_stats> symbolizer_totals() const;
+    void clear();
+    std::string to_string() const;
+};
+
+// Measures the wall clock time since construction with a monotonic clock,
+// time_now() is too coarse for per feature steps. A timer constructed with
+// `started == false` does not read the clock, so instrumented code paths
+// cost nothing when no report is attached.
+class render_timer
+{
+public:
+    using clock = std::chrono::steady_clock;
+
+    explicit render_timer(bool started = true)
+        : start_(started ? clock::now() : clock::time_point()) {}
+
+    double elapsed() const
+    {
+        return std::chrono::duration<double, std::milli>(clock::now() - start_).count();
+    }
+
+    void stop(render_stats & stats, std::size_t features = 0, std::size_t vertices = 0) const
+    {
+        stats.time += elapsed();
+        ++stats.calls;
+        stats.features += features;
+        stats.vertices += vertices;
+    }
+
+private:
+    clock::time_point start_;
+};
+
+MAPNIK_DECL std::size_t vertex_count(geometry::geometry<double> const& geom);
+
+}
+
+#endif // MAPNIK_RENDER_REPORT_HPP
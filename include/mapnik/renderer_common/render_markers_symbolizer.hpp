@@ -28,6 +28,9 @@
 #include <mapnik/renderer_common.hpp>
 #include <mapnik/symbolizer_base.hpp>
 
+// stl
+#include <string>
+
 namespace mapnik {
 
 struct markers_dispatch_params
@@ -40,6 +43,9 @@ struct markers_dispatch_params
     bool snap_to_pixels;
     double scale_factor;
     value_double opacity;
+    // marker_cache key of a vector marker shared between features,
+    // empty for markers built for one feature
+    std::string marker_key;
 
     markers_dispatch_params(box2d<double> const& size,
                             agg::trans_affine const& tr,
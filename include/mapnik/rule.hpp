@@ -32,9 +32,13 @@
 #include <string>
 #include <vector>
 #include <limits>
+#include <memory>
 
 namespace mapnik
 {
+
+class expression_program;
+
 class MAPNIK_DECL rule
 {
 public:
@@ -46,6 +50,7 @@ private:
     double max_scale_;
     symbolizers syms_;
     expression_ptr filter_;
+    std::shared_ptr<expression_program const> filter_program_;
     bool else_filter_;
     bool also_filter_;
 
@@ -73,6 +78,8 @@ public:
     symbolizers::iterator end();
     void set_filter(expression_ptr const& filter);
     expression_ptr const& get_filter() const;
+    // filter compiled by set_filter(), null if there is no filter
+    std::shared_ptr<expression_program const> const& get_filter_program() const;
     void set_else(bool else_filter);
     bool has_else_filter() const;
     void set_also(bool also_filter);
@@ -0,0 +1,111 @@
+/*****************************************************************************
+ *
+ * This file is part of Mapnik (c++ mapping toolkit)
+ *
+ * Copyright (C) 2017 Artem Pavlenko
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ *****************************************************************************/
+
+#ifndef MAPNIK_GLYPH_BITMAP_CACHE_HPP
+#define MAPNIK_GLYPH_BITMAP_CACHE_HPP
+
+// mapnik
+#include <mapnik/config.hpp>
+#include <mapnik/util/lru_cache.hpp>
+#include <mapnik/util/noncopyable.hpp>
+
+// stl
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace mapnik
+{
+
+// A glyph (or its stroked halo) rendered to an 8 bit coverage bitmap.
+// left and top place the bitmap like FreeType does, relative to the
+// integer pixel the glyph origin falls on, y pointing up.
+struct glyph_bitmap
+{
+    std::vector<std::uint8_t> coverage;
+    unsigned width;
+    unsigned rows;
+    int left;
+    int top;
+};
+
+using glyph_bitmap_ptr = std::shared_ptr<glyph_bitmap const>;
+
+struct glyph_bitmap_key
+{
+    void const* face;
+    std::int64_t size;           // 26.6 pixels
+    std::uint32_t glyph_index;
+    std::int64_t rotation[4];    // 16.16 matrix glyphs are loaded with
+    std::int64_t transform[4];   // 16.16 matrix applied to loaded glyphs
+    std::int64_t stroke;         // 26.6 halo radius, 0 if not stroked
+    std::int32_t subpixel_x;     // position in the pixel, in 26.6 units
+    std::int32_t subpixel_y;
+
+    bool operator==(glyph_bitmap_key const& rhs) const;
+};
+
+struct glyph_bitmap_key_hash
+{
+    std::size_t operator()(glyph_bitmap_key const& key) const;
+};
+
+using glyph_bitmap_cache_stats = util::lru_cache_stats;
+
+// Thread-safe cache of rendered glyphs, bounded by the memory held by the
+// bitmaps and evicting the least recently used ones first. Glyph origins
+// are snapped to subpixel_steps positions per pixel on each axis; with 64
+// steps glyphs land exactly where FreeType would put them. Entries are tied
+// to the lifetime of their face so that a key holding its address does not
+// match another face loaded at the same address later.
+// See agg_renderer::set_glyph_bitmap_cache.
+class MAPNIK_DECL glyph_bitmap_cache : private util::noncopyable
+{
+public:
+    explicit glyph_bitmap_cache(std::size_t max_bytes = 8 << 20,
+                                unsigned subpixel_steps = 4);
+
+    unsigned subpixel_steps() const { return subpixel_steps_; }
+    void set_max_bytes(std::size_t max_bytes);
+    std::size_t max_bytes() const;
+    // returns nullptr on a miss
+    glyph_bitmap_ptr find(glyph_bitmap_key const& key);
+    void insert(glyph_bitmap_key const& key, glyph_bitmap_ptr const& bitmap,
+                std::shared_ptr<void const> const& face);
+    void clear();
+    glyph_bitmap_cache_stats stats() const;
+
+private:
+    struct entry
+    {
+        glyph_bitmap_ptr bitmap;
+        std::weak_ptr<void const> face;
+    };
+
+    unsigned const subpixel_steps_;
+    util::lru_cache<glyph_bitmap_key, entry, glyph_bitmap_key_hash> cache_;
+};
+
+}
+
+#endif // MAPNIK_GLYPH_BITMAP_CACHE_HPP
@@ -29,11 +29,14 @@
 #include <mapnik/text/face.hpp>
 #include <mapnik/text/font_feature_settings.hpp>
 #include <mapnik/text/itemizer.hpp>
+#include <mapnik/text/shaping_cache.hpp>
 #include <mapnik/safe_cast.hpp>
 #include <mapnik/font_engine_freetype.hpp>
 
 // stl
+#include <algorithm>
 #include <list>
+#include <string>
 #include <type_traits>
 
 #pragma GCC diagnostic push
@@ -128,6 +131,54 @@ static hb_language_t script_to_language(hb_script_t script)
     }
 }
 
+template <typename T>
+inline void append_key(std::string & key, T const& value)
+{
+    static_assert(std::is_trivially_copyable<T>::value, "key parts are copied bytewise");
+    key.append(reinterpret_cast<char const*>(&value), sizeof(T));
+}
+
+inline void append_key(std::string & key, std::string const& value)
+{
+    append_key(key, value.size());
+    key.append(value);
+}
+
+// HarfBuzz looks at up to HB_BUFFER_CONTEXT_LENGTH (5) characters around
+// the item, so those go into the key along with the item itself.
+inline std::string shaping_key(value_unicode_string const& text,
+                               text_item const& item,
+                               font_feature_settings const& ff_settings)
+{
+    static const unsigned context = 5;
+    unsigned first = item.start > context ? item.start - context : 0;
+    unsigned last = std::min(static_cast<unsigned>(text.length()), item.end + context);
+    std::string key;
+    key.reserve(64 + (last - first) * sizeof(UChar));
+    append_key(key, item.start - first);
+    append_key(key, item.end - item.start);
+    key.append(reinterpret_cast<char const*>(text.getBuffer() + first), (last - first) * sizeof(UChar));
+    append_key(key, item.script);
+    append_key(key, item.dir);
+    append_key(key, item.format_->face_name);
+    if (item.format_->fontset)
+    {
+        append_key(key, item.format_->fontset->get_face_names().size());
+        for (auto const& name : item.format_->fontset->get_face_names())
+        {
+            append_key(key, name);
+        }
+    }
+    for (auto const& feature : ff_settings.features())
+    {
+        append_key(key, feature.tag);
+        append_key(key, feature.value);
+        append_key(key, feature.start);
+        append_key(key, feature.end);
+    }
+    return key;
+}
+
 } // ns detail
 
 struct harfbuzz_shaper
@@ -151,20 +202,33 @@ static void shape_text(text_line & line,
     const std::unique_ptr<hb_buffer_t, decltype(hb_buffer_deleter)> buffer(hb_buffer_create(), hb_buffer_deleter);
     hb_buffer_pre_allocate(buffer.get(), safe_cast<int>(length));
     mapnik::value_unicode_string const& text = itemizer.text();
+    shaping_cache * cache = font_manager.get_shaping_cache();
     for (auto const& text_item : list)
     {
         face_set_ptr face_set = font_manager.get_face_set(text_item.format_->face_name, text_item.format_->fontset);
         double size = text_item.format_->text_size * scale_factor;
-        face_set->set_unscaled_character_sizes();
         std::size_t num_faces = face_set->size();
 
         font_feature_settings const& ff_settings = text_item.format_->ff_settings;
         int ff_count = safe_cast<int>(ff_settings.count());
 
+        std::string key;
+        if (cache != nullptr)
+        {
+            key = detail::shaping_key(text, text_item, ff_settings);
+            shaped_run_ptr run = cache->find(key);
+            if (run && add_shaped_run(line, width_map, *face_set, *run, text_item, size, scale_factor))
+            {
+                continue;
+            }
+        }
+        face_set->set_unscaled_character_sizes();
+
         // rendering information for a single glyph
         struct glyph_face_info
         {
             face_ptr face;
+            unsigned face_index;
             hb_glyph_info_t glyph;
             hb_glyph_position_t position;
         };
@@ -177,6 +241,7 @@ static void shape_text(text_line & line,
         glyphinfos.resize(text.length());
         for (auto const& face : *face_set)
         {
+            unsigned face_index = static_cast<unsigned>(pos);
             ++pos;
             hb_buffer_clear_contents(buffer.get());
             hb_buffer_add_utf16(buffer.get(), detail::uchar_to_utf16(text.getBuffer()), text.length(), text_item.start, static_cast<int>(text_item.end - text_item.start));
@@ -236,15 +301,15 @@ static void shape_text(text_line & line,
                 auto & c = glyphinfos[cluster];
                 if (c.empty())
                 {
-                    c.push_back({face, glyphs[i], positions[i]});
+                    c.push_back({face, face_index, glyphs[i], positions[i]});
                 }
                 else if (c.front().glyph.codepoint == 0)
                 {
-                    c.front() = { face, glyphs[i], positions[i] };
+                    c.front() = { face, face_index, glyphs[i], positions[i] };
                 }
                 else if (in_cluster)
                 {
-                    c.push_back({ face, glyphs[i], positions[i] });
+                    c.push_back({ face, face_index, glyphs[i], positions[i] });
                 }
             }
             bool all_set = true;
@@ -262,6 +327,7 @@ static void shape_text(text_line & line,
                 //Try next font in fontset
                 continue;
             }
+            auto run = std::make_shared<shaped_run>();
             double max_glyph_height = 0;
             for (auto const& c_id : clusters)
             {
@@ -272,10 +338,22 @@ static void shape_text(text_line & line,
                     auto const& glyph = info.glyph;
                     unsigned char_index = glyph.cluster;
                     glyph_info g(glyph.codepoint,char_index,text_item.format_);
-                    if (info.glyph.codepoint != 0) g.face = info.face;
+                    unsigned glyph_face = face_index;
+                    if (info.glyph.codepoint != 0)
+                    {
+                        g.face = info.face;
+                        glyph_face = info.face_index;
+                    }
                     else g.face = face;
                     if (g.face->glyph_dimensions(g))
                     {
+                        if (cache != nullptr)
+                        {
+                            run->push_back({glyph.codepoint, char_index - text_item.start, glyph_face,
+                                            gpos.x_advance, gpos.x_offset, gpos.y_offset,
+                                            g.unscaled_ymin, g.unscaled_ymax,
+                                            g.unscaled_line_height});
+                        }
                         g.scale_multiplier = g.face->get_face()->units_per_EM > 0 ?
                             (size / g.face->get_face()->units_per_EM) : (size / 2048.0) ;
                         //Overwrite default advance with better value provided by HarfBuzz
@@ -293,10 +371,56 @@ static void shape_text(text_line & line,
                 }
             }
             line.update_max_char_height(max_glyph_height);
+            if (cache != nullptr)
+            {
+                cache->insert(key, run);
+            }
             break; //When we reach this point the current font had all glyphs.
         }
     }
 }
+
+private:
+
+// Adds glyphs shaped before like shape_text() does, returns false if the
+// font set does not match the one the run was shaped with.
+static bool add_shaped_run(text_line & line,
+                           std::map<unsigned,double> & width_map,
+                           font_face_set & face_set,
+                           shaped_run const& run,
+                           text_item const& text_item,
+                           double size,
+                           double scale_factor)
+{
+    for (auto const& glyph : run)
+    {
+        if (glyph.face >= face_set.size()) return false;
+    }
+    double max_glyph_height = 0;
+    for (auto const& glyph : run)
+    {
+        unsigned char_index = text_item.start + glyph.cluster;
+        glyph_info g(glyph.glyph_index, char_index, text_item.format_);
+        g.face = *(face_set.begin() + glyph.face);
+        g.unscaled_ymin = glyph.unscaled_ymin;
+        g.unscaled_ymax = glyph.unscaled_ymax;
+        g.unscaled_line_height = glyph.unscaled_line_height;
+        g.scale_multiplier = g.face->get_face()->units_per_EM > 0 ?
+            (size / g.face->get_face()->units_per_EM) : (size / 2048.0) ;
+        g.unscaled_advance = glyph.x_advance;
+        g.offset.set(glyph.x_offset * g.scale_multiplier, glyph.y_offset * g.scale_multiplier);
+        double tmp_height = g.height();
+        if (g.face->is_color())
+        {
+            tmp_height = g.ymax();
+        }
+        if (tmp_height > max_glyph_height) max_glyph_height = tmp_height;
+        width_map[char_index] += g.advance();
+        line.add_glyph(std::move(g), scale_factor);
+    }
+    line.update_max_char_height(max_glyph_height);
+    return true;
+}
 };
 } // namespace mapnik
 
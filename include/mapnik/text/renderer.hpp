@@ -29,7 +29,9 @@
 #include <mapnik/symbolizer_enumerations.hpp>
 #include <mapnik/util/noncopyable.hpp>
 #include <mapnik/pixel_position.hpp>
+#include <mapnik/geometry/box2d.hpp>
 #include <mapnik/text/color_font_renderer.hpp>
+#include <mapnik/text/glyph_bitmap_cache.hpp>
 
 #pragma GCC diagnostic push
 #include <mapnik/warning_ignore.hpp>
@@ -136,11 +138,36 @@ public:
                        double scale_factor = 1.0,
                        stroker_ptr stroker = stroker_ptr());
     void render(glyph_positions const& positions);
+    // composite glyphs and halos from coverage bitmaps rendered once per
+    // face, size, glyph, transform, halo radius and subpixel position
+    void set_glyph_cache(glyph_bitmap_cache * cache)
+    {
+        glyph_cache_ = cache;
+    }
+    // pixels written by render() so far, maxx and maxy being exclusive
+    box2d<int> const& drawn() const
+    {
+        return drawn_;
+    }
 private:
     pixmap_type & pixmap_;
+    glyph_bitmap_cache * glyph_cache_;
+    box2d<int> drawn_;
+
+    void add_drawn(int x, int y, int width, int height)
+    {
+        drawn_.expand_to_include(box2d<int>(x, y, x + width, y + height));
+    }
+
+    void render_cached(glyph_positions const& positions);
+    glyph_bitmap_ptr cached_glyph(glyph_position const& glyph_pos,
+                                  FT_Matrix const& matrix,
+                                  FT_Vector const& start,
+                                  double stroke,
+                                  int & x, int & y);
 
     template <std::size_t PixelWidth>
-    void render_halo(unsigned char *buffer,
+    void render_halo(unsigned char const* buffer,
                      unsigned width,
                      unsigned height,
                      unsigned rgba, int x, int y,
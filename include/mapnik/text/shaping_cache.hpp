@@ -0,0 +1,89 @@
+/*****************************************************************************
+ *
+ * This file is part of Mapnik (c++ mapping toolkit)
+ *
+ * Copyright (C) 2017 Artem Pavlenko
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ *****************************************************************************/
+
+#ifndef MAPNIK_TEXT_SHAPING_CACHE_HPP
+#define MAPNIK_TEXT_SHAPING_CACHE_HPP
+
+// mapnik
+#include <mapnik/config.hpp>
+#include <mapnik/util/lru_cache.hpp>
+#include <mapnik/util/noncopyable.hpp>
+
+// stl
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace mapnik
+{
+
+// One glyph of a shaped text item, in font units. face is the position of
+// the glyph's face in the item's font set and cluster is relative to the
+// start of the item, so that runs can be reused by other face managers and
+// in other strings.
+struct shaped_glyph
+{
+    unsigned glyph_index;
+    unsigned cluster;
+    unsigned face;
+    std::int32_t x_advance;
+    std::int32_t x_offset;
+    std::int32_t y_offset;
+    double unscaled_ymin;
+    double unscaled_ymax;
+    double unscaled_line_height;
+};
+
+using shaped_run = std::vector<shaped_glyph>;
+using shaped_run_ptr = std::shared_ptr<shaped_run const>;
+
+using shaping_cache_stats = util::lru_cache_stats;
+
+// Thread-safe cache of harfbuzz shaping output, bounded by memory and
+// evicting the least recently used runs first. Text is shaped at the
+// unscaled size of its faces, so runs do not depend on the text size.
+// Keys are built by harfbuzz_shaper from the text, font set, script,
+// direction and font features; faces are resolved by name, so a cache
+// should only be shared by renderers using the same font registrations.
+// See face_manager::set_shaping_cache.
+class MAPNIK_DECL shaping_cache : private util::noncopyable
+{
+public:
+    explicit shaping_cache(std::size_t max_bytes = 4 << 20);
+
+    void set_max_bytes(std::size_t max_bytes);
+    std::size_t max_bytes() const;
+    // returns nullptr on a miss
+    shaped_run_ptr find(std::string const& key);
+    void insert(std::string const& key, shaped_run_ptr const& run);
+    void clear();
+    shaping_cache_stats stats() const;
+
+private:
+    util::lru_cache<std::string, shaped_run_ptr> cache_;
+};
+
+}
+
+#endif // MAPNIK_TEXT_SHAPING_CACHE_HPP
@@ -0,0 +1,239 @@
+/*****************************************************************************
+ *
+ * This file is part of Mapnik (c++ mapping toolkit)
+ *
+ * Copyright (C) 2017 Artem Pavlenko
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ *****************************************************************************/
+
+#ifndef MAPNIK_TRANSFORM_PATH_BUFFER_HPP
+#define MAPNIK_TRANSFORM_PATH_BUFFER_HPP
+
+// mapnik
+#include <mapnik/clip_converter.hpp>
+#include <mapnik/proj_transform.hpp>
+#include <mapnik/vertex.hpp>
+#include <mapnik/util/noncopyable.hpp>
+
+// stl
+#include <cstddef>
+#include <limits>
+#include <vector>
+
+namespace mapnik  {
+
+// Same output as transform_path_adapter, but rewind() reads the whole path
+// into a buffer and transforms each ring or line string in one pass with the
+// array overloads of proj_transform::backward and Transform::forward. Points
+// the projection can't transform are dropped and a following line to turns
+// into a move to, as in transform_path_adapter. Without a projection only
+// the view transform is applied, vertex by vertex. The buffers come from
+// the per thread pool of the clip converters.
+template <typename Transform, typename Geometry>
+struct transform_path_buffer : private util::noncopyable
+{
+    // SFINAE value_type detector
+    template <typename T>
+    struct void_type
+    {
+        using type = void;
+    };
+
+    template <typename T, typename D, typename _ = void>
+    struct select_value_type
+    {
+        using type = D;
+    };
+
+    template <typename T, typename D>
+    struct select_value_type<T, D, typename void_type<typename T::value_type>::type>
+    {
+        using type = typename T::value_type;
+    };
+
+    using size_type = std::size_t;
+    using value_type = typename select_value_type<Geometry, void>::type;
+
+    transform_path_buffer(Transform const& _t,
+                          Geometry & _geom,
+                          proj_transform const& prj_trans)
+        : t_(&_t),
+          geom_(_geom),
+          prj_trans_(&prj_trans),
+          buffers_(nullptr),
+          index_(0),
+          size_(0),
+          filled_(false),
+          buffered_(!prj_trans.equal()) {}
+
+    explicit transform_path_buffer(Geometry & _geom)
+        : t_(0),
+          geom_(_geom),
+          prj_trans_(0),
+          buffers_(nullptr),
+          index_(0),
+          size_(0),
+          filled_(false),
+          buffered_(true) {}
+
+    ~transform_path_buffer()
+    {
+        if (buffers_) detail::release_clip_buffers(buffers_);
+    }
+
+    void set_proj_trans(proj_transform const& prj_trans)
+    {
+        prj_trans_ = &prj_trans;
+        buffered_ = !prj_trans.equal();
+    }
+
+    void set_trans(Transform  const& t)
+    {
+        t_ = &t;
+    }
+
+    unsigned vertex(double *x, double *y) const
+    {
+        if (!buffered_)
+        {
+            unsigned command = geom_.vertex(x, y);
+            if (command != SEG_END && command != SEG_CLOSE)
+            {
+                t_->forward(x, y);
+            }
+            return command;
+        }
+        if (!filled_) fill();
+        bool skipped_points = false;
+        detail::clip_path_buffer const& path = buffers_->in;
+        while (index_ < size_)
+        {
+            unsigned command = path.commands[index_];
+            if (command == skipped)
+            {
+                skipped_points = true;
+                ++index_;
+                continue;
+            }
+            *x = path.xs[index_];
+            *y = path.ys[index_];
+            ++index_;
+            if (skipped_points && (command == SEG_LINETO))
+            {
+                command = SEG_MOVETO;
+            }
+            return command;
+        }
+        return SEG_END;
+    }
+
+    void rewind(unsigned pos) const
+    {
+        geom_.rewind(pos);
+        if (buffered_) fill();
+    }
+
+    unsigned type() const
+    {
+        return static_cast<unsigned>(geom_.type());
+    }
+
+    Geometry const& geom() const
+    {
+        return geom_;
+    }
+
+private:
+    static constexpr unsigned skipped = std::numeric_limits<unsigned>::max();
+
+    void fill() const
+    {
+        if (!buffers_) buffers_ = detail::acquire_clip_buffers();
+        detail::clip_path_buffer & path = buffers_->in;
+        filled_ = true;
+        index_ = 0;
+        path.clear();
+        double x, y;
+        unsigned command;
+        while ((command = geom_.vertex(&x, &y)) != SEG_END)
+        {
+            path.push(command, x, y);
+        }
+        size_ = path.size();
+        // close vertices are passed through untransformed
+        std::size_t first = 0;
+        for (std::size_t i = 0; i <= size_; ++i)
+        {
+            if (i == size_ || path.commands[i] == SEG_CLOSE)
+            {
+                transform_run(first, i);
+                first = i + 1;
+            }
+        }
+    }
+
+    void transform_run(std::size_t first, std::size_t last) const
+    {
+        if (first >= last) return;
+        int count = static_cast<int>(last - first);
+        detail::clip_path_buffer & path = buffers_->in;
+        double * x = path.xs.data() + first;
+        double * y = path.ys.data() + first;
+        if (prj_trans_->equal() || prj_trans_->is_known())
+        {
+            // these never fail
+            prj_trans_->backward(x, y, nullptr, count);
+        }
+        else
+        {
+            // keep the input in case some points don't transform
+            std::vector<geometry::point<double>> & backup = buffers_->temp;
+            backup.clear();
+            for (int i = 0; i < count; ++i) backup.emplace_back(x[i], y[i]);
+            if (!prj_trans_->backward(x, y, nullptr, count))
+            {
+                for (int i = 0; i < count; ++i)
+                {
+                    double z = 0;
+                    x[i] = backup[i].x;
+                    y[i] = backup[i].y;
+                    if (!prj_trans_->backward(x[i], y[i], z))
+                    {
+                        path.commands[first + i] = skipped;
+                    }
+                }
+            }
+        }
+        t_->forward(x, y, last - first);
+    }
+
+    Transform const* t_;
+    Geometry & geom_;
+    proj_transform const* prj_trans_;
+    mutable detail::clip_buffers * buffers_;
+    mutable std::size_t index_;
+    mutable std::size_t size_;
+    mutable bool filled_;
+    bool buffered_;
+};
+
+template <typename Transform, typename Geometry>
+constexpr unsigned transform_path_buffer<Transform, Geometry>::skipped;
+
+}
+
+#endif // MAPNIK_TRANSFORM_PATH_BUFFER_HPP
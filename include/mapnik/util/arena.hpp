@@ -0,0 +1,267 @@
+/*****************************************************************************
+ *
+ * This file is part of Mapnik (c++ mapping toolkit)
+ *
+ * Copyright (C) 2017 Artem Pavlenko
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ *****************************************************************************/
+
+#ifndef MAPNIK_UTIL_ARENA_HPP
+#define MAPNIK_UTIL_ARENA_HPP
+
+// mapnik
+#include <mapnik/util/noncopyable.hpp>
+
+// stl
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <memory>
+#include <new>
+#include <thread>
+#include <vector>
+
+namespace mapnik { namespace util {
+
+// Pooled memory resource for the short lived objects of one query.
+// Small allocations are carved out of large blocks in multiples of
+// `granularity` bytes and returned to a free list of their size class on
+// deallocation, so a streamed query keeps reusing the memory of the
+// features it already released. Allocations larger than `max_small_size`
+// bytes or with extended alignment go to the heap. Blocks are only freed
+// when the arena is destroyed.
+//
+// An arena is owned by the thread allocating from it and its free lists
+// are only touched by that thread, without locking. Features are often
+// released on another thread than the one reading them: such frees are
+// pushed onto an atomic list per size class, which the owner takes over
+// when its own list runs empty. Allocating from another thread moves the
+// ownership to it, which is only allowed once the previous owner is done
+// with the arena (e.g. a query handed over from a worker thread).
+class arena : private noncopyable
+{
+public:
+    static constexpr std::size_t granularity = alignof(std::max_align_t);
+    static constexpr std::size_t max_small_size = 1024;
+
+    explicit arena(std::size_t block_size = 64 * 1024)
+        : block_size_(block_size > max_small_size ? block_size : max_small_size),
+          blocks_(),
+          free_lists_(),
+          remote_free_lists_(),
+          current_(nullptr),
+          remaining_(0),
+          owner_(std::thread::id()),
+          allocated_(0),
+          remote_deallocated_(0)
+    {
+        std::fill(std::begin(free_lists_), std::end(free_lists_), nullptr);
+        for (auto & list : remote_free_lists_)
+        {
+            list.store(nullptr, std::memory_order_relaxed);
+        }
+    }
+
+    ~arena()
+    {
+        for (char * block : blocks_)
+        {
+            ::operator delete(block);
+        }
+    }
+
+    void * allocate(std::size_t bytes, std::size_t alignment = granularity)
+    {
+        std::thread::id self = std::this_thread::get_id();
+        if (owner_.load(std::memory_order_relaxed) != self)
+        {
+            owner_.store(self, std::memory_order_relaxed);
+        }
+        allocated_.store(allocated_.load(std::memory_order_relaxed) + bytes, std::memory_order_relaxed);
+        if (bytes > max_small_size || alignment > granularity)
+        {
+            return heap_allocate(bytes, alignment);
+        }
+        std::size_t size_class = class_of(bytes);
+        free_chunk * chunk = free_lists_[size_class];
+        if (chunk == nullptr)
+        {
+            chunk = remote_free_lists_[size_class].exchange(nullptr, std::memory_order_acquire);
+        }
+        if (chunk != nullptr)
+        {
+            free_lists_[size_class] = chunk->next;
+            return chunk;
+        }
+        std::size_t size = (size_class + 1) * granularity;
+        if (size > remaining_)
+        {
+            // the rest of the current block is abandoned
+            current_ = static_cast<char*>(::operator new(block_size_));
+            blocks_.push_back(current_);
+            remaining_ = block_size_;
+        }
+        void * ptr = current_;
+        current_ += size;
+        remaining_ -= size;
+        return ptr;
+    }
+
+    void deallocate(void * ptr, std::size_t bytes, std::size_t alignment = granularity) noexcept
+    {
+        bool owner = owner_.load(std::memory_order_relaxed) == std::this_thread::get_id();
+        if (owner)
+        {
+            allocated_.store(allocated_.load(std::memory_order_relaxed) - bytes, std::memory_order_relaxed);
+        }
+        else
+        {
+            remote_deallocated_.fetch_add(bytes, std::memory_order_relaxed);
+        }
+        if (bytes > max_small_size || alignment > granularity)
+        {
+            heap_deallocate(ptr, alignment);
+            return;
+        }
+        std::size_t size_class = class_of(bytes);
+        free_chunk * chunk = static_cast<free_chunk*>(ptr);
+        if (owner)
+        {
+            chunk->next = free_lists_[size_class];
+            free_lists_[size_class] = chunk;
+            return;
+        }
+        // the owner only ever takes the whole list, so a plain push is safe
+        std::atomic<free_chunk*> & list = remote_free_lists_[size_class];
+        chunk->next = list.load(std::memory_order_relaxed);
+        while (!list.compare_exchange_weak(chunk->next, chunk,
+                                           std::memory_order_release,
+                                           std::memory_order_relaxed)) {}
+    }
+
+    // bytes handed out and not yet deallocated, exact once the arena is idle
+    std::size_t allocated() const
+    {
+        return allocated_.load(std::memory_order_relaxed) -
+            remote_deallocated_.load(std::memory_order_relaxed);
+    }
+
+    // only meaningful on the owning thread or once the arena is idle
+    std::size_t num_blocks() const
+    {
+        return blocks_.size();
+    }
+
+private:
+    struct free_chunk
+    {
+        free_chunk * next;
+    };
+
+    static std::size_t class_of(std::size_t bytes)
+    {
+        return bytes == 0 ? 0 : (bytes - 1) / granularity;
+    }
+
+    // over-allocates to align and keeps the original pointer in front of
+    // the returned one
+    static void * heap_allocate(std::size_t bytes, std::size_t alignment)
+    {
+        alignment = std::max(alignment, alignof(void*));
+        char * raw = static_cast<char*>(::operator new(bytes + alignment + sizeof(void*)));
+        std::uintptr_t start = reinterpret_cast<std::uintptr_t>(raw + sizeof(void*));
+        char * ptr = raw + sizeof(void*) + (alignment - start % alignment) % alignment;
+        reinterpret_cast<void**>(ptr)[-1] = raw;
+        return ptr;
+    }
+
+    static void heap_deallocate(void * ptr, std::size_t) noexcept
+    {
+        ::operator delete(static_cast<void**>(ptr)[-1]);
+    }
+
+    static constexpr std::size_t num_size_classes = max_small_size / granularity;
+
+    std::size_t block_size_;
+    std::vector<char*> blocks_;
+    // owner only
+    free_chunk * free_lists_[num_size_classes];
+    // chunks freed by other threads
+    std::atomic<free_chunk*> remote_free_lists_[num_size_classes];
+    char * current_;
+    std::size_t remaining_;
+    std::atomic<std::thread::id> owner_;
+    // written by the owner only
+    std::atomic<std::size_t> allocated_;
+    std::atomic<std::size_t> remote_deallocated_;
+};
+
+// Standard allocator drawing from a shared arena. Every copy keeps the
+// arena alive, so objects created with std::allocate_shared can safely
+// outlive the code which set the arena up. A default constructed
+// allocator has no arena and uses the heap.
+template <typename T>
+class arena_allocator
+{
+public:
+    using value_type = T;
+
+    arena_allocator() noexcept
+        : arena_() {}
+
+    explicit arena_allocator(std::shared_ptr<arena> const& a) noexcept
+        : arena_(a) {}
+
+    template <typename U>
+    arena_allocator(arena_allocator<U> const& other) noexcept
+        : arena_(other.get_arena()) {}
+
+    T * allocate(std::size_t n)
+    {
+        if (!arena_) return static_cast<T*>(::operator new(n * sizeof(T)));
+        return static_cast<T*>(arena_->allocate(n * sizeof(T), alignof(T)));
+    }
+
+    void deallocate(T * ptr, std::size_t n) noexcept
+    {
+        if (!arena_) ::operator delete(ptr);
+        else arena_->deallocate(ptr, n * sizeof(T), alignof(T));
+    }
+
+    std::shared_ptr<arena> const& get_arena() const noexcept { return arena_; }
+
+    template <typename U>
+    bool operator==(arena_allocator<U> const& other) const noexcept
+    {
+        return arena_ == other.get_arena();
+    }
+
+    template <typename U>
+    bool operator!=(arena_allocator<U> const& other) const noexcept
+    {
+        return arena_ != other.get_arena();
+    }
+
+private:
+    std::shared_ptr<arena> arena_;
+};
+
+}}
+
+#endif // MAPNIK_UTIL_ARENA_HPP
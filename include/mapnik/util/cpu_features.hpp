@@ -0,0 +1,58 @@
+/*****************************************************************************
+ *
+ * This file is part of Mapnik (c++ mapping toolkit)
+ *
+ * Copyright (C) 2017 Artem Pavlenko
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ *****************************************************************************/
+
+#ifndef MAPNIK_UTIL_CPU_FEATURES_HPP
+#define MAPNIK_UTIL_CPU_FEATURES_HPP
+
+#include <mapnik/config.hpp>
+
+// Vectorized kernels are compiled with per function target attributes
+// and selected at runtime, so the library itself does not require any
+// instruction set extension beyond the compiler defaults.
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#define MAPNIK_HAVE_X86_SIMD
+#define MAPNIK_TARGET_SSE41 __attribute__((target("sse4.1")))
+#define MAPNIK_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+
+namespace mapnik { namespace util {
+
+enum class simd_level : int
+{
+    none = 0,
+    sse41,
+    avx2
+};
+
+// highest level supported by the cpu we are running on
+MAPNIK_DECL simd_level detected_simd_level();
+
+// level used by vectorized kernels, defaults to detected_simd_level()
+MAPNIK_DECL simd_level active_simd_level();
+
+// restrict the kernels to `level` (clamped to detected_simd_level()),
+// e.g. to compare vectorized and scalar code paths
+MAPNIK_DECL void set_simd_level(simd_level level);
+
+}}
+
+#endif // MAPNIK_UTIL_CPU_FEATURES_HPP
@@ -0,0 +1,87 @@
+/*****************************************************************************
+ *
+ * This file is part of Mapnik (c++ mapping toolkit)
+ *
+ * Copyright (C) 2017 Artem Pavlenko
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ *****************************************************************************/
+
+#ifndef MAPNIK_DEFERRED_FEATURESET_HPP
+#define MAPNIK_DEFERRED_FEATURESET_HPP
+
+// mapnik
+#include <mapnik/featureset.hpp>
+
+// stl
+#include <future>
+
+namespace mapnik {
+
+// Featureset whose source is produced asynchronously (e.g. on a
+// util::thread_pool). The first call to next() waits for the result
+// and rethrows any exception raised while querying the datasource.
+class deferred_featureset : public Featureset
+{
+public:
+    explicit deferred_featureset(std::future<featureset_ptr> && result)
+      : result_(result.share()),
+        features_()
+    {}
+
+    explicit deferred_featureset(std::shared_future<featureset_ptr> const& result)
+      : result_(result),
+        features_()
+    {}
+
+    virtual ~deferred_featureset() {}
+
+    feature_ptr next()
+    {
+        if (result_.valid())
+        {
+            features_ = result_.get();
+            result_ = std::shared_future<featureset_ptr>();
+        }
+        if (features_)
+        {
+            return features_->next();
+        }
+        return feature_ptr();
+    }
+
+    std::size_t next_batch(feature_ptr * features, std::size_t size)
+    {
+        if (result_.valid())
+        {
+            features_ = result_.get();
+            result_ = std::shared_future<featureset_ptr>();
+        }
+        if (features_)
+        {
+            return features_->next_batch(features, size);
+        }
+        return 0;
+    }
+
+private:
+    std::shared_future<featureset_ptr> result_;
+    featureset_ptr features_;
+};
+
+}
+
+#endif // MAPNIK_DEFERRED_FEATURESET_HPP
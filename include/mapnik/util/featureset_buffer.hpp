@@ -26,6 +26,7 @@
 // mapnik
 #include <mapnik/featureset.hpp>
 
+#include <algorithm>
 #include <vector>
 
 namespace mapnik {
@@ -50,6 +51,14 @@ public:
         return feature_ptr();
     }
 
+    std::size_t next_batch(feature_ptr * features, std::size_t size)
+    {
+        std::size_t count = std::min(size, static_cast<std::size_t>(end_ - pos_));
+        std::copy(pos_, pos_ + count, features);
+        pos_ += count;
+        return count;
+    }
+
     void push(feature_ptr const& feature)
     {
         features_.push_back(feature);
@@ -0,0 +1,200 @@
+/*****************************************************************************
+ *
+ * This file is part of Mapnik (c++ mapping toolkit)
+ *
+ * Copyright (C) 2017 Artem Pavlenko
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ *****************************************************************************/
+
+#ifndef MAPNIK_UTIL_LRU_CACHE_HPP
+#define MAPNIK_UTIL_LRU_CACHE_HPP
+
+// mapnik
+#include <mapnik/util/noncopyable.hpp>
+
+// boost
+#include <boost/optional.hpp>
+
+// stl
+#include <cstddef>
+#include <functional>
+#include <list>
+#include <unordered_map>
+#include <utility>
+#ifdef MAPNIK_THREADSAFE
+#include <mutex>
+#endif
+
+namespace mapnik { namespace util {
+
+struct lru_cache_stats
+{
+    std::size_t hits = 0;
+    std::size_t misses = 0;
+    std::size_t evictions = 0;
+    std::size_t entries = 0;
+    std::size_t bytes = 0;
+    std::size_t max_bytes = 0;
+};
+
+// Thread-safe map bounded by the memory held by its values, evicting the
+// least recently used entries first. Callers estimate the bytes held by
+// each value, the cache adds the cost of its own bookkeeping. Values are
+// returned by copy, so they are usually shared pointers to immutable data.
+template <typename Key, typename Value, typename Hash = std::hash<Key>>
+class lru_cache : private noncopyable
+{
+public:
+    explicit lru_cache(std::size_t max_bytes)
+        : entries_(),
+          index_(),
+          max_bytes_(max_bytes),
+          bytes_(0),
+          hits_(0),
+          misses_(0),
+          evictions_(0) {}
+
+    void set_max_bytes(std::size_t max_bytes)
+    {
+#ifdef MAPNIK_THREADSAFE
+        std::lock_guard<std::mutex> lock(mutex_);
+#endif
+        max_bytes_ = max_bytes;
+        evict(max_bytes_);
+    }
+
+    std::size_t max_bytes() const
+    {
+#ifdef MAPNIK_THREADSAFE
+        std::lock_guard<std::mutex> lock(mutex_);
+#endif
+        return max_bytes_;
+    }
+
+    boost::optional<Value> find(Key const& key)
+    {
+        return find(key, [](Value const&) { return true; });
+    }
+
+    // Entries for which valid(value) is false are stale, e.g. refer to an
+    // object gone since whose address was reused. They are dropped and
+    // reported as a miss.
+    template <typename Valid>
+    boost::optional<Value> find(Key const& key, Valid valid)
+    {
+#ifdef MAPNIK_THREADSAFE
+        std::lock_guard<std::mutex> lock(mutex_);
+#endif
+        auto itr = index_.find(key);
+        if (itr != index_.end())
+        {
+            typename entry_list::iterator pos = itr->second;
+            if (valid(pos->value))
+            {
+                entries_.splice(entries_.begin(), entries_, pos);
+                ++hits_;
+                return pos->value;
+            }
+            bytes_ -= pos->bytes;
+            entries_.erase(pos);
+            index_.erase(itr);
+        }
+        ++misses_;
+        return boost::none;
+    }
+
+    // returns false if the value is too large to cache or the key was
+    // inserted meanwhile, by another thread
+    bool insert(Key const& key, Value const& value, std::size_t bytes)
+    {
+        // the key is stored in the list and in the index
+        bytes += sizeof(entry) + sizeof(Key) + 2 * sizeof(void*);
+#ifdef MAPNIK_THREADSAFE
+        std::lock_guard<std::mutex> lock(mutex_);
+#endif
+        if (bytes > max_bytes_ || index_.count(key) > 0)
+        {
+            return false;
+        }
+        entries_.push_front(entry{key, value, bytes});
+        index_.emplace(key, entries_.begin());
+        bytes_ += bytes;
+        evict(max_bytes_);
+        return true;
+    }
+
+    void clear()
+    {
+#ifdef MAPNIK_THREADSAFE
+        std::lock_guard<std::mutex> lock(mutex_);
+#endif
+        entries_.clear();
+        index_.clear();
+        bytes_ = 0;
+    }
+
+    lru_cache_stats stats() const
+    {
+#ifdef MAPNIK_THREADSAFE
+        std::lock_guard<std::mutex> lock(mutex_);
+#endif
+        lru_cache_stats result;
+        result.hits = hits_;
+        result.misses = misses_;
+        result.evictions = evictions_;
+        result.entries = entries_.size();
+        result.bytes = bytes_;
+        result.max_bytes = max_bytes_;
+        return result;
+    }
+
+private:
+    struct entry
+    {
+        Key key;
+        Value value;
+        std::size_t bytes;
+    };
+    using entry_list = std::list<entry>;
+
+    void evict(std::size_t max_bytes)
+    {
+        while (bytes_ > max_bytes && !entries_.empty())
+        {
+            entry const& last = entries_.back();
+            bytes_ -= last.bytes;
+            index_.erase(last.key);
+            entries_.pop_back();
+            ++evictions_;
+        }
+    }
+
+    entry_list entries_;
+    std::unordered_map<Key, typename entry_list::iterator, Hash> index_;
+    std::size_t max_bytes_;
+    std::size_t bytes_;
+    std::size_t hits_;
+    std::size_t misses_;
+    std::size_t evictions_;
+#ifdef MAPNIK_THREADSAFE
+    mutable std::mutex mutex_;
+#endif
+};
+
+}}
+
+#endif // MAPNIK_UTIL_LRU_CACHE_HPP
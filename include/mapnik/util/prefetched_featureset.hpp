@@ -0,0 +1,114 @@
+/*****************************************************************************
+ *
+ * This file is part of Mapnik (c++ mapping toolkit)
+ *
+ * Copyright (C) 2017 Artem Pavlenko
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ *****************************************************************************/
+
+#ifndef MAPNIK_PREFETCHED_FEATURESET_HPP
+#define MAPNIK_PREFETCHED_FEATURESET_HPP
+
+// mapnik
+#include <mapnik/featureset.hpp>
+#include <mapnik/query_slots.hpp>
+
+// stl
+#include <algorithm>
+#include <vector>
+
+namespace mapnik {
+
+// Featureset returning the features a query read ahead (e.g. on a
+// util::thread_pool worker) and then the features left in the live
+// featureset the read ahead stopped at. The query's slot is kept until
+// the live featureset is exhausted or the prefetched_featureset destroyed.
+class prefetched_featureset : public Featureset
+{
+public:
+    prefetched_featureset(std::vector<feature_ptr> && features,
+                          featureset_ptr const& rest,
+                          query_slot && slot)
+      : features_(std::move(features)),
+        pos_(0),
+        slot_(std::move(slot)),
+        rest_(rest)
+    {
+        if (!rest_) slot_.release();
+    }
+
+    virtual ~prefetched_featureset() {}
+
+    feature_ptr next()
+    {
+        if (pos_ < features_.size())
+        {
+            return std::move(features_[pos_++]);
+        }
+        if (rest_)
+        {
+            feature_ptr feature = rest_->next();
+            if (!feature) finish();
+            return feature;
+        }
+        return feature_ptr();
+    }
+
+    std::size_t next_batch(feature_ptr * features, std::size_t size)
+    {
+        if (pos_ < features_.size())
+        {
+            std::size_t count = std::min(size, features_.size() - pos_);
+            std::move(features_.begin() + pos_, features_.begin() + pos_ + count, features);
+            pos_ += count;
+            return count;
+        }
+        if (rest_)
+        {
+            std::size_t count = rest_->next_batch(features, size);
+            if (count == 0) finish();
+            return count;
+        }
+        return 0;
+    }
+
+    // whether features are left in the live featureset
+    bool live() const
+    {
+        return rest_ != nullptr;
+    }
+
+private:
+    void finish()
+    {
+        features_.clear();
+        // let the datasource reclaim its resources (e.g. a cursor's
+        // connection) before the next query gets the slot
+        rest_.reset();
+        slot_.release();
+    }
+
+    std::vector<feature_ptr> features_;
+    std::size_t pos_;
+    // destroyed after rest_
+    query_slot slot_;
+    featureset_ptr rest_;
+};
+
+}
+
+#endif // MAPNIK_PREFETCHED_FEATURESET_HPP
@@ -0,0 +1,120 @@
+/*****************************************************************************
+ *
+ * This file is part of Mapnik (c++ mapping toolkit)
+ *
+ * Copyright (C) 2017 Artem Pavlenko
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ *****************************************************************************/
+
+#ifndef MAPNIK_UTIL_THREAD_POOL_HPP
+#define MAPNIK_UTIL_THREAD_POOL_HPP
+
+// mapnik
+#include <mapnik/util/noncopyable.hpp>
+
+// stl
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+namespace mapnik { namespace util {
+
+// Fixed size pool of worker threads executing tasks in FIFO order.
+// Tasks are submitted as nullary callables and their results (or
+// exceptions) are handed back through std::future.
+class thread_pool : private noncopyable
+{
+public:
+    explicit thread_pool(std::size_t num_threads = std::thread::hardware_concurrency())
+        : stop_(false)
+    {
+        num_threads = std::max<std::size_t>(1, num_threads);
+        workers_.reserve(num_threads);
+        for (std::size_t i = 0; i < num_threads; ++i)
+        {
+            workers_.emplace_back([this] { run(); });
+        }
+    }
+
+    ~thread_pool()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stop_ = true;
+        }
+        cond_.notify_all();
+        for (std::thread & worker : workers_)
+        {
+            worker.join();
+        }
+    }
+
+    template <typename F>
+    auto submit(F && f) -> std::future<typename std::result_of<F()>::type>
+    {
+        using result_type = typename std::result_of<F()>::type;
+        auto task = std::make_shared<std::packaged_task<result_type()>>(std::forward<F>(f));
+        std::future<result_type> result = task->get_future();
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            tasks_.emplace_back([task] { (*task)(); });
+        }
+        cond_.notify_one();
+        return result;
+    }
+
+    std::size_t size() const
+    {
+        return workers_.size();
+    }
+
+private:
+    void run()
+    {
+        for (;;)
+        {
+            std::function<void()> task;
+            {
+                std::unique_lock<std::mutex> lock(mutex_);
+                cond_.wait(lock, [this] { return stop_ || !tasks_.empty(); });
+                // drain remaining tasks before shutting down so that
+                // no future is left without a value
+                if (tasks_.empty()) return;
+                task = std::move(tasks_.front());
+                tasks_.pop_front();
+            }
+            task();
+        }
+    }
+
+    std::vector<std::thread> workers_;
+    std::deque<std::function<void()>> tasks_;
+    std::mutex mutex_;
+    std::condition_variable cond_;
+    bool stop_;
+};
+
+}}
+
+#endif // MAPNIK_UTIL_THREAD_POOL_HPP
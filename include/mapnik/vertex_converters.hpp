@@ -28,6 +28,7 @@
 #include <mapnik/attribute.hpp>
 #include <mapnik/view_transform.hpp>
 #include <mapnik/transform_path_adapter.hpp>
+#include <mapnik/transform_path_buffer.hpp>
 #include <mapnik/offset_converter.hpp>
 #include <mapnik/simplify.hpp>
 #include <mapnik/simplify_converter.hpp>
@@ -37,6 +38,7 @@
 #include <mapnik/symbolizer_keys.hpp>
 #include <mapnik/symbolizer.hpp>
 #include <mapnik/extend_converter.hpp>
+#include <mapnik/clip_converter.hpp>
 
 #pragma GCC diagnostic push
 #include <mapnik/warning_ignore_agg.hpp>
@@ -60,6 +62,9 @@ namespace mapnik {
 struct transform_tag {};
 struct clip_line_tag {};
 struct clip_poly_tag {};
+// clip with line_clip_converter and polygon_clip_converter instead of agg
+struct clip_line_simd_tag {};
+struct clip_poly_simd_tag {};
 struct smooth_tag {};
 struct simplify_tag {};
 struct stroke_tag {};
@@ -114,6 +119,20 @@ struct converter_traits<T, mapnik::clip_line_tag>
     }
 };
 
+template <typename T>
+struct converter_traits<T, mapnik::clip_line_simd_tag>
+{
+    using geometry_type = T;
+    using conv_type = line_clip_converter<geometry_type>;
+
+    template <typename Args>
+    static void setup(geometry_type & geom, Args const& args)
+    {
+        auto const& box = args.bbox;
+        geom.clip_box(box.minx(),box.miny(),box.maxx(),box.maxy());
+    }
+};
+
 template <typename T>
 struct converter_traits<T, mapnik::dash_tag>
 {
@@ -207,11 +226,24 @@ struct converter_traits<T,mapnik::clip_poly_tag>
     }
 };
 
+template <typename T>
+struct converter_traits<T,mapnik::clip_poly_simd_tag>
+{
+    using geometry_type = T;
+    using conv_type = polygon_clip_converter<geometry_type>;
+    template <typename Args>
+    static void setup(geometry_type & geom, Args const& args)
+    {
+        auto const& box = args.bbox;
+        geom.clip_box(box.minx(),box.miny(),box.maxx(),box.maxy());
+    }
+};
+
 template <typename T>
 struct converter_traits<T,mapnik::transform_tag>
 {
     using geometry_type = T;
-    using conv_type = transform_path_adapter<view_transform, geometry_type>;
+    using conv_type = transform_path_buffer<view_transform, geometry_type>;
 
     template <typename Args>
     static void setup(geometry_type & geom, Args const& args)
@@ -28,6 +28,9 @@
 #include <mapnik/geometry/box2d.hpp>
 #include <mapnik/proj_transform.hpp>
 
+// stl
+#include <cstddef>
+
 namespace mapnik
 {
 
@@ -103,6 +106,21 @@ public:
         *y = (extent_.maxy() - *y) * sy_ - (offset_y_ - offset_);
     }
 
+    // transforms count points from separate x and y arrays, with the same
+    // arithmetic as forward(x, y) so compilers can vectorize the loop
+    inline void forward(double * x, double * y, std::size_t count) const
+    {
+        double const minx = extent_.minx();
+        double const maxy = extent_.maxy();
+        double const dx = offset_x_ - offset_;
+        double const dy = offset_y_ - offset_;
+        for (std::size_t i = 0; i < count; ++i)
+        {
+            x[i] = (x[i] - minx) * sx_ - dx;
+            y[i] = (maxy - y[i]) * sy_ - dy;
+        }
+    }
+
     inline void backward(double *x, double *y) const
     {
         *x = extent_.minx() + (*x + (offset_x_ - offset_)) / sx_;
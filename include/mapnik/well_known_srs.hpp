@@ -24,6 +24,7 @@
 #define MAPNIK_WELL_KNOWN_SRS_HPP
 
 // mapnik
+#include <mapnik/config.hpp>
 #include <mapnik/global.hpp> // for M_PI on windows
 #include <mapnik/enumeration.hpp>
 #include <mapnik/geometry/point.hpp>
@@ -35,6 +36,7 @@
 
 // stl
 #include <cmath>
+#include <cstddef>
 #include <vector>
 
 namespace mapnik {
@@ -64,63 +66,29 @@ boost::optional<well_known_srs_e> is_well_known_srs(std::string const& srs);
 
 boost::optional<bool> is_known_geographic(std::string const& srs);
 
-static inline bool lonlat2merc(double * x, double * y, std::size_t point_count)
-{
-    for (std::size_t i = 0; i < point_count; ++i)
-    {
-        if (x[i] > 180) x[i] = 180;
-        else if (x[i] < -180) x[i] = -180;
-        if (y[i] > MAX_LATITUDE) y[i] = MAX_LATITUDE;
-        else if (y[i] < -MAX_LATITUDE) y[i] = -MAX_LATITUDE;
-        x[i] = x[i] * MAXEXTENTby180;
-        y[i] = std::log(std::tan((90.0 + y[i]) * M_PIby360)) * R2D * MAXEXTENTby180;
-    }
-    return true;
-}
+// Web mercator <-> WGS84 for point_count points in separate x and y arrays,
+// with consecutive points `stride` doubles apart (2 for interleaved x and y).
+// These dispatch to sse4.1 or avx2 code when available (see
+// util::active_simd_level()), which evaluates the same formulas with
+// polynomial approximations of the transcendental functions. The vectorized
+// results are within 1e-6 metres (lonlat2merc) and 1e-13 degrees
+// (merc2lonlat) of the scalar code. Strided points are transformed a block
+// at a time through contiguous copies.
+MAPNIK_DECL bool lonlat2merc(double * x, double * y, std::size_t point_count, std::size_t stride = 1);
+MAPNIK_DECL bool merc2lonlat(double * x, double * y, std::size_t point_count, std::size_t stride = 1);
 
-static inline bool merc2lonlat(double * x, double * y, std::size_t point_count)
-{
-    for(std::size_t i = 0; i < point_count; ++i)
-    {
-        if (x[i] > MAXEXTENT) x[i] = MAXEXTENT;
-        else if (x[i] < -MAXEXTENT) x[i] = -MAXEXTENT;
-        if (y[i] > MAXEXTENT) y[i] = MAXEXTENT;
-        else if (y[i] < -MAXEXTENT) y[i] = -MAXEXTENT;
-        x[i] = (x[i] / MAXEXTENT) * 180;
-        y[i] = (y[i] / MAXEXTENT) * 180;
-        y[i] = R2D * (2 * std::atan(std::exp(y[i] * D2R)) - M_PI_by2);
-    }
-    return true;
-}
+static_assert(sizeof(geometry::point<double>) == 2 * sizeof(double), "geometry::point<double> must be two packed doubles");
 
 static inline bool lonlat2merc(std::vector<geometry::point<double>> & ls)
 {
-    for (auto& p : ls)
-    {
-        if (p.x > 180) p.x = 180;
-        else if (p.x < -180) p.x = -180;
-        if (p.y > MAX_LATITUDE) p.y = MAX_LATITUDE;
-        else if (p.y < -MAX_LATITUDE) p.y = -MAX_LATITUDE;
-        p.x = p.x * MAXEXTENTby180;
-        p.y = std::log(std::tan((90 + p.y) * M_PIby360)) * R2D;
-        p.y = p.y * MAXEXTENTby180;
-    }
-    return true;
+    if (ls.empty()) return true;
+    return lonlat2merc(&ls[0].x, &ls[0].y, ls.size(), 2);
 }
 
 static inline bool merc2lonlat(std::vector<geometry::point<double>> & ls)
 {
-    for (auto & p : ls)
-    {
-        if (p.x > MAXEXTENT) p.x = MAXEXTENT;
-        else if (p.x < -MAXEXTENT) p.x = -MAXEXTENT;
-        if (p.y > MAXEXTENT) p.y = MAXEXTENT;
-        else if (p.y < -MAXEXTENT) p.y = -MAXEXTENT;
-        p.x = (p.x / MAXEXTENT) * 180;
-        p.y = (p.y / MAXEXTENT) * 180;
-        p.y = R2D * (2 * std::atan(std::exp(p.y * D2R)) - M_PI_by2);
-    }
-    return true;
+    if (ls.empty()) return true;
+    return merc2lonlat(&ls[0].x, &ls[0].y, ls.size(), 2);
 }
 
 }
@@ -32,7 +32,8 @@
 #include <deque>
 
 csv_featureset::csv_featureset(std::string const& filename, locator_type const& locator, char separator, char quote,
-                               std::vector<std::string> const& headers, mapnik::context_ptr const& ctx, array_type && index_array)
+                               std::vector<std::string> const& headers, mapnik::context_ptr const& ctx, array_type && index_array,
+                               std::shared_ptr<mapnik::util::arena> const& arena)
     :
 #if defined(MAPNIK_MEMORY_MAPPED_FILE)
     //
@@ -48,6 +49,7 @@ csv_featureset::csv_featureset(std::string const& filename, locator_type const&
     index_itr_(index_array_.begin()),
     index_end_(index_array_.end()),
     ctx_(ctx),
+    arena_(arena),
     locator_(locator),
     tr_("utf8")
 {
@@ -75,7 +77,7 @@ mapnik::feature_ptr csv_featureset::parse_feature(char const* beg, char const* e
     auto geom = csv_utils::extract_geometry(values, locator_);
     if (!geom.is<mapnik::geometry::geometry_empty>())
     {
-        mapnik::feature_ptr feature(mapnik::feature_factory::create(ctx_, ++feature_id_));
+        mapnik::feature_ptr feature(mapnik::feature_factory::create(ctx_, ++feature_id_, arena_));
         feature->set_geometry(std::move(geom));
         csv_utils::process_properties(*feature, headers_, values, locator_, tr_);
         return feature;
@@ -108,3 +110,8 @@ mapnik::feature_ptr csv_featureset::next()
     }
     return mapnik::feature_ptr();
 }
+
+std::size_t csv_featureset::next_batch(mapnik::feature_ptr * features, std::size_t size)
+{
+    return mapnik::fill_batch(*this, features, size);
+}
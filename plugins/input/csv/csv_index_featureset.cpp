@@ -40,11 +40,13 @@ csv_index_featureset::csv_index_featureset(std::string const& filename,
                                            char separator,
                                            char quote,
                                            std::vector<std::string> const& headers,
-                                           mapnik::context_ptr const& ctx)
+                                           mapnik::context_ptr const& ctx,
+                                           std::shared_ptr<mapnik::util::arena> const& arena)
     : separator_(separator),
       quote_(quote),
       headers_(headers),
       ctx_(ctx),
+      arena_(arena),
       locator_(locator),
       tr_("utf8")
 #if defined(MAPNIK_MEMORY_MAPPED_FILE)
@@ -96,7 +98,7 @@ mapnik::feature_ptr csv_index_featureset::parse_feature(char const* beg, char co
     auto geom = csv_utils::extract_geometry(values, locator_);
     if (!geom.is<mapnik::geometry::geometry_empty>())
     {
-        mapnik::feature_ptr feature(mapnik::feature_factory::create(ctx_, ++feature_id_));
+        mapnik::feature_ptr feature(mapnik::feature_factory::create(ctx_, ++feature_id_, arena_));
         feature->set_geometry(std::move(geom));
         csv_utils::process_properties(*feature, headers_, values, locator_, tr_);
         return feature;
@@ -135,3 +137,8 @@ mapnik::feature_ptr csv_index_featureset::next()
     }
     return mapnik::feature_ptr();
 }
+
+std::size_t csv_index_featureset::next_batch(mapnik::feature_ptr * features, std::size_t size)
+{
+    return mapnik::fill_batch(*this, features, size);
+}
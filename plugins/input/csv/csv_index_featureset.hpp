@@ -25,6 +25,7 @@
 
 #include <mapnik/feature.hpp>
 #include <mapnik/unicode.hpp>
+#include <mapnik/util/arena.hpp>
 #include <mapnik/geom_util.hpp>
 #include <mapnik/util/spatial_index.hpp>
 #include "csv_utils.hpp"
@@ -51,15 +52,18 @@ public:
                          char separator,
                          char quote,
                          std::vector<std::string> const& headers,
-                         mapnik::context_ptr const& ctx);
+                         mapnik::context_ptr const& ctx,
+                         std::shared_ptr<mapnik::util::arena> const& arena = nullptr);
     ~csv_index_featureset();
     mapnik::feature_ptr next();
+    std::size_t next_batch(mapnik::feature_ptr * features, std::size_t size);
 private:
     mapnik::feature_ptr parse_feature(char const* beg, char const* end);
     char separator_;
     char quote_;
     std::vector<std::string> headers_;
     mapnik::context_ptr ctx_;
+    std::shared_ptr<mapnik::util::arena> arena_;
     mapnik::value_integer feature_id_ = 0;
     locator_type const& locator_;
     mapnik::transcoder tr_;
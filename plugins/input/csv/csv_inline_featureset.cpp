@@ -38,7 +38,8 @@ csv_inline_featureset::csv_inline_featureset(std::string const& inline_string,
                                              char quote,
                                              std::vector<std::string> const& headers,
                                              mapnik::context_ptr const& ctx,
-                                             array_type && index_array)
+                                             array_type && index_array,
+                                             std::shared_ptr<mapnik::util::arena> const& arena)
     : inline_string_(inline_string),
       separator_(separator),
       quote_(quote),
@@ -47,6 +48,7 @@ csv_inline_featureset::csv_inline_featureset(std::string const& inline_string,
       index_itr_(index_array_.begin()),
       index_end_(index_array_.end()),
       ctx_(ctx),
+      arena_(arena),
       locator_(locator),
       tr_("utf8") {}
 
@@ -60,7 +62,7 @@ mapnik::feature_ptr csv_inline_featureset::parse_feature(std::string const& str)
     auto geom = csv_utils::extract_geometry(values, locator_);
     if (!geom.is<mapnik::geometry::geometry_empty>())
     {
-        mapnik::feature_ptr feature(mapnik::feature_factory::create(ctx_, ++feature_id_));
+        mapnik::feature_ptr feature(mapnik::feature_factory::create(ctx_, ++feature_id_, arena_));
         feature->set_geometry(std::move(geom));
         csv_utils::process_properties(*feature, headers_, values, locator_, tr_);
         return feature;
@@ -80,3 +82,8 @@ mapnik::feature_ptr csv_inline_featureset::next()
     }
     return mapnik::feature_ptr();
 }
+
+std::size_t csv_inline_featureset::next_batch(mapnik::feature_ptr * features, std::size_t size)
+{
+    return mapnik::fill_batch(*this, features, size);
+}
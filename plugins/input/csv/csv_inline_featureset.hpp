@@ -25,6 +25,7 @@
 
 #include <mapnik/feature.hpp>
 #include <mapnik/unicode.hpp>
+#include <mapnik/util/arena.hpp>
 #include "csv_utils.hpp"
 #include "csv_datasource.hpp"
 #include <deque>
@@ -40,9 +41,11 @@ public:
                           char quote,
                           std::vector<std::string> const& headers,
                           mapnik::context_ptr const& ctx,
-                          array_type && index_array);
+                          array_type && index_array,
+                          std::shared_ptr<mapnik::util::arena> const& arena = nullptr);
     ~csv_inline_featureset();
     mapnik::feature_ptr next();
+    std::size_t next_batch(mapnik::feature_ptr * features, std::size_t size);
 private:
     mapnik::feature_ptr parse_feature(std::string const& str);
     std::string const& inline_string_;
@@ -53,6 +56,7 @@ private:
     array_type::const_iterator index_itr_;
     array_type::const_iterator index_end_;
     mapnik::context_ptr ctx_;
+    std::shared_ptr<mapnik::util::arena> arena_;
     mapnik::value_integer feature_id_ = 0;
     locator_type const& locator_;
     mapnik::transcoder tr_;
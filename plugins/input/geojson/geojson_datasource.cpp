@@ -394,6 +394,8 @@ void geojson_datasource::parse_geojson(Iterator start, Iterator end)
 
         features_.push_back(std::move(feature));
     }
+    // all columns are known, bind attribute ids for rendering
+    ctx->freeze();
     using values_container = std::vector< std::pair<box_type, std::pair<std::uint64_t, std::uint64_t>>>;
     values_container values;
     values.reserve(features_.size());
@@ -446,6 +448,13 @@ mapnik::layer_descriptor geojson_datasource::get_descriptor() const
     return desc_;
 }
 
+std::size_t geojson_datasource::max_concurrent_queries() const
+{
+    // the index and cached features are read only after construction and
+    // every featureset opens its own file handle
+    return mapnik::query_slot_queue::unlimited;
+}
+
 boost::optional<mapnik::datasource_geometry_t> geojson_datasource::get_geometry_type() const
 {
     boost::optional<mapnik::datasource_geometry_t> result;
@@ -586,14 +595,14 @@ mapnik::featureset_ptr geojson_datasource::features(mapnik::query const& q) cons
             }
             else
             {
-                return std::make_shared<geojson_memory_index_featureset>(filename_, std::move(index_array));
+                return std::make_shared<geojson_memory_index_featureset>(filename_, std::move(index_array), q.get_arena());
             }
         }
         else if (has_disk_index_)
         {
             auto const& bbox = q.get_bbox();
             mapnik::bounding_box_filter<float> const filter(mapnik::box2d<float>(bbox.minx(), bbox.miny(), bbox.maxx(), bbox.maxy()));
-            return std::make_shared<geojson_index_featureset>(filename_, filter);
+            return std::make_shared<geojson_index_featureset>(filename_, filter, q.get_arena());
         }
     }
     // otherwise return an empty featureset
@@ -51,3 +51,21 @@ mapnik::feature_ptr geojson_featureset::next()
     }
     return mapnik::feature_ptr();
 }
+
+std::size_t geojson_featureset::next_batch(mapnik::feature_ptr * features, std::size_t size)
+{
+    std::size_t count = 0;
+    while (count < size && index_itr_ != index_end_)
+    {
+        std::size_t index = index_itr_->second.first;
+        if (index >= features_.size())
+        {
+            // same as next(): an invalid index ends the featureset
+            index_itr_ = index_end_;
+            break;
+        }
+        features[count++] = features_[index];
+        ++index_itr_;
+    }
+    return count;
+}
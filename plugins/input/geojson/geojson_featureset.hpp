@@ -38,6 +38,7 @@ public:
                        array_type && index_array);
     virtual ~geojson_featureset();
     mapnik::feature_ptr next();
+    std::size_t next_batch(mapnik::feature_ptr * features, std::size_t size);
 
 private:
     std::vector<mapnik::feature_ptr> const& features_;
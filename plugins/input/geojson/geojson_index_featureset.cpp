@@ -35,7 +35,8 @@
 #include <fstream>
 #include <algorithm>
 
-geojson_index_featureset::geojson_index_featureset(std::string const& filename, mapnik::bounding_box_filter<float> const& filter)
+geojson_index_featureset::geojson_index_featureset(std::string const& filename, mapnik::bounding_box_filter<float> const& filter,
+                                                   std::shared_ptr<mapnik::util::arena> const& arena)
     :
 #if defined(MAPNIK_MEMORY_MAPPED_FILE)
     //
@@ -44,7 +45,8 @@ geojson_index_featureset::geojson_index_featureset(std::string const& filename,
 #else
     file_(std::fopen(filename.c_str(),"rb"), std::fclose),
 #endif
-    ctx_(std::make_shared<mapnik::context_type>())
+    ctx_(std::make_shared<mapnik::context_type>()),
+    arena_(arena)
 {
 
 #if defined (MAPNIK_MEMORY_MAPPED_FILE)
@@ -99,7 +101,7 @@ mapnik::feature_ptr geojson_index_featureset::next()
         auto const*  end = (count == 1) ? start + record.size() : start;
 #endif
         static const mapnik::transcoder tr("utf8");
-        mapnik::feature_ptr feature(mapnik::feature_factory::create(ctx_, feature_id_++));
+        mapnik::feature_ptr feature(mapnik::feature_factory::create(ctx_, feature_id_++, arena_));
         using mapnik::json::grammar::iterator_type;
         mapnik::json::parse_feature(start, end, *feature, tr); // throw on failure
         // skip empty geometries
@@ -108,3 +110,8 @@ mapnik::feature_ptr geojson_index_featureset::next()
     }
     return mapnik::feature_ptr();
 }
+
+std::size_t geojson_index_featureset::next_batch(mapnik::feature_ptr * features, std::size_t size)
+{
+    return mapnik::fill_batch(*this, features, size);
+}
@@ -27,6 +27,7 @@
 #include <mapnik/feature.hpp>
 #include <mapnik/geom_util.hpp>
 #include <mapnik/util/spatial_index.hpp>
+#include <mapnik/util/arena.hpp>
 
 #if defined(MAPNIK_MEMORY_MAPPED_FILE)
 #pragma GCC diagnostic push
@@ -44,9 +45,11 @@ class geojson_index_featureset : public mapnik::Featureset
 {
     using value_type = mapnik::util::index_record;
 public:
-    geojson_index_featureset(std::string const& filename, mapnik::bounding_box_filter<float> const& filter);
+    geojson_index_featureset(std::string const& filename, mapnik::bounding_box_filter<float> const& filter,
+                             std::shared_ptr<mapnik::util::arena> const& arena = nullptr);
     virtual ~geojson_index_featureset();
     mapnik::feature_ptr next();
+    std::size_t next_batch(mapnik::feature_ptr * features, std::size_t size);
 
 private:
 #if defined (MAPNIK_MEMORY_MAPPED_FILE)
@@ -60,6 +63,7 @@ private:
     mapnik::context_ptr ctx_;
     std::vector<value_type> positions_;
     std::vector<value_type>::iterator itr_;
+    std::shared_ptr<mapnik::util::arena> arena_;
 };
 
 #endif // GEOJSON_INDEX_FEATURESE_HPP
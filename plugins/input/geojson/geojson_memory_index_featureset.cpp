@@ -34,7 +34,8 @@
 #include <vector>
 
 geojson_memory_index_featureset::geojson_memory_index_featureset(std::string const& filename,
-                                                   array_type && index_array)
+                                                   array_type && index_array,
+                                                   std::shared_ptr<mapnik::util::arena> const& arena)
 :
 #ifdef _WINDOWS
     file_(_wfopen(mapnik::utf8_to_utf16(filename).c_str(), L"rb"), std::fclose),
@@ -44,7 +45,8 @@ geojson_memory_index_featureset::geojson_memory_index_featureset(std::string con
     index_array_(std::move(index_array)),
     index_itr_(index_array_.begin()),
     index_end_(index_array_.end()),
-    ctx_(std::make_shared<mapnik::context_type>())
+    ctx_(std::make_shared<mapnik::context_type>()),
+    arena_(arena)
 {
     if (!file_) throw std::runtime_error("Can't open " + filename);
 }
@@ -66,7 +68,7 @@ mapnik::feature_ptr geojson_memory_index_featureset::next()
         chr_iterator_type start = json.data();
         chr_iterator_type end = (count == 1) ? start + json.size() : start;
         static const mapnik::transcoder tr("utf8");
-        mapnik::feature_ptr feature(mapnik::feature_factory::create(ctx_, feature_id_++));
+        mapnik::feature_ptr feature(mapnik::feature_factory::create(ctx_, feature_id_++, arena_));
         mapnik::json::parse_feature(start, end, *feature, tr); // throw on failure
         // skip empty geometries
         if (mapnik::geometry::is_empty(feature->get_geometry()))
@@ -75,3 +77,8 @@ mapnik::feature_ptr geojson_memory_index_featureset::next()
     }
     return mapnik::feature_ptr();
 }
+
+std::size_t geojson_memory_index_featureset::next_batch(mapnik::feature_ptr * features, std::size_t size)
+{
+    return mapnik::fill_batch(*this, features, size);
+}
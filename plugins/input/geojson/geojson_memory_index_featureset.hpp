@@ -24,6 +24,7 @@
 #define GEOJSON_MEMORY_INDEX_FEATURESET_HPP
 
 #include <mapnik/feature.hpp>
+#include <mapnik/util/arena.hpp>
 #include "geojson_datasource.hpp"
 
 #include <deque>
@@ -36,9 +37,11 @@ public:
     using file_ptr = std::unique_ptr<std::FILE, int (*)(std::FILE *)>;
 
     geojson_memory_index_featureset(std::string const& filename,
-                             array_type && index_array);
+                             array_type && index_array,
+                             std::shared_ptr<mapnik::util::arena> const& arena = nullptr);
     virtual ~geojson_memory_index_featureset();
     mapnik::feature_ptr next();
+    std::size_t next_batch(mapnik::feature_ptr * features, std::size_t size);
 
 private:
     file_ptr file_;
@@ -47,6 +50,7 @@ private:
     array_type::const_iterator index_itr_;
     array_type::const_iterator index_end_;
     mapnik::context_ptr ctx_;
+    std::shared_ptr<mapnik::util::arena> arena_;
 };
 
 #endif // GEOJSON_MEMORY_INDEX_FEATURESET_HPP
@@ -536,6 +536,7 @@ featureset_ptr ogr_datasource::features(query const& q) const
         {
             ctx->push(attr_info.get_name()); // TODO only push query attributes
         }
+        ctx->freeze();
 
         validate_attribute_names(q, desc_ar);
 
@@ -579,6 +580,7 @@ featureset_ptr ogr_datasource::features_at_point(coord2d const& pt, double tol)
         {
             ctx->push(attr_info.get_name()); // TODO only push query attributes
         }
+        ctx->freeze();
 
         OGRLayer* layer = layer_.layer();
 
@@ -951,6 +951,8 @@ featureset_ptr pgraster_datasource::features_with_context(query const& q,process
             }
         }
 
+        ctx->freeze();
+
         s << " FROM " << table_with_bbox;
 
         if (row_limit_ > 0)
@@ -1040,6 +1042,8 @@ featureset_ptr pgraster_datasource::features_at_point(coord2d const& pt, double
                 }
             }
 
+            ctx->freeze();
+
             box2d<double> box(pt.x - tol, pt.y - tol, pt.x + tol, pt.y + tol);
             std::string table_with_bbox = populate_tokens(table_, FLT_MAX, box, 0, 0,
                                                           mapnik::attributes{});
@@ -27,6 +27,7 @@
 
 // mapnik
 #include <mapnik/pool.hpp>
+#include <mapnik/query_slots.hpp>
 #include <mapnik/util/singleton.hpp>
 
 // boost
@@ -109,13 +110,16 @@ private:
 
     using ContType = std::map<std::string,std::shared_ptr<PoolType> >;
     using HolderType = std::shared_ptr<Connection>;
+    using SlotsType = std::map<std::string,std::shared_ptr<mapnik::query_slot_queue> >;
     ContType pools_;
+    SlotsType query_slots_;
 
 public:
 
     bool registerPool(ConnectionCreator<Connection> const& creator,unsigned initialSize,unsigned maxSize)
     {
         ContType::const_iterator itr = pools_.find(creator.id());
+        query_slots_.emplace(creator.id(), std::make_shared<mapnik::query_slot_queue>());
 
         if (itr != pools_.end())
         {
@@ -143,6 +147,17 @@ public:
         return emptyPool;
     }
 
+    // queries borrowing connections from the same pool share its slots
+    std::shared_ptr<mapnik::query_slot_queue> getQuerySlots(std::string const& key)
+    {
+        SlotsType::const_iterator itr = query_slots_.find(key);
+        if (itr != query_slots_.end())
+        {
+            return itr->second;
+        }
+        return std::shared_ptr<mapnik::query_slot_queue>();
+    }
+
     ConnectionManager() {}
 private:
     ConnectionManager(const ConnectionManager&);
@@ -142,6 +142,7 @@ postgis_datasource::postgis_datasource(parameters const& params)
     simplify_dp_preserve_ = simplify_preserve_opt && *simplify_preserve_opt;
 
     ConnectionManager::instance().registerPool(creator_, *initial_size, pool_max_size_);
+    query_slots_ = ConnectionManager::instance().getQuerySlots(creator_.id());
     CnxPool_ptr pool = ConnectionManager::instance().getPool(creator_.id());
     if (pool)
     {
@@ -505,6 +506,27 @@ layer_descriptor postgis_datasource::get_descriptor() const
     return desc_;
 }
 
+std::size_t postgis_datasource::max_concurrent_queries() const
+{
+    // every synchronous query borrows its own connection from the pool,
+    // which hands out no more than max_size of them
+    CnxPool_ptr pool = ConnectionManager::instance().getPool(creator_.id());
+    if (pool && pool->max_size() > 0)
+    {
+        return pool->max_size();
+    }
+    return 1;
+}
+
+mapnik::query_slot_queue & postgis_datasource::query_slots() const
+{
+    if (query_slots_)
+    {
+        return *query_slots_;
+    }
+    return datasource::query_slots();
+}
+
 std::string postgis_datasource::sql_bbox(box2d<double> const& env) const
 {
     std::ostringstream b;
@@ -888,6 +910,8 @@ featureset_ptr postgis_datasource::features_with_context(query const& q,processo
             }
         }
 
+        ctx->freeze();
+
         std::string table_with_bbox = populate_tokens(table_, scale_denom, box, px_gw, px_gh, q.variables());
 
         s << " FROM " << table_with_bbox;
@@ -899,7 +923,7 @@ featureset_ptr postgis_datasource::features_with_context(query const& q,processo
 
         std::shared_ptr<IResultSet> rs = get_resultset(conn, s.str(), pool, proc_ctx);
         return std::make_shared<postgis_featureset>(rs, ctx, desc_.get_encoding(), !key_field_.empty(),
-                                                    key_field_as_attribute_, twkb_encoding_);
+                                                    key_field_as_attribute_, twkb_encoding_, q.get_arena());
 
     }
 
@@ -967,6 +991,8 @@ featureset_ptr postgis_datasource::features_at_point(coord2d const& pt, double t
                 }
             }
 
+            ctx->freeze();
+
             box2d<double> box(pt.x - tol, pt.y - tol, pt.x + tol, pt.y + tol);
             std::string table_with_bbox = populate_tokens(table_, FLT_MAX, box, 0, 0,
                                                           mapnik::attributes{});
@@ -76,6 +76,8 @@ public:
     mapnik::box2d<double> envelope() const;
     boost::optional<mapnik::datasource_geometry_t> get_geometry_type() const;
     layer_descriptor get_descriptor() const;
+    std::size_t max_concurrent_queries() const;
+    mapnik::query_slot_queue & query_slots() const;
 
 private:
     std::string sql_bbox(box2d<double> const& env) const;
@@ -112,6 +114,7 @@ private:
     layer_descriptor desc_;
     ConnectionCreator<Connection> creator_;
     int pool_max_size_;
+    std::shared_ptr<mapnik::query_slot_queue> query_slots_;
     bool persist_connection_;
     bool extent_from_subquery_;
     bool estimate_extent_;
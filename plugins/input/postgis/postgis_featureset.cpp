@@ -50,7 +50,8 @@ postgis_featureset::postgis_featureset(std::shared_ptr<IResultSet> const& rs,
                                        std::string const& encoding,
                                        bool key_field,
                                        bool key_field_as_attribute,
-                                       bool twkb_encoding)
+                                       bool twkb_encoding,
+                                       std::shared_ptr<mapnik::util::arena> const& arena)
     : rs_(rs),
       ctx_(ctx),
       tr_(new transcoder(encoding)),
@@ -58,7 +59,8 @@ postgis_featureset::postgis_featureset(std::shared_ptr<IResultSet> const& rs,
       feature_id_(1),
       key_field_(key_field),
       key_field_as_attribute_(key_field_as_attribute),
-      twkb_encoding_(twkb_encoding)
+      twkb_encoding_(twkb_encoding),
+      arena_(arena)
 {
 }
 
@@ -100,7 +102,7 @@ feature_ptr postgis_featureset::next()
                 val = int4net(buf);
             }
 
-            feature = feature_factory::create(ctx_, val);
+            feature = feature_factory::create(ctx_, val, arena_);
             if (key_field_as_attribute_)
             {
                 feature->put<mapnik::value_integer>(name,val);
@@ -110,7 +112,7 @@ feature_ptr postgis_featureset::next()
         else
         {
             // fallback to auto-incrementing id
-            feature = feature_factory::create(ctx_, feature_id_);
+            feature = feature_factory::create(ctx_, feature_id_, arena_);
             ++feature_id_;
         }
 
@@ -237,3 +239,8 @@ postgis_featureset::~postgis_featureset()
 {
     rs_->close();
 }
+
+std::size_t postgis_featureset::next_batch(feature_ptr * features, std::size_t size)
+{
+    return mapnik::fill_batch(*this, features, size);
+}
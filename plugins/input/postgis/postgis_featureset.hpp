@@ -28,6 +28,7 @@
 #include <mapnik/datasource.hpp>
 #include <mapnik/feature.hpp>
 #include <mapnik/unicode.hpp>
+#include <mapnik/util/arena.hpp>
 
 using mapnik::Featureset;
 using mapnik::box2d;
@@ -45,8 +46,10 @@ public:
                        std::string const& encoding,
                        bool key_field,
                        bool key_field_as_attribute,
-                       bool twkb_encoding);
+                       bool twkb_encoding,
+                       std::shared_ptr<mapnik::util::arena> const& arena = nullptr);
     feature_ptr next();
+    std::size_t next_batch(feature_ptr * features, std::size_t size);
     ~postgis_featureset();
 
 private:
@@ -58,6 +61,7 @@ private:
     bool key_field_;
     bool key_field_as_attribute_;
     bool twkb_encoding_;
+    std::shared_ptr<mapnik::util::arena> arena_;
 };
 
 #endif // POSTGIS_FEATURESET_HPP
@@ -248,7 +248,8 @@ featureset_ptr shape_datasource::features(query const& q) const
                                                                             q.property_names(),
                                                                             desc_.get_encoding(),
                                                                             shape_name_,
-                                                                            row_limit_));
+                                                                            row_limit_,
+                                                                            q.get_arena()));
     }
     else
     {
@@ -257,7 +258,8 @@ featureset_ptr shape_datasource::features(query const& q) const
                                                                   shape_name_,
                                                                   q.property_names(),
                                                                   desc_.get_encoding(),
-                                                                  row_limit_);
+                                                                  row_limit_,
+                                                                  q.get_arena());
     }
 }
 
@@ -41,7 +41,8 @@ shape_featureset<filterT>::shape_featureset(filterT const& filter,
                                             std::string const& shape_name,
                                             std::set<std::string> const& attribute_names,
                                             std::string const& encoding,
-                                            int row_limit)
+                                            int row_limit,
+                                            std::shared_ptr<mapnik::util::arena> const& arena)
     : filter_(filter),
       shape_(shape_name, false),
       query_ext_(),
@@ -50,7 +51,8 @@ shape_featureset<filterT>::shape_featureset(filterT const& filter,
       shx_file_length_(0),
       row_limit_(row_limit),
       count_(0),
-      ctx_(std::make_shared<mapnik::context_type>())
+      ctx_(std::make_shared<mapnik::context_type>()),
+      arena_(arena)
 {
     if (!shape_.shx().is_open())
     {
@@ -86,7 +88,7 @@ feature_ptr shape_featureset<filterT>::next()
         // skip null shapes
         if (type == shape_io::shape_null) continue;
 
-        feature_ptr feature(feature_factory::create(ctx_, feature_id));
+        feature_ptr feature(feature_factory::create(ctx_, feature_id, arena_));
         switch (type)
         {
         case shape_io::shape_point:
@@ -164,6 +166,12 @@ feature_ptr shape_featureset<filterT>::next()
     return feature_ptr();
 }
 
+template <typename filterT>
+std::size_t shape_featureset<filterT>::next_batch(feature_ptr * features, std::size_t size)
+{
+    return mapnik::fill_batch(*this, features, size);
+}
+
 template <typename filterT>
 shape_featureset<filterT>::~shape_featureset() {}
 
@@ -32,6 +32,7 @@
 #include <mapnik/feature.hpp>
 #include <mapnik/unicode.hpp>
 #include <mapnik/value/types.hpp>
+#include <mapnik/util/arena.hpp>
 
 // boost
 
@@ -71,9 +72,11 @@ public:
                            std::set<std::string> const& attribute_names,
                            std::string const& encoding,
                            std::string const& shape_name,
-                           int row_limit);
+                           int row_limit,
+                           std::shared_ptr<mapnik::util::arena> const& arena = nullptr);
     virtual ~shape_index_featureset();
     feature_ptr next();
+    std::size_t next_batch(feature_ptr * features, std::size_t size);
 
 private:
     filterT filter_;
@@ -86,6 +89,7 @@ private:
     mapnik::value_integer row_limit_;
     mutable int count_;
     mutable box2d<double> feature_bbox_;
+    std::shared_ptr<mapnik::util::arena> arena_;
 };
 
 #endif // SHAPE_INDEX_FEATURESET_HPP
@@ -68,4 +68,5 @@ void setup_attributes(mapnik::context_ptr const& ctx,
             throw mapnik::datasource_exception("Shape Plugin: " + s);
         }
     }
+    ctx->freeze();
 }
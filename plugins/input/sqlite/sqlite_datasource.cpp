@@ -515,6 +515,7 @@ featureset_ptr sqlite_datasource::features(query const& q) const
             s << ",[" << *pos << "]";
             ctx->push(*pos);
         }
+        ctx->freeze();
         s << " FROM ";
 
         std::string query(table_);
@@ -596,6 +597,7 @@ featureset_ptr sqlite_datasource::features_at_point(coord2d const& pt, double to
             }
         }
 
+        ctx->freeze();
         s << " FROM ";
 
         std::string query(table_);
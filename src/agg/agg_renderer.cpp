@@ -23,6 +23,7 @@
 // mapnik
 #include <mapnik/agg_renderer.hpp>
 #include <mapnik/agg_rasterizer.hpp>
+#include <mapnik/render_report.hpp>
 #include <mapnik/agg_helpers.hpp>
 #include <mapnik/rule.hpp>
 #include <mapnik/debug.hpp>
@@ -68,12 +69,116 @@
 namespace mapnik
 {
 
+namespace {
+
+// Number of pixels a filter spreads non-transparent pixels by, or -1 if
+// it may turn transparent pixels anywhere in the image opaque.
+struct filter_reach_visitor
+{
+    filter_reach_visitor(double scale_factor)
+        : scale_factor_(scale_factor) {}
+
+    int operator() (filter::blur const&) const { return 1; }
+    int operator() (filter::gray const&) const { return 0; }
+    int operator() (filter::invert const&) const { return 0; }
+    int operator() (filter::color_to_alpha const&) const { return 0; }
+    int operator() (filter::agg_stack_blur const& op) const
+    {
+        return static_cast<int>(std::ceil(std::max(op.rx, op.ry) * scale_factor_));
+    }
+    template <typename T>
+    int operator() (T const&) const { return -1; }
+
+    double scale_factor_;
+};
+
+// Applies image filters to the region of buffer the non-transparent pixels
+// within extent can spread to, and returns that region. Filters that are
+// not local are applied to the whole buffer. The region is filtered in a
+// scratch buffer borrowed from images when given.
+template <typename Buffer>
+box2d<int> apply_image_filters(Buffer & buffer,
+                               std::vector<filter::filter_type> const& filters,
+                               box2d<int> const& extent,
+                               double scale_factor,
+                               util::thread_pool * pool,
+                               image_pool<Buffer> * images)
+{
+    box2d<int> full(0, 0, buffer.width(), buffer.height());
+    // one more pixel keeps the edges of the region transparent, so the
+    // border handling of the filters sees the same pixels as on the buffer
+    int reach = 1;
+    for (filter::filter_type const& filter_tag : filters)
+    {
+        int r = util::apply_visitor(filter_reach_visitor(scale_factor), filter_tag);
+        if (r < 0)
+        {
+            reach = -1;
+            break;
+        }
+        reach += r;
+    }
+    if (reach >= 0 && !extent.valid())
+    {
+        // local filters keep a transparent buffer transparent
+        return extent;
+    }
+    box2d<int> region(full);
+    if (reach >= 0)
+    {
+        region = extent;
+        region.pad(reach);
+        region.clip(full);
+    }
+    if (region == full)
+    {
+        filter::filter_visitor<Buffer> visitor(buffer, scale_factor, pool);
+        for (filter::filter_type const& filter_tag : filters)
+        {
+            util::apply_visitor(visitor, filter_tag);
+        }
+        mapnik::premultiply_alpha(buffer);
+        return full;
+    }
+    std::size_t const x0 = region.minx();
+    std::size_t const width = region.width();
+    std::size_t const height = region.height();
+    std::unique_ptr<Buffer> sub = images ? images->acquire(width, height)
+        : std::make_unique<Buffer>(width, height, false);
+    sub->set_premultiplied(buffer.get_premultiplied());
+    for (std::size_t y = 0; y < height; ++y)
+    {
+        std::copy_n(buffer.get_row(y + region.miny()) + x0, width, sub->get_row(y));
+    }
+    filter::filter_visitor<Buffer> visitor(*sub, scale_factor, pool);
+    for (filter::filter_type const& filter_tag : filters)
+    {
+        util::apply_visitor(visitor, filter_tag);
+    }
+    mapnik::premultiply_alpha(*sub);
+    for (std::size_t y = 0; y < height; ++y)
+    {
+        std::copy_n(sub->get_row(y), width, buffer.get_row(y + region.miny()) + x0);
+    }
+    if (images) images->release(std::move(sub));
+    set_premultiplied_alpha(buffer, true);
+    return region;
+}
+
+}
+
 template <typename T0, typename T1>
 agg_renderer<T0,T1>::agg_renderer(Map const& m, T0 & pixmap, double scale_factor, unsigned offset_x, unsigned offset_y)
     : feature_style_processor<agg_renderer>(m, scale_factor),
       buffers_(),
+      drawn_(),
       internal_buffers_(m.width(), m.height()),
       inflated_buffer_(),
+      inflated_dirty_(),
+      buffer_pool_(),
+      filter_pool_(),
+      marker_bitmaps_(),
+      glyph_bitmaps_(),
       ras_ptr(new rasterizer),
       gamma_method_(GAMMA_POWER),
       gamma_(1.0),
@@ -86,8 +191,14 @@ template <typename T0, typename T1>
 agg_renderer<T0,T1>::agg_renderer(Map const& m, request const& req, attributes const& vars, T0 & pixmap, double scale_factor, unsigned offset_x, unsigned offset_y)
     : feature_style_processor<agg_renderer>(m, scale_factor),
       buffers_(),
+      drawn_(),
       internal_buffers_(req.width(), req.height()),
       inflated_buffer_(),
+      inflated_dirty_(),
+      buffer_pool_(),
+      filter_pool_(),
+      marker_bitmaps_(),
+      glyph_bitmaps_(),
       ras_ptr(new rasterizer),
       gamma_method_(GAMMA_POWER),
       gamma_(1.0),
@@ -101,8 +212,14 @@ agg_renderer<T0,T1>::agg_renderer(Map const& m, T0 & pixmap, std::shared_ptr<T1>
                               double scale_factor, unsigned offset_x, unsigned offset_y)
     : feature_style_processor<agg_renderer>(m, scale_factor),
       buffers_(),
+      drawn_(),
       internal_buffers_(m.width(), m.height()),
       inflated_buffer_(),
+      inflated_dirty_(),
+      buffer_pool_(),
+      filter_pool_(),
+      marker_bitmaps_(),
+      glyph_bitmaps_(),
       ras_ptr(new rasterizer),
       gamma_method_(GAMMA_POWER),
       gamma_(1.0),
@@ -157,6 +274,7 @@ template <typename T0, typename T1>
 void agg_renderer<T0,T1>::setup(Map const &m, buffer_type & pixmap)
 {
     buffers_.emplace(pixmap);
+    drawn_.push_back(drawn_region{box2d<int>(), false});
 
     mapnik::set_premultiplied_alpha(pixmap, true);
     boost::optional<color> const& bg = m.background();
@@ -191,18 +309,60 @@ void agg_renderer<T0,T1>::setup(Map const &m, buffer_type & pixmap)
 }
 
 template <typename T0, typename T1>
-agg_renderer<T0,T1>::~agg_renderer() {}
+agg_renderer<T0,T1>::~agg_renderer()
+{
+    if (buffer_pool_)
+    {
+        buffer_pool_->release(std::move(inflated_buffer_));
+    }
+}
+
+template <typename T0, typename T1>
+void agg_renderer<T0,T1>::set_buffer_pool(std::shared_ptr<image_pool<buffer_type>> const& pool)
+{
+    buffer_pool_ = pool;
+    internal_buffers_.set_pool(pool);
+}
+
+template <typename T0, typename T1>
+void agg_renderer<T0,T1>::set_filter_pool(std::shared_ptr<util::thread_pool> const& pool)
+{
+    filter_pool_ = pool;
+}
+
+template <typename T0, typename T1>
+void agg_renderer<T0,T1>::set_marker_bitmap_cache(std::shared_ptr<marker_bitmap_cache> const& cache)
+{
+    marker_bitmaps_ = cache;
+}
+
+template <typename T0, typename T1>
+void agg_renderer<T0,T1>::set_glyph_bitmap_cache(std::shared_ptr<glyph_bitmap_cache> const& cache)
+{
+    glyph_bitmaps_ = cache;
+}
+
+template <typename T0, typename T1>
+void agg_renderer<T0,T1>::set_shaping_cache(std::shared_ptr<shaping_cache> const& cache)
+{
+    common_.font_manager_.set_shaping_cache(cache);
+}
 
 template <typename T0, typename T1>
 void agg_renderer<T0,T1>::start_map_processing(Map const& map)
 {
     MAPNIK_LOG_DEBUG(agg_renderer) << "agg_renderer: Start map processing bbox=" << map.get_current_extent();
     ras_ptr->clip_box(0,0,common_.width_,common_.height_);
+    if (std::shared_ptr<render_report> const& report = this->get_render_report())
+    {
+        ras_ptr->set_stats(&report->geometry, &report->rasterize);
+    }
 }
 
 template <typename T0, typename T1>
 void agg_renderer<T0,T1>::end_map_processing(Map const& map)
 {
+    ras_ptr->set_stats(nullptr, nullptr);
     mapnik::demultiply_alpha(buffers_.top().get());
     MAPNIK_LOG_DEBUG(agg_renderer) << "agg_renderer: End map processing";
 }
@@ -228,6 +388,7 @@ void agg_renderer<T0,T1>::start_layer_processing(layer const& lay, box2d<double>
 
     if (lay.comp_op() || lay.get_opacity() < 1.0)
     {
+        push_drawn_region();
         buffers_.emplace(internal_buffers_.push());
         set_premultiplied_alpha(buffers_.top().get(), true);
     }
@@ -248,10 +409,22 @@ void agg_renderer<T0,T1>::end_layer_processing(layer const& lyr)
 
     if (&current_buffer != &previous_buffer)
     {
+        // only the pixels the layer has drawn need compositing
+        box2d<int> extent = pop_drawn_region(current_buffer);
         composite_mode_e comp_op = lyr.comp_op() ? *lyr.comp_op() : src_over;
-        composite(previous_buffer, current_buffer,
-                  comp_op, lyr.get_opacity(), 0, 0);
-        internal_buffers_.pop();
+        if (!transparent_source_is_noop(comp_op))
+        {
+            composite(previous_buffer, current_buffer,
+                      comp_op, lyr.get_opacity(), 0, 0);
+            ras_ptr->add_drawn(box2d<int>(0, 0, previous_buffer.width(), previous_buffer.height()));
+        }
+        else if (extent.valid())
+        {
+            composite(previous_buffer, current_buffer, extent,
+                      comp_op, lyr.get_opacity(), 0, 0);
+            ras_ptr->add_drawn(extent);
+        }
+        internal_buffers_.pop(extent);
     }
 }
 
@@ -283,16 +456,34 @@ void agg_renderer<T0,T1>::start_style_processing(feature_type_style const& st)
                 (inflated_buffer_->width() < target_width ||
                  inflated_buffer_->height() < target_height))
             {
-                inflated_buffer_ = std::make_unique<buffer_type>(target_width, target_height);
+                if (buffer_pool_)
+                {
+                    buffer_pool_->release(std::move(inflated_buffer_));
+                    inflated_buffer_ = buffer_pool_->acquire(target_width, target_height);
+                }
+                else
+                {
+                    inflated_buffer_ = std::make_unique<buffer_type>(target_width, target_height, false);
+                }
+                mapnik::fill(*inflated_buffer_, 0); // fill with transparent colour
             }
-            else
+            else if (inflated_dirty_.valid())
             {
-                mapnik::fill(*inflated_buffer_, 0); // fill with transparent colour
+                // only clear what the previous style left behind
+                for (int y = inflated_dirty_.miny(); y < inflated_dirty_.maxy(); ++y)
+                {
+                    std::fill(inflated_buffer_->get_row(y) + inflated_dirty_.minx(),
+                              inflated_buffer_->get_row(y) + inflated_dirty_.maxx(), 0);
+                }
             }
+            // anything may be drawn until the style ends
+            inflated_dirty_ = box2d<int>(0, 0, inflated_buffer_->width(), inflated_buffer_->height());
+            push_drawn_region();
             buffers_.emplace(*inflated_buffer_);
         }
         else
         {
+            push_drawn_region();
             buffers_.emplace(internal_buffers_.push());
             common_.t_.set_offset(0);
             ras_ptr->clip_box(0,0,common_.width_,common_.height_);
@@ -315,50 +506,96 @@ void agg_renderer<T0,T1>::end_style_processing(feature_type_style const& st)
     buffer_type & previous_buffer = buffers_.top().get();
     if (&current_buffer != &previous_buffer)
     {
+        // only the pixels the style has drawn, and those image filters
+        // spread them to, need filtering and compositing
+        box2d<int> extent = pop_drawn_region(current_buffer);
         bool blend_from = false;
         if (st.image_filters().size() > 0)
         {
             blend_from = true;
-            mapnik::filter::filter_visitor<buffer_type> visitor(current_buffer, common_.scale_factor_);
-            for (mapnik::filter::filter_type const& filter_tag : st.image_filters())
-            {
-                util::apply_visitor(visitor, filter_tag);
-            }
-            mapnik::premultiply_alpha(current_buffer);
-        }
-        if (st.comp_op())
-        {
-            composite(previous_buffer, current_buffer,
-                      *st.comp_op(), st.get_opacity(),
-                      -common_.t_.offset(),
-                      -common_.t_.offset());
+            extent = apply_image_filters(current_buffer, st.image_filters(), extent,
+                                         common_.scale_factor_, filter_pool_.get(),
+                                         buffer_pool_.get());
         }
-        else if (blend_from || st.get_opacity() < 1.0)
+        if (st.comp_op() || blend_from || st.get_opacity() < 1.0)
         {
-            composite(previous_buffer, current_buffer,
-                      src_over, st.get_opacity(),
-                      -common_.t_.offset(),
-                      -common_.t_.offset());
+            composite_mode_e comp_op = st.comp_op() ? *st.comp_op() : src_over;
+            if (!transparent_source_is_noop(comp_op))
+            {
+                composite(previous_buffer, current_buffer,
+                          comp_op, st.get_opacity(),
+                          -common_.t_.offset(),
+                          -common_.t_.offset());
+                ras_ptr->add_drawn(box2d<int>(0, 0, previous_buffer.width(), previous_buffer.height()));
+            }
+            else if (extent.valid())
+            {
+                composite(previous_buffer, current_buffer, extent,
+                          comp_op, st.get_opacity(),
+                          -common_.t_.offset(),
+                          -common_.t_.offset());
+                box2d<int> target(extent);
+                target.move(-common_.t_.offset(), -common_.t_.offset());
+                ras_ptr->add_drawn(target);
+            }
         }
         if (internal_buffers_.in_range()
             && &current_buffer == &internal_buffers_.top())
         {
-            internal_buffers_.pop();
+            internal_buffers_.pop(extent);
+        }
+        else if (inflated_buffer_ && &current_buffer == inflated_buffer_.get())
+        {
+            inflated_dirty_ = extent;
         }
     }
     if (st.direct_image_filters().size() > 0)
     {
         // apply any 'direct' image filters
-        mapnik::filter::filter_visitor<buffer_type> visitor(previous_buffer, common_.scale_factor_);
+        mapnik::filter::filter_visitor<buffer_type> visitor(previous_buffer, common_.scale_factor_,
+                                                           filter_pool_.get());
         for (mapnik::filter::filter_type const& filter_tag : st.direct_image_filters())
         {
             util::apply_visitor(visitor, filter_tag);
         }
         mapnik::premultiply_alpha(previous_buffer);
+        mark_drawn_untracked();
     }
     MAPNIK_LOG_DEBUG(agg_renderer) << "agg_renderer: End processing style";
 }
 
+template <typename T0, typename T1>
+void agg_renderer<T0,T1>::push_drawn_region()
+{
+    // what was drawn so far went to the buffer below
+    drawn_.back().box.expand_to_include(ras_ptr->take_drawn());
+    drawn_.push_back(drawn_region{box2d<int>(), false});
+}
+
+template <typename T0, typename T1>
+box2d<int> agg_renderer<T0,T1>::pop_drawn_region(buffer_type const& buffer)
+{
+    drawn_region region = drawn_.back();
+    drawn_.pop_back();
+    region.box.expand_to_include(ras_ptr->take_drawn());
+    if (region.scan)
+    {
+        return nonzero_extent(buffer);
+    }
+    region.box.clip(box2d<int>(0, 0, buffer.width(), buffer.height()));
+    if (!region.box.valid() || region.box.width() == 0 || region.box.height() == 0)
+    {
+        return box2d<int>();
+    }
+    return region.box;
+}
+
+template <typename T0, typename T1>
+void agg_renderer<T0,T1>::mark_drawn_untracked()
+{
+    drawn_.back().scan = true;
+}
+
 template <typename buffer_type>
 struct agg_render_marker_visitor
 {
@@ -465,10 +702,12 @@ struct agg_render_marker_visitor
         {
             double cx = 0.5 * width;
             double cy = 0.5 * height;
+            int x = static_cast<int>(std::floor(pos_.x - cx + .5));
+            int y = static_cast<int>(std::floor(pos_.y - cy + .5));
             composite(current_buffer_, marker.get_data(),
-                      comp_op_, opacity_,
-                      std::floor(pos_.x - cx + .5),
-                      std::floor(pos_.y - cy + .5));
+                      comp_op_, opacity_, x, y);
+            ras_ptr_->add_drawn(box2d<int>(x, y, x + static_cast<int>(marker.width()),
+                                                y + static_cast<int>(marker.height())));
         }
         else
         {
@@ -630,6 +869,7 @@ void agg_renderer<T0,T1>::draw_geo_extent(box2d<double> const& extent, mapnik::c
     double y0 = box.miny();
     double y1 = box.maxy();
     unsigned rgba = color.rgba();
+    mark_drawn_untracked();
     for (double x=x0; x<x1; x++)
     {
         mapnik::set_pixel(buffers_.top().get(), x, y0, rgba);
@@ -240,6 +240,7 @@ void agg_renderer<T0,T1>::process(debug_symbolizer const& sym,
     }
     else if (mode == DEBUG_SYM_MODE_COLLISION)
     {
+        mark_drawn_untracked();
         for (auto const& n : *common_.detector_)
         {
             draw_rect(buffers_.top().get(), n.get().box);
@@ -248,6 +249,7 @@ void agg_renderer<T0,T1>::process(debug_symbolizer const& sym,
     else if (mode == DEBUG_SYM_MODE_VERTEX)
     {
         using apply_vertex_mode = apply_vertex_mode<buffer_type>;
+        mark_drawn_untracked();
         apply_vertex_mode apply(buffers_.top().get(), common_.t_, prj_trans);
         util::apply_visitor(geometry::vertex_processor<apply_vertex_mode>(apply), feature.get_geometry());
     }
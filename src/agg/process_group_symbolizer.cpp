@@ -62,11 +62,14 @@ struct thunk_renderer<image_rgba8> : render_thunk_list_dispatch
     thunk_renderer(renderer_type &ren,
                    std::unique_ptr<rasterizer> const& ras_ptr,
                    buffer_type & buf,
-                   renderer_common &common)
+                   renderer_common &common,
+                   glyph_bitmap_cache * glyph_cache)
         : ren_(ren), ras_ptr_(ras_ptr), buf_(buf), common_(common),
           tex_(buf, HALO_RASTERIZER_FULL, src_over, src_over,
                common.scale_factor_, common.font_manager_.get_stroker())
-    {}
+    {
+        tex_.set_glyph_cache(glyph_cache);
+    }
 
     virtual void operator()(vector_marker_render_thunk const& thunk)
     {
@@ -131,6 +134,7 @@ struct thunk_renderer<image_rgba8> : render_thunk_list_dispatch
             }
             tex_.render(*glyphs);
         }
+        ras_ptr_->add_drawn(tex_.drawn());
     }
 
 private:
@@ -146,7 +150,7 @@ void agg_renderer<T0,T1>::process(group_symbolizer const& sym,
                                   mapnik::feature_impl & feature,
                                   proj_transform const& prj_trans)
 {
-    thunk_renderer<buffer_type> ren(*this, ras_ptr, buffers_.top().get(), common_);
+    thunk_renderer<buffer_type> ren(*this, ras_ptr, buffers_.top().get(), common_, glyph_bitmaps_.get());
 
     render_group_symbolizer(
         sym, feature, common_.vars_, prj_trans, clipping_extent(common_), common_,
@@ -185,6 +185,8 @@ void  agg_renderer<T0,T1>::process(line_pattern_symbolizer const& sym,
         gamma_ = 1.0;
     }
     std::shared_ptr<mapnik::marker const> marker = marker_cache::instance().find(filename, true);
+    // patterns are drawn by the outline renderer, which reports no bounds
+    mark_drawn_untracked();
     agg_renderer_process_visitor_l<buffer_type> visitor(common_,
                                          buffers_.top().get(),
                                          ras_ptr,
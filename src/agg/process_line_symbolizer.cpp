@@ -168,6 +168,8 @@ void agg_renderer<T0,T1>::process(line_symbolizer const& sym,
         ren.color(agg::rgba8_pre(r, g, b, int(a * opacity)));
         rasterizer_type ras(ren);
         set_join_caps_aa(sym, ras, feature, common_.vars_);
+        // the outline renderer has no cell bounds to report
+        mark_drawn_untracked();
 
         using vertex_converter_type = vertex_converter<clip_line_tag, clip_poly_tag, transform_tag,
                                                        affine_transform_tag,
@@ -25,6 +25,7 @@
 #include <mapnik/agg_renderer.hpp>
 #include <mapnik/agg_rasterizer.hpp>
 #include <mapnik/agg_render_marker.hpp>
+#include <mapnik/marker_bitmap_cache.hpp>
 #include <mapnik/svg/svg_renderer_agg.hpp>
 #include <mapnik/svg/svg_storage.hpp>
 #include <mapnik/svg/svg_path_adapter.hpp>
@@ -47,10 +48,29 @@
 #include "agg_conv_transform.h"
 #pragma GCC diagnostic pop
 
+// stl
+#include <algorithm>
+#include <cmath>
+#include <memory>
+#include <type_traits>
+
 namespace mapnik {
 
 namespace detail {
 
+template <typename T>
+void append_bytes(std::string & key, T const& value)
+{
+    static_assert(std::is_trivially_copyable<T>::value, "");
+    key.append(reinterpret_cast<char const*>(&value), sizeof(T));
+}
+
+// longest distance a unit vector can have under tr
+inline double max_scale(agg::trans_affine const& tr)
+{
+    return std::max(std::hypot(tr.sx, tr.shy), std::hypot(tr.shx, tr.sy));
+}
+
 template <typename SvgRenderer, typename BufferType, typename RasterizerType>
 struct agg_markers_renderer_context : markers_renderer_context
 {
@@ -58,18 +78,33 @@ struct agg_markers_renderer_context : markers_renderer_context
     using vertex_source_type = typename SvgRenderer::vertex_source_type;
     using pixfmt_type = typename renderer_base::pixfmt_type;
 
+    // marker positions are bucketed to 1/subpixel_steps of a pixel
+    static constexpr int subpixel_steps = 4;
+
     agg_markers_renderer_context(symbolizer_base const& sym,
                                  feature_impl const& feature,
                                  attributes const& vars,
                                  BufferType & buf,
-                                 RasterizerType & ras)
+                                 RasterizerType & ras,
+                                 marker_bitmap_cache * bitmaps,
+                                 double gamma,
+                                 gamma_method_enum gamma_method)
       : buf_(buf),
         pixf_(buf_),
         renb_(pixf_),
-        ras_(ras)
+        ras_(ras),
+        bitmaps_(nullptr),
+        gamma_(gamma),
+        gamma_method_(gamma_method),
+        keyed_marker_(nullptr),
+        keyed_attrs_(nullptr),
+        marker_key_()
     {
         auto comp_op = get<composite_mode_e, keys::comp_op>(sym, feature, vars);
         pixf_.comp_op(static_cast<agg::comp_op_e>(comp_op));
+        // with other comp-ops the paths of a marker are composited one
+        // by one, which a single bitmap cannot reproduce
+        if (comp_op == src_over) bitmaps_ = bitmaps;
     }
 
     virtual void render_marker(svg_path_ptr const& src,
@@ -78,6 +113,10 @@ struct agg_markers_renderer_context : markers_renderer_context
                                markers_dispatch_params const& params,
                                agg::trans_affine const& marker_tr)
     {
+        if (bitmaps_ && render_cached_marker(src, path, attrs, params, marker_tr))
+        {
+            return;
+        }
         SvgRenderer svg_renderer(path, attrs);
         render_vector_marker(svg_renderer, ras_, renb_, src->bounding_box(),
                              marker_tr, params.opacity, params.snap_to_pixels);
@@ -95,10 +134,186 @@ struct agg_markers_renderer_context : markers_renderer_context
     }
 
 private:
+    // Identifies the marker geometry and its evaluated styles. Markers
+    // shared through the marker cache are identified by their cache key,
+    // markers built for a single feature (ellipses) by their vertices.
+    std::string const& marker_key(svg_path_ptr const& src, svg_path_adapter & path,
+                                  svg_attribute_type const& attrs,
+                                  markers_dispatch_params const& params)
+    {
+        if (src.get() == keyed_marker_ && &attrs == keyed_attrs_)
+        {
+            return marker_key_;
+        }
+        marker_key_.clear();
+        if (!params.marker_key.empty())
+        {
+            append_bytes(marker_key_, params.marker_key.size());
+            marker_key_ += params.marker_key;
+        }
+        else
+        {
+            append_bytes(marker_key_, std::size_t(0));
+            for (auto const& attr : attrs)
+            {
+                double x, y;
+                unsigned cmd;
+                path.rewind(attr.index);
+                while (!agg::is_stop(cmd = path.vertex(&x, &y)))
+                {
+                    append_bytes(marker_key_, cmd);
+                    append_bytes(marker_key_, x);
+                    append_bytes(marker_key_, y);
+                }
+            }
+        }
+        for (auto const& attr : attrs)
+        {
+            append_bytes(marker_key_, attr.transform);
+            append_bytes(marker_key_, attr.opacity);
+            append_bytes(marker_key_, attr.fill_opacity);
+            append_bytes(marker_key_, attr.stroke_opacity);
+            append_bytes(marker_key_, attr.miter_limit);
+            append_bytes(marker_key_, attr.stroke_width);
+            append_bytes(marker_key_, attr.index);
+            append_bytes(marker_key_, attr.fill_color);
+            append_bytes(marker_key_, attr.stroke_color);
+            append_bytes(marker_key_, attr.line_join);
+            append_bytes(marker_key_, attr.line_cap);
+            unsigned flags = attr.fill_flag | attr.fill_none << 1 | attr.stroke_flag << 2 | attr.stroke_none << 3
+                | attr.even_odd_flag << 4 | attr.visibility_flag << 5 | attr.display_flag << 6;
+            append_bytes(marker_key_, flags);
+            for (auto const& dash : attr.dash)
+            {
+                append_bytes(marker_key_, dash.first);
+                append_bytes(marker_key_, dash.second);
+            }
+            append_bytes(marker_key_, attr.dash_offset);
+        }
+        keyed_marker_ = src.get();
+        keyed_attrs_ = &attrs;
+        return marker_key_;
+    }
+
+    // extent of the marker under tr, including strokes and antialiasing
+    static box2d<double> marker_extent(svg_path_adapter & path, svg_attribute_type const& attrs,
+                                       agg::trans_affine const& tr)
+    {
+        box2d<double> extent;
+        for (auto const& attr : attrs)
+        {
+            if (!attr.visibility_flag) continue;
+            agg::trans_affine attr_tr = attr.transform;
+            attr_tr *= tr;
+            double pad = 1.0;
+            if (attr.stroke_flag || attr.stroke_gradient.get_gradient_type() != NO_GRADIENT)
+            {
+                pad += 0.5 * attr.stroke_width * std::max(attr.miter_limit, 1.5) * max_scale(attr_tr);
+            }
+            double x, y;
+            unsigned cmd;
+            path.rewind(attr.index);
+            while (!agg::is_stop(cmd = path.vertex(&x, &y)))
+            {
+                if (!agg::is_vertex(cmd)) continue;
+                attr_tr.transform(&x, &y);
+                box2d<double> box(x - pad, y - pad, x + pad, y + pad);
+                if (extent.valid()) extent.expand_to_include(box);
+                else extent = box;
+            }
+        }
+        return extent;
+    }
+
+    bool render_cached_marker(svg_path_ptr const& src,
+                              svg_path_adapter & path,
+                              svg_attribute_type const& attrs,
+                              markers_dispatch_params const& params,
+                              agg::trans_affine const& marker_tr)
+    {
+        double tx = marker_tr.tx;
+        double ty = marker_tr.ty;
+        if (params.snap_to_pixels)
+        {
+            tx = std::floor(tx + .5);
+            ty = std::floor(ty + .5);
+        }
+        double qx = std::floor(tx * subpixel_steps + .5);
+        double qy = std::floor(ty * subpixel_steps + .5);
+        if (!(std::fabs(qx) < 1e9 && std::fabs(qy) < 1e9)) return false;
+        int x = static_cast<int>(std::floor(qx / subpixel_steps));
+        int y = static_cast<int>(std::floor(qy / subpixel_steps));
+        int fx = static_cast<int>(qx) - x * subpixel_steps;
+        int fy = static_cast<int>(qy) - y * subpixel_steps;
+
+        // the scale factor is part of the transform
+        std::string key = marker_key(src, path, attrs, params);
+        append_bytes(key, marker_tr.sx);
+        append_bytes(key, marker_tr.shy);
+        append_bytes(key, marker_tr.shx);
+        append_bytes(key, marker_tr.sy);
+        append_bytes(key, fx);
+        append_bytes(key, fy);
+        append_bytes(key, params.opacity);
+        append_bytes(key, gamma_);
+        append_bytes(key, gamma_method_);
+
+        // a marker reloaded under the same key must not match
+        bool shared = !params.marker_key.empty();
+        void const* owner = shared ? src.get() : nullptr;
+        marker_bitmap_ptr bitmap = bitmaps_->find(key, owner);
+        if (!bitmap)
+        {
+            agg::trans_affine tr(marker_tr.sx, marker_tr.shy, marker_tr.shx, marker_tr.sy,
+                                 static_cast<double>(fx) / subpixel_steps,
+                                 static_cast<double>(fy) / subpixel_steps);
+            box2d<double> extent = marker_extent(path, attrs, tr);
+            if (!extent.valid()) return false;
+            int x0 = static_cast<int>(std::floor(extent.minx()));
+            int y0 = static_cast<int>(std::floor(extent.miny()));
+            double width = std::ceil(extent.maxx()) - x0;
+            double height = std::ceil(extent.maxy()) - y0;
+            // leave huge markers to direct rendering
+            if (width * height * 4 > bitmaps_->max_bytes() / 16) return false;
+            auto result = std::make_shared<marker_bitmap>();
+            result->image = image_rgba8(static_cast<std::size_t>(width), static_cast<std::size_t>(height), true, true);
+            result->x = x0;
+            result->y = y0;
+            tr.tx -= x0;
+            tr.ty -= y0;
+            BufferType buf(result->image.bytes(), result->image.width(), result->image.height(),
+                           result->image.row_size());
+            pixfmt_type pixf(buf);
+            pixf.comp_op(static_cast<agg::comp_op_e>(src_over));
+            renderer_base renb(pixf);
+            std::unique_ptr<RasterizerType> ras(new RasterizerType);
+            set_gamma_method(ras, gamma_, gamma_method_);
+            SvgRenderer svg_renderer(path, attrs);
+            render_vector_marker(svg_renderer, *ras, renb, src->bounding_box(), tr, params.opacity, false);
+            bitmap = result;
+            bitmaps_->insert(key, bitmap, shared ? std::shared_ptr<void const>(src) : nullptr);
+        }
+        using const_rendering_buffer = util::rendering_buffer<image_rgba8>;
+        using pixfmt_pre = agg::pixfmt_alpha_blend_rgba<agg::blender_rgba32_pre, const_rendering_buffer, agg::pixel32_type>;
+        const_rendering_buffer bitmap_buffer(bitmap->image);
+        pixfmt_pre bitmap_pixf(bitmap_buffer);
+        renb_.blend_from(bitmap_pixf, 0, x + bitmap->x, y + bitmap->y, agg::cover_full);
+        ras_.add_drawn(box2d<int>(x + bitmap->x, y + bitmap->y,
+                                  x + bitmap->x + static_cast<int>(bitmap->image.width()),
+                                  y + bitmap->y + static_cast<int>(bitmap->image.height())));
+        return true;
+    }
+
     BufferType & buf_;
     pixfmt_type pixf_;
     renderer_base renb_;
     RasterizerType & ras_;
+    marker_bitmap_cache * bitmaps_;
+    double gamma_;
+    gamma_method_enum gamma_method_;
+    svg_storage_type const* keyed_marker_;
+    svg_attribute_type const* keyed_attrs_;
+    std::string marker_key_;
 };
 
 } // namespace detail
@@ -137,7 +352,8 @@ void agg_renderer<T0,T1>::process(markers_symbolizer const& sym,
     using renderer_context_type = detail::agg_markers_renderer_context<svg_renderer_type,
                                                               buf_type,
                                                               rasterizer>;
-    renderer_context_type renderer_context(sym, feature, common_.vars_, render_buffer, *ras_ptr);
+    renderer_context_type renderer_context(sym, feature, common_.vars_, render_buffer, *ras_ptr,
+                                           marker_bitmaps_.get(), gamma, gamma_method);
 
     render_markers_symbolizer(
         sym, feature, prj_trans, common_, clip_box, renderer_context);
@@ -24,6 +24,7 @@
 #include <mapnik/feature.hpp>
 #include <mapnik/agg_renderer.hpp>
 #include <mapnik/agg_rasterizer.hpp>
+#include <mapnik/render_report.hpp>
 #include <mapnik/text/symbolizer_helpers.hpp>
 #include <mapnik/pixel_position.hpp>
 #include <mapnik/text/renderer.hpp>
@@ -57,10 +58,14 @@ void  agg_renderer<T0,T1>::process(shield_symbolizer const& sym,
                               halo_comp_op,
                               common_.scale_factor_,
                               common_.font_manager_.get_stroker());
+    ren.set_glyph_cache(glyph_bitmaps_.get());
 
     double opacity = get<double>(sym,keys::opacity, feature, common_.vars_, 1.0);
 
+    std::shared_ptr<render_report> const& report = this->get_render_report();
+    render_timer labeling_timer(report != nullptr);
     placements_list const& placements = helper.get();
+    if (report) labeling_timer.stop(report->labeling, placements.size());
     for (auto const& glyphs : placements)
     {
         marker_info_ptr mark = glyphs->get_marker();
@@ -73,6 +78,7 @@ void  agg_renderer<T0,T1>::process(shield_symbolizer const& sym,
         }
         ren.render(*glyphs);
     }
+    ras_ptr->add_drawn(ren.drawn());
 }
 
 
@@ -25,6 +25,7 @@
 #include <mapnik/agg_renderer.hpp>
 #include <mapnik/image_any.hpp>
 #include <mapnik/agg_rasterizer.hpp>
+#include <mapnik/render_report.hpp>
 #include <mapnik/text/symbolizer_helpers.hpp>
 #include <mapnik/text/renderer.hpp>
 #include <mapnik/text/glyph_positions.hpp>
@@ -58,6 +59,7 @@ void agg_renderer<T0,T1>::process(text_symbolizer const& sym,
                               halo_comp_op,
                               common_.scale_factor_,
                               common_.font_manager_.get_stroker());
+    ren.set_glyph_cache(glyph_bitmaps_.get());
 
     auto halo_transform = get_optional<transform_type>(sym, keys::halo_transform);
     if (halo_transform)
@@ -67,11 +69,15 @@ void agg_renderer<T0,T1>::process(text_symbolizer const& sym,
         ren.set_halo_transform(halo_affine_transform);
     }
 
+    std::shared_ptr<render_report> const& report = this->get_render_report();
+    render_timer labeling_timer(report != nullptr);
     placements_list const& placements = helper.get();
+    if (report) labeling_timer.stop(report->labeling, placements.size());
     for (auto const& glyphs : placements)
     {
         ren.render(*glyphs);
     }
+    ras_ptr->add_drawn(ren.drawn());
 }
 
 template void agg_renderer<image_rgba8>::process(text_symbolizer const&,
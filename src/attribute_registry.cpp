@@ -0,0 +1,71 @@
+/*****************************************************************************
+ *
+ * This file is part of Mapnik (c++ mapping toolkit)
+ *
+ * Copyright (C) 2017 Artem Pavlenko
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ *****************************************************************************/
+
+// mapnik
+#include <mapnik/attribute_registry.hpp>
+
+namespace mapnik
+{
+
+template class singleton<attribute_registry, CreateStatic>;
+
+constexpr std::size_t attribute_registry::npos;
+constexpr std::size_t attribute_registry::max_size;
+
+attribute_registry::attribute_registry()
+    : ids_(),
+      size_(0) {}
+
+std::size_t attribute_registry::insert(std::string const& name)
+{
+#ifdef MAPNIK_THREADSAFE
+    std::lock_guard<std::mutex> lock(mutex_);
+#endif
+    auto itr = ids_.find(name);
+    if (itr != ids_.end())
+    {
+        return itr->second;
+    }
+    if (ids_.size() >= max_size)
+    {
+        return npos;
+    }
+    std::size_t id = ids_.size();
+    ids_.emplace(name, id);
+    size_.store(ids_.size(), std::memory_order_release);
+    return id;
+}
+
+std::size_t attribute_registry::find(std::string const& name) const
+{
+#ifdef MAPNIK_THREADSAFE
+    std::lock_guard<std::mutex> lock(mutex_);
+#endif
+    auto itr = ids_.find(name);
+    if (itr != ids_.end())
+    {
+        return itr->second;
+    }
+    return npos;
+}
+
+}
@@ -178,6 +178,8 @@ source = Split(
     expression_node.cpp
     expression_string.cpp
     expression.cpp
+    expression_program.cpp
+    attribute_registry.cpp
     transform_expression.cpp
     transform_expression_grammar_x3.cpp
     feature_kv_iterator.cpp
@@ -202,8 +204,10 @@ source = Split(
     image_util_png.cpp
     image_util_tiff.cpp
     image_util_webp.cpp
+    pixel_kernels.cpp
     layer.cpp
     map.cpp
+    metatile.cpp
     load_map.cpp
     palette.cpp
     marker_helpers.cpp
@@ -214,10 +218,17 @@ source = Split(
     twkb.cpp
     projection.cpp
     proj_transform.cpp
+    proj_transform_cache.cpp
     scale_denominator.cpp
     simplify.cpp
     parse_transform.cpp
     memory_datasource.cpp
+    cached_datasource.cpp
+    feature_cache.cpp
+    lod_datasource.cpp
+    geometry_lod_cache.cpp
+    render_report.cpp
+    render_plan.cpp
     symbolizer.cpp
     symbolizer_keys.cpp
     symbolizer_enumerations.cpp
@@ -225,6 +236,7 @@ source = Split(
     raster_colorizer.cpp
     mapped_memory_cache.cpp
     marker_cache.cpp
+    marker_bitmap_cache.cpp
     svg/svg_parser.cpp
     svg/svg_path_parser.cpp
     svg/svg_points_parser.cpp
@@ -233,6 +245,7 @@ source = Split(
     warp.cpp
     vertex_cache.cpp
     vertex_adapters.cpp
+    clip_converter.cpp
     text/font_library.cpp
     text/text_layout.cpp
     text/text_line.cpp
@@ -243,6 +256,8 @@ source = Split(
     text/placement_finder.cpp
     text/properties_util.cpp
     text/renderer.cpp
+    text/glyph_bitmap_cache.cpp
+    text/shaping_cache.cpp
     text/color_font_renderer.cpp
     text/symbolizer_helpers.cpp
     text/text_properties.cpp
@@ -270,6 +285,7 @@ source = Split(
     renderer_common/render_pattern.cpp
     renderer_common/render_thunk_extractor.cpp
     math.cpp
+    cpu_features.cpp
     value.cpp
     """
     )
@@ -0,0 +1,99 @@
+/*****************************************************************************
+ *
+ * This file is part of Mapnik (c++ mapping toolkit)
+ *
+ * Copyright (C) 2017 Artem Pavlenko
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ *****************************************************************************/
+
+// mapnik
+#include <mapnik/cached_datasource.hpp>
+#include <mapnik/feature_cache.hpp>
+#include <mapnik/query.hpp>
+
+namespace mapnik {
+
+cached_datasource::cached_datasource(datasource_ptr const& ds)
+    : datasource(ds->params()),
+      ds_(ds) {}
+
+cached_datasource::~cached_datasource() {}
+
+datasource::datasource_t cached_datasource::type() const
+{
+    return ds_->type();
+}
+
+featureset_ptr cached_datasource::features(query const& q) const
+{
+    return features_with_context(q, processor_context_ptr());
+}
+
+processor_context_ptr cached_datasource::get_context(feature_style_context_map & ctx) const
+{
+    return ds_->get_context(ctx);
+}
+
+featureset_ptr cached_datasource::features_with_context(query const& q, processor_context_ptr ctx) const
+{
+    if (ds_->type() == datasource::Raster)
+    {
+        // raster data is read for the exact query resolution and can be large
+        return ds_->features_with_context(q, ctx);
+    }
+    // cached features outlive the query, they must not keep its arena alive
+    query uncached(q);
+    uncached.set_arena(nullptr);
+    return feature_cache::instance().features(ds_, uncached, ctx);
+}
+
+featureset_ptr cached_datasource::features_at_point(coord2d const& pt, double tol) const
+{
+    return ds_->features_at_point(pt, tol);
+}
+
+box2d<double> cached_datasource::envelope() const
+{
+    return ds_->envelope();
+}
+
+boost::optional<datasource_geometry_t> cached_datasource::get_geometry_type() const
+{
+    return ds_->get_geometry_type();
+}
+
+layer_descriptor cached_datasource::get_descriptor() const
+{
+    return ds_->get_descriptor();
+}
+
+std::size_t cached_datasource::max_concurrent_queries() const
+{
+    return ds_->max_concurrent_queries();
+}
+
+query_slot_queue & cached_datasource::query_slots() const
+{
+    return ds_->query_slots();
+}
+
+datasource_ptr const& cached_datasource::wrapped() const
+{
+    return ds_;
+}
+
+}
@@ -0,0 +1,210 @@
+/*****************************************************************************
+ *
+ * This file is part of Mapnik (c++ mapping toolkit)
+ *
+ * Copyright (C) 2017 Artem Pavlenko
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ *****************************************************************************/
+
+// mapnik
+#include <mapnik/clip_converter.hpp>
+#include <mapnik/util/cpu_features.hpp>
+
+// stl
+#include <cstring>
+#include <memory>
+#include <vector>
+
+#ifdef MAPNIK_HAVE_X86_SIMD
+#include <immintrin.h>
+#endif
+
+namespace mapnik {
+
+namespace detail {
+
+namespace {
+
+// enough for converters nested in one another
+constexpr std::size_t max_pooled_clip_buffers = 4;
+
+std::vector<std::unique_ptr<clip_buffers>> & clip_buffers_pool()
+{
+    // reserved so that releasing never allocates
+    static thread_local std::vector<std::unique_ptr<clip_buffers>> pool = [] {
+        std::vector<std::unique_ptr<clip_buffers>> buffers;
+        buffers.reserve(max_pooled_clip_buffers);
+        return buffers;
+    }();
+    return pool;
+}
+
+}
+
+clip_buffers * acquire_clip_buffers()
+{
+    auto & pool = clip_buffers_pool();
+    if (pool.empty()) return new clip_buffers();
+    clip_buffers * buffers = pool.back().release();
+    pool.pop_back();
+    return buffers;
+}
+
+void release_clip_buffers(clip_buffers * buffers)
+{
+    std::unique_ptr<clip_buffers> ptr(buffers);
+    auto & pool = clip_buffers_pool();
+    if (pool.size() < max_pooled_clip_buffers &&
+        ptr->capacity_bytes() <= max_pooled_clip_buffer_bytes)
+    {
+        pool.push_back(std::move(ptr));
+    }
+}
+
+}
+
+namespace kernels {
+
+namespace {
+
+inline unsigned outcode(double x, double y, double x1, double y1, double x2, double y2)
+{
+    return static_cast<unsigned>(x < x1) |
+           static_cast<unsigned>(x > x2) << 1 |
+           static_cast<unsigned>(y < y1) << 2 |
+           static_cast<unsigned>(y > y2) << 3;
+}
+
+#ifdef MAPNIK_HAVE_X86_SIMD
+
+// The vectorized kernels turn the comparison masks of a vector of points
+// into one byte per point: spread[mask] has bit 0 of byte i set for each
+// bit i of mask. They process whole vectors only, or the bytes of all codes
+// into `any` and return the number of leading points done.
+
+constexpr std::uint32_t spread_bits(unsigned mask)
+{
+    return (mask & 1u) | (mask & 2u) << 7 | (mask & 4u) << 14 | (mask & 8u) << 21;
+}
+
+constexpr std::uint32_t spread[16] = {
+    spread_bits(0), spread_bits(1), spread_bits(2), spread_bits(3),
+    spread_bits(4), spread_bits(5), spread_bits(6), spread_bits(7),
+    spread_bits(8), spread_bits(9), spread_bits(10), spread_bits(11),
+    spread_bits(12), spread_bits(13), spread_bits(14), spread_bits(15)
+};
+
+inline unsigned fold_bytes(std::uint32_t any)
+{
+    return (any | any >> 8 | any >> 16 | any >> 24) & 0xf;
+}
+
+namespace sse41 {
+
+MAPNIK_TARGET_SSE41 std::size_t outcodes(double const* x, double const* y, std::size_t count,
+                                         double x1, double y1, double x2, double y2,
+                                         std::uint8_t * codes, unsigned & any)
+{
+    __m128d const min_x = _mm_set1_pd(x1);
+    __m128d const min_y = _mm_set1_pd(y1);
+    __m128d const max_x = _mm_set1_pd(x2);
+    __m128d const max_y = _mm_set1_pd(y2);
+    std::uint32_t all = 0;
+    std::size_t i = 0;
+    for (; i + 4 <= count; i += 4)
+    {
+        __m128d px0 = _mm_loadu_pd(x + i);
+        __m128d px1 = _mm_loadu_pd(x + i + 2);
+        __m128d py0 = _mm_loadu_pd(y + i);
+        __m128d py1 = _mm_loadu_pd(y + i + 2);
+        unsigned left = _mm_movemask_pd(_mm_cmplt_pd(px0, min_x)) | _mm_movemask_pd(_mm_cmplt_pd(px1, min_x)) << 2;
+        unsigned right = _mm_movemask_pd(_mm_cmpgt_pd(px0, max_x)) | _mm_movemask_pd(_mm_cmpgt_pd(px1, max_x)) << 2;
+        unsigned below = _mm_movemask_pd(_mm_cmplt_pd(py0, min_y)) | _mm_movemask_pd(_mm_cmplt_pd(py1, min_y)) << 2;
+        unsigned above = _mm_movemask_pd(_mm_cmpgt_pd(py0, max_y)) | _mm_movemask_pd(_mm_cmpgt_pd(py1, max_y)) << 2;
+        std::uint32_t c = spread[left] | spread[right] << 1 | spread[below] << 2 | spread[above] << 3;
+        std::memcpy(codes + i, &c, sizeof(c));
+        all |= c;
+    }
+    any |= fold_bytes(all);
+    return i;
+}
+
+} // namespace sse41
+
+namespace avx2 {
+
+MAPNIK_TARGET_AVX2 std::size_t outcodes(double const* x, double const* y, std::size_t count,
+                                        double x1, double y1, double x2, double y2,
+                                        std::uint8_t * codes, unsigned & any)
+{
+    __m256d const min_x = _mm256_set1_pd(x1);
+    __m256d const min_y = _mm256_set1_pd(y1);
+    __m256d const max_x = _mm256_set1_pd(x2);
+    __m256d const max_y = _mm256_set1_pd(y2);
+    std::uint32_t all = 0;
+    std::size_t i = 0;
+    for (; i + 4 <= count; i += 4)
+    {
+        __m256d px = _mm256_loadu_pd(x + i);
+        __m256d py = _mm256_loadu_pd(y + i);
+        unsigned left = _mm256_movemask_pd(_mm256_cmp_pd(px, min_x, _CMP_LT_OQ));
+        unsigned right = _mm256_movemask_pd(_mm256_cmp_pd(px, max_x, _CMP_GT_OQ));
+        unsigned below = _mm256_movemask_pd(_mm256_cmp_pd(py, min_y, _CMP_LT_OQ));
+        unsigned above = _mm256_movemask_pd(_mm256_cmp_pd(py, max_y, _CMP_GT_OQ));
+        std::uint32_t c = spread[left] | spread[right] << 1 | spread[below] << 2 | spread[above] << 3;
+        std::memcpy(codes + i, &c, sizeof(c));
+        all |= c;
+    }
+    any |= fold_bytes(all);
+    return i;
+}
+
+} // namespace avx2
+
+#endif // MAPNIK_HAVE_X86_SIMD
+
+} // anonymous namespace
+
+unsigned outcodes(double const* x, double const* y, std::size_t count,
+                  double x1, double y1, double x2, double y2,
+                  std::uint8_t * codes)
+{
+    unsigned any = 0;
+    std::size_t i = 0;
+#ifdef MAPNIK_HAVE_X86_SIMD
+    switch (util::active_simd_level())
+    {
+    case util::simd_level::avx2:
+        i = avx2::outcodes(x, y, count, x1, y1, x2, y2, codes, any);
+        break;
+    case util::simd_level::sse41:
+        i = sse41::outcodes(x, y, count, x1, y1, x2, y2, codes, any);
+        break;
+    default:
+        break;
+    }
+#endif
+    for (; i < count; ++i)
+    {
+        unsigned code = outcode(x[i], y[i], x1, y1, x2, y2);
+        codes[i] = static_cast<std::uint8_t>(code);
+        any |= code;
+    }
+    return any;
+}
+
+}}
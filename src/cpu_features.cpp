@@ -0,0 +1,69 @@
+/*****************************************************************************
+ *
+ * This file is part of Mapnik (c++ mapping toolkit)
+ *
+ * Copyright (C) 2017 Artem Pavlenko
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ *****************************************************************************/
+
+// mapnik
+#include <mapnik/util/cpu_features.hpp>
+
+// stl
+#include <atomic>
+
+namespace mapnik { namespace util {
+
+namespace {
+
+simd_level detect()
+{
+#ifdef MAPNIK_HAVE_X86_SIMD
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) return simd_level::avx2;
+    if (__builtin_cpu_supports("sse4.1")) return simd_level::sse41;
+#endif
+    return simd_level::none;
+}
+
+std::atomic<int> & active()
+{
+    static std::atomic<int> level(static_cast<int>(detected_simd_level()));
+    return level;
+}
+
+}
+
+simd_level detected_simd_level()
+{
+    static const simd_level level = detect();
+    return level;
+}
+
+simd_level active_simd_level()
+{
+    return static_cast<simd_level>(active().load(std::memory_order_relaxed));
+}
+
+void set_simd_level(simd_level level)
+{
+    int detected = static_cast<int>(detected_simd_level());
+    int requested = static_cast<int>(level);
+    active().store(requested < detected ? requested : detected, std::memory_order_relaxed);
+}
+
+}}
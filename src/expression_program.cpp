@@ -0,0 +1,250 @@
+/*****************************************************************************
+ *
+ * This file is part of Mapnik (c++ mapping toolkit)
+ *
+ * Copyright (C) 2017 Artem Pavlenko
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ *****************************************************************************/
+
+// mapnik
+#include <mapnik/expression_program.hpp>
+#include <mapnik/expression_node.hpp>
+#include <mapnik/util/variant.hpp>
+
+// stl
+#include <algorithm>
+
+namespace mapnik
+{
+
+namespace {
+
+template <typename Tag> struct tag_to_opcode;
+template <> struct tag_to_opcode<tags::negate> { static constexpr auto value = expression_program::op_negate; };
+template <> struct tag_to_opcode<tags::plus> { static constexpr auto value = expression_program::op_plus; };
+template <> struct tag_to_opcode<tags::minus> { static constexpr auto value = expression_program::op_minus; };
+template <> struct tag_to_opcode<tags::mult> { static constexpr auto value = expression_program::op_mult; };
+template <> struct tag_to_opcode<tags::div> { static constexpr auto value = expression_program::op_div; };
+template <> struct tag_to_opcode<tags::mod> { static constexpr auto value = expression_program::op_mod; };
+template <> struct tag_to_opcode<tags::less> { static constexpr auto value = expression_program::op_less; };
+template <> struct tag_to_opcode<tags::less_equal> { static constexpr auto value = expression_program::op_less_equal; };
+template <> struct tag_to_opcode<tags::greater> { static constexpr auto value = expression_program::op_greater; };
+template <> struct tag_to_opcode<tags::greater_equal> { static constexpr auto value = expression_program::op_greater_equal; };
+template <> struct tag_to_opcode<tags::equal_to> { static constexpr auto value = expression_program::op_equal_to; };
+template <> struct tag_to_opcode<tags::not_equal_to> { static constexpr auto value = expression_program::op_not_equal_to; };
+
+}
+
+// Lowers an expr_node tree into the instruction list of an expression_program.
+// Each node is compiled with a destination register `dst_`; leaf nodes don't
+// emit any code and are returned as operands instead. Registers above `dst_`
+// are free to be used as temporaries by child nodes.
+struct expression_program::compiler
+{
+    using operand = expression_program::operand;
+    using instruction = expression_program::instruction;
+
+    compiler(expression_program & prog, std::uint32_t dst)
+        : prog_(prog),
+          dst_(dst)
+    {
+        prog_.num_registers_ = std::max<std::size_t>(prog_.num_registers_, dst_ + 1);
+    }
+
+    operand compile(expr_node const& node, std::uint32_t dst) const
+    {
+        return util::apply_visitor(compiler(prog_, dst), node);
+    }
+
+    operand constant(value_type const& val) const
+    {
+        prog_.constants_.push_back(val);
+        return { expression_program::operand_constant, static_cast<std::uint32_t>(prog_.constants_.size() - 1) };
+    }
+
+    operand global(std::string const& str) const
+    {
+        prog_.names_.push_back(str);
+        return { expression_program::operand_global, static_cast<std::uint32_t>(prog_.names_.size() - 1) };
+    }
+
+    operand result() const
+    {
+        return { expression_program::operand_register, dst_ };
+    }
+
+    std::size_t emit(expression_program::opcode op,
+                     operand const& a = operand{ expression_program::operand_register, 0 },
+                     operand const& b = operand{ expression_program::operand_register, 0 },
+                     std::uint32_t extra = 0) const
+    {
+        prog_.code_.push_back(instruction{ op, dst_, a, b, extra });
+        return prog_.code_.size() - 1;
+    }
+
+    std::uint32_t next() const
+    {
+        return static_cast<std::uint32_t>(prog_.code_.size());
+    }
+
+    operand operator() (value_null const& val) const
+    {
+        return constant(val);
+    }
+
+    operand operator() (value_bool val) const
+    {
+        return constant(val);
+    }
+
+    operand operator() (value_integer val) const
+    {
+        return constant(val);
+    }
+
+    operand operator() (value_double val) const
+    {
+        return constant(val);
+    }
+
+    operand operator() (value_unicode_string const& str) const
+    {
+        return constant(str);
+    }
+
+    operand operator() (attribute const& attr) const
+    {
+        prog_.attributes_.push_back(attr);
+        return { expression_program::operand_attribute, static_cast<std::uint32_t>(prog_.attributes_.size() - 1) };
+    }
+
+    operand operator() (global_attribute const& attr) const
+    {
+        return global(attr.name);
+    }
+
+    operand operator() (geometry_type_attribute const&) const
+    {
+        emit(expression_program::op_geometry_type);
+        return result();
+    }
+
+    template <typename Tag>
+    operand operator() (binary_node<Tag> const& x) const
+    {
+        operand a = compile(x.left, dst_);
+        operand b = compile(x.right, dst_ + 1);
+        emit(tag_to_opcode<Tag>::value, a, b);
+        return result();
+    }
+
+    operand operator() (binary_node<tags::logical_and> const& x) const
+    {
+        return logical(x, expression_program::op_jump_if_false);
+    }
+
+    operand operator() (binary_node<tags::logical_or> const& x) const
+    {
+        return logical(x, expression_program::op_jump_if_true);
+    }
+
+    operand operator() (unary_node<tags::negate> const& x) const
+    {
+        emit(expression_program::op_negate, compile(x.expr, dst_));
+        return result();
+    }
+
+    operand operator() (unary_node<tags::logical_not> const& x) const
+    {
+        emit(expression_program::op_logical_not, compile(x.expr, dst_));
+        return result();
+    }
+
+    operand operator() (regex_match_node const& x) const
+    {
+        operand a = compile(x.expr, dst_);
+        prog_.regex_match_nodes_.push_back(x);
+        emit(expression_program::op_regex_match, a, a,
+             static_cast<std::uint32_t>(prog_.regex_match_nodes_.size() - 1));
+        return result();
+    }
+
+    operand operator() (regex_replace_node const& x) const
+    {
+        operand a = compile(x.expr, dst_);
+        prog_.regex_replace_nodes_.push_back(x);
+        emit(expression_program::op_regex_replace, a, a,
+             static_cast<std::uint32_t>(prog_.regex_replace_nodes_.size() - 1));
+        return result();
+    }
+
+    operand operator() (unary_function_call const& call) const
+    {
+        operand a = compile(call.arg, dst_);
+        prog_.unary_functions_.push_back(call.fun);
+        emit(expression_program::op_unary_call, a, a,
+             static_cast<std::uint32_t>(prog_.unary_functions_.size() - 1));
+        return result();
+    }
+
+    operand operator() (binary_function_call const& call) const
+    {
+        operand a = compile(call.arg1, dst_);
+        operand b = compile(call.arg2, dst_ + 1);
+        prog_.binary_functions_.push_back(call.fun);
+        emit(expression_program::op_binary_call, a, b,
+             static_cast<std::uint32_t>(prog_.binary_functions_.size() - 1));
+        return result();
+    }
+
+    // left and right operands are converted to bool, right is skipped
+    // when left already decides the result.
+    template <typename Tag>
+    operand logical(binary_node<Tag> const& x, expression_program::opcode jump) const
+    {
+        emit(expression_program::op_to_bool, compile(x.left, dst_));
+        std::size_t pos = emit(jump);
+        emit(expression_program::op_to_bool, compile(x.right, dst_));
+        prog_.code_[pos].extra = next();
+        return result();
+    }
+
+    expression_program & prog_;
+    std::uint32_t dst_;
+};
+
+expression_program::expression_program(expr_node const& expr)
+    : code_(),
+      constants_(),
+      names_(),
+      attributes_(),
+      regex_match_nodes_(),
+      regex_replace_nodes_(),
+      unary_functions_(),
+      binary_functions_(),
+      num_registers_(1),
+      null_()
+{
+    compiler comp(*this, 0);
+    operand root = comp.compile(expr, 0);
+    if (root.kind != operand_register || root.index != 0)
+    {
+        comp.emit(op_move, root);
+    }
+}
+
+}
@@ -0,0 +1,327 @@
+/*****************************************************************************
+ *
+ * This file is part of Mapnik (c++ mapping toolkit)
+ *
+ * Copyright (C) 2017 Artem Pavlenko
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ *****************************************************************************/
+
+// mapnik
+#include <mapnik/feature_cache.hpp>
+#include <mapnik/feature.hpp>
+#include <mapnik/geometry.hpp>
+#include <mapnik/value.hpp>
+
+// stl
+#include <utility>
+#include <cmath>
+#include <cstdint>
+
+namespace mapnik
+{
+
+template class singleton<feature_cache, CreateStatic>;
+
+constexpr double feature_cache::super_tile_pixels;
+
+namespace {
+
+// features without geometry are not clipped
+bool intersects(box2d<double> const& envelope, box2d<double> const& box)
+{
+    return !envelope.valid() || envelope.intersects(box);
+}
+
+// replays a cached result clipped to the query bbox, the feature list
+// and its features are shared with the cache
+class cached_featureset : public Featureset
+{
+public:
+    cached_featureset(feature_cache::feature_list_ptr const& features, box2d<double> const& box)
+        : features_(features),
+          box_(box),
+          pos_(0) {}
+
+    feature_ptr next()
+    {
+        while (pos_ < features_->size())
+        {
+            feature_cache::cached_feature const& cached = (*features_)[pos_++];
+            if (intersects(cached.envelope, box_))
+            {
+                return cached.feature;
+            }
+        }
+        return feature_ptr();
+    }
+
+    std::size_t next_batch(feature_ptr * features, std::size_t size)
+    {
+        return fill_batch(*this, features, size);
+    }
+
+private:
+    feature_cache::feature_list_ptr features_;
+    box2d<double> box_;
+    std::size_t pos_;
+};
+
+// estimate of the heap memory held by a geometry
+struct geometry_bytes
+{
+    std::size_t operator() (geometry::geometry_empty const&) const
+    {
+        return 0;
+    }
+
+    template <typename T>
+    std::size_t operator() (geometry::point<T> const&) const
+    {
+        return 0;
+    }
+
+    template <typename T>
+    std::size_t operator() (std::vector<geometry::point<T>> const& points) const
+    {
+        return points.capacity() * sizeof(geometry::point<T>);
+    }
+
+    template <typename T>
+    std::size_t operator() (std::vector<T> const& container) const
+    {
+        std::size_t bytes = container.capacity() * sizeof(T);
+        for (auto const& item : container)
+        {
+            bytes += (*this)(item);
+        }
+        return bytes;
+    }
+
+    template <typename T>
+    std::size_t operator() (geometry::geometry<T> const& geom) const
+    {
+        return util::apply_visitor(*this, geom);
+    }
+};
+
+std::size_t feature_bytes(feature_impl const& feature)
+{
+    std::size_t bytes = sizeof(feature_impl) + feature.size() * sizeof(value);
+    for (value const& val : feature.get_data())
+    {
+        if (val.is<value_unicode_string>())
+        {
+            bytes += val.get<value_unicode_string>().length() * sizeof(UChar);
+        }
+    }
+    return bytes + geometry_bytes()(feature.get_geometry());
+}
+
+void append(std::string & key, void const* data, std::size_t size)
+{
+    key.append(static_cast<char const*>(data), size);
+}
+
+template <typename T>
+void append(std::string & key, T const& value)
+{
+    append(key, &value, sizeof(T));
+}
+
+// the super tiles of the cache grid covering the bbox of a query
+struct super_tiles
+{
+    explicit super_tiles(query const& q)
+        : size_x(feature_cache::super_tile_pixels / std::get<0>(q.resolution())),
+          size_y(feature_cache::super_tile_pixels / std::get<1>(q.resolution())),
+          x0(std::floor(q.get_bbox().minx() / size_x)),
+          y0(std::floor(q.get_bbox().miny() / size_y)),
+          x1(std::ceil(q.get_bbox().maxx() / size_x)),
+          y1(std::ceil(q.get_bbox().maxy() / size_y)) {}
+
+    bool valid() const
+    {
+        return std::isfinite(x0) && std::isfinite(y0) && std::isfinite(x1) && std::isfinite(y1)
+            && size_x > 0 && size_y > 0 && x0 < x1 && y0 < y1;
+    }
+
+    box2d<double> box() const
+    {
+        return box2d<double>(x0 * size_x, y0 * size_y, x1 * size_x, y1 * size_y);
+    }
+
+    double size_x;
+    double size_y;
+    double x0;
+    double y0;
+    double x1;
+    double y1;
+};
+
+std::string make_key(datasource const* ds, query const& q, super_tiles const& tiles)
+{
+    std::string key;
+    append(key, ds);
+    double res_x = std::get<0>(q.resolution());
+    double res_y = std::get<1>(q.resolution());
+    append(key, tiles.x0);
+    append(key, tiles.y0);
+    append(key, tiles.x1);
+    append(key, tiles.y1);
+    append(key, res_x);
+    append(key, res_y);
+    append(key, q.scale_denominator());
+    append(key, q.get_filter_factor());
+    for (std::string const& name : q.property_names())
+    {
+        key += name;
+        key += '\0';
+    }
+    for (auto const& kv : q.variables())
+    {
+        key += kv.first;
+        key += '\0';
+        key += kv.second.to_string();
+        key += '\0';
+    }
+    return key;
+}
+
+}
+
+namespace detail {
+
+// Passes the features of a super tile query through, clipped to the bbox
+// of the original query, and records all of them. Once exhausted the
+// recorded result is added to the cache, unless it grew larger than the
+// whole cache; recording stops as soon as it does.
+class recording_featureset : public Featureset
+{
+public:
+    recording_featureset(featureset_ptr const& fs, box2d<double> const& box, std::string && key,
+                         datasource_ptr const& ds, std::size_t max_bytes)
+        : fs_(fs),
+          box_(box),
+          key_(std::move(key)),
+          ds_(ds),
+          features_(std::make_shared<feature_cache::feature_list>()),
+          bytes_(key_.size()),
+          max_bytes_(max_bytes) {}
+
+    feature_ptr next()
+    {
+        feature_ptr feature;
+        while ((feature = fs_->next()))
+        {
+            box2d<double> envelope = feature->envelope();
+            if (features_)
+            {
+                bytes_ += sizeof(feature_cache::cached_feature) + feature_bytes(*feature);
+                if (bytes_ > max_bytes_)
+                {
+                    // too large to cache, stream the rest through
+                    features_.reset();
+                }
+                else
+                {
+                    features_->push_back(feature_cache::cached_feature{envelope, feature});
+                }
+            }
+            if (intersects(envelope, box_))
+            {
+                return feature;
+            }
+        }
+        if (features_)
+        {
+            feature_cache::instance().cache_.insert(key_, feature_cache::entry{ds_, features_}, bytes_);
+            features_.reset();
+        }
+        return feature;
+    }
+
+    std::size_t next_batch(feature_ptr * features, std::size_t size)
+    {
+        return fill_batch(*this, features, size);
+    }
+
+private:
+    featureset_ptr fs_;
+    box2d<double> box_;
+    std::string key_;
+    datasource_ptr ds_;
+    std::shared_ptr<feature_cache::feature_list> features_;
+    std::size_t bytes_;
+    std::size_t max_bytes_;
+};
+
+}
+
+feature_cache::feature_cache()
+    : cache_(0) {}
+
+void feature_cache::set_max_bytes(std::size_t max_bytes)
+{
+    cache_.set_max_bytes(max_bytes);
+}
+
+std::size_t feature_cache::max_bytes() const
+{
+    return cache_.max_bytes();
+}
+
+featureset_ptr feature_cache::features(datasource_ptr const& ds, query const& q,
+                                       processor_context_ptr const& ctx)
+{
+    std::size_t max_bytes = cache_.max_bytes();
+    if (max_bytes == 0)
+    {
+        return ds->features_with_context(q, ctx);
+    }
+    super_tiles tiles(q);
+    if (!tiles.valid())
+    {
+        return ds->features_with_context(q, ctx);
+    }
+    std::string key = make_key(ds.get(), q, tiles);
+    boost::optional<entry> cached = cache_.find(key, [&ds](entry const& e) { return e.ds.lock() == ds; });
+    if (cached)
+    {
+        return std::make_shared<cached_featureset>(cached->features, q.get_bbox());
+    }
+    query widened(q);
+    widened.set_bbox(tiles.box());
+    widened.set_unbuffered_bbox(tiles.box());
+    featureset_ptr fs = ds->features_with_context(widened, ctx);
+    if (!fs || !is_valid(fs))
+    {
+        return fs;
+    }
+    return std::make_shared<detail::recording_featureset>(fs, q.get_bbox(), std::move(key), ds, max_bytes);
+}
+
+void feature_cache::clear()
+{
+    cache_.clear();
+}
+
+feature_cache_stats feature_cache::stats() const
+{
+    return cache_.stats();
+}
+
+}
@@ -408,7 +408,8 @@ face_manager::face_manager(font_library & library,
     : face_cache_(new face_cache()),
       library_(library),
       font_file_mapping_(font_file_mapping),
-      font_memory_cache_(font_cache)
+      font_memory_cache_(font_cache),
+      shaping_cache_()
       {
             FT_Stroker s;
             FT_Error error = FT_Stroker_New(library_.get(), &s);
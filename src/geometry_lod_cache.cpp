@@ -0,0 +1,67 @@
+/*****************************************************************************
+ *
+ * This file is part of Mapnik (c++ mapping toolkit)
+ *
+ * Copyright (C) 2017 Artem Pavlenko
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ *****************************************************************************/
+
+// mapnik
+#include <mapnik/geometry_lod_cache.hpp>
+
+namespace mapnik
+{
+
+geometry_lod_cache::geometry_lod_cache(std::size_t max_bytes)
+    : cache_(max_bytes) {}
+
+void geometry_lod_cache::set_max_bytes(std::size_t max_bytes)
+{
+    cache_.set_max_bytes(max_bytes);
+}
+
+std::size_t geometry_lod_cache::max_bytes() const
+{
+    return cache_.max_bytes();
+}
+
+geometry_lod_cache::geometry_ptr geometry_lod_cache::find(value_integer id, int band,
+                                                          std::size_t source_hash)
+{
+    // entries made from another geometry with the same id are stale
+    boost::optional<entry> result = cache_.find(key_type{id, band}, [source_hash](entry const& e)
+                                                 { return e.source_hash == source_hash; });
+    return result ? result->geom : geometry_ptr();
+}
+
+void geometry_lod_cache::insert(value_integer id, int band, std::size_t source_hash,
+                                geometry_ptr const& geom, std::size_t bytes)
+{
+    cache_.insert(key_type{id, band}, entry{source_hash, geom}, bytes);
+}
+
+void geometry_lod_cache::clear()
+{
+    cache_.clear();
+}
+
+geometry_lod_cache_stats geometry_lod_cache::stats() const
+{
+    return cache_.stats();
+}
+
+}
@@ -25,7 +25,9 @@
 #include <mapnik/image.hpp>
 #include <mapnik/image_any.hpp>
 #include <mapnik/safe_cast.hpp>
+#include <mapnik/geometry/box2d.hpp>
 #include <mapnik/util/const_rendering_buffer.hpp>
+#include <mapnik/util/cpu_features.hpp>
 
 #pragma GCC diagnostic push
 #include <mapnik/warning_ignore.hpp>
@@ -44,6 +46,13 @@
 #include "agg_color_rgba.h"
 #pragma GCC diagnostic pop
 
+// stl
+#include <cstdint>
+
+#ifdef MAPNIK_HAVE_X86_SIMD
+#include <immintrin.h>
+#endif
+
 namespace mapnik
 {
 
@@ -110,6 +119,35 @@ boost::optional<std::string> comp_op_to_string(composite_mode_e comp_op)
     return mode;
 }
 
+bool transparent_source_is_noop(composite_mode_e comp_op)
+{
+    switch (comp_op)
+    {
+    // the agg blenders of these modes either skip or reproduce the
+    // destination for a source pixel with zero alpha and colour
+    case dst:
+    case src_over:
+    case dst_over:
+    case _xor:
+    case plus:
+    case minus:
+    case multiply:
+    case screen:
+    case overlay:
+    case darken:
+    case lighten:
+    case color_dodge:
+    case hard_light:
+    case difference:
+    case exclusion:
+    case invert:
+    case invert_rgb:
+        return true;
+    default:
+        return false;
+    }
+}
+
 /*
 Note: the difference between agg::pixfmt_rgba32 and agg:pixfmt_rgba32_pre is subtle.
 
@@ -124,22 +162,339 @@ For example, if you generate some pattern with AGG (premultiplied) and would lik
 
 */
 
-template <>
-MAPNIK_DECL void composite(image_rgba8 & dst, image_rgba8 const& src, composite_mode_e mode,
-               float opacity,
-               int dx,
-               int dy)
+namespace detail {
+
+// Vectorized row blenders for the most common comp-ops. They reproduce the
+// integer arithmetic of the corresponding agg::comp_op_rgba_* blenders
+// bit for bit (including wrap around on non premultiplied input) and hand
+// the pixels left over at the end of a row to those scalar blenders.
+using blend_row_func = void (*)(std::uint8_t * dst, std::uint8_t const* src, unsigned len, unsigned cover);
+
+#ifdef MAPNIK_HAVE_X86_SIMD
+
+template <typename Op>
+MAPNIK_TARGET_SSE41
+void blend_row_sse41(std::uint8_t * dst, std::uint8_t const* src, unsigned len, unsigned cover)
+{
+    __m128i const zero = _mm_setzero_si128();
+    __m128i const low_byte = _mm_set1_epi16(0xff);
+    __m128i const vcover = _mm_set1_epi16(static_cast<short>(cover));
+    bool const partial = cover < 255;
+    for (; len >= 4; len -= 4, src += 16, dst += 16)
+    {
+        __m128i s = _mm_loadu_si128(reinterpret_cast<__m128i const*>(src));
+        if (Op::skip_transparent && _mm_testz_si128(s, s)) continue;
+        __m128i d = _mm_loadu_si128(reinterpret_cast<__m128i const*>(dst));
+        __m128i lo = Op::blend(_mm_unpacklo_epi8(s, zero), _mm_unpacklo_epi8(d, zero), vcover, partial);
+        __m128i hi = Op::blend(_mm_unpackhi_epi8(s, zero), _mm_unpackhi_epi8(d, zero), vcover, partial);
+        // truncate like the value_type casts in agg before packing
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst),
+                         _mm_packus_epi16(_mm_and_si128(lo, low_byte), _mm_and_si128(hi, low_byte)));
+    }
+    for (; len > 0; --len, src += 4, dst += 4)
+    {
+        Op::scalar_type::blend_pix(dst, src[0], src[1], src[2], src[3], cover);
+    }
+}
+
+template <typename Op>
+MAPNIK_TARGET_AVX2
+void blend_row_avx2(std::uint8_t * dst, std::uint8_t const* src, unsigned len, unsigned cover)
+{
+    __m256i const zero = _mm256_setzero_si256();
+    __m256i const low_byte = _mm256_set1_epi16(0xff);
+    __m256i const vcover = _mm256_set1_epi16(static_cast<short>(cover));
+    bool const partial = cover < 255;
+    for (; len >= 8; len -= 8, src += 32, dst += 32)
+    {
+        __m256i s = _mm256_loadu_si256(reinterpret_cast<__m256i const*>(src));
+        if (Op::skip_transparent && _mm256_testz_si256(s, s)) continue;
+        __m256i d = _mm256_loadu_si256(reinterpret_cast<__m256i const*>(dst));
+        // unpack and pack both work within 128 bit lanes, so pixel order is preserved
+        __m256i lo = Op::blend(_mm256_unpacklo_epi8(s, zero), _mm256_unpacklo_epi8(d, zero), vcover, partial);
+        __m256i hi = Op::blend(_mm256_unpackhi_epi8(s, zero), _mm256_unpackhi_epi8(d, zero), vcover, partial);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst),
+                            _mm256_packus_epi16(_mm256_and_si256(lo, low_byte), _mm256_and_si256(hi, low_byte)));
+    }
+    for (; len > 0; --len, src += 4, dst += 4)
+    {
+        Op::scalar_type::blend_pix(dst, src[0], src[1], src[2], src[3], cover);
+    }
+}
+
+// The blend functions below work on two (sse4.1) or four (avx2) pixels
+// unpacked to 16 bit lanes in rgba order.
+
+namespace sse41 {
+
+MAPNIK_TARGET_SSE41 inline __m128i alpha(__m128i x)
+{
+    return _mm_shufflehi_epi16(_mm_shufflelo_epi16(x, 0xff), 0xff);
+}
+
+// (x + 255) >> 8
+MAPNIK_TARGET_SSE41 inline __m128i shift_round(__m128i x)
+{
+    return _mm_srli_epi16(_mm_add_epi16(x, _mm_set1_epi16(255)), 8);
+}
+
+MAPNIK_TARGET_SSE41 inline __m128i inverse(__m128i x)
+{
+    return _mm_sub_epi16(_mm_set1_epi16(255), x);
+}
+
+// Sca + Dca - Sca.Dca
+MAPNIK_TARGET_SSE41 inline __m128i screen(__m128i s, __m128i d)
+{
+    return _mm_sub_epi16(_mm_add_epi16(s, d), shift_round(_mm_mullo_epi16(s, d)));
+}
+
+struct src_over
+{
+    using scalar_type = agg::comp_op_rgba_src_over<agg::rgba8, agg::order_rgba>;
+    static constexpr bool skip_transparent = true;
+    MAPNIK_TARGET_SSE41 static __m128i blend(__m128i s, __m128i d, __m128i cover, bool partial)
+    {
+        if (partial) s = shift_round(_mm_mullo_epi16(s, cover));
+        return _mm_add_epi16(s, shift_round(_mm_mullo_epi16(d, inverse(alpha(s)))));
+    }
+};
+
+struct multiply
+{
+    using scalar_type = agg::comp_op_rgba_multiply<agg::rgba8, agg::order_rgba>;
+    static constexpr bool skip_transparent = true;
+    MAPNIK_TARGET_SSE41 static __m128i blend(__m128i s, __m128i d, __m128i cover, bool partial)
+    {
+        if (partial) s = shift_round(_mm_mullo_epi16(s, cover));
+        __m128i sa = alpha(s);
+        // Sca.(Dca + 1 - Da) + Dca.(1 - Sa) can exceed 16 bits
+        __m128i f = _mm_add_epi16(d, inverse(alpha(d)));
+        __m128i s1a = inverse(sa);
+        __m128i round = _mm_set1_epi32(255);
+        __m128i lo = _mm_madd_epi16(_mm_unpacklo_epi16(s, d), _mm_unpacklo_epi16(f, s1a));
+        __m128i hi = _mm_madd_epi16(_mm_unpackhi_epi16(s, d), _mm_unpackhi_epi16(f, s1a));
+        __m128i c = _mm_packus_epi32(_mm_srli_epi32(_mm_add_epi32(lo, round), 8),
+                                     _mm_srli_epi32(_mm_add_epi32(hi, round), 8));
+        // Da' = Sa + Da - Sa.Da
+        __m128i r = _mm_blend_epi16(c, screen(s, d), 0x88);
+        return _mm_blendv_epi8(r, d, _mm_cmpeq_epi16(sa, _mm_setzero_si128()));
+    }
+};
+
+struct screen_op
+{
+    using scalar_type = agg::comp_op_rgba_screen<agg::rgba8, agg::order_rgba>;
+    static constexpr bool skip_transparent = true;
+    MAPNIK_TARGET_SSE41 static __m128i blend(__m128i s, __m128i d, __m128i cover, bool partial)
+    {
+        if (partial) s = shift_round(_mm_mullo_epi16(s, cover));
+        return _mm_blendv_epi8(screen(s, d), d, _mm_cmpeq_epi16(alpha(s), _mm_setzero_si128()));
+    }
+};
+
+struct dst_out
+{
+    using scalar_type = agg::comp_op_rgba_dst_out<agg::rgba8, agg::order_rgba>;
+    static constexpr bool skip_transparent = false;
+    MAPNIK_TARGET_SSE41 static __m128i blend(__m128i s, __m128i d, __m128i cover, bool partial)
+    {
+        __m128i sa = alpha(s);
+        if (partial) sa = shift_round(_mm_mullo_epi16(sa, cover));
+        // agg rounds with base_shift here
+        return _mm_srli_epi16(_mm_add_epi16(_mm_mullo_epi16(d, inverse(sa)), _mm_set1_epi16(8)), 8);
+    }
+};
+
+struct dst_in
+{
+    using scalar_type = agg::comp_op_rgba_dst_in<agg::rgba8, agg::order_rgba>;
+    static constexpr bool skip_transparent = false;
+    MAPNIK_TARGET_SSE41 static __m128i blend(__m128i s, __m128i d, __m128i cover, bool partial)
+    {
+        __m128i sa = alpha(s);
+        if (partial) sa = inverse(shift_round(_mm_mullo_epi16(inverse(sa), cover)));
+        return shift_round(_mm_mullo_epi16(d, sa));
+    }
+};
+
+} // namespace sse41
+
+namespace avx2 {
+
+MAPNIK_TARGET_AVX2 inline __m256i alpha(__m256i x)
+{
+    return _mm256_shufflehi_epi16(_mm256_shufflelo_epi16(x, 0xff), 0xff);
+}
+
+MAPNIK_TARGET_AVX2 inline __m256i shift_round(__m256i x)
+{
+    return _mm256_srli_epi16(_mm256_add_epi16(x, _mm256_set1_epi16(255)), 8);
+}
+
+MAPNIK_TARGET_AVX2 inline __m256i inverse(__m256i x)
+{
+    return _mm256_sub_epi16(_mm256_set1_epi16(255), x);
+}
+
+MAPNIK_TARGET_AVX2 inline __m256i screen(__m256i s, __m256i d)
+{
+    return _mm256_sub_epi16(_mm256_add_epi16(s, d), shift_round(_mm256_mullo_epi16(s, d)));
+}
+
+struct src_over
+{
+    using scalar_type = agg::comp_op_rgba_src_over<agg::rgba8, agg::order_rgba>;
+    static constexpr bool skip_transparent = true;
+    MAPNIK_TARGET_AVX2 static __m256i blend(__m256i s, __m256i d, __m256i cover, bool partial)
+    {
+        if (partial) s = shift_round(_mm256_mullo_epi16(s, cover));
+        return _mm256_add_epi16(s, shift_round(_mm256_mullo_epi16(d, inverse(alpha(s)))));
+    }
+};
+
+struct multiply
+{
+    using scalar_type = agg::comp_op_rgba_multiply<agg::rgba8, agg::order_rgba>;
+    static constexpr bool skip_transparent = true;
+    MAPNIK_TARGET_AVX2 static __m256i blend(__m256i s, __m256i d, __m256i cover, bool partial)
+    {
+        if (partial) s = shift_round(_mm256_mullo_epi16(s, cover));
+        __m256i sa = alpha(s);
+        __m256i f = _mm256_add_epi16(d, inverse(alpha(d)));
+        __m256i s1a = inverse(sa);
+        __m256i round = _mm256_set1_epi32(255);
+        __m256i lo = _mm256_madd_epi16(_mm256_unpacklo_epi16(s, d), _mm256_unpacklo_epi16(f, s1a));
+        __m256i hi = _mm256_madd_epi16(_mm256_unpackhi_epi16(s, d), _mm256_unpackhi_epi16(f, s1a));
+        __m256i c = _mm256_packus_epi32(_mm256_srli_epi32(_mm256_add_epi32(lo, round), 8),
+                                        _mm256_srli_epi32(_mm256_add_epi32(hi, round), 8));
+        __m256i r = _mm256_blend_epi16(c, screen(s, d), 0x88);
+        return _mm256_blendv_epi8(r, d, _mm256_cmpeq_epi16(sa, _mm256_setzero_si256()));
+    }
+};
+
+struct screen_op
+{
+    using scalar_type = agg::comp_op_rgba_screen<agg::rgba8, agg::order_rgba>;
+    static constexpr bool skip_transparent = true;
+    MAPNIK_TARGET_AVX2 static __m256i blend(__m256i s, __m256i d, __m256i cover, bool partial)
+    {
+        if (partial) s = shift_round(_mm256_mullo_epi16(s, cover));
+        return _mm256_blendv_epi8(screen(s, d), d, _mm256_cmpeq_epi16(alpha(s), _mm256_setzero_si256()));
+    }
+};
+
+struct dst_out
+{
+    using scalar_type = agg::comp_op_rgba_dst_out<agg::rgba8, agg::order_rgba>;
+    static constexpr bool skip_transparent = false;
+    MAPNIK_TARGET_AVX2 static __m256i blend(__m256i s, __m256i d, __m256i cover, bool partial)
+    {
+        __m256i sa = alpha(s);
+        if (partial) sa = shift_round(_mm256_mullo_epi16(sa, cover));
+        return _mm256_srli_epi16(_mm256_add_epi16(_mm256_mullo_epi16(d, inverse(sa)), _mm256_set1_epi16(8)), 8);
+    }
+};
+
+struct dst_in
+{
+    using scalar_type = agg::comp_op_rgba_dst_in<agg::rgba8, agg::order_rgba>;
+    static constexpr bool skip_transparent = false;
+    MAPNIK_TARGET_AVX2 static __m256i blend(__m256i s, __m256i d, __m256i cover, bool partial)
+    {
+        __m256i sa = alpha(s);
+        if (partial) sa = inverse(shift_round(_mm256_mullo_epi16(inverse(sa), cover)));
+        return shift_round(_mm256_mullo_epi16(d, sa));
+    }
+};
+
+} // namespace avx2
+
+#endif // MAPNIK_HAVE_X86_SIMD
+
+blend_row_func select_blend_row(composite_mode_e mode)
+{
+#ifdef MAPNIK_HAVE_X86_SIMD
+    switch (util::active_simd_level())
+    {
+    case util::simd_level::avx2:
+        switch (mode)
+        {
+        case src_over: return &blend_row_avx2<avx2::src_over>;
+        case multiply: return &blend_row_avx2<avx2::multiply>;
+        case screen: return &blend_row_avx2<avx2::screen_op>;
+        case dst_out: return &blend_row_avx2<avx2::dst_out>;
+        case dst_in: return &blend_row_avx2<avx2::dst_in>;
+        default: return nullptr;
+        }
+    case util::simd_level::sse41:
+        switch (mode)
+        {
+        case src_over: return &blend_row_sse41<sse41::src_over>;
+        case multiply: return &blend_row_sse41<sse41::multiply>;
+        case screen: return &blend_row_sse41<sse41::screen_op>;
+        case dst_out: return &blend_row_sse41<sse41::dst_out>;
+        case dst_in: return &blend_row_sse41<sse41::dst_in>;
+        default: return nullptr;
+        }
+    default:
+        break;
+    }
+#endif
+    (void)mode;
+    return nullptr;
+}
+
+// Routes renderer_base::blend_from spans to a vectorized row blender
+// when one is available for the comp-op.
+template <typename PixFmt>
+class vectorized_blend_pixfmt : public PixFmt
+{
+public:
+    vectorized_blend_pixfmt(agg::rendering_buffer & rbuf, blend_row_func blend_row)
+        : PixFmt(rbuf),
+          blend_row_(blend_row) {}
+
+    template <typename SrcPixelFormatRenderer>
+    void blend_from(SrcPixelFormatRenderer const& from,
+                    int xdst, int ydst,
+                    int xsrc, int ysrc,
+                    unsigned len,
+                    agg::int8u cover)
+    {
+        if (blend_row_ == nullptr)
+        {
+            PixFmt::blend_from(from, xdst, ydst, xsrc, ysrc, len, cover);
+            return;
+        }
+        std::uint8_t const* psrc = from.row_ptr(ysrc);
+        if (psrc)
+        {
+            blend_row_(this->pix_ptr(xdst, ydst), psrc + (xsrc << 2), len, cover);
+        }
+    }
+
+private:
+    blend_row_func blend_row_;
+};
+
+void composite_rgba8(image_rgba8 & dst, image_rgba8 const& src, agg::rect_i const* src_rect,
+                     composite_mode_e mode,
+                     float opacity,
+                     int dx,
+                     int dy)
 {
     using color = agg::rgba8;
     using order = agg::order_rgba;
     using const_rendering_buffer = util::rendering_buffer<image_rgba8>;
     using blender_type = agg::comp_op_adaptor_rgba_pre<color, order>;
-    using pixfmt_type = agg::pixfmt_custom_blend_rgba<blender_type, agg::rendering_buffer>;
+    using pixfmt_type = vectorized_blend_pixfmt<agg::pixfmt_custom_blend_rgba<blender_type, agg::rendering_buffer>>;
     using renderer_type = agg::renderer_base<pixfmt_type>;
 
     agg::rendering_buffer dst_buffer(dst.bytes(),safe_cast<unsigned>(dst.width()),safe_cast<unsigned>(dst.height()),safe_cast<int>(dst.row_size()));
     const_rendering_buffer src_buffer(src);
-    pixfmt_type pixf(dst_buffer);
+    // row blenders assume distinct buffers, agg handles overlapping spans
+    pixfmt_type pixf(dst_buffer, dst.bytes() != src.bytes() ? select_blend_row(mode) : nullptr);
     pixf.comp_op(static_cast<agg::comp_op_e>(mode));
     agg::pixfmt_alpha_blend_rgba<agg::blender_rgba32_pre, const_rendering_buffer, agg::pixel32_type> pixf_mask(src_buffer);
 #ifdef MAPNIK_DEBUG
@@ -153,7 +508,30 @@ MAPNIK_DECL void composite(image_rgba8 & dst, image_rgba8 const& src, composite_
     }
 #endif
     renderer_type ren(pixf);
-    ren.blend_from(pixf_mask,0,dx,dy,safe_cast<agg::cover_type>(255*opacity));
+    ren.blend_from(pixf_mask,src_rect,dx,dy,safe_cast<agg::cover_type>(255*opacity));
+}
+
+}
+
+template <>
+MAPNIK_DECL void composite(image_rgba8 & dst, image_rgba8 const& src, composite_mode_e mode,
+               float opacity,
+               int dx,
+               int dy)
+{
+    detail::composite_rgba8(dst, src, nullptr, mode, opacity, dx, dy);
+}
+
+MAPNIK_DECL void composite(image_rgba8 & dst, image_rgba8 const& src,
+                           box2d<int> const& src_region,
+                           composite_mode_e mode,
+                           float opacity,
+                           int dx,
+                           int dy)
+{
+    // agg rectangles are inclusive
+    agg::rect_i src_rect(src_region.minx(), src_region.miny(), src_region.maxx() - 1, src_region.maxy() - 1);
+    detail::composite_rgba8(dst, src, &src_rect, mode, opacity, dx, dy);
 }
 
 template <>
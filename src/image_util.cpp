@@ -36,6 +36,7 @@
 #include <mapnik/util/variant.hpp>
 #include <mapnik/debug.hpp>
 #include <mapnik/safe_cast.hpp>
+#include <mapnik/pixel_kernels.hpp>
 #ifdef SSE_MATH
 #include <mapnik/sse.hpp>
 #endif
@@ -489,6 +490,42 @@ template MAPNIK_DECL bool is_solid(image_view_gray64 const&);
 template MAPNIK_DECL bool is_solid(image_view_gray64s const&);
 template MAPNIK_DECL bool is_solid(image_view_gray64f const&);
 
+MAPNIK_DECL box2d<int> nonzero_extent(image_rgba8 const& image)
+{
+    using pixel_type = image_rgba8::pixel_type;
+    std::size_t const width = image.width();
+    std::size_t const height = image.height();
+    auto row_is_zero = [&](std::size_t y)
+    {
+        pixel_type const* row = image.get_row(y);
+        pixel_type bits = 0;
+        for (std::size_t x = 0; x < width; ++x) bits |= row[x];
+        return bits == 0;
+    };
+    std::size_t y0 = 0;
+    while (y0 < height && row_is_zero(y0)) ++y0;
+    if (y0 == height)
+    {
+        return box2d<int>();
+    }
+    std::size_t y1 = height;
+    while (row_is_zero(y1 - 1)) --y1;
+    std::size_t x0 = width;
+    std::size_t x1 = 0;
+    for (std::size_t y = y0; y < y1; ++y)
+    {
+        pixel_type const* row = image.get_row(y);
+        std::size_t x = 0;
+        while (x < x0 && row[x] == 0) ++x;
+        x0 = x;
+        x = width;
+        while (x > x1 && row[x - 1] == 0) --x;
+        x1 = x;
+    }
+    return box2d<int>(static_cast<int>(x0), static_cast<int>(y0),
+                      static_cast<int>(x1), static_cast<int>(y1));
+}
+
 namespace detail {
 
 struct premultiply_visitor
@@ -497,9 +534,7 @@ struct premultiply_visitor
     {
         if (!data.get_premultiplied())
         {
-            agg::rendering_buffer buffer(data.bytes(),safe_cast<unsigned>(data.width()),safe_cast<unsigned>(data.height()),safe_cast<int>(data.row_size()));
-            agg::pixfmt_rgba32 pixf(buffer);
-            pixf.premultiply();
+            kernels::premultiply(data.data(), data.width() * data.height());
             data.set_premultiplied(true);
             return true;
         }
@@ -519,9 +554,7 @@ struct demultiply_visitor
     {
         if (data.get_premultiplied())
         {
-            agg::rendering_buffer buffer(data.bytes(),safe_cast<unsigned>(data.width()),safe_cast<unsigned>(data.height()),safe_cast<int>(data.row_size()));
-            agg::pixfmt_rgba32_pre pixf(buffer);
-            pixf.demultiply();
+            kernels::demultiply(data.data(), data.width() * data.height());
             data.set_premultiplied(false);
             return true;
         }
@@ -642,21 +675,7 @@ struct visitor_apply_opacity
 
     void operator() (image_rgba8 & data) const
     {
-        using pixel_type = image_rgba8::pixel_type;
-        for (std::size_t y = 0; y < data.height(); ++y)
-        {
-            pixel_type* row_to =  data.get_row(y);
-            for (std::size_t x = 0; x < data.width(); ++x)
-            {
-                pixel_type rgba = row_to[x];
-                pixel_type a = static_cast<pixel_type>(((rgba >> 24u) & 0xff) * opacity_);
-                pixel_type r = rgba & 0xff;
-                pixel_type g = (rgba >> 8u ) & 0xff;
-                pixel_type b = (rgba >> 16u) & 0xff;
-
-                row_to[x] = (a << 24u) | (b << 16u) |  (g << 8u) | (r) ;
-            }
-        }
+        kernels::apply_opacity(data.data(), data.width() * data.height(), opacity_);
     }
 
     template <typename T>
@@ -713,23 +732,7 @@ struct visitor_set_grayscale_to_alpha
 {
     void operator() (image_rgba8 & data) const
     {
-        using pixel_type = image_rgba8::pixel_type;
-        for (std::size_t y = 0; y < data.height(); ++y)
-        {
-            pixel_type* row_from = data.get_row(y);
-            for (std::size_t x = 0; x < data.width(); ++x)
-            {
-                pixel_type rgba = row_from[x];
-                pixel_type r = rgba & 0xff;
-                pixel_type g = (rgba >> 8u) & 0xff;
-                pixel_type b = (rgba >> 16u) & 0xff;
-
-                // magic numbers for grayscale
-                pixel_type a = static_cast<pixel_type>(std::ceil((r * .3) + (g * .59) + (b * .11)));
-
-                row_from[x] = (a << 24u) | (255 << 16u) |  (255 << 8u) | (255u) ;
-            }
-        }
+        kernels::grayscale_to_alpha(data.data(), data.width() * data.height(), 0xffffff);
     }
 
     template <typename T>
@@ -746,26 +749,7 @@ struct visitor_set_grayscale_to_alpha_c
 
     void operator() (image_rgba8 & data) const
     {
-        using pixel_type = image_rgba8::pixel_type;
-        for (std::size_t y = 0; y < data.height(); ++y)
-        {
-            pixel_type* row_from = data.get_row(y);
-            for (std::size_t x = 0; x < data.width(); ++x)
-            {
-                pixel_type rgba = row_from[x];
-                pixel_type r = rgba & 0xff;
-                pixel_type g = (rgba >> 8 ) & 0xff;
-                pixel_type b = (rgba >> 16) & 0xff;
-
-                // magic numbers for grayscale
-                pixel_type a = static_cast<pixel_type>(std::ceil((r * .3) + (g * .59) + (b * .11)));
-
-                row_from[x] = static_cast<unsigned>(a << 24u) |
-                              static_cast<unsigned>(c_.blue() << 16u) |
-                              static_cast<unsigned>(c_.green() << 8u) |
-                              static_cast<unsigned>(c_.red() );
-            }
-        }
+        kernels::grayscale_to_alpha(data.data(), data.width() * data.height(), c_.rgba() & 0xffffff);
     }
 
     template <typename T>
@@ -861,22 +845,7 @@ struct visitor_set_color_to_alpha
 
     void operator() (image_rgba8 & data) const
     {
-        using pixel_type = image_rgba8::pixel_type;
-        for (std::size_t y = 0; y < data.height(); ++y)
-        {
-            pixel_type* row_from = data.get_row(y);
-            for (std::size_t x = 0; x < data.width(); ++x)
-            {
-                pixel_type rgba = row_from[x];
-                pixel_type r = rgba & 0xff;
-                pixel_type g = (rgba >> 8 ) & 0xff;
-                pixel_type b = (rgba >> 16) & 0xff;
-                if (r == c_.red() && g == c_.green() && b == c_.blue())
-                {
-                    row_from[x] = 0;
-                }
-            }
-        }
+        kernels::color_to_alpha(data.data(), data.width() * data.height(), c_.rgba() & 0xffffff);
     }
 
     template <typename T>
@@ -937,6 +906,12 @@ struct visitor_fill
     visitor_fill(T1 const& val)
         : val_(val) {}
 
+    void operator() (image_rgba8 & data) const
+    {
+        using pixel_type = image_rgba8::pixel_type;
+        kernels::fill(data.data(), data.width() * data.height(), safe_cast<pixel_type>(val_));
+    }
+
     template <typename T2>
     void operator() (T2 & data) const
     {
@@ -956,9 +931,7 @@ struct visitor_fill<color>
 
     void operator() (image_rgba8 & data) const
     {
-        using pixel_type = image_rgba8::pixel_type;
-        pixel_type val = static_cast<pixel_type>(val_.rgba());
-        data.set(val);
+        kernels::fill(data.data(), data.width() * data.height(), val_.rgba());
         data.set_premultiplied(val_.get_premultiplied());
     }
 
@@ -0,0 +1,334 @@
+/*****************************************************************************
+ *
+ * This file is part of Mapnik (c++ mapping toolkit)
+ *
+ * Copyright (C) 2017 Artem Pavlenko
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ *****************************************************************************/
+
+// mapnik
+#include <mapnik/lod_datasource.hpp>
+#include <mapnik/feature.hpp>
+#include <mapnik/query.hpp>
+#include <mapnik/simplify_converter.hpp>
+#include <mapnik/vertex_adapters.hpp>
+
+// stl
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+
+namespace mapnik {
+
+namespace {
+
+// vertices of the geometry types that are simplified, 0 for the others,
+// and a hash of their coordinates, so that a cached geometry is only
+// reused for the geometry it was made from
+struct source_signature
+{
+    std::size_t vertices = 0;
+    std::size_t hash = 0;
+
+    void add(std::size_t value)
+    {
+        hash ^= value + 0x9e3779b9 + (hash << 6) + (hash >> 2);
+    }
+
+    void add(double value)
+    {
+        std::uint64_t bits;
+        std::memcpy(&bits, &value, sizeof(bits));
+        add(static_cast<std::size_t>(bits ^ (bits >> 32)));
+    }
+
+    template <typename Points>
+    void add_points(Points const& points)
+    {
+        vertices += points.size();
+        add(points.size());
+        for (auto const& pt : points)
+        {
+            add(pt.x);
+            add(pt.y);
+        }
+    }
+
+    template <typename T>
+    void operator() (T const&) {}
+
+    void operator() (geometry::line_string<double> const& line)
+    {
+        add_points(line);
+    }
+
+    void operator() (geometry::polygon<double> const& poly)
+    {
+        add(poly.size());
+        for (auto const& ring : poly)
+        {
+            add_points(ring);
+        }
+    }
+
+    void operator() (geometry::multi_line_string<double> const& lines)
+    {
+        add(lines.size());
+        for (auto const& line : lines)
+        {
+            (*this)(line);
+        }
+    }
+
+    void operator() (geometry::multi_polygon<double> const& polys)
+    {
+        add(polys.size());
+        for (auto const& poly : polys)
+        {
+            (*this)(poly);
+        }
+    }
+};
+
+// simplifies each line string and ring on its own with simplify_converter,
+// bytes accumulates the memory held by the output
+struct simplifier
+{
+    simplify_algorithm_e algorithm;
+    double tolerance;
+    std::size_t & bytes;
+
+    template <typename Adapter, typename Points>
+    void simplify(Adapter const& va, Points & points) const
+    {
+        simplify_converter<Adapter const> converter(va);
+        converter.set_simplify_algorithm(algorithm);
+        converter.set_simplify_tolerance(tolerance);
+        double x, y;
+        unsigned command;
+        while ((command = converter.vertex(&x, &y)) != SEG_END)
+        {
+            if (command == SEG_CLOSE)
+            {
+                if (!points.empty()) points.push_back(points.front());
+            }
+            else
+            {
+                points.emplace_back(x, y);
+            }
+        }
+        points.shrink_to_fit();
+        bytes += sizeof(Points) + points.size() * sizeof(geometry::point<double>);
+    }
+
+    template <typename T>
+    geometry::geometry<double> operator() (T const& geom) const
+    {
+        return geometry::geometry<double>(geom);
+    }
+
+    geometry::line_string<double> simplify_line(geometry::line_string<double> const& line) const
+    {
+        geometry::line_string<double> result;
+        simplify(geometry::line_string_vertex_adapter<double>(line), result);
+        return result;
+    }
+
+    geometry::polygon<double> simplify_polygon(geometry::polygon<double> const& poly) const
+    {
+        geometry::polygon<double> result;
+        result.reserve(poly.size());
+        for (auto const& ring : poly)
+        {
+            result.emplace_back();
+            simplify(geometry::ring_vertex_adapter<double>(ring), result.back());
+        }
+        return result;
+    }
+
+    geometry::geometry<double> operator() (geometry::line_string<double> const& line) const
+    {
+        return geometry::geometry<double>(simplify_line(line));
+    }
+
+    geometry::geometry<double> operator() (geometry::polygon<double> const& poly) const
+    {
+        return geometry::geometry<double>(simplify_polygon(poly));
+    }
+
+    geometry::geometry<double> operator() (geometry::multi_line_string<double> const& lines) const
+    {
+        geometry::multi_line_string<double> result;
+        result.reserve(lines.size());
+        for (auto const& line : lines)
+        {
+            result.push_back(simplify_line(line));
+        }
+        return geometry::geometry<double>(std::move(result));
+    }
+
+    geometry::geometry<double> operator() (geometry::multi_polygon<double> const& polys) const
+    {
+        geometry::multi_polygon<double> result;
+        result.reserve(polys.size());
+        for (auto const& poly : polys)
+        {
+            result.push_back(simplify_polygon(poly));
+        }
+        return geometry::geometry<double>(std::move(result));
+    }
+};
+
+class lod_featureset : public Featureset
+{
+public:
+    lod_featureset(featureset_ptr const& fs,
+                   std::shared_ptr<geometry_lod_cache> const& cache,
+                   simplify_algorithm_e algorithm,
+                   double tolerance,
+                   int band)
+        : fs_(fs),
+          cache_(cache),
+          algorithm_(algorithm),
+          tolerance_(tolerance),
+          band_(band) {}
+
+    feature_ptr next()
+    {
+        feature_ptr feature = fs_->next();
+        if (feature) apply(feature);
+        return feature;
+    }
+
+    std::size_t next_batch(feature_ptr * features, std::size_t size)
+    {
+        std::size_t count = fs_->next_batch(features, size);
+        for (std::size_t i = 0; i < count; ++i)
+        {
+            apply(features[i]);
+        }
+        return count;
+    }
+
+private:
+    void apply(feature_ptr & feature) const
+    {
+        geometry::geometry<double> const& geom = feature->get_geometry();
+        source_signature source;
+        util::apply_visitor(source, geom);
+        if (source.vertices == 0) return;
+        geometry_lod_cache::geometry_ptr simplified = cache_->find(feature->id(), band_, source.hash);
+        if (!simplified)
+        {
+            std::size_t bytes = 0;
+            simplified = std::make_shared<geometry::geometry<double> const>(
+                util::apply_visitor(simplifier{algorithm_, tolerance_, bytes}, geom));
+            cache_->insert(feature->id(), band_, source.hash, simplified, bytes);
+        }
+        // the feature may be held by the datasource, never modify it
+        feature_ptr copy = std::make_shared<feature_impl>(feature->context(), feature->id());
+        copy->set_data(feature->get_data());
+        copy->set_raster(feature->get_raster());
+        copy->set_geometry_copy(*simplified);
+        feature = std::move(copy);
+    }
+
+    featureset_ptr fs_;
+    std::shared_ptr<geometry_lod_cache> cache_;
+    simplify_algorithm_e algorithm_;
+    double tolerance_;
+    int band_;
+};
+
+}
+
+lod_datasource::lod_datasource(datasource_ptr const& ds,
+                               simplify_algorithm_e algorithm,
+                               double tolerance,
+                               std::size_t max_bytes)
+    : datasource(ds->params()),
+      ds_(ds),
+      algorithm_(algorithm),
+      tolerance_(tolerance),
+      cache_(std::make_shared<geometry_lod_cache>(max_bytes)) {}
+
+lod_datasource::~lod_datasource() {}
+
+datasource::datasource_t lod_datasource::type() const
+{
+    return ds_->type();
+}
+
+featureset_ptr lod_datasource::features(query const& q) const
+{
+    featureset_ptr fs = ds_->features(q);
+    // the query resolution is in pixels per unit of the layer srs
+    double res = std::max(std::get<0>(q.resolution()), std::get<1>(q.resolution()));
+    if (ds_->type() == datasource::Raster || !is_valid(fs) ||
+        tolerance_ <= 0.0 || !(res > 0.0) || !std::isfinite(res))
+    {
+        return fs;
+    }
+    // resolutions in [2^band, 2^(band + 1)) share the geometries simplified
+    // at the finest of them, which are within tolerance for the whole band
+    int band = static_cast<int>(std::floor(std::log2(res)));
+    double tolerance = tolerance_ / std::ldexp(1.0, band + 1);
+    return std::make_shared<lod_featureset>(fs, cache_, algorithm_, tolerance, band);
+}
+
+featureset_ptr lod_datasource::features_at_point(coord2d const& pt, double tol) const
+{
+    return ds_->features_at_point(pt, tol);
+}
+
+box2d<double> lod_datasource::envelope() const
+{
+    return ds_->envelope();
+}
+
+boost::optional<datasource_geometry_t> lod_datasource::get_geometry_type() const
+{
+    return ds_->get_geometry_type();
+}
+
+layer_descriptor lod_datasource::get_descriptor() const
+{
+    return ds_->get_descriptor();
+}
+
+std::size_t lod_datasource::max_concurrent_queries() const
+{
+    return ds_->max_concurrent_queries();
+}
+
+query_slot_queue & lod_datasource::query_slots() const
+{
+    return ds_->query_slots();
+}
+
+datasource_ptr const& lod_datasource::wrapped() const
+{
+    return ds_;
+}
+
+geometry_lod_cache & lod_datasource::cache() const
+{
+    return *cache_;
+}
+
+}
@@ -0,0 +1,66 @@
+/*****************************************************************************
+ *
+ * This file is part of Mapnik (c++ mapping toolkit)
+ *
+ * Copyright (C) 2017 Artem Pavlenko
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ *****************************************************************************/
+
+// mapnik
+#include <mapnik/marker_bitmap_cache.hpp>
+
+namespace mapnik
+{
+
+marker_bitmap_cache::marker_bitmap_cache(std::size_t max_bytes)
+    : cache_(max_bytes) {}
+
+void marker_bitmap_cache::set_max_bytes(std::size_t max_bytes)
+{
+    cache_.set_max_bytes(max_bytes);
+}
+
+std::size_t marker_bitmap_cache::max_bytes() const
+{
+    return cache_.max_bytes();
+}
+
+marker_bitmap_ptr marker_bitmap_cache::find(std::string const& key, void const* owner)
+{
+    // entries whose owner is gone, its address reused or not, are stale
+    boost::optional<entry> result = cache_.find(key, [owner](entry const& e)
+                                                 { return !e.has_owner || (owner != nullptr && e.owner.lock().get() == owner); });
+    return result ? result->bitmap : marker_bitmap_ptr();
+}
+
+void marker_bitmap_cache::insert(std::string const& key, marker_bitmap_ptr const& bitmap,
+                                 std::shared_ptr<void const> const& owner)
+{
+    cache_.insert(key, entry{bitmap, owner, owner != nullptr}, key.size() + bitmap->image.size());
+}
+
+void marker_bitmap_cache::clear()
+{
+    cache_.clear();
+}
+
+marker_bitmap_cache_stats marker_bitmap_cache::stats() const
+{
+    return cache_.stats();
+}
+
+}
@@ -165,6 +165,12 @@ layer_descriptor memory_datasource::get_descriptor() const
     return desc_;
 }
 
+std::size_t memory_datasource::max_concurrent_queries() const
+{
+    // features() only reads the feature vector
+    return query_slot_queue::unlimited;
+}
+
 size_t memory_datasource::size() const
 {
     return features_.size();
@@ -0,0 +1,108 @@
+/*****************************************************************************
+ *
+ * This file is part of Mapnik (c++ mapping toolkit)
+ *
+ * Copyright (C) 2017 Artem Pavlenko
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ *****************************************************************************/
+
+// mapnik
+#include <mapnik/metatile.hpp>
+#include <mapnik/map.hpp>
+#include <mapnik/request.hpp>
+#include <mapnik/attribute.hpp>
+#include <mapnik/agg_renderer.hpp>
+#include <mapnik/image_view.hpp>
+#include <mapnik/image_util.hpp>
+#include <mapnik/util/thread_pool.hpp>
+
+// stl
+#include <future>
+#include <stdexcept>
+
+namespace mapnik
+{
+
+std::vector<std::string> encode_metatile(image_rgba8 const& image,
+                                         unsigned tile_size,
+                                         std::string const& format,
+                                         util::thread_pool * pool)
+{
+    if (tile_size == 0 || image.width() % tile_size != 0 || image.height() % tile_size != 0)
+    {
+        throw std::runtime_error("encode_metatile: image dimensions must be a multiple of tile size");
+    }
+    std::size_t cols = image.width() / tile_size;
+    std::size_t rows = image.height() / tile_size;
+    std::vector<std::string> tiles(cols * rows);
+
+    auto encode = [&image, &tiles, &format, tile_size, cols](std::size_t index)
+    {
+        std::size_t x = (index % cols) * tile_size;
+        std::size_t y = (index / cols) * tile_size;
+        image_view_rgba8 view(x, y, tile_size, tile_size, image);
+        tiles[index] = save_to_string(view, format);
+    };
+
+    if (pool == nullptr)
+    {
+        for (std::size_t i = 0; i < tiles.size(); ++i)
+        {
+            encode(i);
+        }
+    }
+    else
+    {
+        std::vector<std::future<void>> results;
+        results.reserve(tiles.size());
+        for (std::size_t i = 0; i < tiles.size(); ++i)
+        {
+            results.push_back(pool->submit([&encode, i] { encode(i); }));
+        }
+        // wait for all tiles before rethrowing, the tasks reference local state
+        for (std::future<void> & result : results)
+        {
+            result.wait();
+        }
+        for (std::future<void> & result : results)
+        {
+            result.get();
+        }
+    }
+    return tiles;
+}
+
+std::vector<std::string> render_metatile(Map const& map,
+                                         box2d<double> const& extent,
+                                         metatile_options const& options)
+{
+    unsigned size = options.tiles * options.tile_size;
+    request req(size, size, extent);
+    req.set_buffer_size(options.buffer_size ? *options.buffer_size : map.buffer_size());
+
+    image_rgba8 image(size, size);
+    agg_renderer<image_rgba8> ren(map, req, attributes(), image, options.scale_factor);
+    ren.set_query_pool(options.query_pool);
+    ren.set_render_report(options.report);
+    ren.set_render_plans(options.plans);
+    ren.set_shaping_cache(options.shaping);
+    ren.apply(req);
+
+    return encode_metatile(image, options.tile_size, options.format, options.pool.get());
+}
+
+}
@@ -0,0 +1,797 @@
+/*****************************************************************************
+ *
+ * This file is part of Mapnik (c++ mapping toolkit)
+ *
+ * Copyright (C) 2017 Artem Pavlenko
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ *****************************************************************************/
+
+// mapnik
+#include <mapnik/pixel_kernels.hpp>
+#include <mapnik/util/cpu_features.hpp>
+
+#pragma GCC diagnostic push
+#include <mapnik/warning_ignore_agg.hpp>
+#include "agg_pixfmt_rgba.h"
+#include "agg_blur.h"
+#pragma GCC diagnostic pop
+
+// stl
+#include <cmath>
+#include <cstring>
+#include <vector>
+
+#ifdef MAPNIK_HAVE_X86_SIMD
+#include <immintrin.h>
+#endif
+
+namespace mapnik { namespace kernels {
+
+namespace {
+
+using multiplier = agg::multiplier_rgba<agg::rgba8, agg::order_rgba>;
+
+// The vectorized kernels process whole vectors only and return the number
+// of leading pixels done; the callers below finish the span with scalar code.
+
+#ifdef MAPNIK_HAVE_X86_SIMD
+
+namespace sse41 {
+
+MAPNIK_TARGET_SSE41 inline bool opaque(__m128i p)
+{
+    return _mm_testc_si128(p, _mm_set1_epi32(static_cast<int>(0xff000000))) != 0;
+}
+
+MAPNIK_TARGET_SSE41 inline __m128i alpha(__m128i x)
+{
+    return _mm_shufflehi_epi16(_mm_shufflelo_epi16(x, 0xff), 0xff);
+}
+
+// two pixels unpacked to 16 bit lanes
+MAPNIK_TARGET_SSE41 inline __m128i premultiply2(__m128i x)
+{
+    // (c * a + 255) >> 8 also yields 0 for a == 0 and c for a == 255
+    __m128i c = _mm_srli_epi16(_mm_add_epi16(_mm_mullo_epi16(x, alpha(x)), _mm_set1_epi16(255)), 8);
+    return _mm_blend_epi16(c, x, 0x88);
+}
+
+// one pixel unpacked to 32 bit lanes
+MAPNIK_TARGET_SSE41 inline __m128i demultiply1(__m128i x)
+{
+    __m128 f = _mm_cvtepi32_ps(x);
+    __m128 a = _mm_shuffle_ps(f, f, 0xff);
+    // c * 255 / a is exact in single precision up to truncation; a == 0
+    // gives inf or nan which converts to INT_MIN and is clamped to 0
+    __m128i c = _mm_cvttps_epi32(_mm_div_ps(_mm_mul_ps(f, _mm_set1_ps(255.0f)), a));
+    c = _mm_min_epi32(_mm_max_epi32(c, _mm_setzero_si128()), _mm_set1_epi32(255));
+    return _mm_blend_epi16(c, x, 0xc0);
+}
+
+MAPNIK_TARGET_SSE41 std::size_t premultiply(std::uint32_t * pixels, std::size_t count)
+{
+    __m128i const zero = _mm_setzero_si128();
+    std::size_t i = 0;
+    for (; i + 4 <= count; i += 4)
+    {
+        __m128i * ptr = reinterpret_cast<__m128i*>(pixels + i);
+        __m128i p = _mm_loadu_si128(ptr);
+        if (opaque(p)) continue;
+        _mm_storeu_si128(ptr, _mm_packus_epi16(premultiply2(_mm_unpacklo_epi8(p, zero)),
+                                               premultiply2(_mm_unpackhi_epi8(p, zero))));
+    }
+    return i;
+}
+
+MAPNIK_TARGET_SSE41 std::size_t demultiply(std::uint32_t * pixels, std::size_t count)
+{
+    std::size_t i = 0;
+    for (; i + 4 <= count; i += 4)
+    {
+        __m128i * ptr = reinterpret_cast<__m128i*>(pixels + i);
+        __m128i p = _mm_loadu_si128(ptr);
+        if (opaque(p)) continue;
+        __m128i p0 = demultiply1(_mm_cvtepu8_epi32(p));
+        __m128i p1 = demultiply1(_mm_cvtepu8_epi32(_mm_srli_si128(p, 4)));
+        __m128i p2 = demultiply1(_mm_cvtepu8_epi32(_mm_srli_si128(p, 8)));
+        __m128i p3 = demultiply1(_mm_cvtepu8_epi32(_mm_srli_si128(p, 12)));
+        _mm_storeu_si128(ptr, _mm_packus_epi16(_mm_packus_epi32(p0, p1), _mm_packus_epi32(p2, p3)));
+    }
+    return i;
+}
+
+MAPNIK_TARGET_SSE41 std::size_t apply_opacity(std::uint32_t * pixels, std::size_t count, float opacity)
+{
+    __m128 const op = _mm_set1_ps(opacity);
+    __m128i const rgb_mask = _mm_set1_epi32(0x00ffffff);
+    std::size_t i = 0;
+    for (; i + 4 <= count; i += 4)
+    {
+        __m128i * ptr = reinterpret_cast<__m128i*>(pixels + i);
+        __m128i p = _mm_loadu_si128(ptr);
+        __m128i a = _mm_cvttps_epi32(_mm_mul_ps(_mm_cvtepi32_ps(_mm_srli_epi32(p, 24)), op));
+        _mm_storeu_si128(ptr, _mm_or_si128(_mm_and_si128(p, rgb_mask), _mm_slli_epi32(a, 24)));
+    }
+    return i;
+}
+
+// ceil(r * .3 + g * .59 + b * .11) for the two low pixels
+MAPNIK_TARGET_SSE41 inline __m128i luminance2(__m128i p)
+{
+    __m128i const byte = _mm_set1_epi32(0xff);
+    __m128d r = _mm_cvtepi32_pd(_mm_and_si128(p, byte));
+    __m128d g = _mm_cvtepi32_pd(_mm_and_si128(_mm_srli_epi32(p, 8), byte));
+    __m128d b = _mm_cvtepi32_pd(_mm_and_si128(_mm_srli_epi32(p, 16), byte));
+    __m128d l = _mm_add_pd(_mm_add_pd(_mm_mul_pd(r, _mm_set1_pd(.3)), _mm_mul_pd(g, _mm_set1_pd(.59))),
+                           _mm_mul_pd(b, _mm_set1_pd(.11)));
+    return _mm_cvttpd_epi32(_mm_ceil_pd(l));
+}
+
+MAPNIK_TARGET_SSE41 std::size_t grayscale_to_alpha(std::uint32_t * pixels, std::size_t count, std::uint32_t rgb)
+{
+    __m128i const color = _mm_set1_epi32(static_cast<int>(rgb));
+    std::size_t i = 0;
+    for (; i + 4 <= count; i += 4)
+    {
+        __m128i * ptr = reinterpret_cast<__m128i*>(pixels + i);
+        __m128i p = _mm_loadu_si128(ptr);
+        __m128i a = _mm_unpacklo_epi64(luminance2(p), luminance2(_mm_srli_si128(p, 8)));
+        _mm_storeu_si128(ptr, _mm_or_si128(_mm_slli_epi32(a, 24), color));
+    }
+    return i;
+}
+
+MAPNIK_TARGET_SSE41 std::size_t color_to_alpha(std::uint32_t * pixels, std::size_t count, std::uint32_t rgb)
+{
+    __m128i const color = _mm_set1_epi32(static_cast<int>(rgb));
+    __m128i const rgb_mask = _mm_set1_epi32(0x00ffffff);
+    std::size_t i = 0;
+    for (; i + 4 <= count; i += 4)
+    {
+        __m128i * ptr = reinterpret_cast<__m128i*>(pixels + i);
+        __m128i p = _mm_loadu_si128(ptr);
+        __m128i match = _mm_cmpeq_epi32(_mm_and_si128(p, rgb_mask), color);
+        _mm_storeu_si128(ptr, _mm_andnot_si128(match, p));
+    }
+    return i;
+}
+
+MAPNIK_TARGET_SSE41 std::size_t fill(std::uint32_t * pixels, std::size_t count, std::uint32_t value)
+{
+    __m128i const v = _mm_set1_epi32(static_cast<int>(value));
+    std::size_t i = 0;
+    for (; i + 4 <= count; i += 4)
+    {
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(pixels + i), v);
+    }
+    return i;
+}
+
+} // namespace sse41
+
+namespace avx2 {
+
+MAPNIK_TARGET_AVX2 inline bool opaque(__m256i p)
+{
+    return _mm256_testc_si256(p, _mm256_set1_epi32(static_cast<int>(0xff000000))) != 0;
+}
+
+MAPNIK_TARGET_AVX2 inline __m256i alpha(__m256i x)
+{
+    return _mm256_shufflehi_epi16(_mm256_shufflelo_epi16(x, 0xff), 0xff);
+}
+
+MAPNIK_TARGET_AVX2 inline __m256i premultiply4(__m256i x)
+{
+    __m256i c = _mm256_srli_epi16(_mm256_add_epi16(_mm256_mullo_epi16(x, alpha(x)), _mm256_set1_epi16(255)), 8);
+    return _mm256_blend_epi16(c, x, 0x88);
+}
+
+MAPNIK_TARGET_AVX2 inline __m256i demultiply2(__m256i x)
+{
+    __m256 f = _mm256_cvtepi32_ps(x);
+    __m256 a = _mm256_shuffle_ps(f, f, 0xff);
+    __m256i c = _mm256_cvttps_epi32(_mm256_div_ps(_mm256_mul_ps(f, _mm256_set1_ps(255.0f)), a));
+    c = _mm256_min_epi32(_mm256_max_epi32(c, _mm256_setzero_si256()), _mm256_set1_epi32(255));
+    return _mm256_blend_epi16(c, x, 0xc0);
+}
+
+MAPNIK_TARGET_AVX2 std::size_t premultiply(std::uint32_t * pixels, std::size_t count)
+{
+    __m256i const zero = _mm256_setzero_si256();
+    std::size_t i = 0;
+    for (; i + 8 <= count; i += 8)
+    {
+        __m256i * ptr = reinterpret_cast<__m256i*>(pixels + i);
+        __m256i p = _mm256_loadu_si256(ptr);
+        if (opaque(p)) continue;
+        // unpack and pack both work within 128 bit lanes, so pixel order is preserved
+        _mm256_storeu_si256(ptr, _mm256_packus_epi16(premultiply4(_mm256_unpacklo_epi8(p, zero)),
+                                                     premultiply4(_mm256_unpackhi_epi8(p, zero))));
+    }
+    return i;
+}
+
+MAPNIK_TARGET_AVX2 std::size_t demultiply(std::uint32_t * pixels, std::size_t count)
+{
+    // packing two pixel pairs per lane interleaves them, this puts them back
+    __m256i const order = _mm256_setr_epi32(0, 4, 1, 5, 2, 6, 3, 7);
+    std::size_t i = 0;
+    for (; i + 8 <= count; i += 8)
+    {
+        __m256i * ptr = reinterpret_cast<__m256i*>(pixels + i);
+        if (opaque(_mm256_loadu_si256(ptr))) continue;
+        __m128i const* src = reinterpret_cast<__m128i const*>(pixels + i);
+        __m256i p01 = demultiply2(_mm256_cvtepu8_epi32(_mm_loadl_epi64(src)));
+        __m256i p23 = demultiply2(_mm256_cvtepu8_epi32(_mm_loadl_epi64(reinterpret_cast<__m128i const*>(pixels + i + 2))));
+        __m256i p45 = demultiply2(_mm256_cvtepu8_epi32(_mm_loadl_epi64(reinterpret_cast<__m128i const*>(pixels + i + 4))));
+        __m256i p67 = demultiply2(_mm256_cvtepu8_epi32(_mm_loadl_epi64(reinterpret_cast<__m128i const*>(pixels + i + 6))));
+        __m256i packed = _mm256_packus_epi16(_mm256_packus_epi32(p01, p23), _mm256_packus_epi32(p45, p67));
+        _mm256_storeu_si256(ptr, _mm256_permutevar8x32_epi32(packed, order));
+    }
+    return i;
+}
+
+MAPNIK_TARGET_AVX2 std::size_t apply_opacity(std::uint32_t * pixels, std::size_t count, float opacity)
+{
+    __m256 const op = _mm256_set1_ps(opacity);
+    __m256i const rgb_mask = _mm256_set1_epi32(0x00ffffff);
+    std::size_t i = 0;
+    for (; i + 8 <= count; i += 8)
+    {
+        __m256i * ptr = reinterpret_cast<__m256i*>(pixels + i);
+        __m256i p = _mm256_loadu_si256(ptr);
+        __m256i a = _mm256_cvttps_epi32(_mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_srli_epi32(p, 24)), op));
+        _mm256_storeu_si256(ptr, _mm256_or_si256(_mm256_and_si256(p, rgb_mask), _mm256_slli_epi32(a, 24)));
+    }
+    return i;
+}
+
+MAPNIK_TARGET_AVX2 std::size_t grayscale_to_alpha(std::uint32_t * pixels, std::size_t count, std::uint32_t rgb)
+{
+    __m128i const color = _mm_set1_epi32(static_cast<int>(rgb));
+    __m128i const byte = _mm_set1_epi32(0xff);
+    std::size_t i = 0;
+    for (; i + 4 <= count; i += 4)
+    {
+        __m128i * ptr = reinterpret_cast<__m128i*>(pixels + i);
+        __m128i p = _mm_loadu_si128(ptr);
+        __m256d r = _mm256_cvtepi32_pd(_mm_and_si128(p, byte));
+        __m256d g = _mm256_cvtepi32_pd(_mm_and_si128(_mm_srli_epi32(p, 8), byte));
+        __m256d b = _mm256_cvtepi32_pd(_mm_and_si128(_mm_srli_epi32(p, 16), byte));
+        __m256d l = _mm256_add_pd(_mm256_add_pd(_mm256_mul_pd(r, _mm256_set1_pd(.3)),
+                                                _mm256_mul_pd(g, _mm256_set1_pd(.59))),
+                                  _mm256_mul_pd(b, _mm256_set1_pd(.11)));
+        __m128i a = _mm256_cvttpd_epi32(_mm256_ceil_pd(l));
+        _mm_storeu_si128(ptr, _mm_or_si128(_mm_slli_epi32(a, 24), color));
+    }
+    return i;
+}
+
+MAPNIK_TARGET_AVX2 std::size_t color_to_alpha(std::uint32_t * pixels, std::size_t count, std::uint32_t rgb)
+{
+    __m256i const color = _mm256_set1_epi32(static_cast<int>(rgb));
+    __m256i const rgb_mask = _mm256_set1_epi32(0x00ffffff);
+    std::size_t i = 0;
+    for (; i + 8 <= count; i += 8)
+    {
+        __m256i * ptr = reinterpret_cast<__m256i*>(pixels + i);
+        __m256i p = _mm256_loadu_si256(ptr);
+        __m256i match = _mm256_cmpeq_epi32(_mm256_and_si256(p, rgb_mask), color);
+        _mm256_storeu_si256(ptr, _mm256_andnot_si256(match, p));
+    }
+    return i;
+}
+
+MAPNIK_TARGET_AVX2 std::size_t fill(std::uint32_t * pixels, std::size_t count, std::uint32_t value)
+{
+    __m256i const v = _mm256_set1_epi32(static_cast<int>(value));
+    std::size_t i = 0;
+    for (; i + 8 <= count; i += 8)
+    {
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(pixels + i), v);
+    }
+    return i;
+}
+
+} // namespace avx2
+
+template <typename... Args>
+std::size_t vectorized(std::size_t (*avx2_kernel)(std::uint32_t *, std::size_t, Args...),
+                       std::size_t (*sse41_kernel)(std::uint32_t *, std::size_t, Args...),
+                       std::uint32_t * pixels, std::size_t count, Args... args)
+{
+    switch (util::active_simd_level())
+    {
+    case util::simd_level::avx2:
+        return avx2_kernel(pixels, count, args...);
+    case util::simd_level::sse41:
+        return sse41_kernel(pixels, count, args...);
+    default:
+        return 0;
+    }
+}
+
+#define MAPNIK_VECTORIZED(name, ...) vectorized(&avx2::name, &sse41::name, __VA_ARGS__)
+#else
+#define MAPNIK_VECTORIZED(name, ...) std::size_t(0)
+#endif // MAPNIK_HAVE_X86_SIMD
+
+} // anonymous namespace
+
+void premultiply(std::uint32_t * pixels, std::size_t count)
+{
+    for (std::size_t i = MAPNIK_VECTORIZED(premultiply, pixels, count); i < count; ++i)
+    {
+        multiplier::premultiply(reinterpret_cast<agg::int8u*>(pixels + i));
+    }
+}
+
+void demultiply(std::uint32_t * pixels, std::size_t count)
+{
+    for (std::size_t i = MAPNIK_VECTORIZED(demultiply, pixels, count); i < count; ++i)
+    {
+        multiplier::demultiply(reinterpret_cast<agg::int8u*>(pixels + i));
+    }
+}
+
+void apply_opacity(std::uint32_t * pixels, std::size_t count, float opacity)
+{
+    for (std::size_t i = MAPNIK_VECTORIZED(apply_opacity, pixels, count, opacity); i < count; ++i)
+    {
+        std::uint32_t rgba = pixels[i];
+        std::uint32_t a = static_cast<std::uint32_t>(((rgba >> 24u) & 0xff) * opacity);
+        pixels[i] = (a << 24u) | (rgba & 0xffffff);
+    }
+}
+
+void grayscale_to_alpha(std::uint32_t * pixels, std::size_t count, std::uint32_t rgb)
+{
+    for (std::size_t i = MAPNIK_VECTORIZED(grayscale_to_alpha, pixels, count, rgb); i < count; ++i)
+    {
+        std::uint32_t rgba = pixels[i];
+        std::uint32_t r = rgba & 0xff;
+        std::uint32_t g = (rgba >> 8u) & 0xff;
+        std::uint32_t b = (rgba >> 16u) & 0xff;
+        // magic numbers for grayscale
+        std::uint32_t a = static_cast<std::uint32_t>(std::ceil((r * .3) + (g * .59) + (b * .11)));
+        pixels[i] = (a << 24u) | rgb;
+    }
+}
+
+void color_to_alpha(std::uint32_t * pixels, std::size_t count, std::uint32_t rgb)
+{
+    for (std::size_t i = MAPNIK_VECTORIZED(color_to_alpha, pixels, count, rgb); i < count; ++i)
+    {
+        if ((pixels[i] & 0xffffff) == rgb)
+        {
+            pixels[i] = 0;
+        }
+    }
+}
+
+void fill(std::uint32_t * pixels, std::size_t count, std::uint32_t value)
+{
+    for (std::size_t i = MAPNIK_VECTORIZED(fill, pixels, count, value); i < count; ++i)
+    {
+        pixels[i] = value;
+    }
+}
+
+namespace {
+
+// agg::stack_blur_rgba32 for a single line, generalized to any pixel step
+void stack_blur_line(std::uint8_t * line, std::ptrdiff_t step, std::size_t len, unsigned radius,
+                     unsigned mul_sum, unsigned shr_sum, std::uint32_t * stack)
+{
+    unsigned const div = radius * 2 + 1;
+    std::size_t const last = len - 1;
+    unsigned sum[4] = { 0, 0, 0, 0 };
+    unsigned sum_in[4] = { 0, 0, 0, 0 };
+    unsigned sum_out[4] = { 0, 0, 0, 0 };
+    std::uint8_t const* src = line;
+    for (unsigned i = 0; i <= radius; ++i)
+    {
+        std::memcpy(&stack[i], src, 4);
+        for (unsigned c = 0; c < 4; ++c)
+        {
+            sum[c] += src[c] * (i + 1);
+            sum_out[c] += src[c];
+        }
+    }
+    for (unsigned i = 1; i <= radius; ++i)
+    {
+        if (i <= last) src += step;
+        std::memcpy(&stack[i + radius], src, 4);
+        for (unsigned c = 0; c < 4; ++c)
+        {
+            sum[c] += src[c] * (radius + 1 - i);
+            sum_in[c] += src[c];
+        }
+    }
+    unsigned stack_ptr = radius;
+    std::size_t xp = radius < last ? radius : last;
+    src = line + static_cast<std::ptrdiff_t>(xp) * step;
+    std::uint8_t * dst = line;
+    for (std::size_t x = 0; x < len; ++x)
+    {
+        for (unsigned c = 0; c < 4; ++c)
+        {
+            dst[c] = static_cast<std::uint8_t>((sum[c] * mul_sum) >> shr_sum);
+            sum[c] -= sum_out[c];
+        }
+        dst += step;
+        unsigned stack_start = stack_ptr + div - radius;
+        if (stack_start >= div) stack_start -= div;
+        std::uint8_t * pix = reinterpret_cast<std::uint8_t*>(&stack[stack_start]);
+        for (unsigned c = 0; c < 4; ++c) sum_out[c] -= pix[c];
+        if (xp < last)
+        {
+            src += step;
+            ++xp;
+        }
+        std::memcpy(pix, src, 4);
+        for (unsigned c = 0; c < 4; ++c)
+        {
+            sum_in[c] += src[c];
+            sum[c] += sum_in[c];
+        }
+        if (++stack_ptr >= div) stack_ptr = 0;
+        pix = reinterpret_cast<std::uint8_t*>(&stack[stack_ptr]);
+        for (unsigned c = 0; c < 4; ++c)
+        {
+            sum_out[c] += pix[c];
+            sum_in[c] -= pix[c];
+        }
+    }
+}
+
+// mirrors mapnik::filter::process_channel_impl
+void convolve_pixel(std::uint8_t const* up, std::uint8_t const* mid, std::uint8_t const* down,
+                    std::uint8_t * dst, std::size_t x, std::size_t width, float const* k)
+{
+    std::size_t const l = (x == 0 ? x : x - 1) * 4;
+    std::size_t const r = (x + 1 == width ? x : x + 1) * 4;
+    std::size_t const o = x * 4;
+    for (std::size_t c = 0; c < 3; ++c)
+    {
+        float p[9] = { float(up[l + c]), float(up[o + c]), float(up[r + c]),
+                       float(mid[l + c]), float(mid[o + c]), float(mid[r + c]),
+                       float(down[l + c]), float(down[o + c]), float(down[r + c]) };
+        float out_value =
+            k[0]*p[0] + k[1]*p[1] + k[2]*p[2] +
+            k[3]*p[3] + k[4]*p[4] + k[5]*p[5] +
+            k[6]*p[6] + k[7]*p[7] + k[8]*p[8]
+            ;
+        if (out_value < 0) out_value = 0;
+        if (out_value > 255) out_value = 255;
+        dst[o + c] = static_cast<std::uint8_t>(out_value);
+    }
+    dst[o + 3] = mid[o + 3];
+}
+
+#ifdef MAPNIK_HAVE_X86_SIMD
+
+namespace sse41 {
+
+MAPNIK_TARGET_SSE41 inline __m128i load_pixel(void const* p)
+{
+    int v;
+    std::memcpy(&v, p, 4);
+    return _mm_cvtepu8_epi32(_mm_cvtsi32_si128(v));
+}
+
+// low byte of each 32 bit lane
+MAPNIK_TARGET_SSE41 inline int pack_pixel(__m128i v)
+{
+    return _mm_cvtsi128_si32(_mm_shuffle_epi8(v, _mm_setr_epi8(0, 4, 8, 12, -1, -1, -1, -1,
+                                                               -1, -1, -1, -1, -1, -1, -1, -1)));
+}
+
+// stack_blur_line with the four channels of a pixel in one register
+MAPNIK_TARGET_SSE41 void stack_blur_line(std::uint8_t * line, std::ptrdiff_t step, std::size_t len, unsigned radius,
+                                         unsigned mul_sum, unsigned shr_sum, std::uint32_t * stack)
+{
+    unsigned const div = radius * 2 + 1;
+    std::size_t const last = len - 1;
+    __m128i const mul = _mm_set1_epi32(static_cast<int>(mul_sum));
+    __m128i const shr = _mm_cvtsi32_si128(static_cast<int>(shr_sum));
+    __m128i sum = _mm_setzero_si128();
+    __m128i sum_in = _mm_setzero_si128();
+    __m128i sum_out = _mm_setzero_si128();
+    std::uint8_t const* src = line;
+    for (unsigned i = 0; i <= radius; ++i)
+    {
+        std::memcpy(&stack[i], src, 4);
+        __m128i p = load_pixel(src);
+        sum = _mm_add_epi32(sum, _mm_mullo_epi32(p, _mm_set1_epi32(static_cast<int>(i + 1))));
+        sum_out = _mm_add_epi32(sum_out, p);
+    }
+    for (unsigned i = 1; i <= radius; ++i)
+    {
+        if (i <= last) src += step;
+        std::memcpy(&stack[i + radius], src, 4);
+        __m128i p = load_pixel(src);
+        sum = _mm_add_epi32(sum, _mm_mullo_epi32(p, _mm_set1_epi32(static_cast<int>(radius + 1 - i))));
+        sum_in = _mm_add_epi32(sum_in, p);
+    }
+    unsigned stack_ptr = radius;
+    std::size_t xp = radius < last ? radius : last;
+    src = line + static_cast<std::ptrdiff_t>(xp) * step;
+    std::uint8_t * dst = line;
+    for (std::size_t x = 0; x < len; ++x)
+    {
+        int out = pack_pixel(_mm_srl_epi32(_mm_mullo_epi32(sum, mul), shr));
+        std::memcpy(dst, &out, 4);
+        dst += step;
+        sum = _mm_sub_epi32(sum, sum_out);
+        unsigned stack_start = stack_ptr + div - radius;
+        if (stack_start >= div) stack_start -= div;
+        sum_out = _mm_sub_epi32(sum_out, load_pixel(&stack[stack_start]));
+        if (xp < last)
+        {
+            src += step;
+            ++xp;
+        }
+        std::memcpy(&stack[stack_start], src, 4);
+        sum_in = _mm_add_epi32(sum_in, load_pixel(src));
+        sum = _mm_add_epi32(sum, sum_in);
+        if (++stack_ptr >= div) stack_ptr = 0;
+        __m128i p = load_pixel(&stack[stack_ptr]);
+        sum_out = _mm_add_epi32(sum_out, p);
+        sum_in = _mm_sub_epi32(sum_in, p);
+    }
+}
+
+MAPNIK_TARGET_SSE41 inline __m128 load_channels(std::uint8_t const* p)
+{
+    return _mm_cvtepi32_ps(load_pixel(p));
+}
+
+// interior pixels of a row from x = 1, returns the first pixel not done
+MAPNIK_TARGET_SSE41 std::size_t convolve_row(std::uint8_t const* up, std::uint8_t const* mid, std::uint8_t const* down,
+                                             std::uint8_t * dst, std::size_t width, float const* k)
+{
+    __m128 const zero = _mm_setzero_ps();
+    __m128 const max = _mm_set1_ps(255.0f);
+    std::size_t x = 1;
+    for (; x + 1 < width; ++x)
+    {
+        std::size_t const o = x * 4;
+        // same order of operations as the scalar sum
+        __m128 acc = _mm_mul_ps(_mm_set1_ps(k[0]), load_channels(up + o - 4));
+        acc = _mm_add_ps(acc, _mm_mul_ps(_mm_set1_ps(k[1]), load_channels(up + o)));
+        acc = _mm_add_ps(acc, _mm_mul_ps(_mm_set1_ps(k[2]), load_channels(up + o + 4)));
+        acc = _mm_add_ps(acc, _mm_mul_ps(_mm_set1_ps(k[3]), load_channels(mid + o - 4)));
+        acc = _mm_add_ps(acc, _mm_mul_ps(_mm_set1_ps(k[4]), load_channels(mid + o)));
+        acc = _mm_add_ps(acc, _mm_mul_ps(_mm_set1_ps(k[5]), load_channels(mid + o + 4)));
+        acc = _mm_add_ps(acc, _mm_mul_ps(_mm_set1_ps(k[6]), load_channels(down + o - 4)));
+        acc = _mm_add_ps(acc, _mm_mul_ps(_mm_set1_ps(k[7]), load_channels(down + o)));
+        acc = _mm_add_ps(acc, _mm_mul_ps(_mm_set1_ps(k[8]), load_channels(down + o + 4)));
+        int out = pack_pixel(_mm_cvttps_epi32(_mm_min_ps(_mm_max_ps(acc, zero), max)));
+        std::memcpy(dst + o, &out, 3);
+        dst[o + 3] = mid[o + 3];
+    }
+    return x;
+}
+
+} // namespace sse41
+
+namespace avx2 {
+
+// one pixel from each of two lines, channels in 32 bit lanes
+MAPNIK_TARGET_AVX2 inline __m256i load_pixels(void const* p0, void const* p1)
+{
+    int v0, v1;
+    std::memcpy(&v0, p0, 4);
+    std::memcpy(&v1, p1, 4);
+    return _mm256_cvtepu8_epi32(_mm_unpacklo_epi32(_mm_cvtsi32_si128(v0), _mm_cvtsi32_si128(v1)));
+}
+
+MAPNIK_TARGET_AVX2 inline __m256i load_pixels(void const* p)
+{
+    return _mm256_cvtepu8_epi32(_mm_loadl_epi64(reinterpret_cast<__m128i const*>(p)));
+}
+
+// low byte of each 32 bit lane, one pixel per 128 bit half
+MAPNIK_TARGET_AVX2 inline __m256i pack_pixels(__m256i v)
+{
+    return _mm256_shuffle_epi8(v, _mm256_setr_epi8(0, 4, 8, 12, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+                                                   0, 4, 8, 12, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1));
+}
+
+// stack_blur_line for two lines at once, one per 128 bit half; `stack`
+// holds pixel pairs
+MAPNIK_TARGET_AVX2 void stack_blur_lines2(std::uint8_t * line0, std::uint8_t * line1, std::ptrdiff_t step,
+                                          std::size_t len, unsigned radius,
+                                          unsigned mul_sum, unsigned shr_sum, std::uint32_t * stack)
+{
+    unsigned const div = radius * 2 + 1;
+    std::size_t const last = len - 1;
+    __m256i const mul = _mm256_set1_epi32(static_cast<int>(mul_sum));
+    __m128i const shr = _mm_cvtsi32_si128(static_cast<int>(shr_sum));
+    __m256i sum = _mm256_setzero_si256();
+    __m256i sum_in = _mm256_setzero_si256();
+    __m256i sum_out = _mm256_setzero_si256();
+    std::ptrdiff_t const offset = line1 - line0;
+    std::uint8_t const* src = line0;
+    for (unsigned i = 0; i <= radius; ++i)
+    {
+        std::memcpy(&stack[2 * i], src, 4);
+        std::memcpy(&stack[2 * i + 1], src + offset, 4);
+        __m256i p = load_pixels(&stack[2 * i]);
+        sum = _mm256_add_epi32(sum, _mm256_mullo_epi32(p, _mm256_set1_epi32(static_cast<int>(i + 1))));
+        sum_out = _mm256_add_epi32(sum_out, p);
+    }
+    for (unsigned i = 1; i <= radius; ++i)
+    {
+        if (i <= last) src += step;
+        std::memcpy(&stack[2 * (i + radius)], src, 4);
+        std::memcpy(&stack[2 * (i + radius) + 1], src + offset, 4);
+        __m256i p = load_pixels(&stack[2 * (i + radius)]);
+        sum = _mm256_add_epi32(sum, _mm256_mullo_epi32(p, _mm256_set1_epi32(static_cast<int>(radius + 1 - i))));
+        sum_in = _mm256_add_epi32(sum_in, p);
+    }
+    unsigned stack_ptr = radius;
+    std::size_t xp = radius < last ? radius : last;
+    src = line0 + static_cast<std::ptrdiff_t>(xp) * step;
+    std::uint8_t * dst = line0;
+    for (std::size_t x = 0; x < len; ++x)
+    {
+        __m256i out = pack_pixels(_mm256_srl_epi32(_mm256_mullo_epi32(sum, mul), shr));
+        int out0 = _mm_cvtsi128_si32(_mm256_castsi256_si128(out));
+        int out1 = _mm_cvtsi128_si32(_mm256_extracti128_si256(out, 1));
+        std::memcpy(dst, &out0, 4);
+        std::memcpy(dst + offset, &out1, 4);
+        dst += step;
+        sum = _mm256_sub_epi32(sum, sum_out);
+        unsigned stack_start = stack_ptr + div - radius;
+        if (stack_start >= div) stack_start -= div;
+        sum_out = _mm256_sub_epi32(sum_out, load_pixels(&stack[2 * stack_start]));
+        if (xp < last)
+        {
+            src += step;
+            ++xp;
+        }
+        std::memcpy(&stack[2 * stack_start], src, 4);
+        std::memcpy(&stack[2 * stack_start + 1], src + offset, 4);
+        sum_in = _mm256_add_epi32(sum_in, load_pixels(&stack[2 * stack_start]));
+        sum = _mm256_add_epi32(sum, sum_in);
+        if (++stack_ptr >= div) stack_ptr = 0;
+        __m256i p = load_pixels(&stack[2 * stack_ptr]);
+        sum_out = _mm256_add_epi32(sum_out, p);
+        sum_in = _mm256_sub_epi32(sum_in, p);
+    }
+}
+
+MAPNIK_TARGET_AVX2 inline __m256 load_channels(std::uint8_t const* p)
+{
+    return _mm256_cvtepi32_ps(load_pixels(p));
+}
+
+// two interior pixels per step
+MAPNIK_TARGET_AVX2 std::size_t convolve_row(std::uint8_t const* up, std::uint8_t const* mid, std::uint8_t const* down,
+                                            std::uint8_t * dst, std::size_t width, float const* k)
+{
+    __m256 const zero = _mm256_setzero_ps();
+    __m256 const max = _mm256_set1_ps(255.0f);
+    std::size_t x = 1;
+    for (; x + 2 < width; x += 2)
+    {
+        std::size_t const o = x * 4;
+        __m256 acc = _mm256_mul_ps(_mm256_set1_ps(k[0]), load_channels(up + o - 4));
+        acc = _mm256_add_ps(acc, _mm256_mul_ps(_mm256_set1_ps(k[1]), load_channels(up + o)));
+        acc = _mm256_add_ps(acc, _mm256_mul_ps(_mm256_set1_ps(k[2]), load_channels(up + o + 4)));
+        acc = _mm256_add_ps(acc, _mm256_mul_ps(_mm256_set1_ps(k[3]), load_channels(mid + o - 4)));
+        acc = _mm256_add_ps(acc, _mm256_mul_ps(_mm256_set1_ps(k[4]), load_channels(mid + o)));
+        acc = _mm256_add_ps(acc, _mm256_mul_ps(_mm256_set1_ps(k[5]), load_channels(mid + o + 4)));
+        acc = _mm256_add_ps(acc, _mm256_mul_ps(_mm256_set1_ps(k[6]), load_channels(down + o - 4)));
+        acc = _mm256_add_ps(acc, _mm256_mul_ps(_mm256_set1_ps(k[7]), load_channels(down + o)));
+        acc = _mm256_add_ps(acc, _mm256_mul_ps(_mm256_set1_ps(k[8]), load_channels(down + o + 4)));
+        __m256i out = pack_pixels(_mm256_cvttps_epi32(_mm256_min_ps(_mm256_max_ps(acc, zero), max)));
+        std::uint32_t pixels[2] = { static_cast<std::uint32_t>(_mm_cvtsi128_si32(_mm256_castsi256_si128(out))),
+                                    static_cast<std::uint32_t>(_mm_cvtsi128_si32(_mm256_extracti128_si256(out, 1))) };
+        std::memcpy(dst + o, &pixels[0], 3);
+        std::memcpy(dst + o + 4, &pixels[1], 3);
+        dst[o + 3] = mid[o + 3];
+        dst[o + 7] = mid[o + 7];
+    }
+    return x;
+}
+
+} // namespace avx2
+
+#endif // MAPNIK_HAVE_X86_SIMD
+
+} // anonymous namespace
+
+void stack_blur(std::uint8_t * first, std::ptrdiff_t line_step, std::ptrdiff_t pixel_step,
+                std::size_t lines, std::size_t len, unsigned radius)
+{
+    if (radius == 0 || len == 0) return;
+    if (radius > 254) radius = 254;
+    unsigned const mul_sum = agg::stack_blur_tables<int>::g_stack_blur8_mul[radius];
+    unsigned const shr_sum = agg::stack_blur_tables<int>::g_stack_blur8_shr[radius];
+    std::vector<std::uint32_t> stack(2 * (radius * 2 + 1));
+    std::size_t j = 0;
+#ifdef MAPNIK_HAVE_X86_SIMD
+    switch (util::active_simd_level())
+    {
+    case util::simd_level::avx2:
+        for (; j + 2 <= lines; j += 2)
+        {
+            std::uint8_t * line = first + static_cast<std::ptrdiff_t>(j) * line_step;
+            avx2::stack_blur_lines2(line, line + line_step, pixel_step, len, radius, mul_sum, shr_sum, stack.data());
+        }
+        // fall through
+    case util::simd_level::sse41:
+        for (; j < lines; ++j)
+        {
+            sse41::stack_blur_line(first + static_cast<std::ptrdiff_t>(j) * line_step, pixel_step, len, radius,
+                                   mul_sum, shr_sum, stack.data());
+        }
+        break;
+    default:
+        break;
+    }
+#endif
+    for (; j < lines; ++j)
+    {
+        stack_blur_line(first + static_cast<std::ptrdiff_t>(j) * line_step, pixel_step, len, radius,
+                        mul_sum, shr_sum, stack.data());
+    }
+}
+
+void convolve_3x3(std::uint8_t const* src, std::uint8_t * dst,
+                  std::size_t width, std::size_t height,
+                  std::size_t y0, std::size_t y1, float const* matrix)
+{
+    if (width == 0) return;
+    std::size_t const row_size = width * 4;
+    for (std::size_t y = y0; y < y1; ++y)
+    {
+        std::uint8_t const* mid = src + y * row_size;
+        std::uint8_t const* prev = y > 0 ? mid - row_size : nullptr;
+        std::uint8_t const* next = y + 1 < height ? mid + row_size : nullptr;
+        std::uint8_t const* up = prev ? prev : (next ? next : mid);
+        std::uint8_t const* down = next ? next : (prev ? prev : mid);
+        std::uint8_t * out = dst + y * row_size;
+        convolve_pixel(up, mid, down, out, 0, width, matrix);
+        std::size_t x = 1;
+#ifdef MAPNIK_HAVE_X86_SIMD
+        switch (util::active_simd_level())
+        {
+        case util::simd_level::avx2:
+            x = avx2::convolve_row(up, mid, down, out, width, matrix);
+            break;
+        case util::simd_level::sse41:
+            x = sse41::convolve_row(up, mid, down, out, width, matrix);
+            break;
+        default:
+            break;
+        }
+#endif
+        for (; x < width; ++x)
+        {
+            convolve_pixel(up, mid, down, out, x, width, matrix);
+        }
+    }
+}
+
+#undef MAPNIK_VECTORIZED
+
+}}
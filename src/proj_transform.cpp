@@ -141,11 +141,11 @@ bool proj_transform::forward (double * x, double * y , double * z, int point_cou
 
     if (wgs84_to_merc_)
     {
-        return lonlat2merc(x,y,point_count);
+        return lonlat2merc(x, y, point_count, offset);
     }
     else if (merc_to_wgs84_)
     {
-        return merc2lonlat(x,y,point_count);
+        return merc2lonlat(x, y, point_count, offset);
     }
 
 #ifdef MAPNIK_USE_PROJ4
@@ -165,7 +165,7 @@ bool proj_transform::forward (double * x, double * y , double * z, int point_cou
     }
 
     for(int j=0; j<point_count; j++) {
-        if (x[j] == HUGE_VAL || y[j] == HUGE_VAL)
+        if (x[j*offset] == HUGE_VAL || y[j*offset] == HUGE_VAL)
         {
             return false;
         }
@@ -190,11 +190,11 @@ bool proj_transform::backward (double * x, double * y , double * z, int point_co
 
     if (wgs84_to_merc_)
     {
-        return merc2lonlat(x,y,point_count);
+        return merc2lonlat(x, y, point_count, offset);
     }
     else if (merc_to_wgs84_)
     {
-        return lonlat2merc(x,y,point_count);
+        return lonlat2merc(x, y, point_count, offset);
     }
 
 #ifdef MAPNIK_USE_PROJ4
@@ -215,7 +215,7 @@ bool proj_transform::backward (double * x, double * y , double * z, int point_co
 
     for (int j = 0; j < point_count; ++j)
     {
-        if (x[j] == HUGE_VAL || y[j] == HUGE_VAL)
+        if (x[j * offset] == HUGE_VAL || y[j * offset] == HUGE_VAL)
         {
             return false;
         }
@@ -279,32 +279,24 @@ bool proj_transform::forward (box2d<double> & box) const
     if (is_source_equal_dest_)
         return true;
 
-    double llx = box.minx();
-    double ulx = box.minx();
-    double lly = box.miny();
-    double lry = box.miny();
-    double lrx = box.maxx();
-    double urx = box.maxx();
-    double uly = box.maxy();
-    double ury = box.maxy();
-    double z = 0.0;
-    if (!forward(llx,lly,z))
-        return false;
-    if (!forward(lrx,lry,z))
-        return false;
-    if (!forward(ulx,uly,z))
-        return false;
-    if (!forward(urx,ury,z))
+    double x[4], y[4];
+    x[0] = box.minx(); // llx 0
+    y[0] = box.miny(); // lly 1
+    x[1] = box.maxx(); // lrx 2
+    y[1] = box.miny(); // lry 3
+    x[2] = box.minx(); // ulx 4
+    y[2] = box.maxy(); // uly 5
+    x[3] = box.maxx(); // urx 6
+    y[3] = box.maxy(); // ury 7
+
+    if (!forward(x, y, nullptr, 4, 1))
         return false;
 
-    double minx = std::min(ulx, llx);
-    double miny = std::min(lly, lry);
-    double maxx = std::max(urx, lrx);
-    double maxy = std::max(ury, uly);
-    box.init(minx,
-             miny,
-             maxx,
-             maxy);
+    double minx = std::min(x[0], x[2]);
+    double miny = std::min(y[0], y[1]);
+    double maxx = std::max(x[1], x[3]);
+    double maxy = std::max(y[2], y[3]);
+    box.init(minx, miny, maxx, maxy);
     return true;
 }
 
@@ -396,12 +388,11 @@ bool proj_transform::backward(box2d<double>& env, int points) const
     std::vector<coord<double,2> > coords;
     envelope_points(coords, env, points);  // this is always clockwise
 
-    double z;
-    for (std::vector<coord<double,2> >::iterator it = coords.begin(); it!=coords.end(); ++it) {
-        z = 0;
-        if (!backward(it->x, it->y, z)) {
-            return false;
-        }
+    // all envelope points in one call, x and y interleaved
+    static_assert(sizeof(coord<double,2>) == 2 * sizeof(double), "coord<double,2> must be two packed doubles");
+    if (!backward(&coords[0].x, &coords[0].y, nullptr, static_cast<int>(coords.size()), 2))
+    {
+        return false;
     }
 
     box2d<double> result = calculate_bbox(coords);
@@ -435,12 +426,11 @@ bool proj_transform::forward(box2d<double>& env, int points) const
     std::vector<coord<double,2> > coords;
     envelope_points(coords, env, points);  // this is always clockwise
 
-    double z;
-    for (std::vector<coord<double,2> >::iterator it = coords.begin(); it!=coords.end(); ++it) {
-        z = 0;
-        if (!forward(it->x, it->y, z)) {
-            return false;
-        }
+    // all envelope points in one call, x and y interleaved
+    static_assert(sizeof(coord<double,2>) == 2 * sizeof(double), "coord<double,2> must be two packed doubles");
+    if (!forward(&coords[0].x, &coords[0].y, nullptr, static_cast<int>(coords.size()), 2))
+    {
+        return false;
     }
 
     box2d<double> result = calculate_bbox(coords);
@@ -0,0 +1,135 @@
+/*****************************************************************************
+ *
+ * This file is part of Mapnik (c++ mapping toolkit)
+ *
+ * Copyright (C) 2017 Artem Pavlenko
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ *****************************************************************************/
+
+// mapnik
+#include <mapnik/proj_transform_cache.hpp>
+#include <mapnik/projection.hpp>
+
+// stl
+#include <chrono>
+#include <unordered_map>
+
+namespace mapnik
+{
+
+template class singleton<proj_transform_cache, CreateStatic>;
+
+namespace {
+
+// the projections are owned by the entry, proj_transform only refers to them
+struct cached_transform
+{
+    cached_transform(std::string const& source, std::string const& dest)
+        : source_proj(source, true),
+          dest_proj(dest, true),
+          trans(source_proj, dest_proj) {}
+
+    projection source_proj;
+    projection dest_proj;
+    proj_transform trans;
+};
+
+// a thread's entries, dropped when they grow past max_entries, which
+// only happens with many distinct srs strings
+struct thread_cache
+{
+    static constexpr std::size_t max_entries = 256;
+
+    std::unordered_map<std::string, std::shared_ptr<cached_transform>> entries;
+    std::string key;
+    std::size_t generation = 0;
+};
+
+thread_cache & local_cache()
+{
+    static thread_local thread_cache cache;
+    return cache;
+}
+
+std::uint64_t elapsed_ns(std::chrono::steady_clock::time_point start)
+{
+    return static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                                          std::chrono::steady_clock::now() - start).count());
+}
+
+}
+
+proj_transform_cache::proj_transform_cache()
+    : generation_(0),
+      lookups_(0),
+      inits_(0),
+      lookup_ns_(0),
+      init_ns_(0) {}
+
+proj_transform_cache::transform_ptr proj_transform_cache::get(std::string const& source,
+                                                              std::string const& dest)
+{
+    auto start = std::chrono::steady_clock::now();
+    thread_cache & cache = local_cache();
+    std::size_t generation = generation_.load(std::memory_order_relaxed);
+    if (cache.generation != generation || cache.entries.size() >= thread_cache::max_entries)
+    {
+        cache.entries.clear();
+        cache.generation = generation;
+    }
+    // srs strings don't contain nul characters
+    cache.key.assign(source);
+    cache.key.push_back('\0');
+    cache.key.append(dest);
+    std::shared_ptr<cached_transform> & entry = cache.entries[cache.key];
+    if (!entry)
+    {
+        auto init_start = std::chrono::steady_clock::now();
+        try
+        {
+            entry = std::make_shared<cached_transform>(source, dest);
+        }
+        catch (...)
+        {
+            cache.entries.erase(cache.key);
+            throw;
+        }
+        ++inits_;
+        init_ns_ += elapsed_ns(init_start);
+    }
+    ++lookups_;
+    transform_ptr result(entry, &entry->trans);
+    lookup_ns_ += elapsed_ns(start);
+    return result;
+}
+
+void proj_transform_cache::clear()
+{
+    ++generation_;
+}
+
+proj_transform_cache_stats proj_transform_cache::stats() const
+{
+    proj_transform_cache_stats result;
+    result.lookups = lookups_;
+    result.inits = inits_;
+    result.lookup_time = lookup_ns_ / 1e6;
+    result.init_time = init_ns_ / 1e6;
+    return result;
+}
+
+}
@@ -0,0 +1,172 @@
+/*****************************************************************************
+ *
+ * This file is part of Mapnik (c++ mapping toolkit)
+ *
+ * Copyright (C) 2017 Artem Pavlenko
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ *****************************************************************************/
+
+// mapnik
+#include <mapnik/render_plan.hpp>
+#include <mapnik/map.hpp>
+#include <mapnik/layer.hpp>
+#include <mapnik/feature_type_style.hpp>
+#include <mapnik/rule.hpp>
+#include <mapnik/attribute_collector.hpp>
+#include <mapnik/debug.hpp>
+
+// stl
+#include <algorithm>
+
+namespace mapnik
+{
+
+namespace {
+
+// rule::active(scale) is true for min_scale - 1e-6 <= scale < max_scale + 1e-6,
+// so every rule is either active or not between two consecutive thresholds
+std::vector<double> scale_thresholds(Map const& m, std::vector<std::string> const& style_names)
+{
+    std::vector<double> thresholds;
+    for (std::string const& style_name : style_names)
+    {
+        boost::optional<feature_type_style const&> style = m.find_style(style_name);
+        if (!style) continue;
+        for (rule const& r : style->get_rules())
+        {
+            thresholds.push_back(r.get_min_scale() - 1e-6);
+            thresholds.push_back(r.get_max_scale() + 1e-6);
+        }
+    }
+    std::sort(thresholds.begin(), thresholds.end());
+    thresholds.erase(std::unique(thresholds.begin(), thresholds.end()), thresholds.end());
+    return thresholds;
+}
+
+std::size_t scale_interval(std::vector<double> const& thresholds, double scale_denom)
+{
+    return std::upper_bound(thresholds.begin(), thresholds.end(), scale_denom) - thresholds.begin();
+}
+
+}
+
+render_plan_cache::render_plan_cache(Map const& m, std::size_t max_plans)
+    : map_(m),
+      max_plans_(max_plans),
+      size_(0),
+      entries_() {}
+
+layer_plan_ptr render_plan_cache::get(layer const& lay, double scale_denom)
+{
+    std::vector<std::string> const& style_names = lay.styles();
+    {
+#ifdef MAPNIK_THREADSAFE
+        std::lock_guard<std::mutex> lock(mutex_);
+#endif
+        auto itr = entries_.find(style_names);
+        if (itr != entries_.end())
+        {
+            styles_entry const& entry = itr->second;
+            auto plan = entry.plans.find(scale_interval(entry.thresholds, scale_denom));
+            if (plan != entry.plans.end())
+            {
+                return plan->second;
+            }
+        }
+    }
+    std::vector<double> thresholds = scale_thresholds(map_, style_names);
+    std::size_t interval = scale_interval(thresholds, scale_denom);
+    layer_plan_ptr plan = make_plan(map_, lay, scale_denom);
+#ifdef MAPNIK_THREADSAFE
+    std::lock_guard<std::mutex> lock(mutex_);
+#endif
+    if (size_ >= max_plans_)
+    {
+        entries_.clear();
+        size_ = 0;
+    }
+    styles_entry & entry = entries_[style_names];
+    entry.thresholds = std::move(thresholds);
+    auto result = entry.plans.emplace(interval, plan);
+    if (result.second) ++size_;
+    return result.first->second;
+}
+
+std::size_t render_plan_cache::size() const
+{
+#ifdef MAPNIK_THREADSAFE
+    std::lock_guard<std::mutex> lock(mutex_);
+#endif
+    return size_;
+}
+
+void render_plan_cache::clear()
+{
+#ifdef MAPNIK_THREADSAFE
+    std::lock_guard<std::mutex> lock(mutex_);
+#endif
+    entries_.clear();
+    size_ = 0;
+}
+
+layer_plan_ptr render_plan_cache::make_plan(Map const& m, layer const& lay, double scale_denom)
+{
+    std::shared_ptr<layer_plan> plan = std::make_shared<layer_plan>();
+    attribute_collector collector(plan->names);
+
+    // iterate through all named styles collecting active styles and attribute names
+    for (std::string const& style_name : lay.styles())
+    {
+        boost::optional<feature_type_style const&> style = m.find_style(style_name);
+        if (!style)
+        {
+            MAPNIK_LOG_ERROR(feature_style_processor)
+                << "feature_style_processor: Style=" << style_name
+                << " required for layer=" << lay.name() << " does not exist.";
+
+            continue;
+        }
+
+        // styles needing compositing operations applied even if the layer is not rendered
+        // https://github.com/mapnik/mapnik/issues/1477
+        if ((style->comp_op() || style->image_filters().size() > 0) && style->active(scale_denom))
+        {
+            plan->composite_styles.push_back(&(*style));
+        }
+
+        bool active_rules = false;
+        rule_cache rc;
+        for (rule const& r : style->get_rules())
+        {
+            if (r.active(scale_denom))
+            {
+                rc.add_rule(r);
+                active_rules = true;
+                collector(r);
+            }
+        }
+        if (active_rules)
+        {
+            plan->rule_caches.push_back(std::move(rc));
+            plan->active_styles.push_back(&(*style));
+        }
+    }
+    plan->filter_factor = collector.get_filter_factor();
+    return plan;
+}
+
+}
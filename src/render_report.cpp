@@ -0,0 +1,180 @@
+/*****************************************************************************
+ *
+ * This file is part of Mapnik (c++ mapping toolkit)
+ *
+ * Copyright (C) 2017 Artem Pavlenko
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ *****************************************************************************/
+
+// mapnik
+#include <mapnik/render_report.hpp>
+
+// stl
+#include <iomanip>
+#include <sstream>
+
+namespace mapnik
+{
+
+namespace {
+
+struct geometry_vertices
+{
+    std::size_t operator() (geometry::geometry_empty const&) const
+    {
+        return 0;
+    }
+
+    template <typename T>
+    std::size_t operator() (geometry::point<T> const&) const
+    {
+        return 1;
+    }
+
+    template <typename T>
+    std::size_t operator() (std::vector<geometry::point<T>> const& points) const
+    {
+        return points.size();
+    }
+
+    template <typename T>
+    std::size_t operator() (std::vector<T> const& container) const
+    {
+        std::size_t count = 0;
+        for (auto const& item : container)
+        {
+            count += (*this)(item);
+        }
+        return count;
+    }
+
+    template <typename T>
+    std::size_t operator() (geometry::geometry<T> const& geom) const
+    {
+        return util::apply_visitor(*this, geom);
+    }
+};
+
+template <typename Report>
+Report & find_or_create(std::vector<Report> & reports, std::string const& name)
+{
+    for (Report & r : reports)
+    {
+        if (r.name == name) return r;
+    }
+    reports.emplace_back();
+    reports.back().name = name;
+    return reports.back();
+}
+
+void print(std::ostream & out, std::string const& label, render_stats const& stats)
+{
+    out << label << ": " << std::fixed << std::setprecision(3) << stats.time << "ms"
+        << " calls=" << stats.calls;
+    if (stats.features > 0) out << " features=" << stats.features;
+    if (stats.vertices > 0) out << " vertices=" << stats.vertices;
+    out << "\n";
+}
+
+}
+
+void render_stats::add(render_stats const& rhs)
+{
+    time += rhs.time;
+    calls += rhs.calls;
+    features += rhs.features;
+    vertices += rhs.vertices;
+}
+
+style_report & layer_report::style(std::string const& name)
+{
+    return find_or_create(styles, name);
+}
+
+layer_report & render_report::layer(std::string const& name)
+{
+    return find_or_create(layers, name);
+}
+
+std::map<std::string, render_stats> render_report::symbolizer_totals() const
+{
+    std::map<std::string, render_stats> totals;
+    for (layer_report const& lr : layers)
+    {
+        for (style_report const& sr : lr.styles)
+        {
+            for (rule_report const& rr : sr.rules)
+            {
+                for (symbolizer_report const& sym : rr.symbolizers)
+                {
+                    totals[sym.type].add(sym.stats);
+                }
+            }
+        }
+    }
+    return totals;
+}
+
+void render_report::clear()
+{
+    layers.clear();
+    total = render_stats();
+    geometry = render_stats();
+    rasterize = render_stats();
+    labeling = render_stats();
+}
+
+std::string render_report::to_string() const
+{
+    std::ostringstream out;
+    print(out, "map", total);
+    for (layer_report const& lr : layers)
+    {
+        print(out, "  layer '" + lr.name + "'", lr.total);
+        print(out, "    query", lr.query);
+        for (style_report const& sr : lr.styles)
+        {
+            print(out, "    style '" + sr.name + "'", sr.total);
+            print(out, "      query", sr.query);
+            print(out, "      composite", sr.composite);
+            for (rule_report const& rr : sr.rules)
+            {
+                print(out, "      rule '" + rr.name + "'", rr.render);
+                print(out, "        filter (matches=" + std::to_string(rr.matches) + ")", rr.filter);
+                for (symbolizer_report const& sym : rr.symbolizers)
+                {
+                    print(out, "        " + sym.type, sym.stats);
+                }
+            }
+        }
+    }
+    for (auto const& kv : symbolizer_totals())
+    {
+        print(out, "  " + kv.first, kv.second);
+    }
+    if (geometry.calls > 0) print(out, "  geometry", geometry);
+    if (rasterize.calls > 0) print(out, "  rasterize", rasterize);
+    if (labeling.calls > 0) print(out, "  labeling", labeling);
+    return out.str();
+}
+
+std::size_t vertex_count(geometry::geometry<double> const& geom)
+{
+    return geometry_vertices()(geom);
+}
+
+}
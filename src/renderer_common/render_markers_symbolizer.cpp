@@ -172,7 +172,8 @@ struct render_marker_symbolizer_visitor
                                                  feature_,
                                                  common_.vars_,
                                                  snap_to_pixels,
-                                                 renderer_context_);
+                                                 renderer_context_,
+                                                 is_ellipse ? std::string() : filename_);
 
         render_marker(mark, rasterizer_dispatch);
     }
@@ -0,0 +1,106 @@
+/*****************************************************************************
+ *
+ * This file is part of Mapnik (c++ mapping toolkit)
+ *
+ * Copyright (C) 2017 Artem Pavlenko
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ *****************************************************************************/
+
+// mapnik
+#include <mapnik/text/glyph_bitmap_cache.hpp>
+
+// stl
+#include <algorithm>
+#include <functional>
+
+namespace mapnik
+{
+
+namespace {
+
+template <typename T>
+inline void hash_combine(std::size_t & seed, T const& value)
+{
+    seed ^= std::hash<T>()(value) + 0x9e3779b9 + (seed << 6) + (seed >> 2);
+}
+
+}
+
+bool glyph_bitmap_key::operator==(glyph_bitmap_key const& rhs) const
+{
+    return face == rhs.face &&
+        size == rhs.size &&
+        glyph_index == rhs.glyph_index &&
+        std::equal(rotation, rotation + 4, rhs.rotation) &&
+        std::equal(transform, transform + 4, rhs.transform) &&
+        stroke == rhs.stroke &&
+        subpixel_x == rhs.subpixel_x &&
+        subpixel_y == rhs.subpixel_y;
+}
+
+std::size_t glyph_bitmap_key_hash::operator()(glyph_bitmap_key const& key) const
+{
+    std::size_t seed = std::hash<void const*>()(key.face);
+    hash_combine(seed, key.size);
+    hash_combine(seed, key.glyph_index);
+    for (std::int64_t value : key.rotation) hash_combine(seed, value);
+    for (std::int64_t value : key.transform) hash_combine(seed, value);
+    hash_combine(seed, key.stroke);
+    hash_combine(seed, key.subpixel_x);
+    hash_combine(seed, key.subpixel_y);
+    return seed;
+}
+
+glyph_bitmap_cache::glyph_bitmap_cache(std::size_t max_bytes, unsigned subpixel_steps)
+    : subpixel_steps_(std::min(std::max(subpixel_steps, 1u), 64u)),
+      cache_(max_bytes) {}
+
+void glyph_bitmap_cache::set_max_bytes(std::size_t max_bytes)
+{
+    cache_.set_max_bytes(max_bytes);
+}
+
+std::size_t glyph_bitmap_cache::max_bytes() const
+{
+    return cache_.max_bytes();
+}
+
+glyph_bitmap_ptr glyph_bitmap_cache::find(glyph_bitmap_key const& key)
+{
+    // entries whose face is gone and its address reused are stale
+    boost::optional<entry> result = cache_.find(key, [&key](entry const& e)
+                                                 { return e.face.lock().get() == key.face; });
+    return result ? result->bitmap : glyph_bitmap_ptr();
+}
+
+void glyph_bitmap_cache::insert(glyph_bitmap_key const& key, glyph_bitmap_ptr const& bitmap,
+                                std::shared_ptr<void const> const& face)
+{
+    cache_.insert(key, entry{bitmap, face}, sizeof(glyph_bitmap) + bitmap->coverage.size());
+}
+
+void glyph_bitmap_cache::clear()
+{
+    cache_.clear();
+}
+
+glyph_bitmap_cache_stats glyph_bitmap_cache::stats() const
+{
+    return cache_.stats();
+}
+
+}
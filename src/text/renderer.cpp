@@ -47,6 +47,12 @@
 #include "agg_renderer_scanline.h"
 #pragma GCC diagnostic pop
 
+// stl
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+
 namespace mapnik
 {
 
@@ -134,16 +140,17 @@ void text_renderer::prepare_glyphs(glyph_positions const& positions)
 }
 
 template <typename T>
-void composite_bitmap(T & pixmap, FT_Bitmap *bitmap, unsigned rgba, int x, int y, double opacity, composite_mode_e comp_op)
+void composite_coverage(T & pixmap, unsigned char const* buffer, unsigned width, unsigned rows,
+                        unsigned rgba, int x, int y, double opacity, composite_mode_e comp_op)
 {
-    int x_max = x + bitmap->width;
-    int y_max = y + bitmap->rows;
+    int x_max = x + width;
+    int y_max = y + rows;
 
     for (int i = x, p = 0; i < x_max; ++i, ++p)
     {
         for (int j = y, q = 0; j < y_max; ++j, ++q)
         {
-            unsigned gray = bitmap->buffer[q * bitmap->width + p];
+            unsigned gray = buffer[q * width + p];
             if (gray)
             {
                 mapnik::composite_pixel(pixmap, comp_op, i, j, rgba, gray, opacity);
@@ -152,6 +159,21 @@ void composite_bitmap(T & pixmap, FT_Bitmap *bitmap, unsigned rgba, int x, int y
     }
 }
 
+template <typename T>
+void composite_bitmap(T & pixmap, FT_Bitmap *bitmap, unsigned rgba, int x, int y, double opacity, composite_mode_e comp_op)
+{
+    composite_coverage(pixmap, bitmap->buffer, bitmap->width, bitmap->rows, rgba, x, y, opacity, comp_op);
+}
+
+namespace {
+
+inline std::int64_t floor_div(std::int64_t a, std::int64_t b)
+{
+    return a >= 0 ? a / b : -((b - 1 - a) / b);
+}
+
+}
+
 template <typename T>
 agg_text_renderer<T>::agg_text_renderer (pixmap_type & pixmap,
                                          halo_rasterizer_e rasterizer,
@@ -159,12 +181,22 @@ agg_text_renderer<T>::agg_text_renderer (pixmap_type & pixmap,
                                          composite_mode_e halo_comp_op,
                                          double scale_factor,
                                          stroker_ptr stroker)
-    : text_renderer(rasterizer, comp_op, halo_comp_op, scale_factor, stroker), pixmap_(pixmap)
+    : text_renderer(rasterizer, comp_op, halo_comp_op, scale_factor, stroker),
+      pixmap_(pixmap),
+      glyph_cache_(nullptr),
+      drawn_()
 {}
 
 template <typename T>
 void agg_text_renderer<T>::render(glyph_positions const& pos)
 {
+    if (glyph_cache_ != nullptr &&
+        std::none_of(pos.begin(), pos.end(), [](glyph_position const& glyph_pos)
+                     { return glyph_pos.glyph.face->is_color(); }))
+    {
+        render_cached(pos);
+        return;
+    }
     prepare_glyphs(pos);
     FT_Error  error;
     FT_Vector start;
@@ -222,6 +254,7 @@ void agg_text_renderer<T>::render(glyph_positions const& pos)
                     FT_BitmapGlyph bit = reinterpret_cast<FT_BitmapGlyph>(g);
                     if (bit->bitmap.pixel_mode != FT_PIXEL_MODE_BGRA)
                     {
+                        add_drawn(bit->left, height - bit->top, bit->bitmap.width, bit->bitmap.rows);
                         composite_bitmap(pixmap_,
                                          &bit->bitmap,
                                          halo_fill,
@@ -300,6 +333,21 @@ void agg_text_renderer<T>::render(glyph_positions const& pos)
                                     x, y,
                                     -glyph.rot.angle(),
                                     glyph.bbox));
+                double p[8] = { 0, 0,
+                                double(bit->bitmap.width), 0,
+                                double(bit->bitmap.width), double(bit->bitmap.rows),
+                                0, double(bit->bitmap.rows) };
+                box2d<double> glyph_box;
+                for (int i = 0; i < 8; i += 2)
+                {
+                    transform.transform(&p[i], &p[i + 1]);
+                    glyph_box.expand_to_include(p[i], p[i + 1]);
+                }
+                // one more pixel for resampling and rounding
+                add_drawn(static_cast<int>(std::floor(glyph_box.minx())) - 1,
+                          static_cast<int>(std::floor(glyph_box.miny())) - 1,
+                          static_cast<int>(std::ceil(glyph_box.width())) + 3,
+                          static_cast<int>(std::ceil(glyph_box.height())) + 3);
                 composite_color_glyph(pixmap_,
                                       bit->bitmap,
                                       transform,
@@ -308,6 +356,7 @@ void agg_text_renderer<T>::render(glyph_positions const& pos)
             }
             else
             {
+                add_drawn(bit->left, height - bit->top, bit->bitmap.width, bit->bitmap.rows);
                 composite_bitmap(pixmap_,
                                  &bit->bitmap,
                                  fill,
@@ -322,6 +371,188 @@ void agg_text_renderer<T>::render(glyph_positions const& pos)
 
 }
 
+template <typename T>
+void agg_text_renderer<T>::render_cached(glyph_positions const& pos)
+{
+    FT_Vector start;
+    FT_Vector start_halo;
+    int height = pixmap_.height();
+    pixel_position const& base_point = pos.get_base_point();
+
+    start.x =  static_cast<FT_Pos>(base_point.x * (1 << 6));
+    start.y =  static_cast<FT_Pos>((height - base_point.y) * (1 << 6));
+    start_halo = start;
+    start.x += transform_.tx * 64;
+    start.y += transform_.ty * 64;
+    start_halo.x += halo_transform_.tx * 64;
+    start_halo.y += halo_transform_.ty * 64;
+
+    FT_Matrix halo_matrix;
+    halo_matrix.xx = halo_transform_.sx  * 0x10000L;
+    halo_matrix.xy = halo_transform_.shx * 0x10000L;
+    halo_matrix.yy = halo_transform_.sy  * 0x10000L;
+    halo_matrix.yx = halo_transform_.shy * 0x10000L;
+
+    FT_Matrix matrix;
+    matrix.xx = transform_.sx  * 0x10000L;
+    matrix.xy = transform_.shx * 0x10000L;
+    matrix.yy = transform_.sy  * 0x10000L;
+    matrix.yx = transform_.shy * 0x10000L;
+
+    int x = 0;
+    int y = 0;
+    for (auto const& glyph_pos : pos)
+    {
+        detail::evaluated_format_properties const& format = *glyph_pos.glyph.format;
+        double halo_radius = format.halo_radius * scale_factor_;
+        // make sure we've got reasonable values.
+        if (halo_radius <= 0.0 || halo_radius > 1024.0) continue;
+        bool stroked = (rasterizer_ == HALO_RASTERIZER_FULL);
+        glyph_bitmap_ptr bitmap = cached_glyph(glyph_pos, halo_matrix, start_halo,
+                                               stroked ? halo_radius : 0.0, x, y);
+        if (!bitmap) continue;
+        if (stroked)
+        {
+            add_drawn(x, y, bitmap->width, bitmap->rows);
+            composite_coverage(pixmap_,
+                               bitmap->coverage.data(),
+                               bitmap->width,
+                               bitmap->rows,
+                               format.halo_fill.rgba(),
+                               x, y,
+                               format.halo_opacity,
+                               halo_comp_op_);
+        }
+        else
+        {
+            render_halo<1>(bitmap->coverage.data(),
+                           bitmap->width,
+                           bitmap->rows,
+                           format.halo_fill.rgba(),
+                           x, y,
+                           halo_radius,
+                           format.halo_opacity,
+                           halo_comp_op_);
+        }
+    }
+
+    // render actual text
+    for (auto const& glyph_pos : pos)
+    {
+        detail::evaluated_format_properties const& format = *glyph_pos.glyph.format;
+        glyph_bitmap_ptr bitmap = cached_glyph(glyph_pos, matrix, start, 0.0, x, y);
+        if (!bitmap) continue;
+        add_drawn(x, y, bitmap->width, bitmap->rows);
+        composite_coverage(pixmap_,
+                           bitmap->coverage.data(),
+                           bitmap->width,
+                           bitmap->rows,
+                           format.fill.rgba(),
+                           x, y,
+                           format.text_opacity,
+                           comp_op_);
+    }
+}
+
+// Looks up, or renders and caches, the coverage of a glyph loaded like
+// prepare_glyphs() does and transformed like render() does, and returns
+// where its top left corner goes in the pixmap. Only the position of the
+// glyph origin within its pixel, snapped to the cache's subpixel steps,
+// goes into the bitmap; the integer part is added when compositing.
+template <typename T>
+glyph_bitmap_ptr agg_text_renderer<T>::cached_glyph(glyph_position const& glyph_pos,
+                                                    FT_Matrix const& matrix,
+                                                    FT_Vector const& start,
+                                                    double stroke,
+                                                    int & x, int & y)
+{
+    glyph_info const& glyph = glyph_pos.glyph;
+    double size = glyph.format->text_size * scale_factor_;
+
+    FT_Matrix rotation;
+    rotation.xx = static_cast<FT_Fixed>( glyph_pos.rot.cos * 0x10000L);
+    rotation.xy = static_cast<FT_Fixed>(-glyph_pos.rot.sin * 0x10000L);
+    rotation.yx = static_cast<FT_Fixed>( glyph_pos.rot.sin * 0x10000L);
+    rotation.yy = static_cast<FT_Fixed>( glyph_pos.rot.cos * 0x10000L);
+
+    pixel_position pen = glyph_pos.pos + glyph.offset.rotate(glyph_pos.rot);
+    FT_Vector origin;
+    origin.x = static_cast<FT_Pos>(pen.x * 64);
+    origin.y = static_cast<FT_Pos>(pen.y * 64);
+    FT_Vector_Transform(&origin, &matrix);
+    origin.x += start.x;
+    origin.y += start.y;
+
+    std::int64_t steps = glyph_cache_->subpixel_steps();
+    std::int64_t qx = floor_div(origin.x * steps + 32, 64);
+    std::int64_t qy = floor_div(origin.y * steps + 32, 64);
+    std::int64_t ix = floor_div(qx, steps);
+    std::int64_t iy = floor_div(qy, steps);
+    FT_Vector subpixel;
+    subpixel.x = static_cast<FT_Pos>((qx - ix * steps) * 64 / steps);
+    subpixel.y = static_cast<FT_Pos>((qy - iy * steps) * 64 / steps);
+
+    glyph_bitmap_key key;
+    key.face = glyph.face.get();
+    key.size = static_cast<std::int64_t>(size * (1 << 6));
+    key.glyph_index = glyph.glyph_index;
+    key.rotation[0] = rotation.xx;
+    key.rotation[1] = rotation.xy;
+    key.rotation[2] = rotation.yx;
+    key.rotation[3] = rotation.yy;
+    key.transform[0] = matrix.xx;
+    key.transform[1] = matrix.xy;
+    key.transform[2] = matrix.yx;
+    key.transform[3] = matrix.yy;
+    key.stroke = static_cast<std::int64_t>(stroke * (1 << 6));
+    key.subpixel_x = static_cast<std::int32_t>(subpixel.x);
+    key.subpixel_y = static_cast<std::int32_t>(subpixel.y);
+
+    glyph_bitmap_ptr bitmap = glyph_cache_->find(key);
+    if (!bitmap)
+    {
+        FT_Face face = glyph.face->get_face();
+        glyph.face->set_character_sizes(size);
+        FT_Set_Transform(face, &rotation, nullptr);
+        if (FT_Load_Glyph(face, glyph.glyph_index, FT_LOAD_DEFAULT | FT_LOAD_NO_HINTING)) return bitmap;
+        FT_Glyph image;
+        if (FT_Get_Glyph(face->glyph, &image)) return bitmap;
+        FT_Matrix transform = matrix;
+        FT_Glyph_Transform(image, &transform, &subpixel);
+        if (stroke > 0.0)
+        {
+            stroker_->init(stroke);
+            FT_Glyph_Stroke(&image, stroker_->get(), 1);
+        }
+        if (!FT_Glyph_To_Bitmap(&image, FT_RENDER_MODE_NORMAL, 0, 1))
+        {
+            FT_BitmapGlyph bit = reinterpret_cast<FT_BitmapGlyph>(image);
+            FT_Bitmap const& source = bit->bitmap;
+            if (source.pixel_mode == FT_PIXEL_MODE_GRAY)
+            {
+                auto rendered = std::make_shared<glyph_bitmap>();
+                rendered->width = source.width;
+                rendered->rows = source.rows;
+                rendered->left = bit->left;
+                rendered->top = bit->top;
+                rendered->coverage.resize(source.width * source.rows);
+                for (unsigned row = 0; row < source.rows; ++row)
+                {
+                    unsigned char const* line = source.buffer + row * std::abs(source.pitch);
+                    std::copy(line, line + source.width, rendered->coverage.begin() + row * source.width);
+                }
+                bitmap = rendered;
+            }
+        }
+        FT_Done_Glyph(image);
+        if (!bitmap) return bitmap;
+        glyph_cache_->insert(key, bitmap, glyph.face);
+    }
+    x = static_cast<int>(ix) + bitmap->left;
+    y = static_cast<int>(pixmap_.height()) - (static_cast<int>(iy) + bitmap->top);
+    return bitmap;
+}
+
 template <typename T>
 void grid_text_renderer<T>::render(glyph_positions const& pos, value_integer feature_id)
 {
@@ -383,7 +614,7 @@ void grid_text_renderer<T>::render(glyph_positions const& pos, value_integer fea
 
 template <typename T>
 template <std::size_t PixelWidth>
-void agg_text_renderer<T>::render_halo(unsigned char *buffer,
+void agg_text_renderer<T>::render_halo(unsigned char const* buffer,
                                        unsigned width,
                                        unsigned height,
                                        unsigned rgba,
@@ -393,6 +624,8 @@ void agg_text_renderer<T>::render_halo(unsigned char *buffer,
                                        double opacity,
                                        composite_mode_e comp_op)
 {
+    int spread = std::max(1, static_cast<int>(halo_radius));
+    add_drawn(x1 - spread, y1 - spread, width + 2 * spread, height + 2 * spread);
     if (halo_radius < 1.0)
     {
         for (unsigned x = 0; x < width; ++x)
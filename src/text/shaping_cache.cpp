@@ -0,0 +1,64 @@
+/*****************************************************************************
+ *
+ * This file is part of Mapnik (c++ mapping toolkit)
+ *
+ * Copyright (C) 2017 Artem Pavlenko
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ *****************************************************************************/
+
+// mapnik
+#include <mapnik/text/shaping_cache.hpp>
+
+namespace mapnik
+{
+
+shaping_cache::shaping_cache(std::size_t max_bytes)
+    : cache_(max_bytes) {}
+
+void shaping_cache::set_max_bytes(std::size_t max_bytes)
+{
+    cache_.set_max_bytes(max_bytes);
+}
+
+std::size_t shaping_cache::max_bytes() const
+{
+    return cache_.max_bytes();
+}
+
+shaped_run_ptr shaping_cache::find(std::string const& key)
+{
+    boost::optional<shaped_run_ptr> run = cache_.find(key);
+    return run ? *run : shaped_run_ptr();
+}
+
+void shaping_cache::insert(std::string const& key, shaped_run_ptr const& run)
+{
+    // the key is stored twice, in the list and in the index
+    cache_.insert(key, run, 2 * key.size() + run->size() * sizeof(shaped_glyph));
+}
+
+void shaping_cache::clear()
+{
+    cache_.clear();
+}
+
+shaping_cache_stats shaping_cache::stats() const
+{
+    return cache_.stats();
+}
+
+}
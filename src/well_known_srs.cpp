@@ -24,12 +24,20 @@
 #include <mapnik/well_known_srs.hpp>
 #include <mapnik/util/trim.hpp>
 #include <mapnik/enumeration.hpp>
+#include <mapnik/util/cpu_features.hpp>
 
 #pragma GCC diagnostic push
 #include <mapnik/warning_ignore.hpp>
 #include <boost/optional.hpp>
 #pragma GCC diagnostic pop
 
+// stl
+#include <algorithm>
+
+#ifdef MAPNIK_HAVE_X86_SIMD
+#include <immintrin.h>
+#endif
+
 namespace mapnik {
 
 static const char * well_known_srs_strings[] = {
@@ -82,4 +90,390 @@ boost::optional<bool> is_known_geographic(std::string const& srs)
 
 IMPLEMENT_ENUM( well_known_srs_e, well_known_srs_strings )
 
+namespace {
+
+void lonlat2merc_scalar(double * x, double * y, std::size_t point_count)
+{
+    for (std::size_t i = 0; i < point_count; ++i)
+    {
+        if (x[i] > 180) x[i] = 180;
+        else if (x[i] < -180) x[i] = -180;
+        if (y[i] > MAX_LATITUDE) y[i] = MAX_LATITUDE;
+        else if (y[i] < -MAX_LATITUDE) y[i] = -MAX_LATITUDE;
+        x[i] = x[i] * MAXEXTENTby180;
+        y[i] = std::log(std::tan((90.0 + y[i]) * M_PIby360)) * R2D * MAXEXTENTby180;
+    }
+}
+
+void merc2lonlat_scalar(double * x, double * y, std::size_t point_count)
+{
+    for (std::size_t i = 0; i < point_count; ++i)
+    {
+        if (x[i] > MAXEXTENT) x[i] = MAXEXTENT;
+        else if (x[i] < -MAXEXTENT) x[i] = -MAXEXTENT;
+        if (y[i] > MAXEXTENT) y[i] = MAXEXTENT;
+        else if (y[i] < -MAXEXTENT) y[i] = -MAXEXTENT;
+        x[i] = (x[i] / MAXEXTENT) * 180;
+        y[i] = (y[i] / MAXEXTENT) * 180;
+        y[i] = R2D * (2 * std::atan(std::exp(y[i] * D2R)) - M_PI_by2);
+    }
+}
+
+#ifdef MAPNIK_HAVE_X86_SIMD
+
+// The vectorized versions compute
+//   log(tan(pi/4 + lat/2)) = log((1 + sin(lat)) / (1 - sin(lat))) / 2
+// for lonlat2merc and 2 * atan(exp(y)) - pi/2 for merc2lonlat. sin and exp
+// are Taylor polynomials over the (reduced) input range, log is the atanh
+// series of the mantissa and atan the cephes rational approximation. Inputs
+// are clamped to MAX_LATITUDE and MAXEXTENT first, so they stay in range.
+
+// 1/k! for k = 12 .. 0
+double const exp_coefficients[] = {
+    2.08767569878680989792e-9, 2.50521083854417187751e-8, 2.75573192239858906526e-7,
+    2.75573192239858906526e-6, 2.48015873015873015873e-5, 1.98412698412698412698e-4,
+    1.38888888888888888889e-3, 8.33333333333333333333e-3, 4.16666666666666666667e-2,
+    1.66666666666666666667e-1, 0.5, 1.0, 1.0 };
+
+// (-1)^k / (2k+1)! for k = 10 .. 1
+double const sin_coefficients[] = {
+    1.95729410633912612308e-20, -8.22063524662432971696e-18, 2.81145725434552076320e-15,
+    -7.64716373181981647590e-13, 1.60590438368216145994e-10, -2.50521083854417187751e-8,
+    2.75573192239858906526e-6, -1.98412698412698412698e-4, 8.33333333333333333333e-3,
+    -1.66666666666666666667e-1 };
+
+// 1/(2k+1) for k = 11 .. 1
+double const log_coefficients[] = {
+    1.0 / 23, 1.0 / 21, 1.0 / 19, 1.0 / 17, 1.0 / 15, 1.0 / 13,
+    1.0 / 11, 1.0 / 9, 1.0 / 7, 1.0 / 5, 1.0 / 3 };
+
+double const atan_p[] = {
+    -8.750608600031904122785e-1, -1.615753718733365076637e1, -7.500855792314704667340e1,
+    -1.228866684490136173410e2, -6.485021904942025371773e1 };
+
+double const atan_q[] = {
+    1.0, 2.485846490142306297962e1, 1.650270098316988542046e2, 4.328810604912902668951e2,
+    4.853903996359136964868e2, 1.945506571482613964425e2 };
+
+double const log2e = 1.44269504088896340736;
+double const ln2_hi = 6.93145751953125e-1;
+double const ln2_lo = 1.42860682030941723212e-6;
+double const sqrt2 = 1.41421356237309504880;
+double const tan_3pi_8 = 2.41421356237309504880;
+double const more_bits = 6.123233995736765886130e-17;
+// or-ing a biased exponent into the mantissa bits of 2^52 and subtracting
+// 2^52 + 1023 gives the unbiased exponent as a double
+double const exponent_magic = 4503599627370496.0 + 1023.0;
+
+namespace sse41 {
+
+using vec = __m128d;
+std::size_t const lanes = 2;
+
+MAPNIK_TARGET_SSE41 inline vec set1(double v) { return _mm_set1_pd(v); }
+MAPNIK_TARGET_SSE41 inline vec add(vec a, vec b) { return _mm_add_pd(a, b); }
+MAPNIK_TARGET_SSE41 inline vec sub(vec a, vec b) { return _mm_sub_pd(a, b); }
+MAPNIK_TARGET_SSE41 inline vec mul(vec a, vec b) { return _mm_mul_pd(a, b); }
+MAPNIK_TARGET_SSE41 inline vec div(vec a, vec b) { return _mm_div_pd(a, b); }
+MAPNIK_TARGET_SSE41 inline vec greater(vec a, double b) { return _mm_cmpgt_pd(a, set1(b)); }
+MAPNIK_TARGET_SSE41 inline vec select(vec mask, vec a, vec b) { return _mm_blendv_pd(b, a, mask); }
+MAPNIK_TARGET_SSE41 inline __m128i set1_bits(long long v) { return _mm_set1_epi64x(v); }
+
+// min and max return their second operand if either one is NaN
+MAPNIK_TARGET_SSE41 inline vec clamp(vec a, double bound)
+{
+    return _mm_max_pd(set1(-bound), _mm_min_pd(set1(bound), a));
+}
+
+template <std::size_t N>
+MAPNIK_TARGET_SSE41 inline vec polynomial(vec x, double const (&c)[N])
+{
+    vec r = set1(c[0]);
+    for (std::size_t i = 1; i < N; ++i) r = add(mul(r, x), set1(c[i]));
+    return r;
+}
+
+// |x| < 700
+MAPNIK_TARGET_SSE41 inline vec exp(vec x)
+{
+    vec n = _mm_round_pd(mul(x, set1(log2e)), _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+    vec r = sub(sub(x, mul(n, set1(ln2_hi))), mul(n, set1(ln2_lo)));
+    __m128i e = _mm_cvtepi32_epi64(_mm_cvtpd_epi32(n));
+    e = _mm_slli_epi64(_mm_add_epi64(e, set1_bits(1023)), 52);
+    return mul(polynomial(r, exp_coefficients), _mm_castsi128_pd(e));
+}
+
+// x positive and normal
+MAPNIK_TARGET_SSE41 inline vec log(vec x)
+{
+    __m128i b = _mm_castpd_si128(x);
+    vec e = sub(_mm_castsi128_pd(_mm_or_si128(_mm_srli_epi64(b, 52), set1_bits(0x4330000000000000LL))),
+                set1(exponent_magic));
+    vec m = _mm_castsi128_pd(_mm_or_si128(_mm_and_si128(b, set1_bits(0x000fffffffffffffLL)),
+                                          set1_bits(0x3ff0000000000000LL)));
+    // mantissa in [sqrt(1/2), sqrt(2))
+    vec big = greater(m, sqrt2);
+    m = select(big, mul(m, set1(0.5)), m);
+    e = add(e, _mm_and_pd(big, set1(1.0)));
+    vec f = sub(m, set1(1.0));
+    vec s = div(f, add(f, set1(2.0)));
+    vec z = mul(s, s);
+    vec s2 = add(s, s);
+    vec r = add(mul(mul(s2, z), polynomial(z, log_coefficients)), mul(e, set1(ln2_lo)));
+    return add(mul(e, set1(ln2_hi)), add(s2, r));
+}
+
+// |x| <= pi/2
+MAPNIK_TARGET_SSE41 inline vec sin(vec x)
+{
+    vec z = mul(x, x);
+    return add(x, mul(mul(x, z), polynomial(z, sin_coefficients)));
+}
+
+// x positive
+MAPNIK_TARGET_SSE41 inline vec atan(vec x)
+{
+    vec one = set1(1.0);
+    vec big = greater(x, tan_3pi_8);
+    vec mid = _mm_andnot_pd(big, greater(x, 0.66));
+    vec t = select(big, div(set1(-1.0), x), select(mid, div(sub(x, one), add(x, one)), x));
+    vec base = select(big, set1(M_PI_by2), select(mid, set1(M_PI / 4), set1(0.0)));
+    vec more = select(big, set1(more_bits), select(mid, set1(0.5 * more_bits), set1(0.0)));
+    vec z = mul(t, t);
+    z = div(mul(z, polynomial(z, atan_p)), polynomial(z, atan_q));
+    return add(base, add(add(mul(t, z), t), more));
+}
+
+MAPNIK_TARGET_SSE41 void lonlat2merc(double * x, double * y)
+{
+    vec lon = clamp(_mm_loadu_pd(x), 180.0);
+    vec lat = clamp(_mm_loadu_pd(y), MAX_LATITUDE);
+    _mm_storeu_pd(x, mul(lon, set1(MAXEXTENTby180)));
+    vec one = set1(1.0);
+    vec s = sin(mul(lat, set1(D2R)));
+    // lat - lat carries NaN through log, which only looks at the bits
+    vec l = add(log(div(add(one, s), sub(one, s))), sub(lat, lat));
+    _mm_storeu_pd(y, mul(mul(l, set1(0.5)), set1(R2D * MAXEXTENTby180)));
+}
+
+MAPNIK_TARGET_SSE41 void merc2lonlat(double * x, double * y)
+{
+    vec mx = clamp(_mm_loadu_pd(x), MAXEXTENT);
+    vec my = clamp(_mm_loadu_pd(y), MAXEXTENT);
+    _mm_storeu_pd(x, mul(div(mx, set1(MAXEXTENT)), set1(180.0)));
+    vec t = mul(mul(div(my, set1(MAXEXTENT)), set1(180.0)), set1(D2R));
+    vec lat = sub(mul(set1(2.0), atan(exp(t))), set1(M_PI_by2));
+    _mm_storeu_pd(y, mul(set1(R2D), lat));
+}
+
+} // namespace sse41
+
+namespace avx2 {
+
+using vec = __m256d;
+std::size_t const lanes = 4;
+
+MAPNIK_TARGET_AVX2 inline vec set1(double v) { return _mm256_set1_pd(v); }
+MAPNIK_TARGET_AVX2 inline vec add(vec a, vec b) { return _mm256_add_pd(a, b); }
+MAPNIK_TARGET_AVX2 inline vec sub(vec a, vec b) { return _mm256_sub_pd(a, b); }
+MAPNIK_TARGET_AVX2 inline vec mul(vec a, vec b) { return _mm256_mul_pd(a, b); }
+MAPNIK_TARGET_AVX2 inline vec div(vec a, vec b) { return _mm256_div_pd(a, b); }
+MAPNIK_TARGET_AVX2 inline vec greater(vec a, double b) { return _mm256_cmp_pd(a, set1(b), _CMP_GT_OQ); }
+MAPNIK_TARGET_AVX2 inline vec select(vec mask, vec a, vec b) { return _mm256_blendv_pd(b, a, mask); }
+MAPNIK_TARGET_AVX2 inline __m256i set1_bits(long long v) { return _mm256_set1_epi64x(v); }
+
+// min and max return their second operand if either one is NaN
+MAPNIK_TARGET_AVX2 inline vec clamp(vec a, double bound)
+{
+    return _mm256_max_pd(set1(-bound), _mm256_min_pd(set1(bound), a));
+}
+
+template <std::size_t N>
+MAPNIK_TARGET_AVX2 inline vec polynomial(vec x, double const (&c)[N])
+{
+    vec r = set1(c[0]);
+    for (std::size_t i = 1; i < N; ++i) r = add(mul(r, x), set1(c[i]));
+    return r;
+}
+
+// |x| < 700
+MAPNIK_TARGET_AVX2 inline vec exp(vec x)
+{
+    vec n = _mm256_round_pd(mul(x, set1(log2e)), _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+    vec r = sub(sub(x, mul(n, set1(ln2_hi))), mul(n, set1(ln2_lo)));
+    __m256i e = _mm256_cvtepi32_epi64(_mm256_cvtpd_epi32(n));
+    e = _mm256_slli_epi64(_mm256_add_epi64(e, set1_bits(1023)), 52);
+    return mul(polynomial(r, exp_coefficients), _mm256_castsi256_pd(e));
+}
+
+// x positive and normal
+MAPNIK_TARGET_AVX2 inline vec log(vec x)
+{
+    __m256i b = _mm256_castpd_si256(x);
+    vec e = sub(_mm256_castsi256_pd(_mm256_or_si256(_mm256_srli_epi64(b, 52), set1_bits(0x4330000000000000LL))),
+                set1(exponent_magic));
+    vec m = _mm256_castsi256_pd(_mm256_or_si256(_mm256_and_si256(b, set1_bits(0x000fffffffffffffLL)),
+                                                set1_bits(0x3ff0000000000000LL)));
+    // mantissa in [sqrt(1/2), sqrt(2))
+    vec big = greater(m, sqrt2);
+    m = select(big, mul(m, set1(0.5)), m);
+    e = add(e, _mm256_and_pd(big, set1(1.0)));
+    vec f = sub(m, set1(1.0));
+    vec s = div(f, add(f, set1(2.0)));
+    vec z = mul(s, s);
+    vec s2 = add(s, s);
+    vec r = add(mul(mul(s2, z), polynomial(z, log_coefficients)), mul(e, set1(ln2_lo)));
+    return add(mul(e, set1(ln2_hi)), add(s2, r));
+}
+
+// |x| <= pi/2
+MAPNIK_TARGET_AVX2 inline vec sin(vec x)
+{
+    vec z = mul(x, x);
+    return add(x, mul(mul(x, z), polynomial(z, sin_coefficients)));
+}
+
+// x positive
+MAPNIK_TARGET_AVX2 inline vec atan(vec x)
+{
+    vec one = set1(1.0);
+    vec big = greater(x, tan_3pi_8);
+    vec mid = _mm256_andnot_pd(big, greater(x, 0.66));
+    vec t = select(big, div(set1(-1.0), x), select(mid, div(sub(x, one), add(x, one)), x));
+    vec base = select(big, set1(M_PI_by2), select(mid, set1(M_PI / 4), set1(0.0)));
+    vec more = select(big, set1(more_bits), select(mid, set1(0.5 * more_bits), set1(0.0)));
+    vec z = mul(t, t);
+    z = div(mul(z, polynomial(z, atan_p)), polynomial(z, atan_q));
+    return add(base, add(add(mul(t, z), t), more));
+}
+
+MAPNIK_TARGET_AVX2 void lonlat2merc(double * x, double * y)
+{
+    vec lon = clamp(_mm256_loadu_pd(x), 180.0);
+    vec lat = clamp(_mm256_loadu_pd(y), MAX_LATITUDE);
+    _mm256_storeu_pd(x, mul(lon, set1(MAXEXTENTby180)));
+    vec one = set1(1.0);
+    vec s = sin(mul(lat, set1(D2R)));
+    // lat - lat carries NaN through log, which only looks at the bits
+    vec l = add(log(div(add(one, s), sub(one, s))), sub(lat, lat));
+    _mm256_storeu_pd(y, mul(mul(l, set1(0.5)), set1(R2D * MAXEXTENTby180)));
+}
+
+MAPNIK_TARGET_AVX2 void merc2lonlat(double * x, double * y)
+{
+    vec mx = clamp(_mm256_loadu_pd(x), MAXEXTENT);
+    vec my = clamp(_mm256_loadu_pd(y), MAXEXTENT);
+    _mm256_storeu_pd(x, mul(div(mx, set1(MAXEXTENT)), set1(180.0)));
+    vec t = mul(mul(div(my, set1(MAXEXTENT)), set1(180.0)), set1(D2R));
+    vec lat = sub(mul(set1(2.0), atan(exp(t))), set1(M_PI_by2));
+    _mm256_storeu_pd(y, mul(set1(R2D), lat));
+}
+
+} // namespace avx2
+
+// Runs kernel over whole vectors and the last partial one through a padded
+// copy, so every point goes through the same code.
+template <std::size_t Lanes>
+void for_each_vector(void (*kernel)(double *, double *), double * x, double * y, std::size_t count)
+{
+    std::size_t i = 0;
+    for (; i + Lanes <= count; i += Lanes)
+    {
+        kernel(x + i, y + i);
+    }
+    if (i < count)
+    {
+        double tx[Lanes] = {};
+        double ty[Lanes] = {};
+        std::copy(x + i, x + count, tx);
+        std::copy(y + i, y + count, ty);
+        kernel(tx, ty);
+        std::copy(tx, tx + (count - i), x + i);
+        std::copy(ty, ty + (count - i), y + i);
+    }
+}
+
+#endif // MAPNIK_HAVE_X86_SIMD
+
+void lonlat2merc_contiguous(double * x, double * y, std::size_t point_count)
+{
+#ifdef MAPNIK_HAVE_X86_SIMD
+    switch (util::active_simd_level())
+    {
+    case util::simd_level::avx2:
+        for_each_vector<avx2::lanes>(&avx2::lonlat2merc, x, y, point_count);
+        return;
+    case util::simd_level::sse41:
+        for_each_vector<sse41::lanes>(&sse41::lonlat2merc, x, y, point_count);
+        return;
+    default:
+        break;
+    }
+#endif
+    lonlat2merc_scalar(x, y, point_count);
+}
+
+void merc2lonlat_contiguous(double * x, double * y, std::size_t point_count)
+{
+#ifdef MAPNIK_HAVE_X86_SIMD
+    switch (util::active_simd_level())
+    {
+    case util::simd_level::avx2:
+        for_each_vector<avx2::lanes>(&avx2::merc2lonlat, x, y, point_count);
+        return;
+    case util::simd_level::sse41:
+        for_each_vector<sse41::lanes>(&sse41::merc2lonlat, x, y, point_count);
+        return;
+    default:
+        break;
+    }
+#endif
+    merc2lonlat_scalar(x, y, point_count);
+}
+
+// Strided points are gathered into contiguous blocks, transformed and
+// scattered back, so they take the same path as contiguous arrays.
+void for_each_block(void (*transform)(double *, double *, std::size_t),
+                    double * x, double * y, std::size_t point_count, std::size_t stride)
+{
+    if (stride == 1)
+    {
+        transform(x, y, point_count);
+        return;
+    }
+    std::size_t const block_size = 64;
+    double bx[block_size];
+    double by[block_size];
+    for (std::size_t first = 0; first < point_count; first += block_size)
+    {
+        std::size_t count = std::min(block_size, point_count - first);
+        double * px = x + first * stride;
+        double * py = y + first * stride;
+        for (std::size_t i = 0; i < count; ++i)
+        {
+            bx[i] = px[i * stride];
+            by[i] = py[i * stride];
+        }
+        transform(bx, by, count);
+        for (std::size_t i = 0; i < count; ++i)
+        {
+            px[i * stride] = bx[i];
+            py[i * stride] = by[i];
+        }
+    }
+}
+
+} // anonymous namespace
+
+bool lonlat2merc(double * x, double * y, std::size_t point_count, std::size_t stride)
+{
+    for_each_block(&lonlat2merc_contiguous, x, y, point_count, stride);
+    return true;
+}
+
+bool merc2lonlat(double * x, double * y, std::size_t point_count, std::size_t stride)
+{
+    for_each_block(&merc2lonlat_contiguous, x, y, point_count, stride);
+    return true;
+}
 }
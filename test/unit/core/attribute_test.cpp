@@ -0,0 +1,85 @@
+#include "catch.hpp"
+
+#include <mapnik/attribute.hpp>
+#include <mapnik/attribute_registry.hpp>
+#include <mapnik/feature.hpp>
+#include <mapnik/feature_factory.hpp>
+
+TEST_CASE("attribute")
+{
+    SECTION("registry ids are stable")
+    {
+        auto & registry = mapnik::attribute_registry::instance();
+        std::size_t id = registry.insert("attribute-test-name");
+        CHECK(registry.insert("attribute-test-name") == id);
+        CHECK(registry.find("attribute-test-name") == id);
+        CHECK(registry.find("attribute-test-unknown") == mapnik::attribute_registry::npos);
+        CHECK(mapnik::attribute("attribute-test-name").id() == id);
+    }
+
+    SECTION("lookup by id")
+    {
+        // registered before the context columns are defined
+        mapnik::attribute early("attribute-test-early");
+        mapnik::context_ptr ctx = std::make_shared<mapnik::context_type>();
+        ctx->push("attribute-test-other");
+        ctx->push("attribute-test-early");
+        // registered after the context columns are defined
+        mapnik::attribute late("attribute-test-other");
+        mapnik::attribute missing("attribute-test-missing");
+        mapnik::feature_ptr feature(mapnik::feature_factory::create(ctx, 1));
+        feature->put("attribute-test-other", mapnik::value_integer(1));
+        feature->put("attribute-test-early", mapnik::value_integer(2));
+
+        CHECK(early.value<mapnik::value>(*feature) == mapnik::value_integer(2));
+        CHECK(late.value<mapnik::value>(*feature) == mapnik::value_integer(1));
+        CHECK(missing.value<mapnik::value>(*feature).is_null());
+
+        // added columns are found until the context is frozen
+        ctx->push("attribute-test-missing");
+        mapnik::feature_ptr feature2(mapnik::feature_factory::create(ctx, 2));
+        feature2->put("attribute-test-missing", mapnik::value_integer(3));
+        CHECK(missing.value<mapnik::value>(*feature2) == mapnik::value_integer(3));
+        CHECK(late.value<mapnik::value>(*feature2).is_null());
+    }
+
+    SECTION("lookup by id in frozen contexts")
+    {
+        mapnik::attribute early("attribute-test-frozen-early");
+        mapnik::attribute absent("attribute-test-frozen-absent");
+        mapnik::context_ptr ctx = std::make_shared<mapnik::context_type>();
+        ctx->push("attribute-test-frozen-late");
+        ctx->push("attribute-test-frozen-early");
+        ctx->freeze();
+        // registered after the ids were bound
+        mapnik::attribute late("attribute-test-frozen-late");
+        mapnik::feature_ptr feature(mapnik::feature_factory::create(ctx, 1));
+        feature->put("attribute-test-frozen-late", mapnik::value_integer(1));
+        feature->put("attribute-test-frozen-early", mapnik::value_integer(2));
+
+        CHECK(early.value<mapnik::value>(*feature) == mapnik::value_integer(2));
+        CHECK(late.value<mapnik::value>(*feature) == mapnik::value_integer(1));
+        CHECK(absent.value<mapnik::value>(*feature).is_null());
+    }
+
+    SECTION("registry is bounded")
+    {
+        auto & registry = mapnik::attribute_registry::instance();
+        for (std::size_t i = 0; registry.size() < mapnik::attribute_registry::max_size; ++i)
+        {
+            registry.insert("attribute-test-fill-" + std::to_string(i));
+        }
+        CHECK(registry.insert("attribute-test-overflow") == mapnik::attribute_registry::npos);
+        CHECK(registry.size() == mapnik::attribute_registry::max_size);
+        CHECK(registry.find("attribute-test-overflow") == mapnik::attribute_registry::npos);
+
+        // unregistered attributes are looked up by name
+        mapnik::attribute overflow("attribute-test-overflow");
+        CHECK(overflow.id() == mapnik::attribute_registry::npos);
+        mapnik::context_ptr ctx = std::make_shared<mapnik::context_type>();
+        ctx->push("attribute-test-overflow");
+        mapnik::feature_ptr feature(mapnik::feature_factory::create(ctx, 1));
+        feature->put("attribute-test-overflow", mapnik::value_integer(4));
+        CHECK(overflow.value<mapnik::value>(*feature) == mapnik::value_integer(4));
+    }
+}
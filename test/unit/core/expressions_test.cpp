@@ -2,6 +2,7 @@
 
 #include <mapnik/expression.hpp>
 #include <mapnik/expression_evaluator.hpp>
+#include <mapnik/expression_program.hpp>
 #include <mapnik/expression_string.hpp>
 #include <mapnik/wkt/wkt_factory.hpp>
 #include <mapnik/feature.hpp>
@@ -43,7 +44,13 @@ mapnik::value_type evaluate(Feature const& feature, Expression const& expr)
 mapnik::value evaluate_string(mapnik::feature_ptr const& feature, std::string const& str)
 {
     auto expr = mapnik::parse_expression(str);
-    return evaluate(*feature, *expr);
+    auto value = evaluate(*feature, *expr);
+    // compiled expression must produce identical results
+    mapnik::expression_program program(*expr);
+    auto compiled = program.evaluate(*feature, mapnik::attributes());
+    CHECK(compiled.which() == value.which());
+    CHECK(compiled == value);
+    return value;
 }
 
 std::string parse_and_dump(std::string const& str)
@@ -0,0 +1,77 @@
+#include "catch.hpp"
+
+#include <mapnik/feature.hpp>
+#include <mapnik/feature_factory.hpp>
+#include <mapnik/feature_schema.hpp>
+
+#include <string>
+#include <vector>
+
+TEST_CASE("feature context")
+{
+    SECTION("schema lookup")
+    {
+        mapnik::feature_schema schema;
+        std::vector<std::string> names;
+        for (std::size_t i = 0; i < 100; ++i)
+        {
+            names.push_back("field" + std::to_string(i));
+            CHECK(schema.emplace(names.back(), i).second);
+        }
+        CHECK(!schema.emplace("field7", 1000).second);
+        CHECK(schema.size() == 100);
+        for (std::size_t i = 0; i < names.size(); ++i)
+        {
+            auto itr = schema.find(names[i]);
+            REQUIRE(itr != schema.end());
+            CHECK(itr->first == names[i]);
+            CHECK(itr->second == i);
+        }
+        CHECK(schema.find("field100") == schema.end());
+        CHECK(schema.count("field42") == 1);
+        CHECK(schema.count("") == 0);
+        // iteration is ordered by name, frozen or not
+        auto check_sorted = [&schema]()
+        {
+            std::string prev;
+            std::size_t count = 0;
+            for (auto const& kv : schema)
+            {
+                CHECK(prev < kv.first);
+                prev = kv.first;
+                ++count;
+            }
+            CHECK(count == schema.size());
+        };
+        check_sorted();
+        names.push_back("a_field");
+        CHECK(schema.emplace(names.back(), 100).second);
+        check_sorted();
+        CHECK(schema.begin()->first == "a_field");
+        schema.freeze();
+        check_sorted();
+        for (std::size_t i = 0; i < names.size(); ++i)
+        {
+            auto itr = schema.find(names[i]);
+            REQUIRE(itr != schema.end());
+            CHECK(itr->second == i);
+        }
+        CHECK(schema.find("field100") == schema.end());
+    }
+
+    SECTION("frozen context")
+    {
+        mapnik::context_ptr ctx = std::make_shared<mapnik::context_type>();
+        ctx->push("a");
+        ctx->push("b");
+        ctx->freeze();
+        CHECK(ctx->frozen());
+        CHECK(ctx->push("a") == 2);
+        CHECK_THROWS(ctx->push("c"));
+        mapnik::feature_ptr feature(mapnik::feature_factory::create(ctx, 1));
+        feature->put_new("b", mapnik::value_integer(2));
+        CHECK(feature->get("b") == mapnik::value_integer(2));
+        CHECK_THROWS(feature->put_new("c", mapnik::value_integer(3)));
+        CHECK(ctx->size() == 2);
+    }
+}
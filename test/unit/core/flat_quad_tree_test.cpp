@@ -0,0 +1,133 @@
+#include "catch.hpp"
+
+#include <mapnik/flat_quad_tree.hpp>
+#include <mapnik/quad_tree.hpp>
+
+#include <algorithm>
+#include <random>
+#include <utility>
+#include <vector>
+
+namespace {
+
+std::vector<std::pair<int, mapnik::box2d<double>>> random_boxes(std::size_t count, unsigned seed)
+{
+    std::mt19937 engine(seed);
+    std::uniform_real_distribution<double> position(-50.0, 1050.0);
+    std::uniform_real_distribution<double> size(0.0, 60.0);
+    std::vector<std::pair<int, mapnik::box2d<double>>> result;
+    for (std::size_t i = 0; i < count; ++i)
+    {
+        double x = position(engine);
+        double y = position(engine);
+        result.emplace_back(static_cast<int>(i), mapnik::box2d<double>(x, y, x + size(engine), y + size(engine)));
+    }
+    return result;
+}
+
+}
+
+TEST_CASE("flat_quad_tree") {
+
+SECTION("insert and query") {
+
+    mapnik::box2d<double> extent(0, 0, 100, 100);
+    mapnik::flat_quad_tree<int> tree(extent);
+    REQUIRE(tree.extent() == extent);
+    tree.insert(1, mapnik::box2d<double>(10, 10, 20, 20));
+    tree.insert(2, mapnik::box2d<double>(30, 30, 40, 40));
+    tree.insert(3, mapnik::box2d<double>(30, 10, 40, 20));
+    tree.insert(4, mapnik::box2d<double>(1, 1, 2, 2));
+    // same nodes as quad_tree before trimming
+    CHECK(tree.count() == 10);
+    CHECK(tree.count_items() == 4);
+
+    std::vector<int> found;
+    auto collect = [&](mapnik::flat_quad_tree<int>::item const& i) { found.push_back(i.value); return false; };
+    CHECK_FALSE(tree.query(extent, collect));
+    CHECK(found == (std::vector<int>{1, 4, 3, 2}));
+
+    // only items intersecting the query box are reported
+    found.clear();
+    tree.query(mapnik::box2d<double>(15, 15, 35, 35), collect);
+    CHECK(found == (std::vector<int>{1, 3, 2}));
+
+    // the visitor can stop the query
+    int visited = 0;
+    CHECK(tree.query(extent, [&](mapnik::flat_quad_tree<int>::item const&) { return ++visited == 2; }));
+    CHECK(visited == 2);
+
+    // boxes sticking out of the extent stay in the root, like quad_tree
+    // nothing is found for query boxes outside the extent
+    tree.insert(5, mapnik::box2d<double>(-10, -10, 200, 5));
+    found.clear();
+    tree.query(mapnik::box2d<double>(50, 2, 60, 3), collect);
+    CHECK(found == (std::vector<int>{5}));
+    found.clear();
+    CHECK_FALSE(tree.query(mapnik::box2d<double>(150, 0, 160, 1), collect));
+    CHECK(found.empty());
+
+    tree.clear();
+    CHECK(tree.count() == 1);
+    CHECK(tree.count_items() == 0);
+    CHECK(tree.extent() == extent);
+    CHECK_FALSE(tree.query(extent, collect));
+}
+
+SECTION("same results as quad_tree") {
+
+    mapnik::box2d<double> extent(0, 0, 1000, 1000);
+    auto boxes = random_boxes(5000, 11);
+    auto queries = random_boxes(200, 12);
+
+    mapnik::quad_tree<int> reference(extent);
+    mapnik::flat_quad_tree<int> incremental(extent);
+    mapnik::flat_quad_tree<int> bulk(extent);
+    for (auto const& b : boxes)
+    {
+        reference.insert(b.first, b.second);
+        incremental.insert(b.first, b.second);
+    }
+    bulk.insert(boxes.begin(), boxes.end());
+    CHECK(static_cast<int>(bulk.count()) == reference.count());
+    CHECK(static_cast<int>(incremental.count()) == reference.count());
+    CHECK(bulk.count_items() == boxes.size());
+
+    for (auto const& q : queries)
+    {
+        std::vector<int> expected;
+        auto itr = reference.query_in_box(q.second);
+        auto end = reference.query_end();
+        for ( ; itr != end; ++itr)
+        {
+            if (boxes[itr->get()].second.intersects(q.second)) expected.push_back(itr->get());
+        }
+        std::vector<int> found;
+        incremental.query(q.second, [&](mapnik::flat_quad_tree<int>::item const& i) { found.push_back(i.value); return false; });
+        REQUIRE(found == expected);
+        // packing keeps the depth first order
+        found.clear();
+        bulk.query(q.second, [&](mapnik::flat_quad_tree<int>::item const& i) { found.push_back(i.value); return false; });
+        REQUIRE(found == expected);
+    }
+
+    // inserting after a pack and packing again
+    auto more = random_boxes(500, 13);
+    for (auto & b : more)
+    {
+        b.first += static_cast<int>(boxes.size());
+        bulk.insert(b.first, b.second);
+    }
+    mapnik::box2d<double> everything(-100, -100, 1200, 1200);
+    std::vector<int> before;
+    bulk.query(everything, [&](mapnik::flat_quad_tree<int>::item const& i) { before.push_back(i.value); return false; });
+    bulk.pack();
+    std::vector<int> after;
+    bulk.query(everything, [&](mapnik::flat_quad_tree<int>::item const& i) { after.push_back(i.value); return false; });
+    CHECK(before == after);
+    std::sort(after.begin(), after.end());
+    CHECK(after.size() == boxes.size() + more.size());
+    CHECK(std::adjacent_find(after.begin(), after.end()) == after.end());
+}
+
+}
@@ -0,0 +1,113 @@
+#include "catch.hpp"
+
+#include <mapnik/label_collision_detector.hpp>
+#include <mapnik/quad_tree.hpp>
+#include <mapnik/unicode.hpp>
+
+#include <random>
+#include <vector>
+
+namespace {
+
+// the quad_tree based detector label_collision_detector4 was before
+struct reference_detector
+{
+    using label = mapnik::label_collision_detector4::label;
+    mapnik::quad_tree<label> tree;
+
+    explicit reference_detector(mapnik::box2d<double> const& extent)
+        : tree(extent) {}
+
+    bool has_placement(mapnik::box2d<double> const& box, double margin,
+                       mapnik::value_unicode_string const& text, double repeat_distance)
+    {
+        mapnik::box2d<double> margin_box(box.minx() - margin, box.miny() - margin,
+                                         box.maxx() + margin, box.maxy() + margin);
+        mapnik::box2d<double> query_box = margin_box;
+        if (repeat_distance > margin)
+        {
+            query_box = mapnik::box2d<double>(box.minx() - repeat_distance, box.miny() - repeat_distance,
+                                              box.maxx() + repeat_distance, box.maxy() + repeat_distance);
+        }
+        auto itr = tree.query_in_box(query_box);
+        auto end = tree.query_end();
+        for ( ; itr != end; ++itr)
+        {
+            if (itr->get().box.intersects(margin_box) ||
+                (repeat_distance > margin && text == itr->get().text && itr->get().box.intersects(query_box)))
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    void insert(mapnik::box2d<double> const& box, mapnik::value_unicode_string const& text)
+    {
+        if (tree.extent().intersects(box)) tree.insert(label(box, text), box);
+    }
+};
+
+}
+
+TEST_CASE("label_collision_detector") {
+
+SECTION("same placements as the quad_tree") {
+
+    mapnik::box2d<double> extent(-64, -64, 576, 576);
+    mapnik::label_collision_detector4 detector(extent);
+    reference_detector reference(extent);
+    mapnik::transcoder tr("utf-8");
+    std::vector<mapnik::value_unicode_string> names = { tr.transcode("Main Street"),
+                                                        tr.transcode("High Street"),
+                                                        tr.transcode("Station Road") };
+    std::mt19937 engine(42);
+    std::uniform_real_distribution<double> position(-150, 650);
+    std::uniform_real_distribution<double> size(0, 40);
+    std::size_t placed = 0;
+    for (int i = 0; i < 5000; ++i)
+    {
+        double x = position(engine);
+        double y = position(engine);
+        mapnik::box2d<double> box(x, y, x + size(engine), y + size(engine) / 2);
+        auto const& text = names[i % names.size()];
+        double margin = (i % 3) * 2.0;
+        double repeat_distance = (i % 4) * 20.0;
+        bool expected = reference.has_placement(box, margin, text, repeat_distance);
+        REQUIRE(detector.has_placement(box, margin, text, repeat_distance) == expected);
+        if (margin == 0)
+        {
+            REQUIRE(detector.has_placement(box) == reference.has_placement(box, 0, text, 0));
+        }
+        if (expected)
+        {
+            detector.insert(box, text);
+            reference.insert(box, text);
+            if (extent.intersects(box)) ++placed;
+        }
+    }
+    CHECK(placed > 100);
+    // begin() collects the labels end() refers to
+    auto itr = detector.begin();
+    CHECK(std::size_t(std::distance(itr, detector.end())) == placed);
+
+    detector.clear();
+    itr = detector.begin();
+    CHECK(itr == detector.end());
+    CHECK(detector.has_placement(mapnik::box2d<double>(0, 0, 512, 512)));
+}
+
+SECTION("nothing collides outside of the extent") {
+
+    mapnik::label_collision_detector4 detector(mapnik::box2d<double>(0, 0, 256, 256));
+    // partly outside, kept
+    detector.insert(mapnik::box2d<double>(200, 200, 300, 300));
+    // outside, dropped
+    detector.insert(mapnik::box2d<double>(400, 400, 500, 500));
+    CHECK_FALSE(detector.has_placement(mapnik::box2d<double>(250, 250, 260, 260)));
+    CHECK(detector.has_placement(mapnik::box2d<double>(270, 270, 280, 280)));
+    CHECK(detector.has_placement(mapnik::box2d<double>(410, 410, 420, 420)));
+    CHECK_FALSE(detector.has_placement(mapnik::box2d<double>(220, 220, 230, 230), 0.0));
+}
+
+}
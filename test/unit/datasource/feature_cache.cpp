@@ -0,0 +1,214 @@
+#include "catch.hpp"
+#include "ds_test_util.hpp"
+
+#include <mapnik/cached_datasource.hpp>
+#include <mapnik/feature_cache.hpp>
+#include <mapnik/feature_factory.hpp>
+#include <mapnik/geometry.hpp>
+#include <mapnik/memory_datasource.hpp>
+#include <mapnik/query.hpp>
+
+namespace {
+
+// memory datasource counting the queries it answers
+class counting_datasource : public mapnik::memory_datasource
+{
+public:
+    counting_datasource()
+        : mapnik::memory_datasource(mapnik::parameters()),
+          count(0),
+          arenas(0) {}
+
+    mapnik::featureset_ptr features(mapnik::query const& q) const
+    {
+        ++count;
+        if (q.get_arena()) ++arenas;
+        return mapnik::memory_datasource::features(q);
+    }
+
+    mutable std::size_t count;
+    mutable std::size_t arenas;
+};
+
+// datasource sharing a processor context between its queries
+class context_datasource : public mapnik::memory_datasource
+{
+public:
+    context_datasource()
+        : mapnik::memory_datasource(mapnik::parameters()),
+          contexts(0) {}
+
+    mapnik::processor_context_ptr get_context(mapnik::feature_style_context_map &) const
+    {
+        return std::make_shared<mapnik::IProcessorContext>();
+    }
+
+    mapnik::featureset_ptr features_with_context(mapnik::query const& q, mapnik::processor_context_ptr ctx) const
+    {
+        if (ctx) ++contexts;
+        return mapnik::memory_datasource::features(q);
+    }
+
+    mutable std::size_t contexts;
+};
+
+std::shared_ptr<counting_datasource> make_datasource()
+{
+    auto ds = std::make_shared<counting_datasource>();
+    mapnik::context_ptr ctx = std::make_shared<mapnik::context_type>();
+    ctx->push("name");
+    for (int i = 0; i < 10; ++i)
+    {
+        mapnik::feature_ptr feature(mapnik::feature_factory::create(ctx, i));
+        feature->put("name", mapnik::value_integer(i));
+        feature->set_geometry(mapnik::geometry::line_string<double>{{0.0, 0.0}, {double(i), double(i)}});
+        ds->push(feature);
+    }
+    return ds;
+}
+
+mapnik::query make_query(mapnik::box2d<double> const& box)
+{
+    // super tiles are 40 map units wide at this resolution
+    mapnik::query q(box, mapnik::query::resolution_type(25.6, 25.6), 1.0, box);
+    q.add_property_name("name");
+    return q;
+}
+
+mapnik::query make_query(double offset)
+{
+    // all features are inside the query box
+    return make_query(mapnik::box2d<double>(offset - 100, offset - 100, offset + 100, offset + 100));
+}
+
+}
+
+TEST_CASE("feature cache") {
+
+    auto & cache = mapnik::feature_cache::instance();
+    cache.clear();
+
+    SECTION("disabled by default")
+    {
+        auto ds = make_datasource();
+        mapnik::cached_datasource cached(ds);
+        CHECK(count_features(cached.features(make_query(0))) == 10);
+        CHECK(count_features(cached.features(make_query(0))) == 10);
+        CHECK(ds->count == 2);
+        CHECK(cache.stats().entries == 0);
+    }
+
+    SECTION("query arenas are not passed on")
+    {
+        // cached features would keep the arena of their query alive
+        auto ds = make_datasource();
+        mapnik::cached_datasource cached(ds);
+        mapnik::query q = make_query(0);
+        q.set_arena(std::make_shared<mapnik::util::arena>());
+        CHECK(count_features(cached.features(q)) == 10);
+        CHECK(ds->count == 1);
+        CHECK(ds->arenas == 0);
+    }
+
+    SECTION("hits and misses")
+    {
+        cache.set_max_bytes(1024 * 1024);
+        auto ds = make_datasource();
+        mapnik::cached_datasource cached(ds);
+        auto before = cache.stats();
+        CHECK(count_features(cached.features(make_query(0))) == 10);
+        // sub pixel difference snaps to the same entry
+        CHECK(count_features(cached.features(make_query(0.001))) == 10);
+        auto fs = cached.features(make_query(0));
+        auto feature = fs->next();
+        REQUIRE(feature != nullptr);
+        CHECK(feature->get("name") == mapnik::value_integer(0));
+        CHECK(ds->count == 1);
+        // adjacent area covering the same super tiles
+        CHECK(count_features(cached.features(make_query(5))) == 10);
+        CHECK(ds->count == 1);
+        // different area
+        CHECK(count_features(cached.features(make_query(1000))) == 0);
+        CHECK(ds->count == 2);
+        // different datasource
+        auto ds2 = make_datasource();
+        mapnik::cached_datasource cached2(ds2);
+        CHECK(count_features(cached2.features(make_query(0))) == 10);
+        CHECK(ds2->count == 1);
+
+        auto stats = cache.stats();
+        CHECK(stats.hits - before.hits == 3);
+        CHECK(stats.misses - before.misses == 3);
+        CHECK(stats.entries == 3);
+        CHECK(stats.bytes > 0);
+        CHECK(stats.bytes <= stats.max_bytes);
+        cache.set_max_bytes(0);
+        CHECK(cache.stats().entries == 0);
+        CHECK(cache.stats().bytes == 0);
+    }
+
+    SECTION("results are clipped to the query bbox")
+    {
+        cache.set_max_bytes(1024 * 1024);
+        auto ds = make_datasource();
+        mapnik::cached_datasource cached(ds);
+        // feature i ends at (i, i)
+        CHECK(count_features(cached.features(make_query(mapnik::box2d<double>(5.5, 5.5, 40, 40)))) == 4);
+        CHECK(ds->count == 1);
+        CHECK(count_features(cached.features(make_query(mapnik::box2d<double>(0, 0, 40, 40)))) == 10);
+        CHECK(count_features(cached.features(make_query(mapnik::box2d<double>(8.5, 8.5, 20, 20)))) == 1);
+        CHECK(ds->count == 1);
+        cache.set_max_bytes(0);
+    }
+
+    SECTION("cached features are shared")
+    {
+        cache.set_max_bytes(1024 * 1024);
+        auto ds = make_datasource();
+        mapnik::cached_datasource cached(ds);
+        count_features(cached.features(make_query(0)));
+        auto feature = cached.features(make_query(0))->next();
+        REQUIRE(feature != nullptr);
+        auto again = cached.features(make_query(0))->next();
+        CHECK(again == feature);
+        CHECK(again->get("name") == mapnik::value_integer(0));
+        CHECK(ds->count == 1);
+        cache.set_max_bytes(0);
+    }
+
+    SECTION("results larger than the cache are streamed through")
+    {
+        cache.set_max_bytes(1024 * 1024);
+        auto ds = make_datasource();
+        mapnik::cached_datasource cached(ds);
+        count_features(cached.features(make_query(0)));
+        std::size_t entry_bytes = cache.stats().bytes;
+        cache.clear();
+        cache.set_max_bytes(entry_bytes / 2);
+        CHECK(count_features(cached.features(make_query(0))) == 10);
+        CHECK(cache.stats().entries == 0);
+        CHECK(count_features(cached.features(make_query(0))) == 10);
+        CHECK(ds->count == 3);
+        cache.set_max_bytes(0);
+    }
+
+    SECTION("processor contexts are passed on")
+    {
+        cache.set_max_bytes(1024 * 1024);
+        auto ds = std::make_shared<context_datasource>();
+        mapnik::context_ptr ctx_type = std::make_shared<mapnik::context_type>();
+        mapnik::feature_ptr feature(mapnik::feature_factory::create(ctx_type, 1));
+        feature->set_geometry(mapnik::geometry::point<double>(0, 0));
+        ds->push(feature);
+        mapnik::cached_datasource cached(ds);
+        mapnik::feature_style_context_map ctx_map;
+        mapnik::processor_context_ptr ctx = cached.get_context(ctx_map);
+        CHECK(ctx != nullptr);
+        count_features(cached.features_with_context(make_query(0), ctx));
+        CHECK(ds->contexts == 1);
+        // a hit does not query the datasource
+        count_features(cached.features_with_context(make_query(0), ctx));
+        CHECK(ds->contexts == 1);
+        cache.set_max_bytes(0);
+    }
+}
@@ -0,0 +1,233 @@
+#include "catch.hpp"
+#include "ds_test_util.hpp"
+
+#include <mapnik/lod_datasource.hpp>
+#include <mapnik/geometry_lod_cache.hpp>
+#include <mapnik/feature_factory.hpp>
+#include <mapnik/geometry.hpp>
+#include <mapnik/memory_datasource.hpp>
+#include <mapnik/query.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <vector>
+
+namespace {
+
+// a wiggly line, a polygon with a hole and a point
+std::shared_ptr<mapnik::memory_datasource> make_datasource()
+{
+    auto ds = std::make_shared<mapnik::memory_datasource>(mapnik::parameters());
+    mapnik::context_ptr ctx = std::make_shared<mapnik::context_type>();
+    ctx->push("name");
+
+    mapnik::feature_ptr line_feature(mapnik::feature_factory::create(ctx, 1));
+    line_feature->put("name", mapnik::value_integer(1));
+    mapnik::geometry::line_string<double> line;
+    for (int i = 0; i <= 1000; ++i)
+    {
+        line.emplace_back(i * 0.1, std::sin(i * 0.1) + 0.001 * (i % 2));
+    }
+    line_feature->set_geometry(std::move(line));
+    ds->push(line_feature);
+
+    mapnik::feature_ptr poly_feature(mapnik::feature_factory::create(ctx, 2));
+    poly_feature->put("name", mapnik::value_integer(2));
+    mapnik::geometry::polygon<double> poly;
+    poly.emplace_back();
+    for (int i = 0; i < 360; ++i)
+    {
+        double a = i * M_PI / 180;
+        poly.back().emplace_back(50 + 40 * std::cos(a), 50 + 40 * std::sin(a));
+    }
+    poly.back().push_back(poly.back().front());
+    poly.emplace_back();
+    poly.back().emplace_back(45, 45);
+    poly.back().emplace_back(45, 55);
+    poly.back().emplace_back(55, 55);
+    poly.back().emplace_back(55, 45);
+    poly.back().emplace_back(45, 45);
+    poly_feature->set_geometry(std::move(poly));
+    ds->push(poly_feature);
+
+    mapnik::feature_ptr point_feature(mapnik::feature_factory::create(ctx, 3));
+    point_feature->put("name", mapnik::value_integer(3));
+    point_feature->set_geometry(mapnik::geometry::point<double>(10, 10));
+    ds->push(point_feature);
+    return ds;
+}
+
+mapnik::query make_query(double res)
+{
+    mapnik::box2d<double> box(-10, -10, 110, 110);
+    mapnik::query q(box, mapnik::query::resolution_type(res, res), 1.0, box);
+    q.add_property_name("name");
+    return q;
+}
+
+std::vector<mapnik::feature_ptr> read_features(mapnik::featureset_ptr const& fs)
+{
+    std::vector<mapnik::feature_ptr> features;
+    mapnik::feature_ptr feature;
+    while ((feature = fs->next()))
+    {
+        features.push_back(feature);
+    }
+    return features;
+}
+
+double segment_distance(mapnik::geometry::point<double> const& p,
+                        mapnik::geometry::point<double> const& a,
+                        mapnik::geometry::point<double> const& b)
+{
+    double dx = b.x - a.x;
+    double dy = b.y - a.y;
+    double length2 = dx * dx + dy * dy;
+    double t = length2 > 0 ? ((p.x - a.x) * dx + (p.y - a.y) * dy) / length2 : 0.0;
+    t = std::max(0.0, std::min(1.0, t));
+    return std::hypot(p.x - (a.x + t * dx), p.y - (a.y + t * dy));
+}
+
+// largest distance of a source vertex to the simplified line
+template <typename Points>
+double max_deviation(Points const& source, Points const& simplified)
+{
+    double result = 0.0;
+    for (auto const& p : source)
+    {
+        double distance = std::numeric_limits<double>::max();
+        for (std::size_t i = 1; i < simplified.size(); ++i)
+        {
+            distance = std::min(distance, segment_distance(p, simplified[i - 1], simplified[i]));
+        }
+        result = std::max(result, distance);
+    }
+    return result;
+}
+
+std::size_t line_size(mapnik::feature_ptr const& feature)
+{
+    return feature->get_geometry().get<mapnik::geometry::line_string<double>>().size();
+}
+
+}
+
+TEST_CASE("lod datasource") {
+
+SECTION("simplifies per zoom band and reuses the result") {
+    auto ds = make_datasource();
+    mapnik::lod_datasource lod(ds, mapnik::douglas_peucker, 0.5);
+
+    auto coarse = read_features(lod.features(make_query(1.0)));
+    REQUIRE(coarse.size() == 3);
+    CHECK(coarse[0]->get("name") == mapnik::value_integer(1));
+    CHECK(line_size(coarse[0]) < 100);
+    CHECK(line_size(coarse[0]) > 2);
+    auto const& poly = coarse[1]->get_geometry().get<mapnik::geometry::polygon<double>>();
+    REQUIRE(poly.size() == 2);
+    CHECK(poly[0].size() < 100);
+    CHECK(poly[0].front() == poly[0].back());
+    CHECK(poly[1].size() == 5);
+    CHECK(coarse[2]->get_geometry().is<mapnik::geometry::point<double>>());
+
+    // the datasource features are left untouched
+    auto original = read_features(ds->features(make_query(1.0)));
+    CHECK(line_size(original[0]) == 1001);
+
+    auto stats = lod.cache().stats();
+    CHECK(stats.misses == 2);
+    CHECK(stats.hits == 0);
+    CHECK(stats.entries == 2);
+    CHECK(stats.bytes > 0);
+
+    // same band
+    auto again = read_features(lod.features(make_query(1.9)));
+    CHECK(line_size(again[0]) == line_size(coarse[0]));
+    CHECK(lod.cache().stats().hits == 2);
+
+    // finer band, more vertices
+    auto fine = read_features(lod.features(make_query(64.0)));
+    CHECK(line_size(fine[0]) > line_size(coarse[0]));
+    CHECK(lod.cache().stats().misses == 4);
+}
+
+SECTION("simplified geometries stay within tolerance") {
+    auto ds = make_datasource();
+    auto source = read_features(ds->features(make_query(10.0)));
+    auto const& source_line = source[0]->get_geometry().get<mapnik::geometry::line_string<double>>();
+    auto const& source_poly = source[1]->get_geometry().get<mapnik::geometry::polygon<double>>();
+    // resolution 10 is in the band [8, 16), 0.5 pixels at its finest resolution
+    double const tolerance = 0.5 / 16;
+    // visvalingam-whyatt drops vertices by area, not by distance
+    for (auto algorithm : { mapnik::radial_distance, mapnik::douglas_peucker, mapnik::zhao_saalfeld })
+    {
+        mapnik::lod_datasource lod(ds, algorithm, 0.5);
+        auto features = read_features(lod.features(make_query(10.0)));
+        REQUIRE(features.size() == 3);
+        INFO("algorithm " << algorithm);
+        auto const& line = features[0]->get_geometry().get<mapnik::geometry::line_string<double>>();
+        CHECK(line.size() > 2);
+        CHECK(line.size() < 1001);
+        CHECK(line.front().x == 0.0);
+        CHECK(max_deviation(source_line, line) <= tolerance);
+        auto const& poly = features[1]->get_geometry().get<mapnik::geometry::polygon<double>>();
+        REQUIRE(poly.size() == 2);
+        CHECK(poly[0].size() >= 4);
+        CHECK(poly[0].front() == poly[0].back());
+        CHECK(max_deviation(source_poly[0], poly[0]) <= tolerance);
+    }
+}
+
+SECTION("memory budget") {
+    auto ds = make_datasource();
+    mapnik::lod_datasource lod(ds, mapnik::douglas_peucker, 0.5, 0);
+    auto features = read_features(lod.features(make_query(1.0)));
+    CHECK(features.size() == 3);
+    CHECK(line_size(features[0]) < 100);
+    CHECK(lod.cache().stats().entries == 0);
+    lod.cache().set_max_bytes(1 << 20);
+    read_features(lod.features(make_query(1.0)));
+    CHECK(lod.cache().stats().entries == 2);
+    lod.cache().set_max_bytes(0);
+    CHECK(lod.cache().stats().entries == 0);
+    CHECK(lod.cache().stats().evictions == 2);
+}
+
+SECTION("moved geometries with the same vertex count miss") {
+    auto ds = make_datasource();
+    mapnik::lod_datasource lod(ds, mapnik::douglas_peucker, 0.5);
+    auto before = read_features(lod.features(make_query(1.0)));
+    CHECK(lod.cache().stats().misses == 2);
+
+    // same id and vertex count, shifted by 5 units
+    auto source = read_features(ds->features(make_query(1.0)));
+    auto line = source[0]->get_geometry().get<mapnik::geometry::line_string<double>>();
+    for (auto & pt : line)
+    {
+        pt.y += 5;
+    }
+    source[0]->set_geometry(std::move(line));
+
+    auto after = read_features(lod.features(make_query(1.0)));
+    CHECK(lod.cache().stats().misses == 3);
+    CHECK(lod.cache().stats().hits == 1);
+    auto const& moved = after[0]->get_geometry().get<mapnik::geometry::line_string<double>>();
+    auto const& original = before[0]->get_geometry().get<mapnik::geometry::line_string<double>>();
+    REQUIRE(moved.size() == original.size());
+    CHECK(moved.front().y == original.front().y + 5);
+}
+
+SECTION("reused feature ids miss") {
+    mapnik::geometry_lod_cache cache;
+    auto geom = std::make_shared<mapnik::geometry::geometry<double> const>(
+        mapnik::geometry::line_string<double>{{0.0, 0.0}, {1.0, 1.0}});
+    cache.insert(7, 3, 100, geom, 32);
+    CHECK(cache.find(7, 3, 100) == geom);
+    CHECK(cache.find(7, 4, 100) == nullptr);
+    CHECK(cache.find(7, 3, 101) == nullptr);
+    CHECK(cache.find(7, 3, 100) == nullptr);
+    CHECK(cache.stats().entries == 0);
+}
+
+} // END TEST CASE
@@ -27,6 +27,51 @@
 #include <mapnik/datasource.hpp>
 #include <mapnik/memory_datasource.hpp>
 #include <mapnik/datasource_cache.hpp>
+#include <mapnik/feature_factory.hpp>
+#include <mapnik/filter_featureset.hpp>
+#include <mapnik/geometry.hpp>
+#include <mapnik/util/featureset_buffer.hpp>
+#include <mapnik/util/prefetched_featureset.hpp>
+
+#include <vector>
+
+namespace {
+
+// featureset relying on the default next_batch adapter
+struct counting_featureset : mapnik::Featureset
+{
+    explicit counting_featureset(mapnik::featureset_ptr const& fs)
+        : fs_(fs) {}
+    mapnik::feature_ptr next() { return fs_->next(); }
+    mapnik::featureset_ptr fs_;
+};
+
+struct odd_id_filter
+{
+    bool pass(mapnik::feature_impl const& feature) const
+    {
+        return feature.id() % 2 == 1;
+    }
+};
+
+std::vector<mapnik::value_integer> batch_ids(mapnik::featureset_ptr const& fs, std::size_t batch_size)
+{
+    std::vector<mapnik::value_integer> ids;
+    std::vector<mapnik::feature_ptr> batch(batch_size);
+    std::size_t size;
+    while ((size = fs->next_batch(batch.data(), batch.size())) > 0)
+    {
+        REQUIRE(size <= batch_size);
+        for (std::size_t i = 0; i < size; ++i)
+        {
+            REQUIRE(batch[i] != nullptr);
+            ids.push_back(batch[i]->id());
+        }
+    }
+    return ids;
+}
+
+}
 
 
 TEST_CASE("memory datasource") {
@@ -43,4 +88,79 @@ TEST_CASE("memory datasource") {
             CHECK(false); // shouldn't get here
         }
     }
+
+    SECTION("next_batch")
+    {
+        mapnik::parameters params;
+        auto ds = std::make_shared<mapnik::memory_datasource>(params);
+        mapnik::context_ptr ctx = std::make_shared<mapnik::context_type>();
+        std::vector<mapnik::value_integer> expected;
+        for (mapnik::value_integer id = 1; id <= 10; ++id)
+        {
+            mapnik::feature_ptr feature(mapnik::feature_factory::create(ctx, id));
+            feature->set_geometry(mapnik::geometry::point<double>(id, id));
+            ds->push(feature);
+            expected.push_back(id);
+        }
+        CHECK(batch_ids(all_features(ds), 3) == expected);
+        CHECK(batch_ids(all_features(ds), 64) == expected);
+        CHECK(batch_ids(std::make_shared<counting_featureset>(all_features(ds)), 4) == expected);
+
+        auto buffer = std::make_shared<mapnik::featureset_buffer>();
+        auto fs = all_features(ds);
+        while (auto f = fs->next()) buffer->push(f);
+        buffer->prepare();
+        CHECK(batch_ids(buffer, 7) == expected);
+
+        std::vector<mapnik::value_integer> odd = {1, 3, 5, 7, 9};
+        auto filtered = std::make_shared<mapnik::filter_featureset<odd_id_filter>>(all_features(ds), odd_id_filter());
+        CHECK(batch_ids(filtered, 2) == odd);
+
+        CHECK(batch_ids(mapnik::make_invalid_featureset(), 8).empty());
+    }
+
+    SECTION("prefetched featureset")
+    {
+        mapnik::parameters params;
+        auto ds = std::make_shared<mapnik::memory_datasource>(params);
+        mapnik::context_ptr ctx = std::make_shared<mapnik::context_type>();
+        std::vector<mapnik::value_integer> expected;
+        for (mapnik::value_integer id = 1; id <= 10; ++id)
+        {
+            mapnik::feature_ptr feature(mapnik::feature_factory::create(ctx, id));
+            feature->set_geometry(mapnik::geometry::point<double>(id, id));
+            ds->push(feature);
+            expected.push_back(id);
+        }
+        mapnik::query_slot_queue slots;
+
+        // read ahead stopped after 4 features, the rest comes from the live featureset
+        auto fs = all_features(ds);
+        std::vector<mapnik::feature_ptr> features;
+        for (int i = 0; i < 4; ++i) features.push_back(fs->next());
+        auto prefetched = std::make_shared<mapnik::prefetched_featureset>(
+            std::move(features), fs, mapnik::query_slot(slots, 1));
+        CHECK(prefetched->live());
+        CHECK(slots.in_flight() == 1);
+        CHECK(batch_ids(prefetched, 3) == expected);
+        // exhausting the live featureset gives the slot back
+        CHECK_FALSE(prefetched->live());
+        CHECK(slots.in_flight() == 0);
+
+        // fully read ahead
+        fs = all_features(ds);
+        features.clear();
+        while (auto f = fs->next()) features.push_back(f);
+        prefetched = std::make_shared<mapnik::prefetched_featureset>(
+            std::move(features), mapnik::featureset_ptr(), mapnik::query_slot(slots, 1));
+        CHECK(slots.in_flight() == 0);
+        CHECK(batch_ids(prefetched, 64) == expected);
+
+        // destroying a live featureset gives the slot back too
+        prefetched = std::make_shared<mapnik::prefetched_featureset>(
+            std::vector<mapnik::feature_ptr>(), all_features(ds), mapnik::query_slot(slots, 1));
+        CHECK(slots.in_flight() == 1);
+        prefetched.reset();
+        CHECK(slots.in_flight() == 0);
+    }
 }
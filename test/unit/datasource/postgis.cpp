@@ -23,11 +23,20 @@
 #include "catch.hpp"
 #include "ds_test_util.hpp"
 
+#include <mapnik/agg_renderer.hpp>
 #include <mapnik/datasource.hpp>
 #include <mapnik/datasource_cache.hpp>
+#include <mapnik/feature_type_style.hpp>
 #include <mapnik/geometry/geometry_type.hpp>
+#include <mapnik/image.hpp>
+#include <mapnik/layer.hpp>
+#include <mapnik/map.hpp>
+#include <mapnik/render_report.hpp>
+#include <mapnik/rule.hpp>
+#include <mapnik/symbolizer.hpp>
 #include <mapnik/unicode.hpp>
 #include <mapnik/util/fs.hpp>
+#include <mapnik/util/thread_pool.hpp>
 
 /*
   Compile and run just this test:
@@ -289,6 +298,44 @@ TEST_CASE("postgis") {
             REQUIRE(ext.maxy() == 4);
         }
 
+        SECTION("Postgis pooled queries don't borrow more than 'max_size' connections")
+        {
+            mapnik::parameters params(base_params);
+            params["table"] = "test";
+            params["max_size"] = "1";
+            // pools are shared per connection string, don't reuse the one
+            // registered with the default max_size by the sections above
+            params["connect_timeout"] = "5";
+            auto ds = mapnik::datasource_cache::instance().create(params);
+            REQUIRE(ds != nullptr);
+            REQUIRE(ds->max_concurrent_queries() == 1);
+
+            mapnik::Map map(256, 256);
+            mapnik::feature_type_style style;
+            mapnik::rule rule;
+            rule.append(mapnik::line_symbolizer());
+            style.add_rule(std::move(rule));
+            map.insert_style("lines", std::move(style));
+            for (std::string const& name : { "first", "second" })
+            {
+                mapnik::layer lyr(name);
+                lyr.set_datasource(ds);
+                lyr.add_style("lines");
+                map.add_layer(lyr);
+            }
+            map.zoom_to_box(ds->envelope());
+
+            mapnik::image_rgba8 im(map.width(), map.height());
+            mapnik::agg_renderer<mapnik::image_rgba8> ren(map, im);
+            ren.set_query_pool(std::make_shared<mapnik::util::thread_pool>(2));
+            auto report = std::make_shared<mapnik::render_report>();
+            ren.set_render_report(report);
+            REQUIRE_NOTHROW(ren.apply());
+            REQUIRE(report->layer("first").query.features > 0);
+            REQUIRE(report->layer("second").query.features == report->layer("first").query.features);
+            REQUIRE(ds->query_slots().in_flight() == 0);
+        }
+
         SECTION("Postgis doesn't interpret @domain in email address as @variable")
         {
             mapnik::parameters params(base_params);
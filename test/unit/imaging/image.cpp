@@ -7,6 +7,11 @@
 #include <mapnik/image_any.hpp>
 #include <mapnik/color.hpp>
 #include <mapnik/image_util.hpp>
+#include <mapnik/image_compositing.hpp>
+#include <mapnik/geometry/box2d.hpp>
+
+// stl
+#include <cstring>
 
 TEST_CASE("image class") {
 
@@ -389,4 +394,44 @@ SECTION("image::swap")
     }
 }
 
+SECTION("nonzero_extent")
+{
+    mapnik::image_rgba8 im(16, 8);
+    CHECK_FALSE(mapnik::nonzero_extent(im).valid());
+
+    im(3, 2) = 0x01000000;
+    CHECK(mapnik::nonzero_extent(im) == mapnik::box2d<int>(3, 2, 4, 3));
+
+    im(15, 7) = 1;
+    im(1, 5) = 1;
+    CHECK(mapnik::nonzero_extent(im) == mapnik::box2d<int>(1, 2, 16, 8));
+}
+
+SECTION("composite region")
+{
+    // compositing the non-transparent region only gives the same result
+    mapnik::image_rgba8 src(32, 32, true, true);
+    for (std::size_t y = 10; y < 20; ++y)
+    {
+        for (std::size_t x = 5; x < 12; ++x)
+        {
+            src(x, y) = mapnik::color(100, 20, 30, 200, true).rgba();
+        }
+    }
+    mapnik::box2d<int> extent = mapnik::nonzero_extent(src);
+    REQUIRE(extent == mapnik::box2d<int>(5, 10, 12, 20));
+    for (mapnik::composite_mode_e mode : { mapnik::src_over, mapnik::multiply, mapnik::dst_over, mapnik::_xor })
+    {
+        REQUIRE(mapnik::transparent_source_is_noop(mode));
+        mapnik::image_rgba8 full(32, 32, true, true);
+        mapnik::fill(full, mapnik::color(10, 50, 90, 120, true));
+        mapnik::image_rgba8 region(full);
+        mapnik::composite(full, src, mode, 0.7f, 3, -2);
+        mapnik::composite(region, src, extent, mode, 0.7f, 3, -2);
+        CHECK(std::memcmp(full.bytes(), region.bytes(), full.size()) == 0);
+    }
+    CHECK_FALSE(mapnik::transparent_source_is_noop(mapnik::dst_in));
+    CHECK_FALSE(mapnik::transparent_source_is_noop(mapnik::src));
+}
+
 } // END TEST CASE
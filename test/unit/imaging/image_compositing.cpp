@@ -0,0 +1,104 @@
+#include "catch.hpp"
+
+// mapnik
+#include <mapnik/image.hpp>
+#include <mapnik/image_compositing.hpp>
+#include <mapnik/geometry/box2d.hpp>
+#include <mapnik/util/cpu_features.hpp>
+
+// stl
+#include <cstring>
+#include <random>
+#include <vector>
+
+namespace {
+
+mapnik::image_rgba8 random_image(std::size_t width, std::size_t height, std::mt19937 & engine, bool premultiplied)
+{
+    mapnik::image_rgba8 im(width, height, true, true);
+    std::uniform_int_distribution<int> dist(0, 255);
+    std::uint8_t * bytes = im.bytes();
+    for (std::size_t i = 0; i < im.size(); i += 4)
+    {
+        // mostly transparent or opaque pixels, like rendered layers
+        int a = dist(engine);
+        a = a < 96 ? 0 : (a > 160 ? 255 : a);
+        for (std::size_t c = 0; c < 3; ++c)
+        {
+            int v = dist(engine);
+            bytes[i + c] = static_cast<std::uint8_t>(premultiplied ? (v * a) / 255 : v);
+        }
+        bytes[i + 3] = static_cast<std::uint8_t>(a);
+    }
+    return im;
+}
+
+struct simd_level_guard
+{
+    ~simd_level_guard() { mapnik::util::set_simd_level(mapnik::util::detected_simd_level()); }
+};
+
+} // namespace
+
+TEST_CASE("image compositing") {
+
+SECTION("vectorized comp-ops match agg blenders") {
+
+    using mapnik::util::simd_level;
+    simd_level_guard guard;
+    std::vector<simd_level> levels;
+    for (int l = static_cast<int>(simd_level::sse41); l <= static_cast<int>(mapnik::util::detected_simd_level()); ++l)
+    {
+        levels.push_back(static_cast<simd_level>(l));
+    }
+    std::mt19937 engine(42);
+    std::vector<mapnik::composite_mode_e> modes = { mapnik::src_over, mapnik::multiply, mapnik::screen,
+                                                    mapnik::dst_out, mapnik::dst_in, mapnik::overlay };
+    for (bool premultiplied : { true, false })
+    {
+        // odd width so rows end with a scalar tail
+        mapnik::image_rgba8 src = random_image(37, 11, engine, premultiplied);
+        mapnik::image_rgba8 dst = random_image(37, 11, engine, premultiplied);
+        for (auto mode : modes)
+        {
+            for (float opacity : { 1.0f, 0.5f, 0.0f })
+            {
+                for (int dx : { 0, 3, -5 })
+                {
+                    mapnik::util::set_simd_level(simd_level::none);
+                    mapnik::image_rgba8 expected(dst);
+                    mapnik::composite(expected, src, mode, opacity, dx, 1);
+                    for (auto level : levels)
+                    {
+                        mapnik::util::set_simd_level(level);
+                        INFO("mode " << mode << " opacity " << opacity << " dx " << dx << " level " << static_cast<int>(level));
+                        mapnik::image_rgba8 result(dst);
+                        mapnik::composite(result, src, mode, opacity, dx, 1);
+                        CHECK(std::memcmp(result.bytes(), expected.bytes(), result.size()) == 0);
+
+                        mapnik::box2d<int> region(2, 3, 33, 9);
+                        mapnik::util::set_simd_level(simd_level::none);
+                        mapnik::image_rgba8 expected_region(dst);
+                        mapnik::composite(expected_region, src, region, mode, opacity, dx, 0);
+                        mapnik::util::set_simd_level(level);
+                        mapnik::image_rgba8 result_region(dst);
+                        mapnik::composite(result_region, src, region, mode, opacity, dx, 0);
+                        CHECK(std::memcmp(result_region.bytes(), expected_region.bytes(), result_region.size()) == 0);
+                    }
+                }
+            }
+        }
+    }
+}
+
+SECTION("simd level is clamped to the detected level") {
+
+    using mapnik::util::simd_level;
+    simd_level_guard guard;
+    mapnik::util::set_simd_level(simd_level::avx2);
+    CHECK(mapnik::util::active_simd_level() == mapnik::util::detected_simd_level());
+    mapnik::util::set_simd_level(simd_level::none);
+    CHECK(mapnik::util::active_simd_level() == simd_level::none);
+}
+
+} // END TEST CASE
@@ -7,9 +7,14 @@
 #include <mapnik/image_filter.hpp>
 #include <mapnik/image_util.hpp>
 #include <mapnik/image_filter_types.hpp>
+#include <mapnik/util/cpu_features.hpp>
+#include <mapnik/util/thread_pool.hpp>
 // stl
 #include <sstream>
 #include <array>
+#include <cstring>
+#include <random>
+#include <vector>
 
 TEST_CASE("image filter") {
 
@@ -521,3 +526,141 @@ SECTION("test color-blind-tritanope") {
 } // END SECTION
 
 } // END TEST CASE
+
+namespace {
+
+mapnik::image_rgba8 random_image(std::size_t width, std::size_t height, std::mt19937 & engine)
+{
+    mapnik::image_rgba8 im(width, height, true, true);
+    std::uniform_int_distribution<int> dist(0, 255);
+    std::uint8_t * bytes = im.bytes();
+    for (std::size_t i = 0; i < im.size(); i += 4)
+    {
+        int a = dist(engine);
+        for (std::size_t c = 0; c < 3; ++c)
+        {
+            bytes[i + c] = static_cast<std::uint8_t>((dist(engine) * a) / 255);
+        }
+        bytes[i + 3] = static_cast<std::uint8_t>(a);
+    }
+    return im;
+}
+
+bool same_pixels(mapnik::image_rgba8 const& a, mapnik::image_rgba8 const& b)
+{
+    return a.width() == b.width() && a.height() == b.height()
+        && std::memcmp(a.bytes(), b.bytes(), a.size()) == 0;
+}
+
+struct simd_level_guard
+{
+    ~simd_level_guard() { mapnik::util::set_simd_level(mapnik::util::detected_simd_level()); }
+};
+
+template <typename Filter>
+void check_convolution(mapnik::image_rgba8 const& src, Filter const& filter,
+                       std::vector<mapnik::util::simd_level> const& levels,
+                       mapnik::util::thread_pool & pool)
+{
+    mapnik::image_rgba8 expected(src);
+    mapnik::demultiply_alpha(expected);
+    {
+        mapnik::filter::double_buffer<mapnik::image_rgba8> tb(expected);
+        mapnik::filter::apply_convolution_3x3(tb.src_view, tb.dst_view, filter);
+    }
+    for (auto level : levels)
+    {
+        mapnik::util::set_simd_level(level);
+        for (mapnik::util::thread_pool * p : { static_cast<mapnik::util::thread_pool*>(nullptr), &pool })
+        {
+            mapnik::image_rgba8 im(src);
+            mapnik::filter::apply_filter(im, filter, 1.0, p);
+            INFO(filter << " " << src.width() << "x" << src.height()
+                 << " level " << static_cast<int>(level) << (p ? " pool" : ""));
+            CHECK(same_pixels(im, expected));
+        }
+    }
+}
+
+} // namespace
+
+TEST_CASE("image filter bands") {
+
+using mapnik::util::simd_level;
+simd_level_guard guard;
+std::vector<simd_level> levels;
+for (int l = static_cast<int>(simd_level::none); l <= static_cast<int>(mapnik::util::detected_simd_level()); ++l)
+{
+    levels.push_back(static_cast<simd_level>(l));
+}
+mapnik::util::thread_pool pool(3);
+std::mt19937 engine(11);
+
+SECTION("agg-stack-blur matches agg::stack_blur_rgba32") {
+
+    // sizes below and above the band size, and radii beyond the image size
+    std::vector<std::array<std::size_t, 2>> sizes = { {{1, 1}}, {{2, 3}}, {{67, 53}}, {{130, 41}} };
+    std::vector<std::array<unsigned, 2>> radii = { {{1, 1}}, {{2, 7}}, {{5, 5}}, {{40, 3}}, {{300, 300}} };
+    for (auto const& size : sizes)
+    {
+        mapnik::image_rgba8 src = random_image(size[0], size[1], engine);
+        for (auto const& r : radii)
+        {
+            mapnik::image_rgba8 expected(src);
+            {
+                agg::rendering_buffer buf(expected.bytes(), expected.width(), expected.height(), expected.row_size());
+                agg::pixfmt_rgba32_pre pixf(buf);
+                agg::stack_blur_rgba32(pixf, r[0], r[1]);
+            }
+            mapnik::filter::agg_stack_blur op(r[0], r[1]);
+            for (auto level : levels)
+            {
+                mapnik::util::set_simd_level(level);
+                for (mapnik::util::thread_pool * p : { static_cast<mapnik::util::thread_pool*>(nullptr), &pool })
+                {
+                    mapnik::image_rgba8 im(src);
+                    mapnik::filter::apply_filter(im, op, 1.0, p);
+                    INFO(size[0] << "x" << size[1] << " radius " << r[0] << "," << r[1]
+                         << " level " << static_cast<int>(level) << (p ? " pool" : ""));
+                    CHECK(same_pixels(im, expected));
+                }
+            }
+        }
+    }
+
+} // END SECTION
+
+SECTION("3x3 convolutions match apply_convolution_3x3") {
+
+    std::vector<std::array<std::size_t, 2>> sizes = { {{2, 2}}, {{3, 5}}, {{66, 53}}, {{67, 40}} };
+    for (auto const& size : sizes)
+    {
+        mapnik::image_rgba8 src = random_image(size[0], size[1], engine);
+        check_convolution(src, mapnik::filter::blur(), levels, pool);
+        check_convolution(src, mapnik::filter::emboss(), levels, pool);
+        check_convolution(src, mapnik::filter::sharpen(), levels, pool);
+        check_convolution(src, mapnik::filter::edge_detect(), levels, pool);
+        check_convolution(src, mapnik::filter::sobel(), levels, pool);
+    }
+
+} // END SECTION
+
+SECTION("pixel filters give the same result with a pool") {
+
+    mapnik::image_rgba8 src = random_image(45, 70, engine);
+    std::vector<mapnik::filter::filter_type> filters;
+    REQUIRE(mapnik::filter::parse_image_filters("scale-hsla(0.0,0.5,0.0,1.0,0.0,0.5,0.0,0.5) "
+                                                "colorize-alpha(#0000ff 0%,#00ff00 50%,#ff0000 100%) "
+                                                "colorize-alpha(green)", filters));
+    for (mapnik::filter::filter_type const& filter : filters)
+    {
+        mapnik::image_rgba8 expected(src);
+        mapnik::image_rgba8 im(src);
+        mapnik::util::apply_visitor(mapnik::filter::filter_visitor<mapnik::image_rgba8>(expected), filter);
+        mapnik::util::apply_visitor(mapnik::filter::filter_visitor<mapnik::image_rgba8>(im, 1.0, &pool), filter);
+        CHECK(same_pixels(im, expected));
+    }
+
+} // END SECTION
+
+} // END TEST CASE
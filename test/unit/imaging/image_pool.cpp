@@ -0,0 +1,121 @@
+
+#include "catch.hpp"
+
+// mapnik
+#include <mapnik/image.hpp>
+#include <mapnik/image_pool.hpp>
+#include <mapnik/image_util.hpp>
+#include <mapnik/agg_renderer.hpp>
+#include <mapnik/map.hpp>
+#include <mapnik/layer.hpp>
+#include <mapnik/rule.hpp>
+#include <mapnik/feature_type_style.hpp>
+#include <mapnik/feature_factory.hpp>
+#include <mapnik/memory_datasource.hpp>
+#include <mapnik/symbolizer.hpp>
+#include <mapnik/image_filter_types.hpp>
+
+TEST_CASE("image_pool") {
+
+SECTION("reuses released images of the same size") {
+
+    mapnik::image_pool<mapnik::image_rgba8> pool(2);
+    auto im = pool.acquire(16, 8);
+    REQUIRE(im->width() == 16);
+    REQUIRE(im->height() == 8);
+    im->painted(true);
+    im->set_premultiplied(true);
+    mapnik::image_rgba8 const* data = im.get();
+    pool.release(std::move(im));
+    REQUIRE(pool.size() == 1);
+
+    auto other = pool.acquire(8, 8);
+    REQUIRE(other.get() != data);
+    REQUIRE(pool.size() == 1);
+
+    auto reused = pool.acquire(16, 8);
+    REQUIRE(reused.get() == data);
+    REQUIRE_FALSE(reused->painted());
+    REQUIRE_FALSE(reused->get_premultiplied());
+    REQUIRE(pool.size() == 0);
+
+    pool.release(std::move(reused));
+    pool.release(std::move(other));
+    pool.release(pool.acquire(4, 4));
+    REQUIRE(pool.size() == pool.max_size());
+    pool.clear();
+    REQUIRE(pool.size() == 0);
+}
+
+SECTION("buffer_stack borrows from the pool and clears buffers") {
+
+    auto pool = std::make_shared<mapnik::image_pool<mapnik::image_rgba8>>();
+    {
+        mapnik::buffer_stack<mapnik::image_rgba8> buffers(4, 4);
+        buffers.set_pool(pool);
+        mapnik::image_rgba8 & first = buffers.push();
+        mapnik::fill(first, 0xffffffff);
+        mapnik::image_rgba8 & second = buffers.push();
+        REQUIRE(&first != &second);
+        buffers.pop();
+        REQUIRE(&buffers.top() == &first);
+        buffers.pop();
+        REQUIRE_FALSE(buffers.in_range());
+        REQUIRE(pool->size() == 0);
+    }
+    REQUIRE(pool->size() == 2);
+    {
+        mapnik::buffer_stack<mapnik::image_rgba8> buffers(4, 4);
+        buffers.set_pool(pool);
+        mapnik::image_rgba8 & im = buffers.push();
+        REQUIRE(pool->size() == 1);
+        REQUIRE(mapnik::is_solid(im));
+        REQUIRE(im(0, 0) == 0);
+    }
+    REQUIRE(pool->size() == 2);
+}
+
+SECTION("image filter scratch buffers come from the pool") {
+
+    mapnik::parameters params;
+    params["type"] = "memory";
+    auto ds = std::make_shared<mapnik::memory_datasource>(params);
+    mapnik::context_ptr ctx = std::make_shared<mapnik::context_type>();
+    mapnik::feature_ptr feature(mapnik::feature_factory::create(ctx, 1));
+    feature->set_geometry(mapnik::geometry::point<double>(32, 32));
+    ds->push(feature);
+    mapnik::Map map(128, 128);
+    mapnik::feature_type_style style;
+    // a local filter, only the region around the marker is filtered
+    REQUIRE(mapnik::filter::parse_image_filters("agg-stack-blur(2,2)", style.image_filters()));
+    mapnik::rule r;
+    r.append(mapnik::markers_symbolizer());
+    style.add_rule(std::move(r));
+    map.insert_style("blurred", std::move(style));
+    mapnik::layer lyr("points");
+    lyr.set_datasource(ds);
+    lyr.add_style("blurred");
+    map.add_layer(lyr);
+    map.zoom_to_box(mapnik::box2d<double>(0, 0, 128, 128));
+
+    mapnik::image_rgba8 expected(128, 128);
+    {
+        mapnik::agg_renderer<mapnik::image_rgba8> ren(map, expected);
+        ren.apply();
+    }
+    auto pool = std::make_shared<mapnik::image_pool<mapnik::image_rgba8>>();
+    for (int pass = 0; pass < 2; ++pass)
+    {
+        mapnik::image_rgba8 image(128, 128);
+        mapnik::agg_renderer<mapnik::image_rgba8> ren(map, image);
+        ren.set_buffer_pool(pool);
+        ren.apply();
+        REQUIRE(mapnik::compare(image, expected, 0) == 0);
+    }
+    // the style's compositing buffer and the scratch buffer of the region
+    REQUIRE(pool->size() == 2);
+    pool->acquire(128, 128);
+    REQUIRE(pool->size() == 1);
+}
+
+}
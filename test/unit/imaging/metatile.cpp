@@ -0,0 +1,159 @@
+#include "catch.hpp"
+
+// mapnik
+#include <mapnik/image.hpp>
+#include <mapnik/image_any.hpp>
+#include <mapnik/image_reader.hpp>
+#include <mapnik/color.hpp>
+#include <mapnik/image_util.hpp>
+#include <mapnik/metatile.hpp>
+#include <mapnik/map.hpp>
+#include <mapnik/layer.hpp>
+#include <mapnik/rule.hpp>
+#include <mapnik/feature_type_style.hpp>
+#include <mapnik/feature_factory.hpp>
+#include <mapnik/memory_datasource.hpp>
+#include <mapnik/symbolizer.hpp>
+#include <mapnik/agg_renderer.hpp>
+#include <mapnik/render_plan.hpp>
+#include <mapnik/util/thread_pool.hpp>
+
+// stl
+#include <memory>
+
+namespace {
+
+// markers on tile borders and just outside the map extent, which tiles only
+// show when they are rendered with the map's buffer
+mapnik::Map markers_map()
+{
+    mapnik::parameters params;
+    params["type"] = "memory";
+    auto ds = std::make_shared<mapnik::memory_datasource>(params);
+    mapnik::context_ptr ctx = std::make_shared<mapnik::context_type>();
+    double const positions[][2] = { { 62, 30 }, { 64.5, 64 }, { 20, 66 }, { 100, 61.5 },
+                                    { -3, 40 }, { 131, 100 }, { 90, -4 }, { 30, 130 } };
+    mapnik::value_integer id = 0;
+    for (auto const& pos : positions)
+    {
+        mapnik::feature_ptr feature(mapnik::feature_factory::create(ctx, ++id));
+        feature->set_geometry(mapnik::geometry::point<double>(pos[0], pos[1]));
+        ds->push(feature);
+    }
+    mapnik::Map map(128, 128);
+    map.set_buffer_size(16);
+    mapnik::feature_type_style style;
+    mapnik::rule r;
+    mapnik::markers_symbolizer sym;
+    mapnik::put(sym, mapnik::keys::allow_overlap, true);
+    r.append(std::move(sym));
+    style.add_rule(std::move(r));
+    map.insert_style("markers", std::move(style));
+    mapnik::layer lyr("markers");
+    lyr.set_datasource(ds);
+    lyr.add_style("markers");
+    map.add_layer(lyr);
+    map.zoom_to_box(mapnik::box2d<double>(0, 0, 128, 128));
+    return map;
+}
+
+}
+
+TEST_CASE("metatile") {
+
+SECTION("encode_metatile slices tiles in row-major order") {
+
+#if defined(HAVE_PNG)
+    mapnik::image_rgba8 im(8,8);
+    mapnik::color c_red("red");
+    mapnik::color c_blue("blue");
+    mapnik::color c_green("green");
+    mapnik::color c_yellow("yellow");
+    mapnik::fill(im, c_red);
+    for (std::size_t y = 0; y < 4; ++y)
+    {
+        for (std::size_t x = 0; x < 4; ++x)
+        {
+            mapnik::set_pixel(im, x, y, c_blue);
+            mapnik::set_pixel(im, x + 4, y, c_green);
+            mapnik::set_pixel(im, x, y + 4, c_yellow);
+        }
+    }
+    mapnik::color expected[] = { c_blue, c_green, c_yellow, c_red };
+
+    mapnik::util::thread_pool pool(2);
+    std::vector<std::string> serial = mapnik::encode_metatile(im, 4, "png32");
+    std::vector<std::string> parallel = mapnik::encode_metatile(im, 4, "png32", &pool);
+    REQUIRE(serial.size() == 4);
+    REQUIRE(serial == parallel);
+
+    for (std::size_t i = 0; i < serial.size(); ++i)
+    {
+        std::unique_ptr<mapnik::image_reader> reader(mapnik::get_image_reader(serial[i].data(), serial[i].size()));
+        REQUIRE(reader);
+        REQUIRE(reader->width() == 4);
+        REQUIRE(reader->height() == 4);
+        mapnik::image_any data = reader->read(0, 0, 4, 4);
+        REQUIRE(data.is<mapnik::image_rgba8>());
+        mapnik::image_rgba8 const& tile = data.get<mapnik::image_rgba8>();
+        mapnik::image_rgba8 reference(4, 4);
+        mapnik::fill(reference, expected[i]);
+        CHECK(mapnik::compare(tile, reference) == 0);
+    }
+#endif
+
+    CHECK_THROWS(mapnik::encode_metatile(mapnik::image_rgba8(6,6), 4, "png32"));
+}
+
+SECTION("render_metatile matches individually rendered tiles") {
+
+#if defined(HAVE_PNG)
+    mapnik::Map map = markers_map();
+    mapnik::metatile_options options;
+    options.tiles = 2;
+    options.tile_size = 64;
+    options.format = "png32";
+    options.query_pool = std::make_shared<mapnik::util::thread_pool>(2);
+    std::vector<std::string> tiles = mapnik::render_metatile(map, mapnik::box2d<double>(0, 0, 128, 128), options);
+    REQUIRE(tiles.size() == 4);
+    CHECK(map.width() == 128);
+
+    for (std::size_t i = 0; i < tiles.size(); ++i)
+    {
+        INFO("tile " << i);
+        // rows go down from the top of the extent
+        double x = (i % 2) * 64.0;
+        double y = 64.0 - (i / 2) * 64.0;
+        mapnik::Map tile_map(map);
+        tile_map.resize(64, 64);
+        tile_map.zoom_to_box(mapnik::box2d<double>(x, y, x + 64, y + 64));
+        mapnik::image_rgba8 reference(64, 64);
+        mapnik::agg_renderer<mapnik::image_rgba8> ren(tile_map, reference);
+        ren.apply();
+
+        std::unique_ptr<mapnik::image_reader> reader(mapnik::get_image_reader(tiles[i].data(), tiles[i].size()));
+        REQUIRE(reader);
+        mapnik::image_any data = reader->read(0, 0, 64, 64);
+        REQUIRE(data.is<mapnik::image_rgba8>());
+        mapnik::image_rgba8 const& tile = data.get<mapnik::image_rgba8>();
+        // the metatile is rasterized at another origin, which can round
+        // antialiased edges differently
+        CHECK(mapnik::compare(tile, reference, 2) == 0);
+        // every tile shows part of a marker
+        CHECK_FALSE(mapnik::is_solid(reference));
+    }
+
+    // render plans are created for the caller's map and can be reused
+    options.plans = std::make_shared<mapnik::render_plan_cache>(map);
+    CHECK(mapnik::render_metatile(map, mapnik::box2d<double>(0, 0, 128, 128), options) == tiles);
+    CHECK(options.plans->size() == 1);
+    options.plans.reset();
+
+    // without the map's buffer the markers beyond the extent are cut off
+    options.buffer_size = 0;
+    std::vector<std::string> unbuffered = mapnik::render_metatile(map, mapnik::box2d<double>(0, 0, 128, 128), options);
+    CHECK(unbuffered != tiles);
+#endif
+}
+
+}
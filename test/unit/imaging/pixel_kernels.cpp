@@ -0,0 +1,121 @@
+#include "catch.hpp"
+
+// mapnik
+#include <mapnik/pixel_kernels.hpp>
+#include <mapnik/util/cpu_features.hpp>
+#include <mapnik/image.hpp>
+#include <mapnik/image_util.hpp>
+#include <mapnik/color.hpp>
+
+// stl
+#include <functional>
+#include <random>
+#include <vector>
+
+namespace {
+
+using pixels_type = std::vector<std::uint32_t>;
+
+// every combination of colour value and alpha, plus random pixels so that
+// the length is not a multiple of any vector width
+pixels_type test_pixels()
+{
+    pixels_type pixels;
+    for (std::uint32_t a = 0; a < 256; ++a)
+    {
+        for (std::uint32_t c = 0; c < 256; ++c)
+        {
+            pixels.push_back((a << 24) | ((255 - c) << 16) | ((c * 7) & 0xff) << 8 | c);
+        }
+    }
+    std::mt19937 engine(7);
+    std::uniform_int_distribution<std::uint32_t> dist;
+    for (std::size_t i = 0; i < 1001; ++i)
+    {
+        pixels.push_back(dist(engine));
+    }
+    return pixels;
+}
+
+struct simd_level_guard
+{
+    ~simd_level_guard() { mapnik::util::set_simd_level(mapnik::util::detected_simd_level()); }
+};
+
+void check_against_scalar(std::function<void(std::uint32_t *, std::size_t)> const& kernel)
+{
+    using mapnik::util::simd_level;
+    simd_level_guard guard;
+    pixels_type const input = test_pixels();
+    pixels_type expected(input);
+    mapnik::util::set_simd_level(simd_level::none);
+    kernel(expected.data(), expected.size());
+    for (int l = static_cast<int>(simd_level::sse41); l <= static_cast<int>(mapnik::util::detected_simd_level()); ++l)
+    {
+        mapnik::util::set_simd_level(static_cast<simd_level>(l));
+        // also start off a vector boundary
+        for (std::size_t offset : { 0, 1, 3 })
+        {
+            pixels_type result(input);
+            kernel(result.data() + offset, result.size() - offset);
+            pixels_type reference(input);
+            mapnik::util::set_simd_level(simd_level::none);
+            kernel(reference.data() + offset, reference.size() - offset);
+            mapnik::util::set_simd_level(static_cast<simd_level>(l));
+            INFO("level " << l << " offset " << offset);
+            CHECK(result == reference);
+        }
+    }
+    if (mapnik::util::detected_simd_level() != simd_level::none)
+    {
+        pixels_type result(input);
+        kernel(result.data(), result.size());
+        CHECK(result == expected);
+    }
+}
+
+} // namespace
+
+TEST_CASE("pixel kernels") {
+
+SECTION("premultiply") {
+    check_against_scalar([](std::uint32_t * p, std::size_t n) { mapnik::kernels::premultiply(p, n); });
+}
+
+SECTION("demultiply") {
+    check_against_scalar([](std::uint32_t * p, std::size_t n) { mapnik::kernels::demultiply(p, n); });
+}
+
+SECTION("apply opacity") {
+    for (float opacity : { 0.0f, 0.3f, 0.5f, 0.77f, 1.0f })
+    {
+        check_against_scalar([opacity](std::uint32_t * p, std::size_t n) { mapnik::kernels::apply_opacity(p, n, opacity); });
+    }
+}
+
+SECTION("grayscale to alpha") {
+    check_against_scalar([](std::uint32_t * p, std::size_t n) { mapnik::kernels::grayscale_to_alpha(p, n, 0xffffff); });
+    check_against_scalar([](std::uint32_t * p, std::size_t n) { mapnik::kernels::grayscale_to_alpha(p, n, 0x123456); });
+}
+
+SECTION("color to alpha") {
+    check_against_scalar([](std::uint32_t * p, std::size_t n) { mapnik::kernels::color_to_alpha(p, n, 0x00f80707); });
+}
+
+SECTION("fill") {
+    check_against_scalar([](std::uint32_t * p, std::size_t n) { mapnik::kernels::fill(p, n, 0x80402010); });
+}
+
+SECTION("image_util round trip") {
+    mapnik::image_rgba8 im(33, 5);
+    mapnik::fill(im, mapnik::color(200, 100, 50, 128));
+    CHECK(im(32, 4) == mapnik::color(200, 100, 50, 128).rgba());
+    mapnik::premultiply_alpha(im);
+    CHECK(im(0, 0) == mapnik::color(100, 50, 25, 128).rgba());
+    mapnik::demultiply_alpha(im);
+    CHECK(im(17, 3) == mapnik::color(199, 99, 49, 128).rgba());
+    mapnik::set_color_to_alpha(im, mapnik::color(199, 99, 49));
+    CHECK(im(32, 4) == 0);
+}
+
+} // END TEST CASE
@@ -0,0 +1,72 @@
+#include "catch.hpp"
+
+// mapnik
+#include <mapnik/proj_transform_cache.hpp>
+#include <mapnik/projection.hpp>
+
+// stl
+#include <thread>
+
+TEST_CASE("proj_transform_cache") {
+
+SECTION("transforms are initialized once per thread") {
+    mapnik::proj_transform_cache & cache = mapnik::proj_transform_cache::instance();
+    cache.clear();
+    mapnik::proj_transform_cache_stats before = cache.stats();
+
+    auto trans = cache.get("+init=epsg:4326", "+init=epsg:3857");
+    REQUIRE(trans);
+    CHECK(trans->source().params() == "+init=epsg:4326");
+    CHECK(trans->dest().params() == "+init=epsg:3857");
+    CHECK(trans->is_known());
+    double x = 0, y = 0, z = 0;
+    CHECK(trans->forward(x, y, z));
+    CHECK(x == Approx(0));
+    CHECK(y == Approx(0));
+
+    CHECK(cache.get("+init=epsg:4326", "+init=epsg:3857") == trans);
+    auto reverse = cache.get("+init=epsg:3857", "+init=epsg:4326");
+    CHECK(reverse != trans);
+    CHECK(reverse->source().params() == "+init=epsg:3857");
+    auto identity = cache.get("+init=epsg:3857", "+init=epsg:3857");
+    CHECK(identity->equal());
+
+    mapnik::proj_transform_cache::transform_ptr other;
+    std::thread thread([&]() { other = cache.get("+init=epsg:4326", "+init=epsg:3857"); });
+    thread.join();
+    REQUIRE(other);
+    CHECK(other != trans);
+    CHECK(other->is_known());
+
+    mapnik::proj_transform_cache_stats after = cache.stats();
+    CHECK(after.lookups - before.lookups == 5);
+    CHECK(after.inits - before.inits == 4);
+    CHECK(after.lookup_time >= before.lookup_time);
+    CHECK(after.init_time >= before.init_time);
+    CHECK(after.lookup_time >= after.init_time);
+}
+
+SECTION("clear drops entries, held transforms stay valid") {
+    mapnik::proj_transform_cache & cache = mapnik::proj_transform_cache::instance();
+    auto trans = cache.get("+init=epsg:4326", "+init=epsg:3857");
+    cache.clear();
+    std::size_t inits = cache.stats().inits;
+    auto again = cache.get("+init=epsg:4326", "+init=epsg:3857");
+    CHECK(again != trans);
+    CHECK(cache.stats().inits == inits + 1);
+    double x = 180, y = 0, z = 0;
+    CHECK(trans->forward(x, y, z));
+    CHECK(x == Approx(20037508.342789244));
+}
+
+#if !defined(MAPNIK_USE_PROJ4)
+SECTION("failed inits are not cached") {
+    mapnik::proj_transform_cache & cache = mapnik::proj_transform_cache::instance();
+    std::size_t inits = cache.stats().inits;
+    CHECK_THROWS(cache.get("+init=epsg:4326", "+proj=ortho"));
+    CHECK_THROWS(cache.get("+init=epsg:4326", "+proj=ortho"));
+    CHECK(cache.stats().inits == inits);
+}
+#endif
+
+} // END TEST CASE
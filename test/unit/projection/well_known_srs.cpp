@@ -0,0 +1,196 @@
+#include "catch.hpp"
+
+// mapnik
+#include <mapnik/well_known_srs.hpp>
+#include <mapnik/util/cpu_features.hpp>
+#include <mapnik/projection.hpp>
+#include <mapnik/proj_transform.hpp>
+#include <mapnik/geometry/box2d.hpp>
+
+// stl
+#include <cmath>
+#include <limits>
+#include <vector>
+
+namespace {
+
+using coords_type = std::vector<double>;
+
+struct simd_level_guard
+{
+    ~simd_level_guard() { mapnik::util::set_simd_level(mapnik::util::detected_simd_level()); }
+};
+
+// a grid covering and overshooting the valid range, with a length that is
+// not a multiple of any vector width
+void test_coords(coords_type & x, coords_type & y, double max_x, double max_y)
+{
+    int const steps = 101;
+    for (int i = 0; i <= steps; ++i)
+    {
+        for (int j = 0; j <= steps; ++j)
+        {
+            x.push_back(-1.1 * max_x + 2.2 * max_x * i / steps);
+            y.push_back(-1.1 * max_y + 2.2 * max_y * j / steps);
+        }
+    }
+    x.push_back(0.0);
+    y.push_back(0.0);
+}
+
+template <typename Transform>
+void check_against_scalar(Transform transform, double max_x, double max_y, double tolerance)
+{
+    using mapnik::util::simd_level;
+    simd_level_guard guard;
+    coords_type input_x, input_y;
+    test_coords(input_x, input_y, max_x, max_y);
+    for (int l = static_cast<int>(simd_level::sse41); l <= static_cast<int>(mapnik::util::detected_simd_level()); ++l)
+    {
+        // also start off a vector boundary
+        for (std::size_t offset : { 0, 1, 3 })
+        {
+            std::size_t count = input_x.size() - offset;
+            coords_type x(input_x), y(input_y);
+            mapnik::util::set_simd_level(static_cast<simd_level>(l));
+            CHECK(transform(x.data() + offset, y.data() + offset, count));
+            coords_type ref_x(input_x), ref_y(input_y);
+            mapnik::util::set_simd_level(simd_level::none);
+            CHECK(transform(ref_x.data() + offset, ref_y.data() + offset, count));
+            INFO("level " << l << " offset " << offset);
+            double max_dx = 0, max_dy = 0;
+            for (std::size_t i = offset; i < x.size(); ++i)
+            {
+                max_dx = std::max(max_dx, std::abs(x[i] - ref_x[i]));
+                max_dy = std::max(max_dy, std::abs(y[i] - ref_y[i]));
+            }
+            CHECK(max_dx <= tolerance);
+            CHECK(max_dy <= tolerance);
+        }
+    }
+}
+
+} // namespace
+
+TEST_CASE("well known srs") {
+
+SECTION("lonlat2merc matches scalar code") {
+    check_against_scalar([](double * x, double * y, std::size_t n) { return mapnik::lonlat2merc(x, y, n); },
+                         180.0, 90.0, 1e-6);
+}
+
+SECTION("merc2lonlat matches scalar code") {
+    check_against_scalar([](double * x, double * y, std::size_t n) { return mapnik::merc2lonlat(x, y, n); },
+                         mapnik::MAXEXTENT, mapnik::MAXEXTENT, 1e-13);
+}
+
+SECTION("known values and clamping") {
+    double x[] = { 0.0, 180.0, -200.0, 45.0, 10.0 };
+    double y[] = { 0.0, 85.0511287798066, -90.0, 45.0, 10.0 };
+    REQUIRE(mapnik::lonlat2merc(x, y, 5));
+    CHECK(x[0] == Approx(0.0));
+    CHECK(y[0] == Approx(0.0));
+    CHECK(x[1] == Approx(20037508.342789244));
+    CHECK(y[1] == Approx(20037508.342789244));
+    CHECK(x[2] == Approx(-20037508.342789244));
+    CHECK(y[2] == Approx(-20037508.342789244));
+    CHECK(x[3] == Approx(5009377.085697311));
+    CHECK(y[3] == Approx(5621521.486192066));
+    REQUIRE(mapnik::merc2lonlat(x, y, 5));
+    CHECK(x[3] == Approx(45.0));
+    CHECK(y[3] == Approx(45.0));
+    CHECK(x[4] == Approx(10.0));
+    CHECK(y[4] == Approx(10.0));
+}
+
+SECTION("nan propagates") {
+    simd_level_guard guard;
+    for (int l = 0; l <= static_cast<int>(mapnik::util::detected_simd_level()); ++l)
+    {
+        mapnik::util::set_simd_level(static_cast<mapnik::util::simd_level>(l));
+        double x[] = { 1.0, 2.0, 3.0, 4.0, 5.0 };
+        double y[] = { 1.0, std::numeric_limits<double>::quiet_NaN(), 3.0, 4.0, 5.0 };
+        mapnik::lonlat2merc(x, y, 5);
+        CHECK(std::isnan(y[1]));
+        CHECK(std::isfinite(y[0]));
+        y[1] = std::numeric_limits<double>::quiet_NaN();
+        mapnik::merc2lonlat(x, y, 5);
+        CHECK(std::isnan(y[1]));
+        CHECK(std::isfinite(y[0]));
+    }
+}
+
+SECTION("strided and point vector input match contiguous arrays") {
+    simd_level_guard guard;
+    coords_type x, y;
+    test_coords(x, y, 200.0, 100.0);
+    std::vector<mapnik::geometry::point<double>> points;
+    for (std::size_t i = 0; i < x.size(); ++i) points.emplace_back(x[i], y[i]);
+    for (int l = 0; l <= static_cast<int>(mapnik::util::detected_simd_level()); ++l)
+    {
+        INFO("level " << l);
+        mapnik::util::set_simd_level(static_cast<mapnik::util::simd_level>(l));
+        coords_type ref_x(x), ref_y(y);
+        REQUIRE(mapnik::lonlat2merc(ref_x.data(), ref_y.data(), ref_x.size()));
+        // three doubles per point, more than one block
+        coords_type xyz(3 * x.size(), -1.0);
+        for (std::size_t i = 0; i < x.size(); ++i)
+        {
+            xyz[3 * i] = x[i];
+            xyz[3 * i + 1] = y[i];
+        }
+        REQUIRE(mapnik::lonlat2merc(&xyz[0], &xyz[1], x.size(), 3));
+        auto merc = points;
+        REQUIRE(mapnik::lonlat2merc(merc));
+        for (std::size_t i = 0; i < x.size(); ++i)
+        {
+            CHECK(xyz[3 * i] == ref_x[i]);
+            CHECK(xyz[3 * i + 1] == ref_y[i]);
+            CHECK(xyz[3 * i + 2] == -1.0);
+            CHECK(merc[i].x == ref_x[i]);
+            CHECK(merc[i].y == ref_y[i]);
+        }
+        REQUIRE(mapnik::merc2lonlat(ref_x.data(), ref_y.data(), ref_x.size()));
+        REQUIRE(mapnik::merc2lonlat(merc));
+        for (std::size_t i = 0; i < x.size(); ++i)
+        {
+            CHECK(merc[i].x == ref_x[i]);
+            CHECK(merc[i].y == ref_y[i]);
+        }
+    }
+}
+
+SECTION("proj_transform strided and envelope transforms") {
+    mapnik::projection proj_4326("+init=epsg:4326");
+    mapnik::projection proj_3857("+init=epsg:3857");
+    mapnik::proj_transform prj_trans(proj_4326, proj_3857);
+
+    // interleaved x and y
+    double xy[] = { 10.0, 20.0, -30.0, 40.0, 50.0, -60.0 };
+    REQUIRE(prj_trans.forward(&xy[0], &xy[1], nullptr, 3, 2));
+    for (int i = 0; i < 3; ++i)
+    {
+        double x = i == 0 ? 10.0 : i == 1 ? -30.0 : 50.0;
+        double y = i == 0 ? 20.0 : i == 1 ? 40.0 : -60.0;
+        double z = 0;
+        prj_trans.forward(x, y, z);
+        CHECK(xy[2 * i] == Approx(x));
+        CHECK(xy[2 * i + 1] == Approx(y));
+    }
+
+    mapnik::box2d<double> box(-45.0, 55.0, -40.0, 75.0);
+    mapnik::box2d<double> dense(box);
+    prj_trans.forward(box);
+    prj_trans.forward(dense, 100);
+    CHECK(dense.minx() == Approx(box.minx()));
+    CHECK(dense.miny() == Approx(box.miny()));
+    CHECK(dense.maxx() == Approx(box.maxx()));
+    CHECK(dense.maxy() == Approx(box.maxy()));
+    prj_trans.backward(dense, 100);
+    CHECK(dense.minx() == Approx(-45.0));
+    CHECK(dense.miny() == Approx(55.0));
+    CHECK(dense.maxx() == Approx(-40.0));
+    CHECK(dense.maxy() == Approx(75.0));
+}
+
+} // END TEST CASE
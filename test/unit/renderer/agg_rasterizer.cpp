@@ -0,0 +1,95 @@
+#include "catch.hpp"
+
+// mapnik
+#include <mapnik/agg_rasterizer.hpp>
+#include <mapnik/image.hpp>
+#include <mapnik/image_util.hpp>
+#include <mapnik/render_report.hpp>
+
+// agg
+#include "agg_rendering_buffer.h"
+#include "agg_pixfmt_rgba.h"
+#include "agg_renderer_base.h"
+#include "agg_renderer_scanline.h"
+#include "agg_scanline_u.h"
+#include "agg_path_storage.h"
+
+TEST_CASE("agg rasterizer") {
+
+SECTION("records the bounds of rendered paths") {
+
+    mapnik::image_rgba8 im(64, 64);
+    agg::rendering_buffer buf(im.bytes(), im.width(), im.height(), im.row_size());
+    agg::pixfmt_rgba32_pre pixf(buf);
+    agg::renderer_base<agg::pixfmt_rgba32_pre> renb(pixf);
+    agg::renderer_scanline_aa_solid<agg::renderer_base<agg::pixfmt_rgba32_pre>> ren(renb);
+    ren.color(agg::rgba8_pre(255, 0, 0, 255));
+    agg::scanline_u8 sl;
+
+    mapnik::rasterizer ras;
+    CHECK_FALSE(ras.take_drawn().valid());
+
+    ras.move_to_d(10, 12);
+    ras.line_to_d(20, 12);
+    ras.line_to_d(20, 30);
+    ras.line_to_d(10, 30);
+    ras.close_polygon();
+    agg::render_scanlines(ras, sl, ren);
+
+    ras.reset();
+    ras.move_to_d(40, 40);
+    ras.line_to_d(50, 40);
+    ras.line_to_d(50, 45);
+    ras.close_polygon();
+    agg::render_scanlines(ras, sl, ren);
+
+    mapnik::box2d<int> drawn = ras.take_drawn();
+    REQUIRE(drawn.valid());
+    // the recorded box covers every written pixel
+    CHECK(mapnik::nonzero_extent(im) == drawn.intersect(mapnik::nonzero_extent(im)));
+    CHECK(drawn.minx() <= 10);
+    CHECK(drawn.miny() <= 12);
+    CHECK(drawn.maxx() >= 50);
+    CHECK(drawn.maxy() >= 45);
+    CHECK(drawn.maxx() <= 52);
+    CHECK(drawn.maxy() <= 47);
+    // taking resets the accumulator
+    CHECK_FALSE(ras.take_drawn().valid());
+
+    ras.add_drawn(mapnik::box2d<int>(1, 2, 3, 4));
+    CHECK(ras.take_drawn() == mapnik::box2d<int>(1, 2, 3, 4));
+}
+
+SECTION("times path conversion and sweeping") {
+
+    mapnik::image_rgba8 im(16, 16);
+    agg::rendering_buffer buf(im.bytes(), im.width(), im.height(), im.row_size());
+    agg::pixfmt_rgba32_pre pixf(buf);
+    agg::renderer_base<agg::pixfmt_rgba32_pre> renb(pixf);
+    agg::renderer_scanline_aa_solid<agg::renderer_base<agg::pixfmt_rgba32_pre>> ren(renb);
+    agg::scanline_u8 sl;
+
+    mapnik::rasterizer ras;
+    mapnik::render_stats geometry;
+    mapnik::render_stats rasterize;
+    ras.set_stats(&geometry, &rasterize);
+    agg::path_storage path;
+    path.move_to(1, 1);
+    path.line_to(10, 1);
+    path.line_to(10, 10);
+    path.close_polygon();
+    ras.add_path(path);
+    agg::render_scanlines(ras, sl, ren);
+    CHECK(geometry.calls == 1);
+    CHECK(rasterize.calls == 1);
+
+    // not timed once turned off
+    ras.set_stats(nullptr, nullptr);
+    ras.reset();
+    ras.add_path(path);
+    agg::render_scanlines(ras, sl, ren);
+    CHECK(geometry.calls == 1);
+    CHECK(rasterize.calls == 1);
+}
+
+}
@@ -6,6 +6,7 @@
 #include <mapnik/map.hpp>
 #include <mapnik/params.hpp>
 #include <mapnik/expression.hpp>
+#include <mapnik/feature_type_style.hpp>
 #include <mapnik/layer.hpp>
 #include <mapnik/rule.hpp>
 #include <mapnik/feature_style_processor.hpp>
@@ -13,6 +14,16 @@
 #include <mapnik/value/types.hpp>
 #include <mapnik/symbolizer.hpp>
 #include <mapnik/geometry/geometry_type.hpp>
+#include <mapnik/util/thread_pool.hpp>
+#include <mapnik/render_report.hpp>
+#include <mapnik/render_plan.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
 
 struct rendering_result
 {
@@ -142,6 +153,74 @@ std::shared_ptr<mapnik::memory_datasource> prepare_datasource()
     return datasource;
 }
 
+// memory datasource recording how many features() calls overlap
+class counting_datasource : public mapnik::memory_datasource
+{
+public:
+    counting_datasource(mapnik::parameters const& params, std::size_t max_queries)
+        : mapnik::memory_datasource(params),
+          max_queries_(max_queries),
+          mutex_(),
+          overlap_(),
+          in_flight_(0),
+          max_in_flight_(0) {}
+
+    mapnik::featureset_ptr features(mapnik::query const& q) const override
+    {
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            max_in_flight_ = std::max(max_in_flight_, ++in_flight_);
+            if (max_queries_ > 1)
+            {
+                // hold queries until two of them run at once
+                overlap_.notify_all();
+                overlap_.wait_for(lock, std::chrono::seconds(10), [this] { return max_in_flight_ > 1; });
+            }
+        }
+        if (max_queries_ == 1)
+        {
+            // leave other queries time to start if they were not serialized
+            std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        }
+        mapnik::featureset_ptr result = mapnik::memory_datasource::features(q);
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            --in_flight_;
+        }
+        return result;
+    }
+
+    std::size_t max_concurrent_queries() const override
+    {
+        return max_queries_;
+    }
+
+    int max_in_flight() const
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return max_in_flight_;
+    }
+
+private:
+    std::size_t max_queries_;
+    mutable std::mutex mutex_;
+    mutable std::condition_variable overlap_;
+    mutable int in_flight_;
+    mutable int max_in_flight_;
+};
+
+std::shared_ptr<counting_datasource> prepare_counting_datasource(std::size_t max_queries)
+{
+    mapnik::parameters params;
+    params["type"] = "memory";
+    auto datasource = std::make_shared<counting_datasource>(params, max_queries);
+    mapnik::context_ptr ctx = std::make_shared<mapnik::context_type>();
+    mapnik::feature_ptr feature(mapnik::feature_factory::create(ctx, 1));
+    feature->set_geometry(mapnik::geometry::point<double>(1, 2));
+    datasource->push(feature);
+    return datasource;
+}
+
 mapnik::Map prepare_map()
 {
     mapnik::Map map(256, 256);
@@ -189,6 +268,244 @@ SECTION("test_renderer") {
     REQUIRE(mapnik::geometry::geometry_type(result.geometries[1]) == mapnik::geometry::geometry_types::LineString);
 }
 
+SECTION("test_renderer - concurrent queries") {
+
+    mapnik::Map map(prepare_map());
+    mapnik::layer lyr2("layer2");
+    lyr2.set_datasource(prepare_datasource());
+    lyr2.add_style("lines");
+    map.add_layer(lyr2);
+    rendering_result result;
+    test_renderer renderer(map, result);
+    renderer.set_query_pool(std::make_shared<mapnik::util::thread_pool>(2));
+    renderer.apply();
+
+    REQUIRE(renderer.painted());
+
+    REQUIRE(result.start_map_processing == 1);
+    REQUIRE(result.end_map_processing == 1);
+    REQUIRE(result.end_layer_processing == 2);
+    REQUIRE(result.start_style_processing == 2);
+    REQUIRE(result.end_style_processing == 2);
+
+    REQUIRE(result.geometries.size() == 4);
+    for (std::size_t i = 0; i < result.geometries.size(); i += 2)
+    {
+        REQUIRE(mapnik::geometry::geometry_type(result.geometries[i]) == mapnik::geometry::geometry_types::Point);
+        REQUIRE(mapnik::geometry::geometry_type(result.geometries[i + 1]) == mapnik::geometry::geometry_types::LineString);
+    }
+}
+
+SECTION("test_renderer - concurrent queries are limited per datasource") {
+
+    for (std::size_t max_queries : { std::size_t(1), std::size_t(2), mapnik::query_slot_queue::unlimited })
+    {
+        mapnik::Map map(prepare_map());
+        auto datasource = prepare_counting_datasource(max_queries);
+        for (int i = 0; i < 4; ++i)
+        {
+            mapnik::layer lyr("counted" + std::to_string(i));
+            lyr.set_datasource(datasource);
+            lyr.add_style("lines");
+            map.add_layer(lyr);
+        }
+        rendering_result result;
+        test_renderer renderer(map, result);
+        renderer.set_query_pool(std::make_shared<mapnik::util::thread_pool>(4));
+        renderer.apply();
+
+        REQUIRE(result.end_layer_processing == 5);
+        REQUIRE(result.geometries.size() == 6);
+        if (max_queries == 1)
+        {
+            REQUIRE(datasource->max_in_flight() == 1);
+        }
+        else if (max_queries == 2)
+        {
+            REQUIRE(datasource->max_in_flight() == 2);
+        }
+        else
+        {
+            REQUIRE(datasource->max_in_flight() > 1);
+        }
+        REQUIRE(datasource->query_slots().in_flight() == 0);
+    }
+}
+
+SECTION("test_renderer - concurrent queries past the buffer limit") {
+
+    mapnik::Map map(prepare_map());
+    auto datasource = prepare_counting_datasource(1);
+    mapnik::context_ptr ctx = std::make_shared<mapnik::context_type>();
+    mapnik::feature_ptr feature(mapnik::feature_factory::create(ctx, 2));
+    feature->set_geometry(mapnik::geometry::point<double>(3, 4));
+    datasource->push(feature);
+    for (int i = 0; i < 3; ++i)
+    {
+        mapnik::layer lyr("counted" + std::to_string(i));
+        lyr.set_datasource(datasource);
+        lyr.add_style("lines");
+        map.add_layer(lyr);
+    }
+    rendering_result result;
+    test_renderer renderer(map, result);
+    renderer.set_query_pool(std::make_shared<mapnik::util::thread_pool>(2));
+    // the rendering thread reads the second feature of every query, the
+    // next query against the datasource waits for it
+    renderer.set_query_buffer_limit(1);
+    renderer.apply();
+
+    REQUIRE(result.end_layer_processing == 4);
+    REQUIRE(result.geometries.size() == 8);
+    REQUIRE(datasource->max_in_flight() == 1);
+    REQUIRE(datasource->query_slots().in_flight() == 0);
+}
+
+SECTION("test_renderer - compiled filters") {
+
+    mapnik::Map map(prepare_map());
+    mapnik::feature_type_style style;
+    mapnik::rule rule;
+    rule.set_filter(mapnik::parse_expression("[mapnik::geometry_type]=linestring"));
+    rule.append(mapnik::line_symbolizer());
+    style.add_rule(std::move(rule));
+    map.insert_style("linestrings", std::move(style));
+    map.get_layer(0).styles() = { "linestrings" };
+    rendering_result result;
+    test_renderer renderer(map, result);
+    renderer.set_compiled_filters(true);
+    renderer.apply();
+
+    REQUIRE(renderer.painted());
+    REQUIRE(result.geometries.size() == 1);
+    REQUIRE(mapnik::geometry::geometry_type(result.geometries[0]) == mapnik::geometry::geometry_types::LineString);
+}
+
+SECTION("test_renderer - render report") {
+
+    mapnik::Map map(prepare_map());
+    mapnik::feature_type_style style;
+    mapnik::rule rule("linestrings");
+    rule.set_filter(mapnik::parse_expression("[mapnik::geometry_type]=linestring"));
+    rule.append(mapnik::line_symbolizer());
+    rule.append(mapnik::point_symbolizer());
+    style.add_rule(std::move(rule));
+    map.insert_style("linestrings", std::move(style));
+    map.get_layer(0).styles() = { "linestrings" };
+    rendering_result result;
+    test_renderer renderer(map, result);
+    auto report = std::make_shared<mapnik::render_report>();
+    renderer.set_render_report(report);
+    renderer.apply();
+
+    REQUIRE(report->total.calls == 1);
+    REQUIRE(report->layers.size() == 1);
+    mapnik::layer_report const& lr = report->layers.front();
+    REQUIRE(lr.name == "layer");
+    REQUIRE(lr.total.calls == 1);
+    REQUIRE(lr.query.calls == 1);
+    REQUIRE(lr.styles.size() == 1);
+    mapnik::style_report const& sr = lr.styles.front();
+    REQUIRE(sr.name == "linestrings");
+    REQUIRE(sr.total.calls == 1);
+    REQUIRE(sr.composite.calls == 1);
+    REQUIRE(sr.query.features == 2);
+    REQUIRE(sr.rules.size() == 1);
+    mapnik::rule_report const& rr = sr.rules.front();
+    REQUIRE(rr.name == "linestrings");
+    REQUIRE(rr.filter.features == 2);
+    REQUIRE(rr.matches == 1);
+    REQUIRE(rr.render.features == 1);
+    REQUIRE(rr.render.vertices == 4);
+    REQUIRE(rr.symbolizers.size() == 2);
+    REQUIRE(rr.symbolizers[0].type == "LineSymbolizer");
+    REQUIRE(rr.symbolizers[0].stats.calls == 1);
+    REQUIRE(rr.symbolizers[1].type == "PointSymbolizer");
+    REQUIRE(rr.symbolizers[1].stats.vertices == 4);
+
+    auto totals = report->symbolizer_totals();
+    REQUIRE(totals.size() == 2);
+    REQUIRE(totals["LineSymbolizer"].features == 1);
+    REQUIRE(!report->to_string().empty());
+
+    // disabled again, the report is left untouched
+    renderer.set_render_report(nullptr);
+    renderer.apply();
+    REQUIRE(report->total.calls == 1);
+}
+
+SECTION("test_renderer - render report with a query pool") {
+
+    mapnik::Map map(prepare_map());
+    rendering_result result;
+    test_renderer renderer(map, result);
+    auto report = std::make_shared<mapnik::render_report>();
+    renderer.set_render_report(report);
+    renderer.set_query_pool(std::make_shared<mapnik::util::thread_pool>(2));
+    renderer.apply();
+
+    REQUIRE(report->layers.size() == 1);
+    // timed on the worker while reading the featureset
+    mapnik::layer_report const& lr = report->layers.front();
+    REQUIRE(lr.query.calls == 1);
+    REQUIRE(lr.query.features == 2);
+}
+
+SECTION("test_renderer - render plans") {
+
+    mapnik::Map map(prepare_map());
+    auto plans = std::make_shared<mapnik::render_plan_cache>(map);
+    for (int i = 0; i < 2; ++i)
+    {
+        rendering_result result;
+        test_renderer renderer(map, result);
+        renderer.set_render_plans(plans);
+        renderer.apply();
+
+        REQUIRE(renderer.painted());
+        REQUIRE(result.start_style_processing == 1);
+        REQUIRE(result.geometries.size() == 2);
+        REQUIRE(plans->size() == 1);
+    }
+
+    mapnik::layer const& lyr = map.get_layer(0);
+    mapnik::layer_plan_ptr plan = plans->get(lyr, map.scale_denominator());
+    REQUIRE(plan->active_styles.size() == 1);
+    REQUIRE(plan->rule_caches.size() == 1);
+    REQUIRE(plans->get(lyr, map.scale_denominator() * (1.0 + 1e-14)) == plan);
+    // the rule has no scale limits, all scales share its plan
+    REQUIRE(plans->get(lyr, map.scale_denominator() * 2.0) == plan);
+    REQUIRE(plans->size() == 1);
+    plans->clear();
+    REQUIRE(plans->size() == 0);
+
+    // plans change exactly where rules turn on or off
+    mapnik::Map scaled(prepare_map());
+    mapnik::feature_type_style points_style;
+    mapnik::rule points_rule;
+    points_rule.set_max_scale(1000.0);
+    points_rule.append(mapnik::point_symbolizer());
+    points_style.add_rule(std::move(points_rule));
+    scaled.insert_style("points", std::move(points_style));
+    scaled.get_layer(0).add_style("points");
+    mapnik::render_plan_cache scaled_plans(scaled);
+    mapnik::layer const& scaled_lyr = scaled.get_layer(0);
+    CHECK(scaled_plans.get(scaled_lyr, 1.0)->active_styles.size() == 2);
+    CHECK(scaled_plans.get(scaled_lyr, 1000.0)->active_styles.size() == 2);
+    CHECK(scaled_plans.get(scaled_lyr, 1000.0 + 2e-6)->active_styles.size() == 1);
+    CHECK(scaled_plans.get(scaled_lyr, 1000.0 + 1e-9) == scaled_plans.get(scaled_lyr, 1.0));
+    CHECK(scaled_plans.size() == 2);
+    // layers with the same styles share plans
+    mapnik::layer copy(scaled_lyr);
+    CHECK(scaled_plans.get(copy, 1.0) == scaled_plans.get(scaled_lyr, 1.0));
+    CHECK(scaled_plans.size() == 2);
+
+    mapnik::Map other(prepare_map());
+    rendering_result result;
+    test_renderer renderer(other, result);
+    REQUIRE_THROWS(renderer.set_render_plans(plans));
+}
+
 SECTION("test_renderer - apply() with single layer") {
 
     mapnik::Map map(prepare_map());
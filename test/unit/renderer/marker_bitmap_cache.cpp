@@ -0,0 +1,171 @@
+#include "catch.hpp"
+
+// mapnik
+#include <mapnik/map.hpp>
+#include <mapnik/layer.hpp>
+#include <mapnik/rule.hpp>
+#include <mapnik/feature_type_style.hpp>
+#include <mapnik/feature_factory.hpp>
+#include <mapnik/memory_datasource.hpp>
+#include <mapnik/symbolizer.hpp>
+#include <mapnik/agg_renderer.hpp>
+#include <mapnik/image_util.hpp>
+#include <mapnik/marker_bitmap_cache.hpp>
+
+// stl
+#include <memory>
+#include <string>
+
+namespace {
+
+// with aligned == true markers are placed at whole, half and quarter
+// pixels, otherwise at offsets between quarter pixels
+mapnik::Map markers_map(std::string const& file, double opacity, bool aligned = true)
+{
+    mapnik::parameters params;
+    params["type"] = "memory";
+    auto ds = std::make_shared<mapnik::memory_datasource>(params);
+    mapnik::context_ptr ctx = std::make_shared<mapnik::context_type>();
+    mapnik::value_integer id = 0;
+    for (int y = 0; y < 8; ++y)
+    {
+        for (int x = 0; x < 8; ++x)
+        {
+            mapnik::feature_ptr feature(mapnik::feature_factory::create(ctx, ++id));
+            double dx = aligned ? (x % 3) * 0.25 : 0.1 + x * 0.11;
+            double dy = aligned ? y * 0.5 : 0.37 + y * 0.07;
+            feature->set_geometry(mapnik::geometry::point<double>(16 + x * 28 + dx, 16 + y * 28 + dy));
+            ds->push(feature);
+        }
+    }
+    mapnik::Map map(256, 256);
+    mapnik::feature_type_style style;
+    {
+        mapnik::rule r;
+        mapnik::markers_symbolizer sym;
+        mapnik::put(sym, mapnik::keys::file, file);
+        mapnik::put(sym, mapnik::keys::opacity, opacity);
+        mapnik::put(sym, mapnik::keys::allow_overlap, true);
+        r.append(std::move(sym));
+        style.add_rule(std::move(r));
+    }
+    map.insert_style("markers", std::move(style));
+    mapnik::layer lyr("markers");
+    lyr.set_datasource(ds);
+    lyr.add_style("markers");
+    map.add_layer(lyr);
+    map.zoom_to_box(mapnik::box2d<double>(0, 0, 256, 256));
+    return map;
+}
+
+}
+
+TEST_CASE("marker_bitmap_cache") {
+
+SECTION("lookup") {
+
+    // lru behaviour is covered by the util::lru_cache tests
+    mapnik::marker_bitmap_cache cache;
+    auto bitmap = std::make_shared<mapnik::marker_bitmap>();
+    bitmap->image = mapnik::image_rgba8(16, 16);
+    CHECK_FALSE(cache.find("a"));
+    cache.insert("a", bitmap);
+    CHECK(cache.find("a") == bitmap);
+    CHECK(cache.stats().bytes >= bitmap->image.size());
+}
+
+SECTION("entries are tied to their owner") {
+
+    mapnik::marker_bitmap_cache cache;
+    auto bitmap = std::make_shared<mapnik::marker_bitmap>();
+    auto owner = std::make_shared<int>(1);
+    cache.insert("key", bitmap, owner);
+    CHECK(cache.find("key", owner.get()) == bitmap);
+    void const* address = owner.get();
+    owner.reset();
+    CHECK_FALSE(cache.find("key", address));
+    CHECK(cache.stats().entries == 0);
+}
+
+SECTION("lookups without an owner") {
+
+    mapnik::marker_bitmap_cache cache;
+    auto bitmap = std::make_shared<mapnik::marker_bitmap>();
+    auto owner = std::make_shared<int>(1);
+    cache.insert("key", bitmap, owner);
+    // an owned entry is not found without its owner
+    CHECK_FALSE(cache.find("key"));
+    CHECK_FALSE(cache.find("key", nullptr));
+
+    // nor once its owner expired
+    cache.insert("expired", bitmap, owner);
+    owner.reset();
+    CHECK_FALSE(cache.find("expired"));
+    CHECK_FALSE(cache.find("expired", nullptr));
+
+    // entries without an owner are found by any lookup
+    int other = 2;
+    cache.insert("shared", bitmap);
+    CHECK(cache.find("shared") == bitmap);
+    CHECK(cache.find("shared", &other) == bitmap);
+}
+
+SECTION("cached markers look like directly rendered ones") {
+
+    for (std::string file : { "shape://ellipse", "./test/data/svg/point.svg" })
+    {
+        for (double opacity : { 1.0, 0.6 })
+        {
+            mapnik::Map map = markers_map(file, opacity);
+            mapnik::image_rgba8 expected(map.width(), map.height());
+            {
+                mapnik::agg_renderer<mapnik::image_rgba8> ren(map, expected);
+                ren.apply();
+            }
+            auto cache = std::make_shared<mapnik::marker_bitmap_cache>();
+            for (int pass = 0; pass < 2; ++pass)
+            {
+                mapnik::image_rgba8 image(map.width(), map.height());
+                mapnik::agg_renderer<mapnik::image_rgba8> ren(map, image);
+                ren.set_marker_bitmap_cache(cache);
+                ren.apply();
+                INFO(file << " opacity " << opacity << " pass " << pass);
+                CHECK(mapnik::compare(image, expected, 2) == 0);
+            }
+            auto stats = cache->stats();
+            // one bitmap per distinct quarter pixel offset
+            CHECK(stats.entries <= 16);
+            CHECK(stats.hits >= 2 * 64 - stats.entries);
+        }
+    }
+}
+
+SECTION("markers between quarter pixels stay within tolerance") {
+
+    // positions are rounded to the nearest quarter pixel, by up to 1/8
+    // pixel in x and y. That moves edges by up to sqrt(2)/8 pixel, about 45
+    // levels of coverage, and a bit more where curved edges cross a pixel.
+    int const tolerance = 255 / 4;
+    for (std::string file : { "shape://ellipse", "./test/data/svg/point.svg" })
+    {
+        mapnik::Map map = markers_map(file, 1.0, false);
+        mapnik::image_rgba8 expected(map.width(), map.height());
+        {
+            mapnik::agg_renderer<mapnik::image_rgba8> ren(map, expected);
+            ren.apply();
+        }
+        mapnik::image_rgba8 image(map.width(), map.height());
+        mapnik::agg_renderer<mapnik::image_rgba8> ren(map, image);
+        ren.set_marker_bitmap_cache(std::make_shared<mapnik::marker_bitmap_cache>());
+        ren.apply();
+        INFO(file);
+        CHECK(mapnik::compare(image, expected, tolerance) == 0);
+        if (file == "shape://ellipse")
+        {
+            // the cached bitmaps were used
+            CHECK(mapnik::compare(image, expected, 0) > 0);
+        }
+    }
+}
+
+}
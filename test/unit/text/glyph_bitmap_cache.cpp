@@ -0,0 +1,153 @@
+#include "catch.hpp"
+
+// mapnik
+#include <mapnik/map.hpp>
+#include <mapnik/layer.hpp>
+#include <mapnik/rule.hpp>
+#include <mapnik/feature_type_style.hpp>
+#include <mapnik/feature_factory.hpp>
+#include <mapnik/memory_datasource.hpp>
+#include <mapnik/symbolizer.hpp>
+#include <mapnik/expression.hpp>
+#include <mapnik/unicode.hpp>
+#include <mapnik/agg_renderer.hpp>
+#include <mapnik/image_util.hpp>
+#include <mapnik/text/placements/dummy.hpp>
+#include <mapnik/text/formatting/text.hpp>
+#include <mapnik/text/glyph_bitmap_cache.hpp>
+
+// stl
+#include <memory>
+#include <string>
+
+namespace {
+
+mapnik::Map labels_map(mapnik::halo_rasterizer_enum halo_rasterizer, double orientation)
+{
+    mapnik::parameters params;
+    params["type"] = "memory";
+    auto ds = std::make_shared<mapnik::memory_datasource>(params);
+    mapnik::context_ptr ctx = std::make_shared<mapnik::context_type>();
+    ctx->push("name");
+    mapnik::transcoder tr("utf-8");
+    mapnik::value_integer id = 0;
+    for (int y = 0; y < 8; ++y)
+    {
+        for (int x = 0; x < 2; ++x)
+        {
+            mapnik::feature_ptr feature(mapnik::feature_factory::create(ctx, ++id));
+            feature->put("name", tr.transcode(y % 2 ? "Main Street" : "Station Road"));
+            // labels at whole, half and quarter pixel positions
+            feature->set_geometry(mapnik::geometry::point<double>(64 + x * 128 + y * 0.25, 16 + y * 30.5));
+            ds->push(feature);
+        }
+    }
+    mapnik::Map map(256, 256);
+    map.register_fonts("fonts", true);
+    mapnik::feature_type_style style;
+    {
+        mapnik::rule r;
+        mapnik::text_symbolizer sym;
+        auto placements = std::make_shared<mapnik::text_placements_dummy>();
+        placements->defaults.format_defaults.face_name = "DejaVu Sans Book";
+        placements->defaults.format_defaults.text_size = 13.0;
+        placements->defaults.format_defaults.fill = mapnik::color(20, 40, 160);
+        placements->defaults.format_defaults.halo_fill = mapnik::color(255, 255, 220);
+        placements->defaults.format_defaults.halo_radius = 1.5;
+        placements->defaults.layout_defaults.orientation = orientation;
+        placements->defaults.expressions.allow_overlap = true;
+        placements->defaults.set_format_tree(
+            std::make_shared<mapnik::formatting::text_node>(mapnik::parse_expression("[name]")));
+        mapnik::put<mapnik::text_placements_ptr>(sym, mapnik::keys::text_placements_, placements);
+        mapnik::put(sym, mapnik::keys::halo_rasterizer, halo_rasterizer);
+        r.append(std::move(sym));
+        style.add_rule(std::move(r));
+    }
+    map.insert_style("labels", std::move(style));
+    mapnik::layer lyr("labels");
+    lyr.set_datasource(ds);
+    lyr.add_style("labels");
+    map.add_layer(lyr);
+    map.zoom_to_box(mapnik::box2d<double>(0, 0, 256, 256));
+    return map;
+}
+
+mapnik::image_rgba8 render(mapnik::Map const& map, std::shared_ptr<mapnik::glyph_bitmap_cache> const& cache)
+{
+    mapnik::image_rgba8 image(map.width(), map.height());
+    mapnik::agg_renderer<mapnik::image_rgba8> ren(map, image);
+    ren.set_glyph_bitmap_cache(cache);
+    ren.apply();
+    return image;
+}
+
+mapnik::glyph_bitmap_key make_key(void const* face, unsigned glyph_index)
+{
+    mapnik::glyph_bitmap_key key = {};
+    key.face = face;
+    key.size = 13 * 64;
+    key.glyph_index = glyph_index;
+    key.rotation[0] = key.rotation[3] = 0x10000;
+    key.transform[0] = key.transform[3] = 0x10000;
+    return key;
+}
+
+}
+
+TEST_CASE("glyph_bitmap_cache") {
+
+SECTION("lookup") {
+
+    // lru behaviour is covered by the util::lru_cache tests
+    auto face = std::make_shared<int>(0);
+    auto bitmap = std::make_shared<mapnik::glyph_bitmap>();
+    mapnik::glyph_bitmap_cache cache;
+    cache.insert(make_key(face.get(), 1), bitmap, face);
+    CHECK(cache.find(make_key(face.get(), 1)) == bitmap);
+    CHECK(cache.find(make_key(face.get(), 2)) == nullptr);
+    mapnik::glyph_bitmap_key other = make_key(face.get(), 1);
+    other.subpixel_x = 16;
+    CHECK(cache.find(other) == nullptr);
+}
+
+SECTION("entries die with their face") {
+
+    auto bitmap = std::make_shared<mapnik::glyph_bitmap>();
+    mapnik::glyph_bitmap_cache cache;
+    auto face = std::make_shared<int>(0);
+    void const* address = face.get();
+    cache.insert(make_key(address, 1), bitmap, face);
+    REQUIRE(cache.find(make_key(address, 1)) == bitmap);
+    face.reset();
+    CHECK(cache.find(make_key(address, 1)) == nullptr);
+    CHECK(cache.stats().entries == 0);
+}
+
+SECTION("renders like freetype") {
+
+    for (double orientation : { 0.0, 25.0 })
+    {
+        // with 64 subpixel steps glyphs are placed exactly, stroked halos
+        // may differ slightly since the stroker rounds depending on position
+        mapnik::Map fast = labels_map(mapnik::HALO_RASTERIZER_FAST, orientation);
+        auto exact = std::make_shared<mapnik::glyph_bitmap_cache>(8 << 20, 64);
+        mapnik::image_rgba8 reference = render(fast, nullptr);
+        CHECK(mapnik::compare(reference, render(fast, exact)) == 0);
+        CHECK(mapnik::compare(reference, render(fast, exact)) == 0);
+        CHECK(exact->stats().hits > exact->stats().misses);
+
+        mapnik::Map full = labels_map(mapnik::HALO_RASTERIZER_FULL, orientation);
+        exact->clear();
+        reference = render(full, nullptr);
+        CHECK(mapnik::compare(reference, render(full, exact), 16) == 0);
+
+        // the default quarter pixel steps move glyphs by up to 1/8 pixel
+        auto cache = std::make_shared<mapnik::glyph_bitmap_cache>();
+        mapnik::image_rgba8 cached = render(full, cache);
+        CHECK(mapnik::compare(reference, cached, 254) == 0);
+        CHECK(mapnik::compare(cached, render(full, cache)) == 0);
+        CHECK(cache->stats().hits > 0);
+    }
+}
+
+}
@@ -2,6 +2,7 @@
 #include <mapnik/text/icu_shaper.hpp>
 #include <mapnik/text/harfbuzz_shaper.hpp>
 #include <mapnik/text/font_library.hpp>
+#include <mapnik/text/shaping_cache.hpp>
 #include <mapnik/unicode.hpp>
 
 namespace {
@@ -97,5 +98,30 @@ TEST_CASE("shaping")
         test_shaping(fontset, fm, expected, u8"ⵃⴰⵢ ⵚⵉⵏⴰⵄⵉ الحي الصناعي");
     }
 
+    {
+        // runs reused from the cache, by this or another face manager,
+        // give the same glyphs
+        auto cache = std::make_shared<mapnik::shaping_cache>();
+        mapnik::face_manager other(fl, font_file_mapping, font_memory_cache);
+        fm.set_shaping_cache(cache);
+        other.set_shaping_cache(cache);
+        std::vector<std::pair<unsigned, unsigned>> expected_mixed =
+            {{977, 0}, {1094, 3}, {1038, 4}, {1168, 4}, {9, 7}, {3, 8}, {11, 9}, {68, 10}, {69, 11}, {70, 12}, {12, 13}};
+        std::vector<std::pair<unsigned, unsigned>> expected_rtl =
+            {{0, 0}, {0, 1}, {0, 2}, {3, 3}, {0, 4}, {0, 5}, {0, 6}, {0, 7},
+              {0, 8}, {0, 9}, {3, 10}, {509, 22}, {481, 21}, {438, 20}, {503, 19},
+              {470, 18}, {496, 17}, {43, 16}, {3, 15}, {509, 14}, {454, 13}, {496, 12}, {43, 11}};
+        for (auto * manager : { &fm, &fm, &other })
+        {
+            test_shaping(fontset, *manager, expected_mixed, u8"སྤུ་ཧྲེང (abc)");
+            test_shaping(fontset, *manager, expected_rtl, u8"ⵃⴰⵢ ⵚⵉⵏⴰⵄⵉ الحي الصناعي");
+        }
+        auto stats = cache->stats();
+        CHECK(stats.misses == stats.entries);
+        CHECK(stats.hits == 2 * stats.misses);
+        CHECK(stats.bytes <= stats.max_bytes);
+        fm.set_shaping_cache(nullptr);
+    }
+
 
 }
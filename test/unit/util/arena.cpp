@@ -0,0 +1,122 @@
+#include "catch.hpp"
+
+#include <mapnik/util/arena.hpp>
+#include <mapnik/feature.hpp>
+#include <mapnik/feature_factory.hpp>
+#include <mapnik/query.hpp>
+
+#include <algorithm>
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+TEST_CASE("arena") {
+
+SECTION("allocation") {
+
+    mapnik::util::arena arena(1024);
+    void * p0 = arena.allocate(10, 1);
+    void * p1 = arena.allocate(sizeof(double), alignof(double));
+    CHECK(p0 != p1);
+    CHECK(reinterpret_cast<std::uintptr_t>(p1) % alignof(double) == 0);
+    CHECK(arena.num_blocks() == 1);
+    // larger than a small allocation, taken from the heap
+    void * p2 = arena.allocate(4096, 64);
+    CHECK(reinterpret_cast<std::uintptr_t>(p2) % 64 == 0);
+    CHECK(arena.num_blocks() == 1);
+    CHECK(arena.allocated() == 10 + sizeof(double) + 4096);
+    arena.deallocate(p2, 4096, 64);
+    CHECK(arena.allocated() == 10 + sizeof(double));
+}
+
+SECTION("reuse") {
+
+    mapnik::util::arena arena(1024);
+    void * p0 = arena.allocate(24);
+    arena.deallocate(p0, 24);
+    CHECK(arena.allocated() == 0);
+    // same size class
+    CHECK(arena.allocate(20) == p0);
+    for (int i = 0; i < 10000; ++i)
+    {
+        arena.deallocate(arena.allocate(100), 100);
+    }
+    CHECK(arena.num_blocks() == 1);
+}
+
+SECTION("frees from other threads") {
+
+    mapnik::util::arena arena(1024);
+    std::vector<void *> chunks;
+    for (int i = 0; i < 100; ++i) chunks.push_back(arena.allocate(48));
+    std::size_t blocks = arena.num_blocks();
+    std::vector<std::thread> threads;
+    for (std::size_t t = 0; t < 4; ++t)
+    {
+        threads.emplace_back([&arena, &chunks, t]()
+        {
+            for (std::size_t i = t; i < chunks.size(); i += 4) arena.deallocate(chunks[i], 48);
+        });
+    }
+    for (auto & thread : threads) thread.join();
+    CHECK(arena.allocated() == 0);
+    // the owner reuses the chunks freed elsewhere
+    std::vector<void *> reused;
+    for (int i = 0; i < 100; ++i) reused.push_back(arena.allocate(48));
+    CHECK(arena.num_blocks() == blocks);
+    std::sort(chunks.begin(), chunks.end());
+    std::sort(reused.begin(), reused.end());
+    CHECK(reused == chunks);
+    for (void * ptr : reused) arena.deallocate(ptr, 48);
+    CHECK(arena.allocated() == 0);
+
+    // allocating from another thread takes the arena over
+    std::thread([&arena]()
+    {
+        void * ptr = arena.allocate(48);
+        arena.deallocate(ptr, 48);
+    }).join();
+    CHECK(arena.allocated() == 0);
+}
+
+SECTION("std container") {
+
+    auto arena = std::make_shared<mapnik::util::arena>();
+    std::vector<int, mapnik::util::arena_allocator<int>> vec{mapnik::util::arena_allocator<int>(arena)};
+    for (int i = 0; i < 1000; ++i) vec.push_back(i);
+    CHECK(vec.size() == 1000);
+    CHECK(vec[999] == 999);
+    CHECK(arena->allocated() >= 1000 * sizeof(int));
+    vec.clear();
+    vec.shrink_to_fit();
+    CHECK(arena->allocated() == 0);
+
+    // without an arena the allocator uses the heap
+    std::vector<int, mapnik::util::arena_allocator<int>> heap_vec;
+    heap_vec.push_back(1);
+    CHECK(heap_vec.get_allocator().get_arena() == nullptr);
+}
+
+SECTION("features") {
+
+    mapnik::context_ptr ctx = std::make_shared<mapnik::context_type>();
+    ctx->push("name");
+    mapnik::feature_ptr feature;
+    {
+        mapnik::query q(mapnik::box2d<double>(0, 0, 1, 1));
+        q.set_arena(std::make_shared<mapnik::util::arena>());
+        mapnik::query copy(q);
+        CHECK(copy.get_arena() == q.get_arena());
+        feature = mapnik::feature_factory::create(ctx, 1, q.get_arena());
+        CHECK(q.get_arena()->allocated() >= sizeof(mapnik::feature_impl) + sizeof(mapnik::value));
+        CHECK(feature->get_data().get_allocator().get_arena() == q.get_arena());
+    }
+    // the feature keeps its arena alive
+    feature->put("name", mapnik::value_integer(42));
+    CHECK(feature->get("name") == mapnik::value_integer(42));
+    CHECK(feature->id() == 1);
+
+    mapnik::feature_ptr heap_feature = mapnik::feature_factory::create(ctx, 2, nullptr);
+    CHECK(heap_feature->id() == 2);
+}
+}
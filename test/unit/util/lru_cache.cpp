@@ -0,0 +1,100 @@
+#include "catch.hpp"
+
+#include <mapnik/util/lru_cache.hpp>
+
+#include <string>
+
+namespace {
+
+using cache_type = mapnik::util::lru_cache<int, std::string>;
+
+// bytes an entry of `bytes` is charged with, bookkeeping included
+std::size_t entry_cost(std::size_t bytes)
+{
+    cache_type cache(1 << 20);
+    cache.insert(0, std::string(), bytes);
+    return cache.stats().bytes;
+}
+
+}
+
+TEST_CASE("lru cache") {
+
+SECTION("hits and misses") {
+
+    cache_type cache(1 << 20);
+    CHECK(!cache.find(1));
+    CHECK(cache.insert(1, "one", 3));
+    boost::optional<std::string> value = cache.find(1);
+    REQUIRE(value);
+    CHECK(*value == "one");
+    // the first insert wins
+    CHECK(!cache.insert(1, "uno", 3));
+    CHECK(*cache.find(1) == "one");
+    auto stats = cache.stats();
+    CHECK(stats.hits == 2);
+    CHECK(stats.misses == 1);
+    CHECK(stats.entries == 1);
+    CHECK(stats.bytes == entry_cost(3));
+    CHECK(stats.max_bytes == 1 << 20);
+}
+
+SECTION("stale entries") {
+
+    cache_type cache(1 << 20);
+    cache.insert(1, "one", 3);
+    CHECK(!cache.find(1, [](std::string const& value) { return value == "two"; }));
+    auto stats = cache.stats();
+    CHECK(stats.misses == 1);
+    CHECK(stats.entries == 0);
+    CHECK(stats.bytes == 0);
+    CHECK(cache.insert(1, "two", 3));
+    CHECK(cache.find(1, [](std::string const& value) { return value == "two"; }));
+}
+
+SECTION("lru eviction") {
+
+    // room for two entries
+    cache_type cache(entry_cost(100) * 2 + 50);
+    cache.insert(1, "one", 100);
+    cache.insert(2, "two", 100);
+    // touch the first entry so the second one is evicted next
+    CHECK(cache.find(1));
+    cache.insert(3, "three", 100);
+    auto stats = cache.stats();
+    CHECK(stats.entries == 2);
+    CHECK(stats.evictions == 1);
+    CHECK(stats.bytes <= stats.max_bytes);
+    CHECK(cache.find(1));
+    CHECK(!cache.find(2));
+    CHECK(cache.find(3));
+}
+
+SECTION("byte budget") {
+
+    cache_type cache(entry_cost(100));
+    // larger than the whole cache
+    CHECK(!cache.insert(1, "one", 101));
+    CHECK(cache.stats().entries == 0);
+    CHECK(cache.insert(1, "one", 100));
+    cache.set_max_bytes(0);
+    CHECK(cache.max_bytes() == 0);
+    CHECK(cache.stats().entries == 0);
+    CHECK(cache.stats().bytes == 0);
+    CHECK(cache.stats().evictions == 1);
+    // a disabled cache takes nothing
+    CHECK(!cache.insert(1, "one", 0));
+}
+
+SECTION("clear") {
+
+    cache_type cache(1 << 20);
+    cache.insert(1, "one", 3);
+    cache.insert(2, "two", 3);
+    cache.clear();
+    CHECK(cache.stats().entries == 0);
+    CHECK(cache.stats().bytes == 0);
+    CHECK(!cache.find(1));
+}
+
+}
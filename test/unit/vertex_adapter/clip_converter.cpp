@@ -0,0 +1,275 @@
+#include "catch.hpp"
+
+#include <mapnik/clip_converter.hpp>
+#include <mapnik/geometry.hpp>
+#include <mapnik/geometry/box2d.hpp>
+#include <mapnik/vertex_adapters.hpp>
+#include <mapnik/vertex_converters.hpp>
+#include <mapnik/util/cpu_features.hpp>
+
+#pragma GCC diagnostic push
+#include <mapnik/warning_ignore_agg.hpp>
+#include "agg_conv_clip_polygon.h"
+#include "agg_conv_clip_polyline.h"
+#pragma GCC diagnostic pop
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <random>
+#include <type_traits>
+#include <vector>
+
+namespace {
+
+struct simd_level_guard
+{
+    ~simd_level_guard() { mapnik::util::set_simd_level(mapnik::util::detected_simd_level()); }
+};
+
+struct vertex_record
+{
+    unsigned cmd;
+    double x;
+    double y;
+};
+
+template <typename Path>
+std::vector<vertex_record> read_path(Path & path)
+{
+    std::vector<vertex_record> result;
+    path.rewind(0);
+    double x = 0, y = 0;
+    unsigned cmd;
+    while ((cmd = path.vertex(&x, &y)) != mapnik::SEG_END)
+    {
+        result.push_back(vertex_record{cmd, x, y});
+    }
+    return result;
+}
+
+// sum of the signed areas of all rings, each closed implicitly
+double signed_area(std::vector<vertex_record> const& path)
+{
+    double area = 0;
+    std::vector<vertex_record> ring;
+    auto add_ring = [&]() {
+        for (std::size_t i = 0; i < ring.size(); ++i)
+        {
+            vertex_record const& a = ring[i];
+            vertex_record const& b = ring[(i + 1) % ring.size()];
+            area += a.x * b.y - b.x * a.y;
+        }
+        ring.clear();
+    };
+    for (auto const& v : path)
+    {
+        if (v.cmd == mapnik::SEG_MOVETO) add_ring();
+        if (v.cmd == mapnik::SEG_CLOSE) add_ring();
+        else ring.push_back(v);
+    }
+    add_ring();
+    return area / 2;
+}
+
+bool inside(std::vector<vertex_record> const& path, mapnik::box2d<double> const& box)
+{
+    for (auto const& v : path)
+    {
+        if (v.cmd == mapnik::SEG_CLOSE) continue;
+        if (v.x < box.minx() || v.x > box.maxx() || v.y < box.miny() || v.y > box.maxy()) return false;
+    }
+    return true;
+}
+
+mapnik::geometry::linear_ring<double> random_ring(std::mt19937 & gen, std::size_t size)
+{
+    std::uniform_real_distribution<double> coord(-50.0, 150.0);
+    mapnik::geometry::linear_ring<double> ring;
+    for (std::size_t i = 0; i < size; ++i)
+    {
+        ring.emplace_back(coord(gen), coord(gen));
+    }
+    ring.push_back(ring.front());
+    return ring;
+}
+
+} // namespace
+
+TEST_CASE("clip converter") {
+
+mapnik::box2d<double> const box(0, 0, 100, 100);
+
+SECTION("outcodes match scalar code") {
+    using mapnik::util::simd_level;
+    simd_level_guard guard;
+    std::mt19937 gen(42);
+    std::uniform_int_distribution<int> coord(-2, 12);
+    std::vector<double> x, y;
+    for (int i = 0; i < 1001; ++i)
+    {
+        // multiples of 10 put many points on the border
+        x.push_back(coord(gen) * 10.0);
+        y.push_back(coord(gen) * 10.0);
+    }
+    mapnik::util::set_simd_level(simd_level::none);
+    std::vector<std::uint8_t> expected(x.size());
+    unsigned expected_any = mapnik::kernels::outcodes(x.data(), y.data(), x.size(), 0, 0, 100, 100, expected.data());
+    CHECK(expected_any == 0xf);
+    CHECK(expected[0] == ((x[0] < 0) | (x[0] > 100) << 1 | (y[0] < 0) << 2 | (y[0] > 100) << 3));
+    for (int l = static_cast<int>(simd_level::sse41); l <= static_cast<int>(mapnik::util::detected_simd_level()); ++l)
+    {
+        mapnik::util::set_simd_level(static_cast<simd_level>(l));
+        for (std::size_t offset : { 0, 1, 3 })
+        {
+            INFO("level " << l << " offset " << offset);
+            std::vector<std::uint8_t> codes(x.size());
+            unsigned any = mapnik::kernels::outcodes(x.data() + offset, y.data() + offset, x.size() - offset,
+                                                     0, 0, 100, 100, codes.data());
+            CHECK(any == 0xf);
+            CHECK(std::equal(codes.begin(), codes.end() - offset, expected.begin() + offset));
+        }
+    }
+    std::vector<std::uint8_t> codes(4);
+    double inside_x[] = { 0, 100, 50, 0 };
+    double inside_y[] = { 0, 100, 0, 50 };
+    CHECK(mapnik::kernels::outcodes(inside_x, inside_y, 4, 0, 0, 100, 100, codes.data()) == 0);
+}
+
+SECTION("polygons inside the box pass through") {
+    mapnik::geometry::polygon<double> poly;
+    poly.emplace_back(mapnik::geometry::linear_ring<double>{{10, 10}, {90, 10}, {90, 90}, {10, 90}, {10, 10}});
+    poly.emplace_back(mapnik::geometry::linear_ring<double>{{20, 20}, {20, 80}, {80, 80}, {20, 20}});
+    mapnik::geometry::polygon_vertex_adapter<double> va(poly);
+    auto expected = read_path(va);
+    mapnik::polygon_clip_converter<mapnik::geometry::polygon_vertex_adapter<double>> clipped(va);
+    clipped.clip_box(box.minx(), box.miny(), box.maxx(), box.maxy());
+    for (int pass = 0; pass < 2; ++pass)
+    {
+        auto result = read_path(clipped);
+        REQUIRE(result.size() == expected.size());
+        for (std::size_t i = 0; i < result.size(); ++i)
+        {
+            CHECK(result[i].cmd == expected[i].cmd);
+            if (result[i].cmd == mapnik::SEG_CLOSE) continue;
+            CHECK(result[i].x == expected[i].x);
+            CHECK(result[i].y == expected[i].y);
+        }
+    }
+}
+
+SECTION("rings around or beyond the box") {
+    mapnik::geometry::polygon<double> poly;
+    poly.emplace_back(mapnik::geometry::linear_ring<double>{{-10, -10}, {110, -10}, {110, 110}, {-10, 110}, {-10, -10}});
+    // entirely right of the box
+    poly.emplace_back(mapnik::geometry::linear_ring<double>{{120, 0}, {150, 50}, {120, 100}, {120, 0}});
+    mapnik::geometry::polygon_vertex_adapter<double> va(poly);
+    mapnik::polygon_clip_converter<mapnik::geometry::polygon_vertex_adapter<double>> clipped(va);
+    clipped.clip_box(box.minx(), box.miny(), box.maxx(), box.maxy());
+    auto result = read_path(clipped);
+    REQUIRE(result.size() == 5);
+    CHECK(result.front().cmd == mapnik::SEG_MOVETO);
+    CHECK(result.back().cmd == mapnik::SEG_CLOSE);
+    CHECK(signed_area(result) == Approx(10000));
+    CHECK(inside(result, box));
+}
+
+SECTION("polygon clipping matches agg") {
+    using adapter_type = mapnik::geometry::polygon_vertex_adapter<double>;
+    std::mt19937 gen(7);
+    std::uniform_int_distribution<std::size_t> sizes(3, 60);
+    for (int n = 0; n < 500; ++n)
+    {
+        mapnik::geometry::polygon<double> poly;
+        poly.push_back(random_ring(gen, sizes(gen)));
+        if (n % 2) poly.push_back(random_ring(gen, sizes(gen)));
+        adapter_type va(poly);
+        agg::conv_clip_polygon<adapter_type> reference(va);
+        reference.clip_box(box.minx(), box.miny(), box.maxx(), box.maxy());
+        double expected = signed_area(read_path(reference));
+
+        mapnik::polygon_clip_converter<adapter_type> clipped(va);
+        clipped.clip_box(box.minx(), box.miny(), box.maxx(), box.maxy());
+        auto result = read_path(clipped);
+        INFO("polygon " << n);
+        CHECK(std::abs(signed_area(result) - expected) < 1e-6);
+        CHECK(inside(result, box));
+    }
+}
+
+SECTION("line clipping matches agg") {
+    std::mt19937 gen(11);
+    std::uniform_int_distribution<std::size_t> sizes(2, 60);
+    auto check_same_path = [&box](auto & va) {
+        using adapter_type = typename std::decay<decltype(va)>::type;
+        agg::conv_clip_polyline<adapter_type> reference(va);
+        reference.clip_box(box.minx(), box.miny(), box.maxx(), box.maxy());
+        auto expected = read_path(reference);
+        mapnik::line_clip_converter<adapter_type> clipped(va);
+        clipped.clip_box(box.minx(), box.miny(), box.maxx(), box.maxy());
+        auto result = read_path(clipped);
+        REQUIRE(result.size() == expected.size());
+        for (std::size_t i = 0; i < result.size(); ++i)
+        {
+            CHECK(result[i].cmd == expected[i].cmd);
+            CHECK(std::abs(result[i].x - expected[i].x) < 1e-9);
+            CHECK(std::abs(result[i].y - expected[i].y) < 1e-9);
+        }
+        CHECK(inside(result, box));
+    };
+    for (int n = 0; n < 500; ++n)
+    {
+        INFO("line " << n);
+        auto ring = random_ring(gen, sizes(gen));
+        mapnik::geometry::line_string<double> line(ring.begin(), ring.end());
+        mapnik::geometry::line_string_vertex_adapter<double> line_va(line);
+        check_same_path(line_va);
+        // polygon outlines are closed with SEG_CLOSE
+        mapnik::geometry::polygon<double> poly;
+        poly.push_back(random_ring(gen, sizes(gen)));
+        mapnik::geometry::polygon_vertex_adapter<double> poly_va(poly);
+        check_same_path(poly_va);
+    }
+}
+
+SECTION("large buffers are not pooled") {
+    // a ring big enough to grow the buffers past the pooling limit
+    mapnik::geometry::linear_ring<double> ring;
+    std::size_t const count = mapnik::detail::max_pooled_clip_buffer_bytes / sizeof(double);
+    for (std::size_t i = 0; i < count; ++i)
+    {
+        double angle = 2 * M_PI * i / count;
+        ring.emplace_back(50 + 80 * std::cos(angle), 50 + 80 * std::sin(angle));
+    }
+    ring.push_back(ring.front());
+    mapnik::geometry::polygon<double> poly;
+    poly.push_back(std::move(ring));
+    mapnik::geometry::polygon_vertex_adapter<double> va(poly);
+    {
+        mapnik::polygon_clip_converter<mapnik::geometry::polygon_vertex_adapter<double>> clipped(va);
+        clipped.clip_box(box.minx(), box.miny(), box.maxx(), box.maxy());
+        CHECK(inside(read_path(clipped), box));
+    }
+    std::vector<mapnik::detail::clip_buffers *> buffers;
+    for (int i = 0; i < 8; ++i)
+    {
+        buffers.push_back(mapnik::detail::acquire_clip_buffers());
+        CHECK(buffers.back()->capacity_bytes() <= mapnik::detail::max_pooled_clip_buffer_bytes);
+    }
+    for (auto * b : buffers) mapnik::detail::release_clip_buffers(b);
+}
+
+SECTION("vertex_converter keeps agg as the default clipper") {
+    using adapter_type = mapnik::geometry::polygon_vertex_adapter<double>;
+    using mapnik::detail::converter_traits;
+    CHECK((std::is_same<converter_traits<adapter_type, mapnik::clip_poly_tag>::conv_type,
+                        agg::conv_clip_polygon<adapter_type>>::value));
+    CHECK((std::is_same<converter_traits<adapter_type, mapnik::clip_line_tag>::conv_type,
+                        agg::conv_clip_polyline<adapter_type>>::value));
+    CHECK((std::is_same<converter_traits<adapter_type, mapnik::clip_poly_simd_tag>::conv_type,
+                        mapnik::polygon_clip_converter<adapter_type>>::value));
+    CHECK((std::is_same<converter_traits<adapter_type, mapnik::clip_line_simd_tag>::conv_type,
+                        mapnik::line_clip_converter<adapter_type>>::value));
+}
+
+} // END TEST CASE
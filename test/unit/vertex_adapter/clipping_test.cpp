@@ -5,6 +5,7 @@
 #include <mapnik/util/conversions.hpp>
 #include <mapnik/util/trim.hpp>
 #include <mapnik/path.hpp>
+#include <mapnik/clip_converter.hpp>
 
 #pragma GCC diagnostic push
 #include <mapnik/warning_ignore.hpp>
@@ -49,6 +50,15 @@ std::string clip_line(mapnik::box2d<double> const& bbox,
     return dump_path(clipped);
 }
 
+std::string clip_line_converter(mapnik::box2d<double> const& bbox,
+                                mapnik::path_type const& path)
+{
+    mapnik::vertex_adapter va(path);
+    mapnik::line_clip_converter<mapnik::vertex_adapter> clipped(va);
+    clipped.clip_box(bbox.minx(),bbox.miny(),bbox.maxx(),bbox.maxy());
+    return dump_path(clipped);
+}
+
 void parse_geom(mapnik::path_type & path,
                 std::string const& geom_string) {
     std::vector<std::string> vertices;
@@ -105,6 +115,7 @@ SECTION("lines") {
             //std::clog << dump_path(path) << "\n";
             // third part is expected, clipped geometry
             REQUIRE(clip_line(bbox, path) == mapnik::util::trim_copy(parts[2]));
+            REQUIRE(clip_line_converter(bbox, path) == mapnik::util::trim_copy(parts[2]));
         }
         stream.close();
     }
@@ -0,0 +1,172 @@
+#include "catch.hpp"
+
+#include <mapnik/transform_path_adapter.hpp>
+#include <mapnik/transform_path_buffer.hpp>
+#include <mapnik/vertex_adapters.hpp>
+#include <mapnik/view_transform.hpp>
+#include <mapnik/proj_transform.hpp>
+#include <mapnik/projection.hpp>
+
+#include <vector>
+
+namespace {
+
+struct vertex_record
+{
+    unsigned cmd;
+    double x;
+    double y;
+};
+
+template <typename Path>
+std::vector<vertex_record> read_path(Path & path)
+{
+    std::vector<vertex_record> result;
+    path.rewind(0);
+    double x = 0, y = 0;
+    unsigned cmd;
+    while ((cmd = path.vertex(&x, &y)) != mapnik::SEG_END)
+    {
+        result.push_back(vertex_record{cmd, x, y});
+    }
+    return result;
+}
+
+template <typename Adapter>
+void check_same_path(Adapter & va, mapnik::view_transform const& tr, mapnik::proj_transform const& prj_trans)
+{
+    mapnik::transform_path_adapter<mapnik::view_transform, Adapter> reference(tr, va, prj_trans);
+    std::vector<vertex_record> expected = read_path(reference);
+    mapnik::transform_path_buffer<mapnik::view_transform, Adapter> path(tr, va, prj_trans);
+    for (int pass = 0; pass < 2; ++pass)
+    {
+        std::vector<vertex_record> result = read_path(path);
+        REQUIRE(result.size() == expected.size());
+        for (std::size_t i = 0; i < result.size(); ++i)
+        {
+            CHECK(result[i].cmd == expected[i].cmd);
+            CHECK(result[i].x == expected[i].x);
+            CHECK(result[i].y == expected[i].y);
+        }
+    }
+}
+
+}
+
+TEST_CASE("transform_path_buffer") {
+
+SECTION("same path as transform_path_adapter") {
+
+    mapnik::geometry::polygon<double> poly;
+    poly.emplace_back();
+    poly.back().emplace_back(-10, -10);
+    poly.back().emplace_back(30, -10);
+    poly.back().emplace_back(30, 40);
+    poly.back().emplace_back(-10, -10);
+    poly.emplace_back();
+    poly.back().emplace_back(0, 0);
+    poly.back().emplace_back(10, 0);
+    poly.back().emplace_back(10, 10);
+    poly.back().emplace_back(0, 0);
+
+    mapnik::geometry::line_string<double> line;
+    for (int i = 0; i < 100; ++i)
+    {
+        line.emplace_back(-170 + i * 3.4, -80 + i * 1.6);
+    }
+
+    mapnik::projection wgs84("+init=epsg:4326");
+    mapnik::projection merc("+init=epsg:3857");
+    mapnik::proj_transform identity(wgs84, wgs84);
+    mapnik::proj_transform to_merc(merc, wgs84);
+    mapnik::view_transform tr(256, 256, mapnik::box2d<double>(-180, -90, 180, 90), 1.5, -2.0);
+    mapnik::view_transform merc_tr(256, 256, mapnik::box2d<double>(-20037508.34, -20037508.34, 20037508.34, 20037508.34));
+
+    mapnik::geometry::polygon_vertex_adapter<double> poly_va(poly);
+    mapnik::geometry::line_string_vertex_adapter<double> line_va(line);
+    check_same_path(poly_va, tr, identity);
+    check_same_path(line_va, tr, identity);
+    check_same_path(poly_va, merc_tr, to_merc);
+    check_same_path(line_va, merc_tr, to_merc);
+}
+
+SECTION("close vertices are not transformed") {
+
+    mapnik::geometry::polygon<double> poly;
+    poly.emplace_back();
+    poly.back().emplace_back(10, 10);
+    poly.back().emplace_back(20, 10);
+    poly.back().emplace_back(20, 20);
+    poly.back().emplace_back(10, 10);
+    mapnik::geometry::polygon_vertex_adapter<double> va(poly);
+    mapnik::projection wgs84("+init=epsg:4326");
+    mapnik::proj_transform identity(wgs84, wgs84);
+    mapnik::view_transform tr(100, 100, mapnik::box2d<double>(0, 0, 100, 100));
+    mapnik::transform_path_buffer<mapnik::view_transform, mapnik::geometry::polygon_vertex_adapter<double>> path(tr, va, identity);
+
+    // reads from the start without a rewind, like transform_path_adapter
+    double x, y;
+    CHECK(path.vertex(&x, &y) == mapnik::SEG_MOVETO);
+    CHECK(x == 10);
+    CHECK(y == 90);
+    CHECK(path.vertex(&x, &y) == mapnik::SEG_LINETO);
+    CHECK(path.vertex(&x, &y) == mapnik::SEG_LINETO);
+    CHECK(x == 20);
+    CHECK(y == 80);
+    CHECK(path.vertex(&x, &y) == mapnik::SEG_CLOSE);
+    CHECK(x == 0);
+    CHECK(y == 0);
+    CHECK(path.vertex(&x, &y) == mapnik::SEG_END);
+}
+
+SECTION("buffers are taken from the clip converter pool") {
+
+    mapnik::geometry::line_string<double> line;
+    for (int i = 0; i < 1000; ++i)
+    {
+        line.emplace_back(i * 0.1, i * 0.05);
+    }
+    mapnik::geometry::line_string_vertex_adapter<double> va(line);
+    mapnik::projection wgs84("+init=epsg:4326");
+    mapnik::projection merc("+init=epsg:3857");
+    mapnik::proj_transform prj_trans(merc, wgs84);
+    mapnik::view_transform tr(256, 256, mapnik::box2d<double>(0, 0, 20037508, 20037508));
+    {
+        mapnik::transform_path_buffer<mapnik::view_transform, mapnik::geometry::line_string_vertex_adapter<double>> path(tr, va, prj_trans);
+        CHECK(read_path(path).size() == 1000);
+    }
+    // the buffers grown for the path went back to the pool
+    mapnik::detail::clip_buffers * buffers = mapnik::detail::acquire_clip_buffers();
+    CHECK(buffers->in.commands.size() >= 1000);
+    mapnik::detail::release_clip_buffers(buffers);
+}
+
+#if defined(MAPNIK_USE_PROJ4)
+SECTION("points that don't project are skipped") {
+
+    // the far side of the globe is not visible in an orthographic projection
+    mapnik::geometry::line_string<double> line;
+    line.emplace_back(-20, 0);
+    line.emplace_back(10, 5);
+    line.emplace_back(120, 5);
+    line.emplace_back(130, 10);
+    line.emplace_back(20, 10);
+    line.emplace_back(30, 15);
+    mapnik::geometry::line_string_vertex_adapter<double> va(line);
+    mapnik::projection ortho("+proj=ortho +lat_0=0 +lon_0=0 +ellps=WGS84");
+    mapnik::projection wgs84("+init=epsg:4326");
+    mapnik::proj_transform prj_trans(ortho, wgs84);
+    mapnik::view_transform tr(256, 256, mapnik::box2d<double>(-6378137, -6378137, 6378137, 6378137));
+    check_same_path(va, tr, prj_trans);
+
+    mapnik::transform_path_buffer<mapnik::view_transform, mapnik::geometry::line_string_vertex_adapter<double>> path(tr, va, prj_trans);
+    std::vector<vertex_record> result = read_path(path);
+    REQUIRE(result.size() == 4);
+    CHECK(result[0].cmd == mapnik::SEG_MOVETO);
+    CHECK(result[1].cmd == mapnik::SEG_LINETO);
+    CHECK(result[2].cmd == mapnik::SEG_MOVETO);
+    CHECK(result[3].cmd == mapnik::SEG_LINETO);
+}
+#endif
+
+}